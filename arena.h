@@ -0,0 +1,40 @@
+/*
+ * File: arena.h
+ * Description: Declares a chunked bump allocator.
+ * Purpose: Lets the frontend allocate AST nodes, types, child arrays and strings from one
+ *          region per compilation unit and release them all at once.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+typedef struct ArenaChunk ArenaChunk;
+
+typedef struct Arena {
+    ArenaChunk *head;      // Chunk currently being bumped
+    ArenaChunk *first;     // Oldest chunk, kept across resets
+    void *last_alloc;      // Most recent allocation, may be grown in place
+    size_t last_size;
+    size_t total_allocated; // Bytes handed out since the last reset
+} Arena;
+
+Arena *arena_create(void);
+void arena_destroy(Arena *arena);
+
+// Rewind the arena so its first chunk can be reused; later chunks are released
+void arena_reset(Arena *arena);
+
+// Zero-filled, suitably aligned memory that lives until the arena is reset
+void *arena_alloc(Arena *arena, size_t size);
+
+// Grow an arena allocation; extends in place when ptr is the latest allocation
+void *arena_realloc(Arena *arena, void *ptr, size_t old_size, size_t new_size);
+
+char *arena_strndup(Arena *arena, const char *str, size_t length);
+
+// Takes over every chunk of other, which is freed; its allocations now live as long as arena's
+void arena_adopt(Arena *arena, Arena *other);
+
+#endif // ARENA_H
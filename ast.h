@@ -9,6 +9,8 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include "intern.h"
+#include "type.h"
 
 typedef enum {
     NODE_PROGRAM,
@@ -27,6 +29,8 @@ typedef enum {
     NODE_FOR_STMT,
     NODE_UNARY_OP, // For unary operations like --, ++, etc.
     NODE_FUNCTION_CALL, // For function calls like foo(a, b)
+    NODE_TERNARY, // Conditional expression a ? b : c
+    NODE_STATIC_ASSERT, // static_assert(condition, message); checked and emptied by const_eval
     INVALID_NODE_TYPE,
     UNKNOWN_NODE_TYPE
 } NodeType;
@@ -39,28 +43,16 @@ typedef enum {
     EXPR_UNARY_OP // Unary operation
 } ExprType;
 
-typedef enum {
-    TYPE_INT,
-    TYPE_CHAR,
-    TYPE_VOID,
-    TYPE_POINTER,
-    TYPE_ARRAY
-} TypeKind;
-    
-typedef struct Type {
-    TypeKind kind;
-    struct Type *base; // For pointer/array types
-    size_t array_size; // For array types
-} Type;
-
 typedef union {
-    int int_value;
+    long long int_value;
     void *ptr_value;
 } LiteralValue;
 
+struct Arena;
+
 typedef struct ASTNode {
     NodeType type;
-    char *temp_var; // Temporary variable associated with this node
+    Symbol temp_var; // Temporary variable associated with this node (SYMBOL_NONE if unset)
     union {
         // Literal value
         struct {
@@ -84,20 +76,22 @@ typedef struct ASTNode {
         
         // Variable reference
         struct {
-            char *name;
+            Symbol name;
             Type *type;
         } var_ref;
         
         // Variable declaration
         struct {
-            char *name;
+            Symbol name;
             Type *type;
             struct ASTNode *init_value;
+            bool is_constexpr; // Its initializer and every load are literals after const_eval
+            struct ASTNode *array_size; // A size naming constexpr objects, until const_eval sizes the type
         } var_decl;
         
         // Assignment
         struct {
-            char *name;
+            Symbol name;
             struct ASTNode *value;
         } assignment;
 
@@ -124,19 +118,33 @@ typedef struct ASTNode {
         
         // Function declaration
         struct {
-            char *name;
+            Symbol name;
             Type *return_type;
             struct ASTNode *params;
-            struct ASTNode *body;
+            struct ASTNode *body; // NULL while the body is deferred
+            struct DeferredBody *deferred; // Unparsed body of a lazily parsed program; see function_body
         } function_decl;
         
         // Function call
         struct {
-            char *name; // Function name
+            Symbol name; // Function name
             struct ASTNode **args; // Array of argument expressions
             size_t arg_count; // Number of arguments
         } function_call;
 
+        // Conditional expression
+        struct {
+            struct ASTNode *condition;
+            struct ASTNode *then_expr;
+            struct ASTNode *else_expr;
+        } ternary;
+
+        // Static assertion
+        struct {
+            struct ASTNode *condition;
+            struct ASTNode *message; // String literal, NULL when left out
+        } assertion;
+
         // Return statement
         struct {
             struct ASTNode *value;
@@ -153,6 +161,13 @@ typedef struct ASTNode {
             struct ASTNode **stmts;
             size_t count;
         } stmt_list;
+
+        // Program root; shares its leading fields with stmt_list
+        struct {
+            struct ASTNode **stmts;
+            size_t count;
+            struct Arena *arena; // Owns every node in the tree, released by free_ast
+        } program;
         
         // Type specifier
         struct {
@@ -0,0 +1,232 @@
+/*
+ * File: ast_store.c
+ * Description: Implements the structure-of-arrays AST declared in ast_store.h.
+ * Purpose: Builds stores node by node, bottom-up as the parser does, or by copying
+ *          a pointer tree in with one iterative walk.
+ */
+
+#include "ast_store.h"
+#include "parser.h"
+#include "debug.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void *resize(void *array, size_t capacity, size_t element) {
+    void *resized = realloc(array, capacity * element);
+    if (!resized) {
+        LOG_ERROR("Memory allocation failed for AST store");
+        exit(EXIT_FAILURE);
+    }
+    return resized;
+}
+
+// Grows an array to hold needed elements, doubling from 64
+static void *grow(void *array, size_t *capacity, size_t needed, size_t element) {
+    if (needed <= *capacity) return array;
+    size_t new_capacity = *capacity ? *capacity : 64;
+    while (new_capacity < needed) new_capacity *= 2;
+    *capacity = new_capacity;
+    return resize(array, new_capacity, element);
+}
+
+void ast_store_init(ASTStore *store) {
+    memset(store, 0, sizeof(ASTStore));
+    store->strings = arena_create();
+    // Id 0 is AST_NONE: a childless placeholder so real ids start at 1
+    ast_store_add(store, INVALID_NODE_TYPE, NULL, 0);
+    store->type_table = grow(NULL, &store->type_capacity, 1, sizeof(Type *));
+    store->type_table[store->type_count++] = NULL;
+}
+
+void ast_store_free(ASTStore *store) {
+    free(store->kinds);
+    free(store->first_child);
+    free(store->payload);
+    free(store->temps);
+    free(store->children);
+    free(store->values);
+    free(store->literal_types);
+    free(store->names);
+    free(store->name_types);
+    free(store->type_table);
+    arena_destroy(store->strings);
+    memset(store, 0, sizeof(ASTStore));
+}
+
+static ASTId add_node(ASTStore *store, NodeType kind, uint32_t payload, const ASTId *children, size_t count) {
+    if (store->count >= UINT32_MAX || store->child_total + count >= UINT32_MAX) {
+        LOG_ERROR("AST store is out of 32-bit ids");
+        exit(EXIT_FAILURE);
+    }
+    // first_child needs one entry past the last node
+    if (store->count + 2 > store->capacity) {
+        store->capacity = store->capacity ? store->capacity * 2 : 64;
+        store->kinds = resize(store->kinds, store->capacity, sizeof(uint8_t));
+        store->first_child = resize(store->first_child, store->capacity, sizeof(uint32_t));
+        store->payload = resize(store->payload, store->capacity, sizeof(uint32_t));
+        store->temps = resize(store->temps, store->capacity, sizeof(Symbol));
+    }
+    store->children = grow(store->children, &store->child_capacity, store->child_total + count, sizeof(ASTId));
+    if (count) memcpy(store->children + store->child_total, children, count * sizeof(ASTId));
+
+    ASTId id = (ASTId)store->count++;
+    store->kinds[id] = (uint8_t)kind;
+    store->first_child[id] = (uint32_t)store->child_total;
+    store->child_total += count;
+    store->first_child[id + 1] = (uint32_t)store->child_total;
+    store->payload[id] = payload;
+    store->temps[id] = SYMBOL_NONE;
+    return id;
+}
+
+// Types are canonical, so pointer equality finds an earlier entry
+static uint32_t type_index(ASTStore *store, Type *type) {
+    for (size_t i = store->type_count; i-- > 0;) {
+        if (store->type_table[i] == type) return (uint32_t)i;
+    }
+    store->type_table = grow(store->type_table, &store->type_capacity, store->type_count + 1, sizeof(Type *));
+    store->type_table[store->type_count] = type;
+    return (uint32_t)store->type_count++;
+}
+
+ASTId ast_store_add(ASTStore *store, NodeType kind, const ASTId *children, size_t count) {
+    return add_node(store, kind, 0, children, count);
+}
+
+// Appends name and type to the named columns, returning their index
+static uint32_t add_name(ASTStore *store, Symbol name, Type *type) {
+    if (store->named_count == store->named_capacity) {
+        store->named_capacity = store->named_capacity ? store->named_capacity * 2 : 64;
+        store->names = resize(store->names, store->named_capacity, sizeof(Symbol));
+        store->name_types = resize(store->name_types, store->named_capacity, sizeof(uint32_t));
+    }
+    store->names[store->named_count] = name;
+    store->name_types[store->named_count] = type_index(store, type);
+    return (uint32_t)store->named_count++;
+}
+
+ASTId ast_store_add_named(ASTStore *store, NodeType kind, Symbol name, Type *type, const ASTId *children, size_t count) {
+    if (kind == NODE_VAR_DECL) return ast_store_add_var_decl(store, name, type, false, children, count);
+    return add_node(store, kind, add_name(store, name, type), children, count);
+}
+
+ASTId ast_store_add_var_decl(ASTStore *store, Symbol name, Type *type, bool is_constexpr, const ASTId *children, size_t count) {
+    return add_node(store, NODE_VAR_DECL, (add_name(store, name, type) << 1) | is_constexpr, children, count);
+}
+
+ASTId ast_store_add_operator(ASTStore *store, NodeType kind, int op, bool is_prefix, const ASTId *children, size_t count) {
+    uint32_t payload = kind == NODE_UNARY_OP ? ((uint32_t)op << 1) | is_prefix : (uint32_t)op;
+    return add_node(store, kind, payload, children, count);
+}
+
+static ASTId add_literal(ASTStore *store, LiteralValue value, Type *type) {
+    if (store->literal_count == store->literal_capacity) {
+        store->literal_capacity = store->literal_capacity ? store->literal_capacity * 2 : 64;
+        store->values = resize(store->values, store->literal_capacity, sizeof(LiteralValue));
+        store->literal_types = resize(store->literal_types, store->literal_capacity, sizeof(uint32_t));
+    }
+    store->values[store->literal_count] = value;
+    store->literal_types[store->literal_count] = type_index(store, type);
+    return add_node(store, NODE_LITERAL, (uint32_t)store->literal_count++, NULL, 0);
+}
+
+ASTId ast_store_add_literal(ASTStore *store, long long value, Type *type) {
+    return add_literal(store, (LiteralValue){ .int_value = value }, type);
+}
+
+ASTId ast_store_add_string(ASTStore *store, const char *text, Type *type) {
+    char *copy = text ? arena_strndup(store->strings, text, strlen(text)) : NULL;
+    return add_literal(store, (LiteralValue){ .ptr_value = copy }, type);
+}
+
+// Ids of finished subtrees, waiting for their parent to be left
+typedef struct {
+    ASTStore *store;
+    ASTId *ids;
+    size_t count;
+    size_t capacity;
+} TreeCopy;
+
+static void copy_node(ASTNode *node, size_t depth, void *context) {
+    (void)depth;
+    TreeCopy *copy = context;
+    ASTStore *store = copy->store;
+
+    // Entered children are on the stack in slot order; empty slots were passed over
+    size_t slots = ast_child_count(node);
+    size_t present = 0;
+    for (size_t slot = 0; slot < slots; slot++) present += ast_child(node, slot) != NULL;
+    const ASTId *children = copy->ids + copy->count - present;
+    ASTId spread[4];
+    if (present != slots) {
+        // Only fixed-arity nodes, at most a for loop's four slots, have empty ones
+        const ASTId *taken = children;
+        for (size_t slot = 0; slot < slots; slot++) spread[slot] = ast_child(node, slot) ? *taken++ : AST_NONE;
+        children = spread;
+    }
+    copy->count -= present;
+
+    ASTId id;
+    switch (node->type) {
+        case NODE_LITERAL: {
+            const Type *type = node->data.literal.type;
+            // Only string literals keep their value behind ptr_value
+            if (type && type->kind == TYPE_POINTER && node->data.literal.value.ptr_value) {
+                id = ast_store_add_string(store, node->data.literal.value.ptr_value, node->data.literal.type);
+            } else {
+                id = ast_store_add_literal(store, node->data.literal.value.int_value, node->data.literal.type);
+            }
+            break;
+        }
+        case NODE_BINARY_OP:
+            id = ast_store_add_operator(store, node->type, node->data.binary_op.op, false, children, slots);
+            break;
+        case NODE_UNARY_OP:
+            id = ast_store_add_operator(store, node->type, node->data.unary_op.op, node->data.unary_op.is_prefix, children, slots);
+            break;
+        case NODE_FUNCTION_DECL:
+            id = ast_store_add_named(store, node->type, node->data.function_decl.name, node->data.function_decl.return_type, children, slots);
+            break;
+        case NODE_VAR_DECL:
+            id = ast_store_add_var_decl(store, node->data.var_decl.name, node->data.var_decl.type,
+                                        node->data.var_decl.is_constexpr, children, slots);
+            break;
+        case NODE_VAR_REF:
+            id = ast_store_add_named(store, node->type, node->data.var_ref.name, node->data.var_ref.type, children, slots);
+            break;
+        case NODE_ASSIGNMENT:
+            id = ast_store_add_named(store, node->type, node->data.assignment.name, NULL, children, slots);
+            break;
+        case NODE_FUNCTION_CALL:
+            id = ast_store_add_named(store, node->type, node->data.function_call.name, NULL, children, slots);
+            break;
+        case NODE_TYPE_SPECIFIER:
+            id = ast_store_add_named(store, node->type, SYMBOL_NONE, node->data.type_spec.type, children, slots);
+            break;
+        default:
+            id = ast_store_add(store, node->type, children, slots);
+            break;
+    }
+    ast_store_set_temp(store, id, node->temp_var);
+
+    copy->ids = grow(copy->ids, &copy->capacity, copy->count + 1, sizeof(ASTId));
+    copy->ids[copy->count++] = id;
+}
+
+ASTId ast_store_add_tree(ASTStore *store, const ASTNode *root) {
+    if (!root) return AST_NONE;
+    TreeCopy copy = { store, NULL, 0, 0 };
+    ast_walk((ASTNode *)root, &(ASTVisitor){ NULL, copy_node, &copy });
+    ASTId id = copy.ids[0];
+    free(copy.ids);
+    LOG_INFO("Stored %zu nodes in %zu bytes", store->count - 1, ast_store_bytes(store));
+    return id;
+}
+
+size_t ast_store_bytes(const ASTStore *store) {
+    return store->count * (sizeof(uint8_t) + sizeof(uint32_t) * 2 + sizeof(Symbol)) + sizeof(uint32_t) +
+           store->child_total * sizeof(ASTId) +
+           store->literal_count * (sizeof(LiteralValue) + sizeof(uint32_t)) +
+           store->named_count * (sizeof(Symbol) + sizeof(uint32_t)) +
+           store->type_count * sizeof(Type *) + store->strings->total_allocated;
+}
@@ -0,0 +1,149 @@
+/*
+ * File: ast_store.h
+ * Description: Declares an index-based, structure-of-arrays AST representation.
+ * Purpose: Holds the same trees as ASTNode in flat arrays addressed by 32-bit ids,
+ *          so a node costs a few bytes per column instead of a full tagged union and
+ *          whole-tree passes become linear scans over contiguous memory.
+ */
+
+#ifndef AST_STORE_H
+#define AST_STORE_H
+
+#include "ast.h"
+#include "arena.h"
+#include <stdint.h>
+
+typedef uint32_t ASTId;
+
+#define AST_NONE 0 // No node, as in an empty optional slot; id 0 is never handed out
+
+/*
+ * Nodes are added bottom-up, so every child has a smaller id than its parent and a
+ * scan from 1 to count - 1 visits children first. Adding a node appends its children
+ * to the shared children array, which makes the ranges consecutive: node id owns
+ * children[first_child[id] .. first_child[id + 1]). Slots follow ast_child, with
+ * AST_NONE in empty optional ones. What else a node carries depends on its kind:
+ *   literals             payload indexes values and literal_types
+ *   declarations, references, assignments, calls and type specifiers
+ *                        payload indexes names and name_types, shifted left one
+ *                        for variable declarations with is_constexpr in the low bit
+ *   unary and binary operators
+ *                        payload is the operator, shifted left one for unary
+ *                        operators with is_prefix in the low bit
+ * Types are stored as indexes into type_table, where 0 stands for NULL.
+ */
+typedef struct {
+    uint8_t *kinds; // NodeType
+    uint32_t *first_child; // count + 1 entries
+    uint32_t *payload;
+    Symbol *temps; // temp_var
+    size_t count; // Ids in use, including AST_NONE
+    size_t capacity;
+
+    ASTId *children;
+    size_t child_total;
+    size_t child_capacity;
+
+    LiteralValue *values;
+    uint32_t *literal_types;
+    size_t literal_count;
+    size_t literal_capacity;
+
+    Symbol *names;
+    uint32_t *name_types;
+    size_t named_count;
+    size_t named_capacity;
+
+    Type **type_table; // The distinct types in use, a handful per program
+    size_t type_count;
+    size_t type_capacity;
+
+    Arena *strings; // Copies of string literals
+} ASTStore;
+
+void ast_store_init(ASTStore *store);
+void ast_store_free(ASTStore *store);
+
+// Every child must already be in the store; count children are copied in slot order
+ASTId ast_store_add(ASTStore *store, NodeType kind, const ASTId *children, size_t count);
+ASTId ast_store_add_named(ASTStore *store, NodeType kind, Symbol name, Type *type, const ASTId *children, size_t count);
+ASTId ast_store_add_var_decl(ASTStore *store, Symbol name, Type *type, bool is_constexpr, const ASTId *children, size_t count);
+ASTId ast_store_add_operator(ASTStore *store, NodeType kind, int op, bool is_prefix, const ASTId *children, size_t count);
+ASTId ast_store_add_literal(ASTStore *store, long long value, Type *type);
+// Copies text into the store
+ASTId ast_store_add_string(ASTStore *store, const char *text, Type *type);
+
+/*
+ * Copies a pointer tree in; returns the id of root, AST_NONE for NULL. Bodies still
+ * deferred by a lazy parse are left out, as empty body slots.
+ */
+ASTId ast_store_add_tree(ASTStore *store, const ASTNode *root);
+
+// Bytes held by the nodes, ignoring spare capacity; for comparison with the pointer tree
+size_t ast_store_bytes(const ASTStore *store);
+
+static inline NodeType ast_store_kind(const ASTStore *store, ASTId id) {
+    return (NodeType)store->kinds[id];
+}
+
+static inline size_t ast_store_child_count(const ASTStore *store, ASTId id) {
+    return store->first_child[id + 1] - store->first_child[id];
+}
+
+static inline const ASTId *ast_store_children(const ASTStore *store, ASTId id) {
+    return store->children + store->first_child[id];
+}
+
+static inline ASTId ast_store_child(const ASTStore *store, ASTId id, size_t slot) {
+    return store->children[store->first_child[id] + slot];
+}
+
+static inline bool ast_store_is_named(NodeType kind) {
+    return kind == NODE_FUNCTION_DECL || kind == NODE_VAR_DECL || kind == NODE_VAR_REF ||
+           kind == NODE_ASSIGNMENT || kind == NODE_FUNCTION_CALL || kind == NODE_TYPE_SPECIFIER;
+}
+
+// Index into names and name_types of a named kind
+static inline uint32_t ast_store_named_index(const ASTStore *store, ASTId id) {
+    uint32_t payload = store->payload[id];
+    return ast_store_kind(store, id) == NODE_VAR_DECL ? payload >> 1 : payload;
+}
+
+// SYMBOL_NONE for kinds without a name
+static inline Symbol ast_store_name(const ASTStore *store, ASTId id) {
+    return ast_store_is_named(ast_store_kind(store, id)) ? store->names[ast_store_named_index(store, id)] : SYMBOL_NONE;
+}
+
+// A literal's type, a declaration's or reference's type, or a function's return type
+static inline Type *ast_store_type(const ASTStore *store, ASTId id) {
+    NodeType kind = ast_store_kind(store, id);
+    if (kind == NODE_LITERAL) return store->type_table[store->literal_types[store->payload[id]]];
+    return ast_store_is_named(kind) ? store->type_table[store->name_types[ast_store_named_index(store, id)]] : NULL;
+}
+
+static inline bool ast_store_is_constexpr(const ASTStore *store, ASTId id) {
+    return ast_store_kind(store, id) == NODE_VAR_DECL && (store->payload[id] & 1);
+}
+
+static inline LiteralValue ast_store_literal(const ASTStore *store, ASTId id) {
+    return store->values[store->payload[id]];
+}
+
+static inline int ast_store_op(const ASTStore *store, ASTId id) {
+    uint32_t payload = store->payload[id];
+    return ast_store_kind(store, id) == NODE_UNARY_OP ? (int)(payload >> 1) : (int)payload;
+}
+
+static inline bool ast_store_is_prefix(const ASTStore *store, ASTId id) {
+    return ast_store_kind(store, id) == NODE_UNARY_OP && (store->payload[id] & 1);
+}
+
+static inline Symbol ast_store_temp(const ASTStore *store, ASTId id) {
+    return store->temps[id];
+}
+
+static inline void ast_store_set_temp(ASTStore *store, ASTId id, Symbol temp) {
+    store->temps[id] = temp;
+}
+
+#endif // AST_STORE_H
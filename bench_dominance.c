@@ -0,0 +1,119 @@
+/*
+ * File: bench_dominance.c
+ * Description: Times the dominator tree algorithms on large synthetic CFGs.
+ * Purpose: Compares DOM_ITERATIVE against DOM_SEMI_NCA and checks they agree.
+ *          Built by `make bench`; not part of `make test`.
+ */
+
+#include "cfg.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ull;
+
+static uint32_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)rng_state;
+}
+
+/*
+ * A chain of if/else diamonds and loops, shaped like structured code, with a
+ * sprinkling of long back edges and forward skips so the graph is not reducible
+ * to a simple nest. Block i only branches to blocks near it, plus the extras.
+ */
+static CFG *build_synthetic_cfg(size_t block_count) {
+    CFG *cfg = create_cfg();
+    BasicBlock **blocks = malloc(sizeof(BasicBlock *) * block_count);
+    for (size_t i = 0; i < block_count; i++) {
+        blocks[i] = cfg_add_block(cfg, i == 0 ? BLOCK_ENTRY : BLOCK_NORMAL);
+    }
+    cfg->entry = blocks[0];
+    cfg->exit = blocks[block_count - 1];
+
+    size_t i = 0;
+    while (i + 4 < block_count) {
+        switch (next_random() % 4) {
+            case 0: // Diamond: i -> i+1, i+2 -> i+3
+                cfg_add_edge(blocks[i], blocks[i + 1]);
+                cfg_add_edge(blocks[i], blocks[i + 2]);
+                cfg_add_edge(blocks[i + 1], blocks[i + 3]);
+                cfg_add_edge(blocks[i + 2], blocks[i + 3]);
+                i += 3;
+                break;
+            case 1: // Loop: header i+1, body i+2, back edge to the header
+                cfg_add_edge(blocks[i], blocks[i + 1]);
+                cfg_add_edge(blocks[i + 1], blocks[i + 2]);
+                cfg_add_edge(blocks[i + 2], blocks[i + 1]);
+                cfg_add_edge(blocks[i + 1], blocks[i + 3]);
+                i += 3;
+                break;
+            default: // Straight line
+                cfg_add_edge(blocks[i], blocks[i + 1]);
+                i += 1;
+                break;
+        }
+    }
+    for (; i + 1 < block_count; i++) {
+        cfg_add_edge(blocks[i], blocks[i + 1]);
+    }
+
+    // Occasional long-range edges in both directions
+    for (size_t k = 0; k < block_count / 64; k++) {
+        size_t from = next_random() % block_count;
+        size_t span = 1 + next_random() % 256;
+        size_t to = (next_random() & 1) ? (from + span) % block_count : (from >= span ? from - span : 0);
+        if (to != 0) cfg_add_edge(blocks[from], blocks[to]);
+    }
+
+    free(blocks);
+    return cfg;
+}
+
+static double elapsed_ms(struct timespec start, struct timespec end) {
+    return (double)(end.tv_sec - start.tv_sec) * 1e3 + (double)(end.tv_nsec - start.tv_nsec) / 1e6;
+}
+
+static double time_algorithm(CFG *cfg, DominatorAlgorithm algorithm) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    compute_dominator_tree_with(cfg, algorithm);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return elapsed_ms(start, end);
+}
+
+int main(int argc, char **argv) {
+    size_t sizes[] = { 10000, 100000, 1000000 };
+    size_t size_count = sizeof(sizes) / sizeof(sizes[0]);
+    if (argc > 1) {
+        sizes[0] = strtoul(argv[1], NULL, 10);
+        size_count = 1;
+    }
+
+    printf("%10s %14s %14s\n", "blocks", "iterative ms", "semi-nca ms");
+    for (size_t s = 0; s < size_count; s++) {
+        CFG *cfg = build_synthetic_cfg(sizes[s]);
+
+        double iterative = time_algorithm(cfg, DOM_ITERATIVE);
+        BasicBlock **expected = malloc(sizeof(BasicBlock *) * cfg->block_count);
+        for (size_t i = 0; i < cfg->block_count; i++) {
+            expected[i] = cfg->blocks[i]->dominator;
+        }
+
+        double semi_nca = time_algorithm(cfg, DOM_SEMI_NCA);
+        for (size_t i = 0; i < cfg->block_count; i++) {
+            if (cfg->blocks[i]->dominator != expected[i]) {
+                fprintf(stderr, "Dominator mismatch at block %zu of %zu\n", i, sizes[s]);
+                return EXIT_FAILURE;
+            }
+        }
+
+        printf("%10zu %14.2f %14.2f\n", sizes[s], iterative, semi_nca);
+        free(expected);
+        free_cfg(cfg);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,86 @@
+/*
+ * File: bench_lexer.c
+ * Description: Measures lexer throughput on a large synthetic corpus.
+ * Purpose: Reports MB/s for each block-scanner implementation the CPU supports.
+ *          Built by `make bench`; not part of `make test`.
+ */
+
+#include "lexer.h"
+#include "scan.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ull;
+
+static uint32_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)rng_state;
+}
+
+// Header-like declarations and function bodies, with comments, literals and operators mixed in
+static const char *const fragments[] = {
+    "/*\n * Generated declaration block.\n * Describes the layout of the next few entries.\n */\n",
+    "extern int %s_%u(int count, const char *name, unsigned long flags);\n",
+    "static inline int %s_%u(int a, int b) { return (a << 2) + (b >> 1) - a * b / 3 %% 7; }\n",
+    "    if (%s_%u >= 0x7fff && value != 1.5e3f) { total += %s_%u; } // running total\n",
+    "    for (int i = 0; i < 128; i++) { buffer[i] ^= mask | (i & 3); }\n",
+    "    const char *message = \"value out of range: %s_%u\";\n",
+    "#define %s_%u(x) ((x) ? 'y' : '\\n')\n",
+    "\t\t\n\n        \n",
+};
+
+static const char *const names[] = { "alpha", "beta_value", "config", "x", "node_count", "_reserved" };
+
+static char *build_corpus(size_t target, size_t *length) {
+    char *corpus = malloc(target + 256);
+    size_t used = 0;
+    while (used < target) {
+        const char *fragment = fragments[next_random() % (sizeof(fragments) / sizeof(fragments[0]))];
+        const char *name = names[next_random() % (sizeof(names) / sizeof(names[0]))];
+        unsigned number = next_random() % 10000;
+        used += (size_t)snprintf(corpus + used, 256, fragment, name, number, name, number);
+    }
+    corpus[used] = '\0';
+    *length = used;
+    return corpus;
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+int main(int argc, char **argv) {
+    size_t megabytes = argc > 1 ? (size_t)atoi(argv[1]) : 64;
+    size_t length;
+    char *corpus = build_corpus(megabytes << 20, &length);
+
+    const struct { ScanImpl impl; const char *name; } impls[] = {
+        { SCAN_SWAR, "swar" }, { SCAN_SSE2, "sse2" }, { SCAN_AVX2, "avx2" }
+    };
+    printf("%8s %10s %12s %10s\n", "scanner", "tokens", "best ms", "MB/s");
+    for (size_t m = 0; m < sizeof(impls) / sizeof(impls[0]); m++) {
+        if (!scan_select(impls[m].impl)) continue;
+        double best = 0;
+        size_t tokens = 0;
+        for (int run = 0; run < 5; run++) {
+            Lexer lexer;
+            lexer_init(&lexer, corpus);
+            tokens = 0;
+            double start = now_ms();
+            while (next_token(&lexer).type != TOK_EOF) tokens++;
+            double elapsed = now_ms() - start;
+            if (run == 0 || elapsed < best) best = elapsed;
+        }
+        printf("%8s %10zu %12.2f %10.1f\n", impls[m].name, tokens, best, (length / 1048576.0) / (best / 1000.0));
+    }
+
+    free(corpus);
+    return 0;
+}
@@ -0,0 +1,186 @@
+/*
+ * File: bench_parser.c
+ * Description: Measures parser throughput on expression-heavy synthetic functions.
+ * Purpose: Tokenizes the corpus once, then times parse_tokens alone and reports
+ *          tokens per second, serially and on one thread per core. The tree is
+ *          then copied into an ASTStore to compare footprints and the cost of a
+ *          whole-tree pass over pointers and over flat arrays. A second set of inputs, million-term expressions and
+ *          deep nesting, checks that parsing and walking stay off the C stack.
+ *          Built by `make bench`; not part of `make test`.
+ */
+
+#include "ast_store.h"
+#include "lexer.h"
+#include "parser.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ull;
+
+static uint32_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)rng_state;
+}
+
+// Statements dominated by operators, with calls, grouping and unary operators mixed in
+static const char *const statements[] = {
+    "    x = a + b * (c - d) / 3 - e %% 7;\n",
+    "    y = f%u(a, b + 1, c * 2) * -d + !e;\n",
+    "    if (a < b && c != 0 || !d) { z = z + 1; } else { z = z - 1; }\n",
+    "    while (i <= n) i += 1;\n",
+    "    for (int k = 0; k < 10; k++) { s = s + k * k - (k / 2) * 3; }\n",
+    "    t = ((a + 1) * (b + 2) - (c + 3) * (d + 4)) / (e + 5 == 6);\n",
+    "    u = a >= b == c <= d != (e > f);\n",
+    "    return a * b + c * d - e / f %% g + h;\n",
+};
+
+static char *build_corpus(size_t target, size_t *length) {
+    char *corpus = malloc(target + 1024);
+    size_t used = 0;
+    unsigned function = 0;
+    while (used < target) {
+        used += (size_t)snprintf(corpus + used, 128, "int f%u(int a, int b, int c) {\n", function++);
+        for (int i = 0; i < 16; i++) {
+            const char *statement = statements[next_random() % (sizeof(statements) / sizeof(statements[0]))];
+            used += (size_t)snprintf(corpus + used, 256, statement, next_random() % 1000);
+        }
+        used += (size_t)snprintf(corpus + used, 64, "    return 0;\n}\n");
+    }
+    corpus[used] = '\0';
+    *length = used;
+    return corpus;
+}
+
+// int main() { <open x n> middle <close x n> end }
+static char *build_nested(const char *open, const char *middle, const char *close, const char *end, size_t n) {
+    size_t open_length = strlen(open), close_length = strlen(close);
+    char *source = malloc(strlen("int main() {  }") + strlen(middle) + strlen(end) + (open_length + close_length) * n + 1);
+    char *out = source + sprintf(source, "int main() { ");
+    for (size_t i = 0; i < n; i++, out += open_length) memcpy(out, open, open_length);
+    out += sprintf(out, "%s", middle);
+    for (size_t i = 0; i < n; i++, out += close_length) memcpy(out, close, close_length);
+    sprintf(out, "%s }", end);
+    return source;
+}
+
+static ASTWalkAction count_node(ASTNode *node, const ASTNode *parent, size_t slot, size_t depth, void *context) {
+    (void)node, (void)parent, (void)slot, (void)depth;
+    (*(size_t *)context)++;
+    return AST_WALK_CONTINUE;
+}
+
+typedef struct {
+    size_t nodes;
+    size_t list_slots;
+    size_t operators;
+} TreeCensus;
+
+static ASTWalkAction census_node(ASTNode *node, const ASTNode *parent, size_t slot, size_t depth, void *context) {
+    (void)parent, (void)slot, (void)depth;
+    TreeCensus *census = context;
+    census->nodes++;
+    if (node->type == NODE_PROGRAM || node->type == NODE_STMT_LIST || node->type == NODE_PARAM_LIST ||
+        node->type == NODE_FUNCTION_CALL) {
+        census->list_slots += ast_child_count(node);
+    }
+    census->operators += node->type == NODE_BINARY_OP;
+    return AST_WALK_CONTINUE;
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+int main(int argc, char **argv) {
+    size_t megabytes = argc > 1 ? (size_t)atoi(argv[1]) : 16;
+    size_t length;
+    char *corpus = build_corpus(megabytes << 20, &length);
+
+    Lexer lexer;
+    lexer_init(&lexer, corpus);
+    TokenBuffer tokens;
+    token_buffer_init(&tokens);
+    token_buffer_fill(&tokens, &lexer);
+
+    printf("%-10s %10s %12s %12s %10s\n", "", "tokens", "best ms", "Mtokens/s", "MB/s");
+    for (int parallel = 0; parallel < 2; parallel++) {
+        double best = 0;
+        for (int run = 0; run < 5; run++) {
+            double start = now_ms();
+            ASTNode *ast = parallel ? parse_tokens_parallel(&tokens, 0) : parse_tokens(&tokens);
+            double elapsed = now_ms() - start;
+            if (!ast) {
+                fprintf(stderr, "Benchmark corpus failed to parse\n");
+                return 1;
+            }
+            free_ast(ast);
+            if (run == 0 || elapsed < best) best = elapsed;
+        }
+        printf("%-10s %10zu %12.2f %12.1f %10.1f\n", parallel ? "parallel" : "serial", tokens.count, best,
+               tokens.count / 1e3 / best, (length / 1048576.0) / (best / 1000.0));
+    }
+
+    // The same tree as pointer-linked nodes and as a structure of arrays
+    ASTNode *ast = parse_tokens(&tokens);
+    TreeCensus census = { 0, 0, 0 };
+    double start = now_ms();
+    ast_walk(ast, &(ASTVisitor){ census_node, NULL, &census });
+    double walked = now_ms() - start;
+    ASTStore store;
+    ast_store_init(&store);
+    ast_store_add_tree(&store, ast);
+    start = now_ms();
+    size_t operators = 0;
+    for (ASTId id = 1; id < store.count; id++) operators += store.kinds[id] == NODE_BINARY_OP;
+    double scanned = now_ms() - start;
+    if (operators != census.operators) {
+        fprintf(stderr, "AST store disagrees with the tree\n");
+        return 1;
+    }
+    printf("\n%-10s %12s %12s %14s\n", "", "nodes", "MB", "operators ms");
+    printf("%-10s %12zu %12.1f %14.2f\n", "pointers", census.nodes,
+           (census.nodes * sizeof(ASTNode) + census.list_slots * sizeof(ASTNode *)) / 1048576.0, walked);
+    printf("%-10s %12zu %12.1f %14.2f\n", "store", store.count - 1, ast_store_bytes(&store) / 1048576.0, scanned);
+    ast_store_free(&store);
+    free_ast(ast);
+
+    token_buffer_free(&tokens);
+    free(corpus);
+
+    static const struct {
+        const char *name, *open, *middle, *close, *end;
+    } shapes[] = {
+        { "sum chain", "", "x = 1", " + 1", ";" },
+        { "parentheses", "(", "x", ")", ";" },
+        { "assignments", "x = ", "1", "", ";" },
+        { "conditionals", "x ? 1 : ", "2", "", ";" },
+        { "blocks", "{ ", "x = 1;", " }", "" },
+    };
+    printf("\n%-14s %10s %12s %12s\n", "1M deep", "nodes", "parse ms", "walk ms");
+    for (size_t i = 0; i < sizeof(shapes) / sizeof(shapes[0]); i++) {
+        char *source = build_nested(shapes[i].open, shapes[i].middle, shapes[i].close, shapes[i].end, 1000000);
+        Lexer deep_lexer;
+        lexer_init(&deep_lexer, source);
+        double start = now_ms();
+        ASTNode *ast = parse(&deep_lexer);
+        double parsed = now_ms();
+        size_t nodes = 0;
+        ast_walk(ast, &(ASTVisitor){ count_node, NULL, &nodes });
+        double walked = now_ms();
+        if (!ast) {
+            fprintf(stderr, "Deep input '%s' failed to parse\n", shapes[i].name);
+            return 1;
+        }
+        printf("%-14s %10zu %12.2f %12.2f\n", shapes[i].name, nodes, parsed - start, walked - parsed);
+        free_ast(ast);
+        free(source);
+    }
+    return 0;
+}
@@ -0,0 +1,896 @@
+/*
+ * File: cache.c
+ * Description: Implements the on-disk build cache declared in cache.h.
+ * Purpose: Each entry is one file named after its kind and key, written whole and
+ *          renamed into place. A translation unit entry holds the preprocessed
+ *          token stream and the AST encoded as index-linked records: nodes refer to
+ *          each other, to types and to strings by index, never by address, so the
+ *          entry can be mapped anywhere and decoded in one linear pass.
+ */
+
+#include "cache.h"
+#include "arena.h"
+#include "debug.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Bump whenever the layout of an entry, or of anything stored in one, changes
+#define CACHE_FORMAT_VERSION 3
+
+struct BuildCache {
+    char *directory;
+};
+
+/* XXH64 */
+
+#define PRIME64_1 0x9E3779B185EBCA87ull
+#define PRIME64_2 0xC2B2AE3D27D4EB4Full
+#define PRIME64_3 0x165667B19E3779F9ull
+#define PRIME64_4 0x85EBCA77C2B2AE63ull
+#define PRIME64_5 0x27D4EB2F165667C5ull
+
+static inline uint64_t rotl64(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static inline uint64_t read64(const unsigned char *p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof value);
+    return value;
+}
+
+static inline uint64_t hash_round(uint64_t acc, uint64_t input) {
+    acc += input * PRIME64_2;
+    return rotl64(acc, 31) * PRIME64_1;
+}
+
+static inline uint64_t hash_merge(uint64_t acc, uint64_t lane) {
+    acc ^= hash_round(0, lane);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+uint64_t cache_hash(const void *data, size_t length, uint64_t seed) {
+    const unsigned char *p = data;
+    const unsigned char *end = p + length;
+    uint64_t hash;
+
+    if (length >= 32) {
+        uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+        uint64_t v2 = seed + PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME64_1;
+        do {
+            v1 = hash_round(v1, read64(p));
+            v2 = hash_round(v2, read64(p + 8));
+            v3 = hash_round(v3, read64(p + 16));
+            v4 = hash_round(v4, read64(p + 24));
+            p += 32;
+        } while (end - p >= 32);
+        hash = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        hash = hash_merge(hash, v1);
+        hash = hash_merge(hash, v2);
+        hash = hash_merge(hash, v3);
+        hash = hash_merge(hash, v4);
+    } else {
+        hash = seed + PRIME64_5;
+    }
+
+    hash += length;
+    while (end - p >= 8) {
+        hash ^= hash_round(0, read64(p));
+        hash = rotl64(hash, 27) * PRIME64_1 + PRIME64_4;
+        p += 8;
+    }
+    if (end - p >= 4) {
+        uint32_t word;
+        memcpy(&word, p, sizeof word);
+        hash ^= word * PRIME64_1;
+        hash = rotl64(hash, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    while (p < end) {
+        hash ^= *p++ * PRIME64_5;
+        hash = rotl64(hash, 11) * PRIME64_1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= PRIME64_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+/* Raw entries */
+
+BuildCache *build_cache_open(const char *directory) {
+    if (mkdir(directory, 0755) != 0 && errno != EEXIST) {
+        LOG_ERROR("Unable to create cache directory %s: %s", directory, strerror(errno));
+        return NULL;
+    }
+    struct stat info;
+    if (stat(directory, &info) != 0 || !S_ISDIR(info.st_mode)) {
+        LOG_ERROR("Cache path %s is not a directory", directory);
+        return NULL;
+    }
+
+    BuildCache *cache = malloc(sizeof(BuildCache));
+    char *copy = strdup(directory);
+    if (!cache || !copy) {
+        LOG_ERROR("Unable to allocate memory for build cache");
+        exit(EXIT_FAILURE);
+    }
+    cache->directory = copy;
+    return cache;
+}
+
+void build_cache_close(BuildCache *cache) {
+    if (!cache) return;
+    free(cache->directory);
+    free(cache);
+}
+
+size_t cache_align(size_t size) {
+    return (size + 7) & ~(size_t)7;
+}
+
+static void entry_path(const BuildCache *cache, const char *kind, uint64_t key, char *path, size_t size) {
+    snprintf(path, size, "%s/%s-%016llx", cache->directory, kind, (unsigned long long)key);
+}
+
+// A missing or unreadable file is a miss, not an error
+static bool open_quietly(SourceFile *source, const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    bool opened = source_open_fd(source, fd);
+    close(fd);
+    return opened;
+}
+
+bool build_cache_read(BuildCache *cache, const char *kind, uint64_t key, CacheBlob *blob) {
+    char path[4096];
+    entry_path(cache, kind, key, path, sizeof path);
+    if (!open_quietly(&blob->file, path)) return false;
+    blob->data = (const unsigned char *)blob->file.text;
+    blob->size = blob->file.length;
+    return true;
+}
+
+void cache_blob_release(CacheBlob *blob) {
+    source_close(&blob->file);
+    blob->data = NULL;
+    blob->size = 0;
+}
+
+static bool write_all(int fd, const void *data, size_t size) {
+    const char *p = data;
+    while (size > 0) {
+        ssize_t written = write(fd, p, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += written;
+        size -= (size_t)written;
+    }
+    return true;
+}
+
+bool build_cache_write(BuildCache *cache, const char *kind, uint64_t key, const CacheChunk *chunks, size_t count) {
+    static const char padding[8];
+    char path[4096], temporary[4200];
+    entry_path(cache, kind, key, path, sizeof path);
+    snprintf(temporary, sizeof temporary, "%s.%ld.tmp", path, (long)getpid());
+
+    // Another writer holding the same temporary name is producing the same entry
+    int fd = open(temporary, O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        LOG_INFO("Not caching %s: %s", path, strerror(errno));
+        return false;
+    }
+
+    bool ok = true;
+    for (size_t i = 0; i < count && ok; i++) {
+        ok = write_all(fd, chunks[i].data, chunks[i].size) &&
+             write_all(fd, padding, cache_align(chunks[i].size) - chunks[i].size);
+    }
+    ok = close(fd) == 0 && ok;
+    if (ok && rename(temporary, path) == 0) return true;
+
+    LOG_INFO("Unable to write cache entry %s: %s", path, strerror(errno));
+    unlink(temporary);
+    return false;
+}
+
+/* Translation unit entries */
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t dependency_count;
+    uint64_t key;
+    uint32_t string_count;
+    uint32_t type_count;
+    uint32_t node_count;
+    uint32_t child_count;
+    uint64_t string_bytes;
+    uint64_t token_count;
+    uint64_t literal_count;
+    uint64_t text_length; // The NUL after the text is stored too
+} UnitHeader;
+
+static const char unit_magic[8] = "CCOMPTU";
+
+typedef struct {
+    uint64_t hash;
+    uint32_t path;   // String index
+    uint32_t unused;
+} DependencyRecord;
+
+typedef struct {
+    uint32_t kind;
+    uint32_t base;   // Type index + 1 of an earlier record, 0 for none
+    uint64_t array_size;
+} TypeRecord;
+
+#define NODE_RECORD_PREFIX 0x1 // unary_op.is_prefix
+#define NODE_RECORD_STRING 0x2 // Literal held in ptr_value, a string index in value
+#define NODE_RECORD_CONSTEXPR 0x4 // var_decl.is_constexpr
+
+/*
+ * One record per node, in pre-order, so the root is record 0 and every child comes
+ * after its parent. References are index + 1 so that 0 can stand for NULL. A list
+ * (program, statements, parameters, call arguments) keeps its elements contiguous
+ * in the child table: child[0] is the first slot, child[1] the count.
+ */
+typedef struct {
+    uint8_t type;
+    uint8_t flags;
+    uint16_t unused;
+    int32_t op;
+    uint32_t name;     // String index + 1
+    uint32_t temp;     // String index + 1 of temp_var
+    uint32_t type_ref; // Type index + 1
+    uint32_t child[4];
+    uint32_t reserved;
+    int64_t value;
+} NodeRecord;
+
+_Static_assert(sizeof(NodeRecord) == 48, "NodeRecord layout is part of the cache format");
+
+typedef struct {
+    size_t dependencies;
+    size_t string_offsets;
+    size_t strings;
+    size_t types;
+    size_t nodes;
+    size_t children;
+    size_t tokens;
+    size_t literals;
+    size_t text;
+    size_t end;
+} UnitLayout;
+
+// Mirrors the chunks build_cache_store_unit writes, each padded to 8 bytes
+static UnitLayout unit_layout(const UnitHeader *header) {
+    UnitLayout layout;
+    size_t at = cache_align(sizeof(UnitHeader));
+    layout.dependencies = at;
+    at += cache_align(header->dependency_count * sizeof(DependencyRecord));
+    layout.string_offsets = at;
+    at += cache_align((header->string_count + (size_t)1) * sizeof(uint32_t));
+    layout.strings = at;
+    at += cache_align(header->string_bytes);
+    layout.types = at;
+    at += cache_align(header->type_count * sizeof(TypeRecord));
+    layout.nodes = at;
+    at += cache_align(header->node_count * sizeof(NodeRecord));
+    layout.children = at;
+    at += cache_align(header->child_count * sizeof(uint32_t));
+    layout.tokens = at;
+    at += cache_align(header->token_count * sizeof(CompactToken));
+    layout.literals = at;
+    at += cache_align(header->literal_count * sizeof(Literal));
+    layout.text = at;
+    at += cache_align(header->text_length + 1);
+    layout.end = at;
+    return layout;
+}
+
+static const UnitHeader *unit_header(const CacheBlob *blob) {
+    if (blob->size < sizeof(UnitHeader)) return NULL;
+    const UnitHeader *header = (const UnitHeader *)blob->data;
+    if (memcmp(header->magic, unit_magic, sizeof unit_magic) != 0 || header->version != CACHE_FORMAT_VERSION) {
+        return NULL;
+    }
+    // Every element takes at least a byte, so no count can exceed the entry size; this
+    // keeps the layout arithmetic below from overflowing on a damaged entry
+    size_t size = blob->size;
+    if (header->string_bytes > size || header->token_count > size ||
+        header->literal_count > size || header->text_length > size) {
+        return NULL;
+    }
+    if (unit_layout(header).end != size) return NULL;
+    return header;
+}
+
+static const char *string_at(const CacheBlob *blob, const UnitLayout *layout, uint32_t index, size_t *length) {
+    const uint32_t *offsets = (const uint32_t *)(blob->data + layout->string_offsets);
+    *length = offsets[index + 1] - offsets[index];
+    return (const char *)blob->data + layout->strings + offsets[index];
+}
+
+static bool strings_valid(const CacheBlob *blob, const UnitHeader *header, const UnitLayout *layout) {
+    const uint32_t *offsets = (const uint32_t *)(blob->data + layout->string_offsets);
+    if (offsets[0] != 0 || offsets[header->string_count] != header->string_bytes) return false;
+    for (uint32_t i = 0; i < header->string_count; i++) {
+        if (offsets[i] > offsets[i + 1]) return false;
+    }
+    return true;
+}
+
+static bool dependency_unchanged(const char *path, uint64_t hash) {
+    SourceFile source;
+    if (!open_quietly(&source, path)) return false;
+    bool same = cache_hash(source.text, source.length, 0) == hash;
+    source_close(&source);
+    return same;
+}
+
+bool build_cache_open_unit(BuildCache *cache, uint64_t key, CachedUnit *unit) {
+    if (!build_cache_read(cache, "unit", key, &unit->blob)) return false;
+
+    const CacheBlob *blob = &unit->blob;
+    const UnitHeader *header = unit_header(blob);
+    UnitLayout layout;
+    bool valid = header && header->key == key;
+    if (valid) {
+        layout = unit_layout(header);
+        valid = strings_valid(blob, header, &layout) && blob->data[layout.text + header->text_length] == '\0';
+    }
+
+    const DependencyRecord *dependencies = valid ? (const DependencyRecord *)(blob->data + layout.dependencies) : NULL;
+    for (uint32_t i = 0; valid && i < header->dependency_count; i++) {
+        if (dependencies[i].path >= header->string_count) {
+            valid = false;
+            break;
+        }
+        size_t length;
+        const char *path = string_at(blob, &layout, dependencies[i].path, &length);
+        char buffer[4096];
+        if (length >= sizeof buffer) {
+            valid = false;
+            break;
+        }
+        memcpy(buffer, path, length);
+        buffer[length] = '\0';
+        valid = dependency_unchanged(buffer, dependencies[i].hash);
+        if (!valid) {
+            LOG_INFO("Cached unit %016llx is stale: %s changed", (unsigned long long)key, buffer);
+        }
+    }
+
+    if (!valid) {
+        cache_blob_release(&unit->blob);
+        return false;
+    }
+
+    // A read-only view: the parser never writes through its token buffer
+    unit->tokens.source = (const char *)blob->data + layout.text;
+    unit->tokens.tokens = (CompactToken *)(blob->data + layout.tokens);
+    unit->tokens.count = header->token_count;
+    unit->tokens.capacity = header->token_count;
+    unit->tokens.literals = (Literal *)(blob->data + layout.literals);
+    unit->tokens.literal_count = header->literal_count;
+    unit->tokens.literal_capacity = header->literal_count;
+    return true;
+}
+
+void cached_unit_close(CachedUnit *unit) {
+    cache_blob_release(&unit->blob);
+    memset(&unit->tokens, 0, sizeof(unit->tokens));
+}
+
+static Symbol symbol_for(const CacheBlob *blob, const UnitLayout *layout, Symbol *symbols, uint32_t index) {
+    // Each distinct name is interned once, however many nodes use it
+    if (symbols[index] == SYMBOL_NONE) {
+        size_t length;
+        const char *text = string_at(blob, layout, index, &length);
+        symbols[index] = intern(text, length);
+    }
+    return symbols[index];
+}
+
+static bool is_list(NodeType type) {
+    return type == NODE_PROGRAM || type == NODE_STMT_LIST || type == NODE_PARAM_LIST || type == NODE_FUNCTION_CALL;
+}
+
+ASTNode *cached_unit_ast(const CachedUnit *unit) {
+    const CacheBlob *blob = &unit->blob;
+    const UnitHeader *header = (const UnitHeader *)blob->data;
+    UnitLayout layout = unit_layout(header);
+    const TypeRecord *type_records = (const TypeRecord *)(blob->data + layout.types);
+    const NodeRecord *records = (const NodeRecord *)(blob->data + layout.nodes);
+    const uint32_t *children = (const uint32_t *)(blob->data + layout.children);
+    uint32_t node_count = header->node_count;
+
+    if (node_count == 0 || records[0].type != NODE_PROGRAM) return NULL;
+
+    Type **types = malloc((header->type_count + (size_t)1) * sizeof(Type *));
+    Symbol *symbols = calloc(header->string_count + (size_t)1, sizeof(Symbol));
+    if (!types || !symbols) {
+        LOG_ERROR("Unable to allocate memory for cached unit");
+        exit(EXIT_FAILURE);
+    }
+
+    // Types are rebuilt through the canonical constructors, bases first
+    bool valid = true;
+    for (uint32_t i = 0; i < header->type_count && valid; i++) {
+        const TypeRecord *record = &type_records[i];
+        Type *base = record->base > 0 && record->base <= i ? types[record->base - 1] : NULL;
+        switch (record->kind) {
+            case TYPE_INT:
+            case TYPE_CHAR:
+            case TYPE_VOID:
+            case TYPE_UNSIGNED:
+            case TYPE_LONG:
+            case TYPE_UNSIGNED_LONG:
+            case TYPE_LONG_LONG:
+            case TYPE_UNSIGNED_LONG_LONG:
+                types[i] = type_get((TypeKind)record->kind);
+                break;
+            case TYPE_POINTER:
+                valid = base != NULL;
+                types[i] = valid ? type_pointer(base) : NULL;
+                break;
+            case TYPE_ARRAY:
+                valid = base != NULL;
+                types[i] = valid ? type_array(base, (size_t)record->array_size) : NULL;
+                break;
+            default:
+                valid = false;
+                break;
+        }
+    }
+
+    Arena *arena = arena_create();
+    ASTNode *nodes = arena_alloc(arena, node_count * sizeof(ASTNode));
+
+// A child must follow its parent, which rules out cycles in a damaged entry
+#define CHILD(index) ((index) == 0 ? NULL : ((index) > i + 1 && (index) <= node_count ? &nodes[(index) - 1] : (valid = false, NULL)))
+#define SYMBOL(index) ((index) == 0 ? SYMBOL_NONE : (index) <= header->string_count ? symbol_for(blob, &layout, symbols, (index) - 1) : (valid = false, SYMBOL_NONE))
+#define TYPE(index) ((index) == 0 ? NULL : (index) <= header->type_count ? types[(index) - 1] : (valid = false, NULL))
+
+    for (uint32_t i = 0; i < node_count && valid; i++) {
+        const NodeRecord *record = &records[i];
+        ASTNode *node = &nodes[i];
+        node->type = (NodeType)record->type;
+        node->temp_var = SYMBOL(record->temp);
+
+        ASTNode **list = NULL;
+        size_t count = 0;
+        if (is_list(node->type)) {
+            uint32_t first = record->child[0];
+            count = record->child[1];
+            if (first > header->child_count || count > header->child_count - first) {
+                valid = false;
+                break;
+            }
+            list = count ? arena_alloc(arena, count * sizeof(ASTNode *)) : NULL;
+            for (size_t c = 0; c < count; c++) {
+                list[c] = CHILD(children[first + c]);
+            }
+        }
+
+        switch (node->type) {
+            case NODE_PROGRAM:
+                node->data.program.stmts = list;
+                node->data.program.count = count;
+                node->data.program.arena = arena;
+                break;
+            case NODE_STMT_LIST:
+                node->data.stmt_list.stmts = list;
+                node->data.stmt_list.count = count;
+                break;
+            case NODE_PARAM_LIST:
+                node->data.param_list.params = list;
+                node->data.param_list.count = count;
+                break;
+            case NODE_FUNCTION_CALL:
+                node->data.function_call.name = SYMBOL(record->name);
+                node->data.function_call.args = list;
+                node->data.function_call.arg_count = count;
+                break;
+            case NODE_FUNCTION_DECL:
+                node->data.function_decl.name = SYMBOL(record->name);
+                node->data.function_decl.return_type = TYPE(record->type_ref);
+                node->data.function_decl.params = CHILD(record->child[0]);
+                node->data.function_decl.body = CHILD(record->child[1]);
+                node->data.function_decl.deferred = NULL;
+                break;
+            case NODE_VAR_DECL:
+                node->data.var_decl.name = SYMBOL(record->name);
+                node->data.var_decl.type = TYPE(record->type_ref);
+                node->data.var_decl.init_value = CHILD(record->child[0]);
+                node->data.var_decl.is_constexpr = (record->flags & NODE_RECORD_CONSTEXPR) != 0;
+                break;
+            case NODE_VAR_REF:
+                node->data.var_ref.name = SYMBOL(record->name);
+                node->data.var_ref.type = TYPE(record->type_ref);
+                break;
+            case NODE_ASSIGNMENT:
+                node->data.assignment.name = SYMBOL(record->name);
+                node->data.assignment.value = CHILD(record->child[0]);
+                break;
+            case NODE_BINARY_OP:
+                node->data.binary_op.op = record->op;
+                node->data.binary_op.left = CHILD(record->child[0]);
+                node->data.binary_op.right = CHILD(record->child[1]);
+                break;
+            case NODE_UNARY_OP:
+                node->data.unary_op.op = record->op;
+                node->data.unary_op.operand = CHILD(record->child[0]);
+                node->data.unary_op.is_prefix = (record->flags & NODE_RECORD_PREFIX) != 0;
+                break;
+            case NODE_RETURN:
+                node->data.return_stmt.value = CHILD(record->child[0]);
+                break;
+            case NODE_LITERAL:
+                node->data.literal.type = TYPE(record->type_ref);
+                if (record->flags & NODE_RECORD_STRING) {
+                    if (record->value < 0 || (uint64_t)record->value >= header->string_count) {
+                        valid = false;
+                        break;
+                    }
+                    size_t length;
+                    const char *text = string_at(blob, &layout, (uint32_t)record->value, &length);
+                    node->data.literal.value.ptr_value = arena_strndup(arena, text, length);
+                } else {
+                    node->data.literal.value.int_value = record->value;
+                }
+                break;
+            case NODE_TYPE_SPECIFIER:
+                node->data.type_spec.type = TYPE(record->type_ref);
+                break;
+            case NODE_IF_STMT:
+                node->data.if_stmt.condition = CHILD(record->child[0]);
+                node->data.if_stmt.then_branch = CHILD(record->child[1]);
+                node->data.if_stmt.else_branch = CHILD(record->child[2]);
+                break;
+            case NODE_WHILE_STMT:
+                node->data.while_stmt.condition = CHILD(record->child[0]);
+                node->data.while_stmt.body = CHILD(record->child[1]);
+                break;
+            case NODE_STATIC_ASSERT:
+                node->data.assertion.condition = CHILD(record->child[0]);
+                node->data.assertion.message = CHILD(record->child[1]);
+                break;
+            case NODE_TERNARY:
+                node->data.ternary.condition = CHILD(record->child[0]);
+                node->data.ternary.then_expr = CHILD(record->child[1]);
+                node->data.ternary.else_expr = CHILD(record->child[2]);
+                break;
+            case NODE_FOR_STMT:
+                node->data.for_stmt.init = CHILD(record->child[0]);
+                node->data.for_stmt.condition = CHILD(record->child[1]);
+                node->data.for_stmt.update = CHILD(record->child[2]);
+                node->data.for_stmt.body = CHILD(record->child[3]);
+                break;
+            default:
+                valid = false;
+                break;
+        }
+    }
+
+#undef CHILD
+#undef SYMBOL
+#undef TYPE
+
+    free(types);
+    free(symbols);
+    if (!valid) {
+        LOG_INFO("Cached unit %016llx is damaged, ignoring it", (unsigned long long)header->key);
+        arena_destroy(arena);
+        return NULL;
+    }
+    return &nodes[0];
+}
+
+/* Encoding */
+
+typedef struct {
+    NodeRecord *nodes;
+    size_t node_count;
+    size_t node_capacity;
+    uint32_t *children;
+    size_t child_count;
+    size_t child_capacity;
+    TypeRecord *types;
+    const Type **type_keys;   // The canonical type behind each record
+    size_t type_count;
+    size_t type_capacity;
+    size_t type_key_capacity;
+    uint32_t *string_offsets; // string_count + 1 entries once finished
+    size_t string_count;
+    size_t string_capacity;
+    char *string_bytes;
+    size_t string_length;
+    size_t string_bytes_capacity;
+    uint32_t *symbol_strings; // Symbol -> string index + 1
+    size_t symbol_capacity;
+} Encoder;
+
+static void *grow(void *array, size_t *capacity, size_t needed, size_t element) {
+    if (needed <= *capacity) return array;
+    size_t new_capacity = *capacity ? *capacity : 16;
+    while (new_capacity < needed) new_capacity *= 2;
+    void *grown = realloc(array, new_capacity * element);
+    if (!grown) {
+        LOG_ERROR("Unable to allocate memory for cache encoder");
+        exit(EXIT_FAILURE);
+    }
+    *capacity = new_capacity;
+    return grown;
+}
+
+static uint32_t add_string(Encoder *encoder, const char *text, size_t length) {
+    encoder->string_offsets = grow(encoder->string_offsets, &encoder->string_capacity, encoder->string_count + 2, sizeof(uint32_t));
+    encoder->string_bytes = grow(encoder->string_bytes, &encoder->string_bytes_capacity, encoder->string_length + length + 1, 1);
+    memcpy(encoder->string_bytes + encoder->string_length, text, length);
+    encoder->string_offsets[encoder->string_count] = (uint32_t)encoder->string_length;
+    encoder->string_length += length;
+    encoder->string_offsets[encoder->string_count + 1] = (uint32_t)encoder->string_length;
+    return (uint32_t)encoder->string_count++;
+}
+
+static uint32_t encode_symbol(Encoder *encoder, Symbol symbol) {
+    if (symbol == SYMBOL_NONE) return 0;
+    if (symbol >= encoder->symbol_capacity) {
+        size_t old_capacity = encoder->symbol_capacity;
+        encoder->symbol_strings = grow(encoder->symbol_strings, &encoder->symbol_capacity, symbol + (size_t)1, sizeof(uint32_t));
+        memset(encoder->symbol_strings + old_capacity, 0, (encoder->symbol_capacity - old_capacity) * sizeof(uint32_t));
+    }
+    if (encoder->symbol_strings[symbol] == 0) {
+        encoder->symbol_strings[symbol] = add_string(encoder, symbol_name(symbol), symbol_length(symbol)) + 1;
+    }
+    return encoder->symbol_strings[symbol];
+}
+
+static uint32_t encode_type(Encoder *encoder, const Type *type) {
+    if (!type) return 0;
+    // Programs use a handful of distinct types, so a linear search is enough
+    for (size_t i = 0; i < encoder->type_count; i++) {
+        if (encoder->type_keys[i] == type) return (uint32_t)i + 1;
+    }
+    uint32_t base = encode_type(encoder, type->base);
+    encoder->types = grow(encoder->types, &encoder->type_capacity, encoder->type_count + 1, sizeof(TypeRecord));
+    encoder->type_keys = grow(encoder->type_keys, &encoder->type_key_capacity, encoder->type_count + 1, sizeof(Type *));
+    encoder->types[encoder->type_count] = (TypeRecord){ .kind = type->kind, .base = base, .array_size = type->array_size };
+    encoder->type_keys[encoder->type_count] = type;
+    return (uint32_t)++encoder->type_count;
+}
+
+static uint32_t encode_node(Encoder *encoder, const ASTNode *node);
+
+static void encode_list(Encoder *encoder, size_t index, ASTNode *const *items, size_t count) {
+    // Reserve the slots first: the items' own lists are appended while they are encoded
+    size_t first = encoder->child_count;
+    encoder->children = grow(encoder->children, &encoder->child_capacity, first + count, sizeof(uint32_t));
+    encoder->child_count += count;
+    encoder->nodes[index].child[0] = (uint32_t)first;
+    encoder->nodes[index].child[1] = (uint32_t)count;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t child = encode_node(encoder, items[i]);
+        encoder->children[first + i] = child;
+    }
+}
+
+static uint32_t encode_node(Encoder *encoder, const ASTNode *node) {
+    if (!node) return 0;
+    size_t index = encoder->node_count;
+    encoder->nodes = grow(encoder->nodes, &encoder->node_capacity, index + 1, sizeof(NodeRecord));
+    encoder->node_count++;
+    memset(&encoder->nodes[index], 0, sizeof(NodeRecord));
+
+    // Children may grow the record array, so every write goes through the index
+#define RECORD (encoder->nodes[index])
+    RECORD.type = (uint8_t)node->type;
+    RECORD.temp = encode_symbol(encoder, node->temp_var);
+    switch (node->type) {
+        case NODE_PROGRAM:
+            encode_list(encoder, index, node->data.program.stmts, node->data.program.count);
+            break;
+        case NODE_STMT_LIST:
+            encode_list(encoder, index, node->data.stmt_list.stmts, node->data.stmt_list.count);
+            break;
+        case NODE_PARAM_LIST:
+            encode_list(encoder, index, node->data.param_list.params, node->data.param_list.count);
+            break;
+        case NODE_FUNCTION_CALL:
+            RECORD.name = encode_symbol(encoder, node->data.function_call.name);
+            encode_list(encoder, index, node->data.function_call.args, node->data.function_call.arg_count);
+            break;
+        case NODE_FUNCTION_DECL: {
+            RECORD.name = encode_symbol(encoder, node->data.function_decl.name);
+            RECORD.type_ref = encode_type(encoder, node->data.function_decl.return_type);
+            uint32_t params = encode_node(encoder, node->data.function_decl.params);
+            RECORD.child[0] = params;
+            uint32_t body = encode_node(encoder, node->data.function_decl.body);
+            RECORD.child[1] = body;
+            break;
+        }
+        case NODE_VAR_DECL: {
+            RECORD.name = encode_symbol(encoder, node->data.var_decl.name);
+            RECORD.type_ref = encode_type(encoder, node->data.var_decl.type);
+            RECORD.flags = node->data.var_decl.is_constexpr ? NODE_RECORD_CONSTEXPR : 0;
+            uint32_t init = encode_node(encoder, node->data.var_decl.init_value);
+            RECORD.child[0] = init;
+            break;
+        }
+        case NODE_VAR_REF:
+            RECORD.name = encode_symbol(encoder, node->data.var_ref.name);
+            RECORD.type_ref = encode_type(encoder, node->data.var_ref.type);
+            break;
+        case NODE_ASSIGNMENT: {
+            RECORD.name = encode_symbol(encoder, node->data.assignment.name);
+            uint32_t value = encode_node(encoder, node->data.assignment.value);
+            RECORD.child[0] = value;
+            break;
+        }
+        case NODE_BINARY_OP: {
+            RECORD.op = node->data.binary_op.op;
+            uint32_t left = encode_node(encoder, node->data.binary_op.left);
+            RECORD.child[0] = left;
+            uint32_t right = encode_node(encoder, node->data.binary_op.right);
+            RECORD.child[1] = right;
+            break;
+        }
+        case NODE_UNARY_OP: {
+            RECORD.op = node->data.unary_op.op;
+            RECORD.flags = node->data.unary_op.is_prefix ? NODE_RECORD_PREFIX : 0;
+            uint32_t operand = encode_node(encoder, node->data.unary_op.operand);
+            RECORD.child[0] = operand;
+            break;
+        }
+        case NODE_RETURN: {
+            uint32_t value = encode_node(encoder, node->data.return_stmt.value);
+            RECORD.child[0] = value;
+            break;
+        }
+        case NODE_LITERAL: {
+            const Type *type = node->data.literal.type;
+            RECORD.type_ref = encode_type(encoder, type);
+            // Only string literals keep their value behind ptr_value
+            const char *text = node->data.literal.value.ptr_value;
+            if (type && type->kind == TYPE_POINTER && text) {
+                RECORD.flags = NODE_RECORD_STRING;
+                RECORD.value = add_string(encoder, text, strlen(text));
+            } else {
+                RECORD.value = node->data.literal.value.int_value;
+            }
+            break;
+        }
+        case NODE_TYPE_SPECIFIER:
+            RECORD.type_ref = encode_type(encoder, node->data.type_spec.type);
+            break;
+        case NODE_IF_STMT: {
+            uint32_t condition = encode_node(encoder, node->data.if_stmt.condition);
+            RECORD.child[0] = condition;
+            uint32_t then_branch = encode_node(encoder, node->data.if_stmt.then_branch);
+            RECORD.child[1] = then_branch;
+            uint32_t else_branch = encode_node(encoder, node->data.if_stmt.else_branch);
+            RECORD.child[2] = else_branch;
+            break;
+        }
+        case NODE_STATIC_ASSERT: {
+            uint32_t condition = encode_node(encoder, node->data.assertion.condition);
+            RECORD.child[0] = condition;
+            uint32_t message = encode_node(encoder, node->data.assertion.message);
+            RECORD.child[1] = message;
+            break;
+        }
+        case NODE_TERNARY: {
+            uint32_t condition = encode_node(encoder, node->data.ternary.condition);
+            RECORD.child[0] = condition;
+            uint32_t then_expr = encode_node(encoder, node->data.ternary.then_expr);
+            RECORD.child[1] = then_expr;
+            uint32_t else_expr = encode_node(encoder, node->data.ternary.else_expr);
+            RECORD.child[2] = else_expr;
+            break;
+        }
+        case NODE_WHILE_STMT: {
+            uint32_t condition = encode_node(encoder, node->data.while_stmt.condition);
+            RECORD.child[0] = condition;
+            uint32_t body = encode_node(encoder, node->data.while_stmt.body);
+            RECORD.child[1] = body;
+            break;
+        }
+        case NODE_FOR_STMT: {
+            uint32_t init = encode_node(encoder, node->data.for_stmt.init);
+            RECORD.child[0] = init;
+            uint32_t condition = encode_node(encoder, node->data.for_stmt.condition);
+            RECORD.child[1] = condition;
+            uint32_t update = encode_node(encoder, node->data.for_stmt.update);
+            RECORD.child[2] = update;
+            uint32_t body = encode_node(encoder, node->data.for_stmt.body);
+            RECORD.child[3] = body;
+            break;
+        }
+        default:
+            LOG_ERROR("Cannot cache a %d node", (int)node->type);
+            break;
+    }
+#undef RECORD
+    return (uint32_t)index + 1;
+}
+
+static void encoder_free(Encoder *encoder) {
+    free(encoder->nodes);
+    free(encoder->children);
+    free(encoder->types);
+    free(encoder->type_keys);
+    free(encoder->string_offsets);
+    free(encoder->string_bytes);
+    free(encoder->symbol_strings);
+}
+
+bool build_cache_store_unit(BuildCache *cache, uint64_t key, const CacheDependency *dependencies, size_t dependency_count,
+                            const TokenBuffer *tokens, const ASTNode *ast) {
+    if (!ast || ast->type != NODE_PROGRAM) return false;
+
+    Encoder encoder;
+    memset(&encoder, 0, sizeof(encoder));
+    DependencyRecord *records = calloc(dependency_count ? dependency_count : 1, sizeof(DependencyRecord));
+    if (!records) {
+        LOG_ERROR("Unable to allocate memory for cache encoder");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < dependency_count; i++) {
+        records[i].hash = dependencies[i].hash;
+        records[i].path = add_string(&encoder, dependencies[i].path, strlen(dependencies[i].path));
+    }
+    encode_node(&encoder, ast);
+    if (encoder.string_count == 0) {
+        encoder.string_offsets = grow(encoder.string_offsets, &encoder.string_capacity, 1, sizeof(uint32_t));
+        encoder.string_offsets[0] = 0;
+    }
+
+    size_t text_length = strlen(tokens->source);
+    UnitHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, unit_magic, sizeof unit_magic);
+    header.version = CACHE_FORMAT_VERSION;
+    header.dependency_count = (uint32_t)dependency_count;
+    header.key = key;
+    header.string_count = (uint32_t)encoder.string_count;
+    header.type_count = (uint32_t)encoder.type_count;
+    header.node_count = (uint32_t)encoder.node_count;
+    header.child_count = (uint32_t)encoder.child_count;
+    header.string_bytes = encoder.string_length;
+    header.token_count = tokens->count;
+    header.literal_count = tokens->literal_count;
+    header.text_length = text_length;
+
+    CacheChunk chunks[] = {
+        { &header, sizeof(header) },
+        { records, dependency_count * sizeof(DependencyRecord) },
+        { encoder.string_offsets, (encoder.string_count + 1) * sizeof(uint32_t) },
+        { encoder.string_bytes, encoder.string_length },
+        { encoder.types, encoder.type_count * sizeof(TypeRecord) },
+        { encoder.nodes, encoder.node_count * sizeof(NodeRecord) },
+        { encoder.children, encoder.child_count * sizeof(uint32_t) },
+        { tokens->tokens, tokens->count * sizeof(CompactToken) },
+        { tokens->literals, tokens->literal_count * sizeof(Literal) },
+        { tokens->source, text_length + 1 },
+    };
+    bool stored = build_cache_write(cache, "unit", key, chunks, sizeof(chunks) / sizeof(chunks[0]));
+
+    encoder_free(&encoder);
+    free(records);
+    return stored;
+}
@@ -0,0 +1,67 @@
+/*
+ * File: cache.h
+ * Description: Declares the on-disk build cache.
+ * Purpose: Keeps tokenized files and parsed translation units between runs, keyed
+ *          by content hash. Entries are position-independent and read back through
+ *          a read-only mapping, so a hit costs no lexing or parsing.
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "ast.h"
+#include "lexer.h"
+#include "source.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct BuildCache BuildCache;
+
+// A file a translation unit was built from, and the hash of its contents at the time
+typedef struct {
+    const char *path;
+    uint64_t hash;
+} CacheDependency;
+
+// 64-bit content hash (XXH64)
+uint64_t cache_hash(const void *data, size_t length, uint64_t seed);
+
+// Creates the directory if needed; NULL if it cannot be used
+BuildCache *build_cache_open(const char *directory);
+void build_cache_close(BuildCache *cache);
+
+/* Raw entries, stored under a kind and a key */
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+    SourceFile file;
+} CacheBlob;
+
+typedef struct {
+    const void *data;
+    size_t size;
+} CacheChunk;
+
+// Every chunk starts on an 8-byte boundary; cache_align gives the padded size of one
+size_t cache_align(size_t size);
+bool build_cache_read(BuildCache *cache, const char *kind, uint64_t key, CacheBlob *blob);
+void cache_blob_release(CacheBlob *blob);
+// Written to a temporary file and renamed into place, so readers never see half an entry
+bool build_cache_write(BuildCache *cache, const char *kind, uint64_t key, const CacheChunk *chunks, size_t count);
+
+/* Translation units: the preprocessed token stream and the AST */
+typedef struct {
+    CacheBlob blob;
+    TokenBuffer tokens; // Points into the mapping; read it, but never token_buffer_free it
+} CachedUnit;
+
+// False unless the entry exists and every dependency still hashes the same
+bool build_cache_open_unit(BuildCache *cache, uint64_t key, CachedUnit *unit);
+// Decodes a fresh tree, released with free_ast
+ASTNode *cached_unit_ast(const CachedUnit *unit);
+void cached_unit_close(CachedUnit *unit);
+bool build_cache_store_unit(BuildCache *cache, uint64_t key, const CacheDependency *dependencies, size_t dependency_count,
+                            const TokenBuffer *tokens, const ASTNode *ast);
+
+#endif // CACHE_H
@@ -36,6 +36,7 @@ static BasicBlock* create_basic_block(CFG *cfg, BlockType type) {
     block->succ_capacity = 0;
     
     block->dominator = NULL;
+    block->rpo_index = SIZE_MAX;
     block->dom_frontier = NULL;
     block->df_count = 0;
     block->df_capacity = 0;
@@ -44,7 +45,14 @@ static BasicBlock* create_basic_block(CFG *cfg, BlockType type) {
     block->dominated_count = 0;
     block->dominated_capacity = 0;
 
-    block->function_name = NULL; // Initialize function_name to NULL
+    block->function_name = SYMBOL_NONE; // Set for function entry blocks only
+
+    block->tac = NULL;
+    block->tac_count = 0;
+    block->tac_capacity = 0;
+    block->phi_args = NULL;
+    block->phi_arg_count = 0;
+    block->phi_arg_capacity = 0;
 
     block->phi_vars = NULL;
     block->phi_count = 0;
@@ -140,8 +148,13 @@ static void process_statement(CFG *cfg, BasicBlock **current_block, ASTNode *stm
             add_statement(*current_block, stmt);
             break;
 
+        case NODE_TERNARY:
+            // Evaluated in place as an expression statement
+            add_statement(*current_block, stmt);
+            break;
+
         case NODE_FUNCTION_CALL:
-            LOG_INFO("Processing function call: %s", stmt->data.function_call.name);
+            LOG_INFO("Processing function call: %s", symbol_name(stmt->data.function_call.name));
             add_statement(*current_block, stmt);
             break;
             
@@ -248,21 +261,57 @@ static void process_statement(CFG *cfg, BasicBlock **current_block, ASTNode *stm
     }
 }
 
-CFG* ast_to_cfg(ASTNode *ast) {
-    if (!ast || ast->type != NODE_PROGRAM) {
-        LOG_ERROR("Invalid AST root node for CFG construction: type=%s", ast ? node_type_to_string(ast->type) : "NULL");
-        return NULL;
-    }
-
+CFG* create_cfg(void) {
     CFG *cfg = malloc(sizeof(CFG));
     if (!cfg) {
         LOG_ERROR("Unable to allocate memory for CFG");
         return NULL;
     }
 
+    cfg->function_name = SYMBOL_NONE;
+    cfg->entry = NULL;
+    cfg->exit = NULL;
     cfg->blocks = NULL;
     cfg->block_count = 0;
     cfg->block_capacity = 0;
+    cfg->rpo = NULL;
+    cfg->rpo_count = 0;
+    return cfg;
+}
+
+BasicBlock* cfg_add_block(CFG *cfg, BlockType type) {
+    return create_basic_block(cfg, type);
+}
+
+void cfg_add_edge(BasicBlock *from, BasicBlock *to) {
+    add_successor(from, to);
+}
+
+// Lower one function body into cfg, between cfg->entry and cfg->exit
+static void add_function(CFG *cfg, ASTNode *func) {
+    // Create a new block for the function body
+    BasicBlock *func_block = create_basic_block(cfg, BLOCK_NORMAL);
+    func_block->function_name = func->data.function_decl.name;
+    add_successor(cfg->entry, func_block);
+
+    // Process function body
+    BasicBlock *current_block = func_block;
+    process_statement(cfg, &current_block, func->data.function_decl.body);
+
+    // Connect the last block of the function to the exit block
+    if (current_block != cfg->exit) {
+        add_successor(current_block, cfg->exit);
+    }
+}
+
+CFG* ast_to_cfg(ASTNode *ast) {
+    if (!ast || ast->type != NODE_PROGRAM) {
+        LOG_ERROR("Invalid AST root node for CFG construction: type=%s", ast ? node_type_to_string(ast->type) : "NULL");
+        return NULL;
+    }
+
+    CFG *cfg = create_cfg();
+    if (!cfg) return NULL;
 
     // Create entry and exit blocks
     cfg->entry = create_basic_block(cfg, BLOCK_ENTRY);
@@ -273,86 +322,457 @@ CFG* ast_to_cfg(ASTNode *ast) {
     for (size_t i = 0; i < ast->data.stmt_list.count; i++) {
         ASTNode *func = ast->data.stmt_list.stmts[i];
         if (func->type != NODE_FUNCTION_DECL) continue;
+        if (!function_body(func)) {
+            free_cfg(cfg);
+            return NULL;
+        }
+        add_function(cfg, func);
+    }
 
-        // Create a new block for the function body
-        BasicBlock *func_block = create_basic_block(cfg, BLOCK_NORMAL);
-        if (func->data.function_decl.name) {
-            func_block->function_name = strdup(func->data.function_decl.name);
+    return cfg;
+}
+
+CFG* function_to_cfg(ASTNode *func) {
+    if (!func || func->type != NODE_FUNCTION_DECL) {
+        LOG_ERROR("Invalid AST node for function CFG construction: type=%s", func ? node_type_to_string(func->type) : "NULL");
+        return NULL;
+    }
+    // A lazily parsed function is parsed here, on first use
+    if (!function_body(func)) {
+        LOG_ERROR("Body of function %s does not parse", symbol_name(func->data.function_decl.name));
+        return NULL;
+    }
+
+    CFG *cfg = create_cfg();
+    if (!cfg) return NULL;
+
+    cfg->function_name = func->data.function_decl.name;
+    cfg->entry = create_basic_block(cfg, BLOCK_ENTRY);
+    cfg->exit = create_basic_block(cfg, BLOCK_EXIT);
+    add_function(cfg, func);
+
+    LOG_INFO("Created CFG for function %s with %zu blocks", symbol_name(cfg->function_name), cfg->block_count);
+    return cfg;
+}
+
+typedef struct {
+    Symbol name;
+    size_t index; // Position in the program
+} FunctionIndex;
+
+static int compare_function_index(const void *a, const void *b) {
+    Symbol x = ((const FunctionIndex *)a)->name, y = ((const FunctionIndex *)b)->name;
+    return (x > y) - (x < y);
+}
+
+typedef struct {
+    const FunctionIndex *functions;
+    size_t count;
+    bool *reached;
+    size_t *worklist;
+    size_t worklist_count;
+} CallGraphWalk;
+
+static ASTWalkAction note_callee(ASTNode *node, const ASTNode *parent, size_t slot, size_t depth, void *context) {
+    (void)parent, (void)slot, (void)depth;
+    if (node->type != NODE_FUNCTION_CALL) return AST_WALK_CONTINUE;
+    CallGraphWalk *walk = context;
+    FunctionIndex key = { node->data.function_call.name, 0 };
+    const FunctionIndex *callee = bsearch(&key, walk->functions, walk->count, sizeof(FunctionIndex), compare_function_index);
+    if (callee && !walk->reached[callee->index]) {
+        walk->reached[callee->index] = true;
+        walk->worklist[walk->worklist_count++] = callee->index;
+    }
+    return AST_WALK_CONTINUE;
+}
+
+/*
+ * Marks the functions that main reaches through calls, parsing each body as it is
+ * reached; bodies of the rest are never parsed. Without a main every function counts.
+ * False if a reached body does not parse.
+ */
+static bool mark_reachable(ASTNode *ast, bool *reached) {
+    size_t count = ast->data.program.count;
+    FunctionIndex *functions = malloc(sizeof(FunctionIndex) * (count ? count : 1));
+    size_t *worklist = malloc(sizeof(size_t) * (count ? count : 1));
+    if (!functions || !worklist) {
+        LOG_ERROR("Unable to allocate memory for the call graph");
+        exit(EXIT_FAILURE);
+    }
+
+    Symbol main_name = intern_cstr("main");
+    CallGraphWalk walk = { functions, 0, reached, worklist, 0 };
+    for (size_t i = 0; i < count; i++) {
+        ASTNode *func = ast->data.program.stmts[i];
+        reached[i] = false;
+        if (func->type != NODE_FUNCTION_DECL) continue;
+        functions[walk.count++] = (FunctionIndex){ func->data.function_decl.name, i };
+        if (func->data.function_decl.name == main_name) {
+            reached[i] = true;
+            worklist[walk.worklist_count++] = i;
+        }
+    }
+    if (walk.worklist_count == 0) {
+        for (size_t i = 0; i < count; i++) reached[i] = true;
+    } else {
+        qsort(functions, walk.count, sizeof(FunctionIndex), compare_function_index);
+        while (walk.worklist_count > 0) {
+            ASTNode *func = ast->data.program.stmts[worklist[--walk.worklist_count]];
+            ASTNode *body = function_body(func);
+            if (!body) {
+                LOG_ERROR("Body of function %s does not parse", symbol_name(func->data.function_decl.name));
+                free(functions);
+                free(worklist);
+                return false;
+            }
+            ast_walk(body, &(ASTVisitor){ note_callee, NULL, &walk });
         }
-        add_successor(cfg->entry, func_block);
+    }
 
-        // Process function body
-        BasicBlock *current_block = func_block;
-        process_statement(cfg, &current_block, func->data.function_decl.body);
+    free(functions);
+    free(worklist);
+    return true;
+}
 
-        // Connect the last block of the function to the exit block
-        if (current_block != cfg->exit) {
-            add_successor(current_block, cfg->exit);
+static bool has_deferred_bodies(ASTNode *ast) {
+    for (size_t i = 0; i < ast->data.program.count; i++) {
+        ASTNode *func = ast->data.program.stmts[i];
+        if (func->type == NODE_FUNCTION_DECL && func->data.function_decl.deferred) return true;
+    }
+    return false;
+}
+
+Module* ast_to_module(ASTNode *ast) {
+    if (!ast || ast->type != NODE_PROGRAM) {
+        LOG_ERROR("Invalid AST root node for module construction: type=%s", ast ? node_type_to_string(ast->type) : "NULL");
+        return NULL;
+    }
+
+    Module *module = malloc(sizeof(Module));
+    if (!module) {
+        LOG_ERROR("Unable to allocate memory for module");
+        return NULL;
+    }
+    module->functions = NULL;
+    module->function_count = 0;
+    module->function_capacity = 0;
+
+    // A lazily parsed program only pays for the functions it uses
+    bool *reached = NULL;
+    if (has_deferred_bodies(ast)) {
+        reached = malloc(sizeof(bool) * (ast->data.program.count ? ast->data.program.count : 1));
+        if (!reached) {
+            LOG_ERROR("Unable to allocate memory for reachable functions");
+            free(module);
+            return NULL;
+        }
+        if (!mark_reachable(ast, reached)) {
+            free(reached);
+            free(module);
+            return NULL;
         }
     }
 
-    return cfg;
+    for (size_t i = 0; i < ast->data.program.count; i++) {
+        ASTNode *func = ast->data.program.stmts[i];
+        if (func->type != NODE_FUNCTION_DECL) continue;
+        if (reached && !reached[i]) {
+            LOG_INFO("Function %s is never called; its body is not parsed", symbol_name(func->data.function_decl.name));
+            continue;
+        }
+
+        CFG *cfg = function_to_cfg(func);
+        if (!cfg) {
+            free(reached);
+            free_module(module);
+            return NULL;
+        }
+
+        if (module->function_count >= module->function_capacity) {
+            size_t new_capacity = module->function_capacity == 0 ? 4 : module->function_capacity * 2;
+            CFG **new_functions = realloc(module->functions, sizeof(CFG *) * new_capacity);
+            if (!new_functions) {
+                LOG_ERROR("Unable to allocate memory for module functions");
+                free_cfg(cfg);
+                free(reached);
+                free_module(module);
+                return NULL;
+            }
+            module->functions = new_functions;
+            module->function_capacity = new_capacity;
+        }
+        module->functions[module->function_count++] = cfg;
+    }
+
+    free(reached);
+    LOG_INFO("Created module with %zu functions", module->function_count);
+    return module;
 }
 
-// Function to compute the dominator tree for the CFG
-void compute_dominator_tree(CFG *cfg) {
+CFG* module_find_function(Module *module, Symbol name) {
+    if (!module) return NULL;
+    for (size_t i = 0; i < module->function_count; i++) {
+        if (module->functions[i]->function_name == name) return module->functions[i];
+    }
+    return NULL;
+}
+
+void module_for_each(Module *module, void (*pass)(CFG *cfg)) {
+    if (!module || !pass) return;
+    for (size_t i = 0; i < module->function_count; i++) {
+        pass(module->functions[i]);
+    }
+}
+
+void free_module(Module *module) {
+    if (!module) {
+        LOG_ERROR("NULL module pointer");
+        return;
+    }
+    for (size_t i = 0; i < module->function_count; i++) {
+        free_cfg(module->functions[i]);
+    }
+    free(module->functions);
+    free(module);
+}
+
+/*
+ * Reverse postorder numbering. An explicit DFS stack keeps this safe on very
+ * large CFGs; unreachable blocks keep rpo_index == SIZE_MAX and stay out of cfg->rpo.
+ */
+void compute_rpo(CFG *cfg) {
     if (!cfg || !cfg->entry) {
         LOG_ERROR("Invalid CFG or entry block");
         return;
     }
 
-    // Initialize dominators
+    free(cfg->rpo);
+    cfg->rpo = malloc(sizeof(BasicBlock *) * (cfg->block_count ? cfg->block_count : 1));
+    BasicBlock **stack = malloc(sizeof(BasicBlock *) * (cfg->block_count ? cfg->block_count : 1));
+    size_t *next_succ = calloc(cfg->block_count ? cfg->block_count : 1, sizeof(size_t));
+    if (!cfg->rpo || !stack || !next_succ) {
+        LOG_ERROR("Unable to allocate memory for reverse postorder");
+        exit(EXIT_FAILURE);
+    }
+
     for (size_t i = 0; i < cfg->block_count; i++) {
-        cfg->blocks[i]->dominator = NULL;
+        cfg->blocks[i]->rpo_index = SIZE_MAX;
+    }
+
+    // Postorder fills cfg->rpo from the back, so the finished array is already reversed
+    size_t post = cfg->block_count;
+    size_t depth = 0;
+    stack[depth++] = cfg->entry;
+    cfg->entry->rpo_index = 0; // Marks the block as visited until its real number is known
+    while (depth > 0) {
+        BasicBlock *block = stack[depth - 1];
+        if (next_succ[block->id] < block->succ_count) {
+            BasicBlock *succ = block->succs[next_succ[block->id]++];
+            if (succ->rpo_index == SIZE_MAX) {
+                succ->rpo_index = 0;
+                stack[depth++] = succ;
+            }
+            continue;
+        }
+        cfg->rpo[--post] = block;
+        depth--;
+    }
+
+    // Slide the reachable blocks to the front and number them
+    cfg->rpo_count = cfg->block_count - post;
+    memmove(cfg->rpo, cfg->rpo + post, sizeof(BasicBlock *) * cfg->rpo_count);
+    for (size_t i = 0; i < cfg->rpo_count; i++) {
+        cfg->rpo[i]->rpo_index = i;
     }
-    cfg->entry->dominator = cfg->entry; // Entry block dominates itself
+
+    free(stack);
+    free(next_succ);
+    LOG_INFO("Computed reverse postorder: %zu of %zu blocks reachable", cfg->rpo_count, cfg->block_count);
+}
+
+/*
+ * Cooper, Harvey and Kennedy's iterative algorithm. Blocks are visited in
+ * reverse postorder and the intersect step walks the finger with the larger
+ * RPO number up the tree, which is what makes the walk terminate correctly.
+ */
+static void dominators_iterative(CFG *cfg, size_t *idom) {
+    size_t n = cfg->rpo_count;
+    for (size_t i = 0; i < n; i++) {
+        idom[i] = SIZE_MAX;
+    }
+    idom[0] = 0;
 
     bool changed;
     do {
         changed = false;
-
-        for (size_t i = 0; i < cfg->block_count; i++) {
-            BasicBlock *block = cfg->blocks[i];
-            if (block == cfg->entry) continue; // Skip the entry block
-
-            BasicBlock *new_idom = NULL;
+        for (size_t b = 1; b < n; b++) {
+            BasicBlock *block = cfg->rpo[b];
+            size_t new_idom = SIZE_MAX;
             for (size_t j = 0; j < block->pred_count; j++) {
-                BasicBlock *pred = block->preds[j];
-                if (pred->dominator) {
-                    if (!new_idom) {
-                        new_idom = pred;
-                    } else {
-                        // Intersect dominators
-                        BasicBlock *finger1 = pred;
-                        BasicBlock *finger2 = new_idom;
-                        while (finger1 != finger2) {
-                            while (finger1 && finger1->id > finger2->id) {
-                                finger1 = finger1->dominator;
-                            }
-                            while (finger2 && finger2->id > finger1->id) {
-                                finger2 = finger2->dominator;
-                            }
-                        }
-                        new_idom = finger1;
-                    }
+                size_t p = block->preds[j]->rpo_index;
+                if (p == SIZE_MAX || idom[p] == SIZE_MAX) continue;
+                if (new_idom == SIZE_MAX) {
+                    new_idom = p;
+                    continue;
+                }
+                // Intersect dominators
+                size_t finger1 = p;
+                size_t finger2 = new_idom;
+                while (finger1 != finger2) {
+                    while (finger1 > finger2) finger1 = idom[finger1];
+                    while (finger2 > finger1) finger2 = idom[finger2];
                 }
+                new_idom = finger1;
             }
-
-            if (block->dominator != new_idom) {
-                block->dominator = new_idom;
+            if (idom[b] != new_idom) {
+                idom[b] = new_idom;
                 changed = true;
             }
         }
     } while (changed);
+}
+
+/*
+ * Semi-NCA (Georgiadis/Tarjan): Lengauer-Tarjan semidominators with simple
+ * path-compressed linking, then each idom is found as the nearest ancestor of
+ * the DFS parent whose number does not exceed the semidominator. Needs DFS
+ * preorder (cross edges must point to smaller numbers), so it numbers the
+ * blocks itself and translates the result back to RPO indices at the end.
+ */
+static void dominators_semi_nca(CFG *cfg, size_t *idom) {
+    size_t n = cfg->rpo_count;
+    size_t *pre = malloc(sizeof(size_t) * cfg->block_count);     // Preorder number by block id
+    size_t *next_succ = calloc(cfg->block_count, sizeof(size_t));
+    BasicBlock **vertex = malloc(sizeof(BasicBlock *) * n);       // Block by preorder number
+    size_t *parent = malloc(sizeof(size_t) * n);
+    size_t *semi = malloc(sizeof(size_t) * n);
+    size_t *label = malloc(sizeof(size_t) * n);
+    size_t *ancestor = malloc(sizeof(size_t) * n);
+    size_t *dom = malloc(sizeof(size_t) * n);
+    size_t *stack = malloc(sizeof(size_t) * n);
+    if (!pre || !next_succ || !vertex || !parent || !semi || !label || !ancestor || !dom || !stack) {
+        LOG_ERROR("Unable to allocate memory for semi-NCA dominators");
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t i = 0; i < cfg->block_count; i++) {
+        pre[i] = SIZE_MAX;
+    }
+
+    // Preorder DFS recording spanning tree parents
+    size_t count = 0;
+    size_t depth = 0;
+    pre[cfg->entry->id] = count;
+    vertex[count] = cfg->entry;
+    parent[count++] = 0;
+    stack[depth++] = 0;
+    while (depth > 0) {
+        BasicBlock *block = vertex[stack[depth - 1]];
+        if (next_succ[block->id] == block->succ_count) {
+            depth--;
+            continue;
+        }
+        BasicBlock *succ = block->succs[next_succ[block->id]++];
+        if (pre[succ->id] != SIZE_MAX) continue;
+        pre[succ->id] = count;
+        vertex[count] = succ;
+        parent[count] = stack[depth - 1];
+        stack[depth++] = count++;
+    }
+
+    for (size_t v = 0; v < n; v++) {
+        semi[v] = v;
+        label[v] = v;
+        ancestor[v] = SIZE_MAX;
+    }
+
+    // Semidominators, in decreasing preorder; the DFS stack doubles as the compression path
+    for (size_t w = n - 1; w > 0; w--) {
+        BasicBlock *block = vertex[w];
+        for (size_t j = 0; j < block->pred_count; j++) {
+            size_t v = pre[block->preds[j]->id];
+            if (v == SIZE_MAX) continue;
+
+            size_t u = v;
+            if (ancestor[v] != SIZE_MAX) {
+                depth = 0;
+                for (size_t x = v; ancestor[ancestor[x]] != SIZE_MAX; x = ancestor[x]) {
+                    stack[depth++] = x;
+                }
+                while (depth > 0) {
+                    size_t x = stack[--depth];
+                    if (semi[label[ancestor[x]]] < semi[label[x]]) {
+                        label[x] = label[ancestor[x]];
+                    }
+                    ancestor[x] = ancestor[ancestor[x]];
+                }
+                u = label[v];
+            }
+            if (semi[u] < semi[w]) semi[w] = semi[u];
+        }
+        ancestor[w] = parent[w];
+    }
+
+    // Nearest common ancestor pass, in increasing preorder
+    dom[0] = 0;
+    for (size_t w = 1; w < n; w++) {
+        size_t j = parent[w];
+        while (j > semi[w]) j = dom[j];
+        dom[w] = j;
+    }
+
+    for (size_t w = 0; w < n; w++) {
+        idom[vertex[w]->rpo_index] = vertex[dom[w]]->rpo_index;
+    }
+
+    free(pre);
+    free(next_succ);
+    free(vertex);
+    free(parent);
+    free(semi);
+    free(label);
+    free(ancestor);
+    free(dom);
+    free(stack);
+}
+
+// Function to compute the dominator tree for the CFG
+void compute_dominator_tree(CFG *cfg) {
+    compute_dominator_tree_with(cfg, DOM_SEMI_NCA);
+}
+
+void compute_dominator_tree_with(CFG *cfg, DominatorAlgorithm algorithm) {
+    if (!cfg || !cfg->entry) {
+        LOG_ERROR("Invalid CFG or entry block");
+        return;
+    }
+
+    compute_rpo(cfg);
+
+    size_t *idom = malloc(sizeof(size_t) * cfg->rpo_count);
+    if (!idom) {
+        LOG_ERROR("Unable to allocate memory for dominator tree");
+        exit(EXIT_FAILURE);
+    }
+    if (algorithm == DOM_ITERATIVE) {
+        dominators_iterative(cfg, idom);
+    } else {
+        dominators_semi_nca(cfg, idom);
+    }
+
+    // Unreachable blocks have no dominator; the entry block dominates itself
+    for (size_t i = 0; i < cfg->block_count; i++) {
+        BasicBlock *block = cfg->blocks[i];
+        block->dominator = block->rpo_index == SIZE_MAX ? NULL : cfg->rpo[idom[block->rpo_index]];
+    }
+    free(idom);
 
     LOG_INFO("Dominator tree computed successfully");
 
-    // Initialize the dominated array for each block
+    // Reset the dominated array for each block, dropping any earlier tree
     for (size_t i = 0; i < cfg->block_count; i++) {
         BasicBlock *block = cfg->blocks[i];
-        block->dominated = NULL;
         block->dominated_count = 0;
-        block->dominated_capacity = 0;
     }
 
     // Populate the dominated array based on dominator relationships
@@ -388,17 +808,15 @@ void free_cfg(CFG *cfg) {
             free(block->succs);
             free(block->dom_frontier);
             free(block->dominated);
-            if (block->phi_vars) {
-                for (size_t j = 0; j < block->phi_count; ++j) {
-                    free(block->phi_vars[j]);
-                }
-                free(block->phi_vars);
-            }
+            free(block->phi_vars);
+            free(block->tac);
+            free(block->phi_args);
             free(block);
         }
     }
     
     free(cfg->blocks);
+    free(cfg->rpo);
     free(cfg);
 }
 
@@ -439,7 +857,7 @@ void print_ast_node_for_cfg(ASTNode *node, int current_indent_spaces, FILE *stre
             break;
 
         case NODE_VAR_DECL:
-            fprintf(stream, "VarDecl: %s", node->data.var_decl.name);
+            fprintf(stream, "VarDecl: %s", symbol_name(node->data.var_decl.name));
             if (node->data.var_decl.init_value) {
                 newline_indent(current_indent_spaces, stream); // Same indent for Initializer label
                 fprintf(stream, "Initializer:");
@@ -451,7 +869,7 @@ void print_ast_node_for_cfg(ASTNode *node, int current_indent_spaces, FILE *stre
             break;
 
         case NODE_ASSIGNMENT:
-            fprintf(stream, "Assignment: %s", node->data.assignment.name);
+            fprintf(stream, "Assignment: %s", symbol_name(node->data.assignment.name));
             newline_indent(current_indent_spaces, stream); // Same indent for value
             print_ast_node_for_cfg(node->data.assignment.value, current_indent_spaces, stream);
             break;
@@ -490,16 +908,16 @@ void print_ast_node_for_cfg(ASTNode *node, int current_indent_spaces, FILE *stre
                 fprintf(stream, "Literal (pointer): %p\n", node->data.literal.value.ptr_value);
             } else {
                 // Assuming int for simplicity based on expected output
-                fprintf(stream, "Literal: %d\n", node->data.literal.value.int_value);
+                fprintf(stream, "Literal: %lld\n", node->data.literal.value.int_value);
             }
             break;
 
         case NODE_VAR_REF:
-            fprintf(stream, "VarRef: %s\n", node->data.var_ref.name);
+            fprintf(stream, "VarRef: %s\n", symbol_name(node->data.var_ref.name));
             break;
 
         case NODE_FUNCTION_CALL:
-            fprintf(stream, "FunctionCall: %s", node->data.function_call.name);
+            fprintf(stream, "FunctionCall: %s", symbol_name(node->data.function_call.name));
             if (node->data.function_call.arg_count > 0) {
                  newline_indent(current_indent_spaces, stream); // Same indent for Args label
                  fprintf(stream, "Arguments:");
@@ -512,6 +930,22 @@ void print_ast_node_for_cfg(ASTNode *node, int current_indent_spaces, FILE *stre
             }
             break;
 
+        case NODE_TERNARY:
+            fprintf(stream, "Ternary");
+            newline_indent(current_indent_spaces, stream);
+            fprintf(stream, "Condition:");
+            newline_indent(current_indent_spaces + 2, stream);
+            print_ast_node_for_cfg(node->data.ternary.condition, current_indent_spaces + 2, stream);
+            newline_indent(current_indent_spaces, stream);
+            fprintf(stream, "Then:");
+            newline_indent(current_indent_spaces + 2, stream);
+            print_ast_node_for_cfg(node->data.ternary.then_expr, current_indent_spaces + 2, stream);
+            newline_indent(current_indent_spaces, stream);
+            fprintf(stream, "Else:");
+            newline_indent(current_indent_spaces + 2, stream);
+            print_ast_node_for_cfg(node->data.ternary.else_expr, current_indent_spaces + 2, stream);
+            break;
+
         default:
             fprintf(stream, "Unknown node type (%d)\n", node->type);
             break;
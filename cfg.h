@@ -9,13 +9,17 @@
 #define CFG_H
 
 #include "ast.h"
+#include "intern.h"
 #include "debug.h"
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 // Forward declarations to resolve circular dependencies
 struct BasicBlock;
 struct CFG;
+struct TAC;
+struct Operand;
 
 // Structure to represent dominance frontiers
 typedef struct DominanceFrontier {
@@ -51,6 +55,7 @@ typedef struct BasicBlock {
     
     // For dominance calculations
     struct BasicBlock *dominator;
+    size_t rpo_index;   // Position in cfg->rpo, SIZE_MAX if unreachable from the entry
     DominanceFrontier *dom_frontier; // Pointer to the dominance frontier structure
     size_t df_count;
     size_t df_capacity;
@@ -59,23 +64,59 @@ typedef struct BasicBlock {
     size_t dominated_count;       // Number of blocks dominated
     size_t dominated_capacity;    // Capacity of the dominated array
 
-    char *function_name; // Name of the function this block belongs to (set for function entry blocks)
-    struct TAC *tac_head; // Head of TAC list for this block
-    struct TAC *tac_tail; // Tail of TAC list for this block
+    Symbol function_name; // Name of the function this block belongs to (set for function entry blocks)
+    struct TAC *tac;      // Contiguous TAC instructions for this block
+    size_t tac_count;
+    size_t tac_capacity;
+    struct Operand *phi_args; // Phi operands, pred_count slots per phi TAC
+    size_t phi_arg_count;
+    size_t phi_arg_capacity;
     // Phi function tracking (populated by insert_phi_functions)
-    char **phi_vars;
+    Symbol *phi_vars;
     size_t phi_count;
 } BasicBlock;
 
 typedef struct {
+    Symbol function_name; // Function this CFG was built from, SYMBOL_NONE for whole-program CFGs
     BasicBlock *entry;
     BasicBlock *exit;
     BasicBlock **blocks; // the dominance frontier
     size_t block_count;
     size_t block_capacity;
+    BasicBlock **rpo;    // Reachable blocks in reverse postorder (filled by compute_rpo)
+    size_t rpo_count;
 } CFG;
 
-CFG* ast_to_cfg(ASTNode *ast);
+// Algorithms available to compute_dominator_tree_with; both give the same tree
+typedef enum {
+    DOM_ITERATIVE,  // Cooper-Harvey-Kennedy fixed point over reverse postorder
+    DOM_SEMI_NCA    // Semidominators plus nearest common ancestor, near-linear
+} DominatorAlgorithm;
+
+// One CFG per function, each with its own entry and exit blocks
+typedef struct Module {
+    CFG **functions;        // In source order
+    size_t function_count;
+    size_t function_capacity;
+} Module;
+
+/* Iteration: MODULE_FOREACH(module, cfg) visits every function CFG in source order */
+#define MODULE_FOREACH(module, cfg) \
+    for (CFG **cfg##_it = (module)->functions, *cfg; \
+         cfg##_it < (module)->functions + (module)->function_count && (cfg = *cfg##_it, 1); ++cfg##_it)
+
+CFG* ast_to_cfg(ASTNode *ast); // Whole program in one CFG sharing an entry and exit
+CFG* function_to_cfg(ASTNode *func);
+Module* ast_to_module(ASTNode *ast);
+CFG* module_find_function(Module *module, Symbol name);
+void module_for_each(Module *module, void (*pass)(CFG *cfg));
+void free_module(Module *module);
+
+// Builder interface for constructing CFGs directly (tests, benchmarks)
+CFG* create_cfg(void);
+BasicBlock* cfg_add_block(CFG *cfg, BlockType type);
+void cfg_add_edge(BasicBlock *from, BasicBlock *to);
+
 void free_cfg(CFG *cfg);
 void print_cfg(CFG *cfg, FILE *stream);
 void generate_dot_file(CFG *cfg, const char *filename);
@@ -85,8 +126,23 @@ void compute_dominance_frontiers(CFG *cfg);
 void free_dominance_frontiers(CFG *cfg);
 void generate_dominance_frontiers_dot(CFG *cfg, const char *filename);
 void print_dominance_frontiers(CFG *cfg, FILE *stream);
-void compute_dominator_tree(CFG *cfg);
-void insert_phi_functions(CFG *cfg);
+void compute_rpo(CFG *cfg);
+void compute_dominator_tree(CFG *cfg); // Uses DOM_SEMI_NCA
+void compute_dominator_tree_with(CFG *cfg, DominatorAlgorithm algorithm);
+// How many phis insert_phi_functions_with keeps; see dominance.c
+typedef enum {
+    SSA_MINIMAL,     // Every block in the dominance frontier of a definition
+    SSA_SEMI_PRUNED, // Skip variables that are never live across a block boundary
+    SSA_PRUNED       // Only where the variable is live-in
+} SSAMode;
+
+typedef struct {
+    size_t inserted; // Phis placed
+    size_t avoided;  // Phis minimal SSA would have placed but the mode pruned
+} PhiStats;
+
+void insert_phi_functions(CFG *cfg); // SSA_MINIMAL
+void insert_phi_functions_with(CFG *cfg, SSAMode mode, PhiStats *stats);
 
 const char* block_type_to_string(BlockType type);
 
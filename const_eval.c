@@ -0,0 +1,582 @@
+/*
+ * File: const_eval.c
+ * Description: Implements the compile-time evaluator declared in const_eval.h.
+ * Purpose: One post-order walk per function computes, for every expression, its type
+ *          where that is known and its value where it is an integer constant, then
+ *          rewrites sizeof, constexpr loads and static assertions in place.
+ */
+
+#include "const_eval.h"
+#include "parser.h"
+#include "debug.h"
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A name in scope: a parameter or local, and for a constexpr object its value
+typedef struct {
+    Symbol name;
+    Type *type;
+    bool constant;
+    int64_t value;
+} Binding;
+
+// What the walk knows about a node it has left
+typedef struct {
+    Type *type; // NULL where it cannot tell, as for calls
+    bool constant; // An integer constant expression, with value
+    bool derived; // The value comes from sizeof or a constexpr object, so the node is worth replacing
+    int64_t value; // As its type holds it, in 64 bits: sign-extended if signed, zero-extended if not
+    ASTNode *load; // A constexpr object's reference, replaced once its parent shows it is only read
+} Value;
+
+typedef struct {
+    Binding *bindings; // Innermost last, so lookups search from the end
+    size_t binding_count;
+    size_t binding_capacity;
+    size_t *scopes; // binding_count when each open scope was entered
+    size_t scope_count;
+    size_t scope_capacity;
+    Value *values; // One per left node whose parent is still open, in slot order
+    size_t value_count;
+    size_t value_capacity;
+    Symbol function; // Named in diagnostics
+    bool quiet;
+    bool failed;
+    size_t replaced; // Nodes turned into literals
+} Evaluator;
+
+// Doubles an evaluator stack; capacity is in elements
+static void *grow_stack(void *items, size_t *capacity, size_t size) {
+    *capacity = *capacity ? *capacity * 2 : 64;
+    items = realloc(items, size * *capacity);
+    if (!items) {
+        LOG_ERROR("Unable to allocate memory for constant evaluation");
+        exit(EXIT_FAILURE);
+    }
+    return items;
+}
+
+static void fail(Evaluator *e, const char *format, ...) {
+    e->failed = true;
+    if (e->quiet) return;
+    if (e->function != SYMBOL_NONE) {
+        fprintf(stderr, "Error in function %s: ", symbol_name(e->function));
+    } else {
+        fprintf(stderr, "Error: ");
+    }
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+static const Binding *lookup(const Evaluator *e, Symbol name) {
+    for (size_t i = e->binding_count; i-- > 0;) {
+        if (e->bindings[i].name == name) return &e->bindings[i];
+    }
+    return NULL;
+}
+
+static void bind(Evaluator *e, Symbol name, Type *type, bool constant, int64_t value) {
+    if (e->binding_count == e->binding_capacity) {
+        e->bindings = grow_stack(e->bindings, &e->binding_capacity, sizeof(Binding));
+    }
+    e->bindings[e->binding_count++] = (Binding){ name, type, constant, value };
+}
+
+// Integer types by conversion rank; 0 for char, which is promoted before any arithmetic
+static int rank(const Type *type) {
+    switch (type->kind) {
+        case TYPE_INT:
+        case TYPE_UNSIGNED: return 1;
+        case TYPE_LONG:
+        case TYPE_UNSIGNED_LONG: return 2;
+        case TYPE_LONG_LONG:
+        case TYPE_UNSIGNED_LONG_LONG: return 3;
+        default: return 0;
+    }
+}
+
+static bool is_integer(const Type *type) {
+    return type && (type->kind == TYPE_CHAR || rank(type) > 0);
+}
+
+static Type *promote(Type *type) {
+    return type->kind == TYPE_CHAR ? type_get(TYPE_INT) : type;
+}
+
+// The usual arithmetic conversions of two integer operands
+static Type *common_type(Type *a, Type *b) {
+    a = promote(a);
+    b = promote(b);
+    if (type_is_unsigned(a) == type_is_unsigned(b)) return rank(a) >= rank(b) ? a : b;
+    Type *unsigned_type = type_is_unsigned(a) ? a : b;
+    Type *signed_type = unsigned_type == a ? b : a;
+    if (rank(unsigned_type) >= rank(signed_type)) return unsigned_type;
+    if (type_size(signed_type) > type_size(unsigned_type)) return signed_type;
+    return type_get(signed_type->kind == TYPE_LONG ? TYPE_UNSIGNED_LONG : TYPE_UNSIGNED_LONG_LONG);
+}
+
+// The value as an integer type holds it: cut to its width, then extended by its signedness
+static int64_t convert(int64_t value, const Type *type) {
+    if (type->kind == TYPE_CHAR) return (int8_t)value;
+    if (type_size(type) == 8) return value;
+    return type_is_unsigned(type) ? (int64_t)(uint32_t)value : (int64_t)(int32_t)value;
+}
+
+// A char keeps its type as an object, but its loads are promoted to int
+static void make_literal(Evaluator *e, ASTNode *node, Type *type, int64_t value) {
+    node->type = NODE_LITERAL;
+    node->data.literal.value.int_value = value;
+    node->data.literal.type = promote(type);
+    e->replaced++;
+}
+
+static void settle(Evaluator *e, Value *value) {
+    if (value->load) make_literal(e, value->load, value->type, value->value);
+    value->load = NULL;
+}
+
+static bool opens_scope(NodeType kind) {
+    return kind == NODE_FUNCTION_DECL || kind == NODE_STMT_LIST || kind == NODE_FOR_STMT;
+}
+
+static bool is_list(NodeType kind) {
+    return kind == NODE_PROGRAM || kind == NODE_STMT_LIST || kind == NODE_PARAM_LIST || kind == NODE_FUNCTION_CALL;
+}
+
+static bool is_pointer(const Type *type) {
+    return type && (type->kind == TYPE_POINTER || type->kind == TYPE_ARRAY);
+}
+
+static bool is_compound_assignment(int op) {
+    switch (op) {
+        case TOK_PLUS_EQ:
+        case TOK_MINUS_EQ:
+        case TOK_STAR_EQ:
+        case TOK_SLASH_EQ:
+        case TOK_PERCENT_EQ:
+        case TOK_AMP_EQ:
+        case TOK_PIPE_EQ:
+        case TOK_CARET_EQ:
+        case TOK_LSHIFT_EQ:
+        case TOK_RSHIFT_EQ: return true;
+        default: return false;
+    }
+}
+
+// Elements of a string literal's array, terminator included, from its quoted spelling
+static size_t string_length(const char *spelling) {
+    const char *p = strchr(spelling, '"');
+    size_t length = 1;
+    for (p = p ? p + 1 : spelling; *p && *p != '"'; length++) {
+        if (*p++ != '\\') continue;
+        if (*p == 'x') {
+            for (p++; isxdigit((unsigned char)*p); p++) {}
+        } else if (*p >= '0' && *p <= '7') {
+            for (int digits = 0; digits < 3 && *p >= '0' && *p <= '7'; digits++) p++;
+        } else if (*p) {
+            p++;
+        }
+    }
+    return length;
+}
+
+static Value literal_value(const ASTNode *node) {
+    Value value = { node->data.literal.type, false, false, 0, NULL };
+    const Type *type = node->data.literal.type;
+    if (type && type->kind == TYPE_POINTER && node->data.literal.value.ptr_value) {
+        value.type = type_array(type_get(TYPE_CHAR), string_length(node->data.literal.value.ptr_value));
+        return value;
+    }
+    value.constant = is_integer(type);
+    value.value = value.constant ? convert(node->data.literal.value.int_value, type) : 0;
+    return value;
+}
+
+static bool yields_int(int op) {
+    switch (op) {
+        case TOK_EQ_EQ:
+        case TOK_BANG_EQ:
+        case TOK_LT:
+        case TOK_GT:
+        case TOK_LT_EQ:
+        case TOK_GT_EQ:
+        case TOK_AMP_AMP:
+        case TOK_PIPE_PIPE: return true;
+        default: return false;
+    }
+}
+
+/*
+ * Integer arithmetic in type, which the operands have been converted to; a shift's count
+ * keeps its own type. Unsigned arithmetic wraps; what is undefined or implementation-defined
+ * for signed types has no result, as in const_eval_binary.
+ */
+static bool integer_binary(int op, const Type *type, int64_t l, int64_t r, int64_t *result) {
+    bool is_unsigned = type_is_unsigned(type);
+    int64_t width = (int64_t)type_size(type) * 8;
+    uint64_t ul = (uint64_t)l, ur = (uint64_t)r;
+    int64_t value;
+    switch (op) {
+        case TOK_PLUS:
+            if (is_unsigned) value = (int64_t)(ul + ur);
+            else if (__builtin_add_overflow(l, r, &value)) return false;
+            break;
+        case TOK_MINUS:
+            if (is_unsigned) value = (int64_t)(ul - ur);
+            else if (__builtin_sub_overflow(l, r, &value)) return false;
+            break;
+        case TOK_STAR:
+            if (is_unsigned) value = (int64_t)(ul * ur);
+            else if (__builtin_mul_overflow(l, r, &value)) return false;
+            break;
+        case TOK_SLASH:
+        case TOK_PERCENT:
+            if (r == 0 || (!is_unsigned && l == INT64_MIN && r == -1)) return false;
+            if (is_unsigned) value = (int64_t)(op == TOK_SLASH ? ul / ur : ul % ur);
+            else value = op == TOK_SLASH ? l / r : l % r;
+            break;
+        case TOK_LSHIFT:
+            if (r < 0 || r >= width || (!is_unsigned && l < 0)) return false;
+            value = (int64_t)(ul << r);
+            if (!is_unsigned && (value < 0 || ((uint64_t)value >> r) != ul)) return false;
+            break;
+        case TOK_RSHIFT:
+            if (r < 0 || r >= width || (!is_unsigned && l < 0)) return false;
+            value = (int64_t)(ul >> r);
+            break;
+        case TOK_AMP: value = l & r; break;
+        case TOK_PIPE: value = l | r; break;
+        case TOK_CARET: value = l ^ r; break;
+        case TOK_EQ_EQ: *result = l == r; return true;
+        case TOK_BANG_EQ: *result = l != r; return true;
+        case TOK_LT: *result = is_unsigned ? ul < ur : l < r; return true;
+        case TOK_GT: *result = is_unsigned ? ul > ur : l > r; return true;
+        case TOK_LT_EQ: *result = is_unsigned ? ul <= ur : l <= r; return true;
+        case TOK_GT_EQ: *result = is_unsigned ? ul >= ur : l >= r; return true;
+        case TOK_AMP_AMP: *result = l && r; return true;
+        case TOK_PIPE_PIPE: *result = l || r; return true;
+        default: return false;
+    }
+    *result = convert(value, type);
+    return is_unsigned || *result == value; // Signed overflow of an int
+}
+
+// Prefix - + ! ~ on an operand of the promoted type
+static bool integer_unary(int op, const Type *type, int64_t operand, int64_t *result) {
+    int64_t value;
+    switch (op) {
+        case TOK_MINUS:
+            if (type_is_unsigned(type)) value = (int64_t)(0 - (uint64_t)operand);
+            else if (__builtin_sub_overflow((int64_t)0, operand, &value)) return false;
+            break;
+        case TOK_PLUS: value = operand; break;
+        case TOK_BANG: *result = !operand; return true;
+        case TOK_TILDE: value = ~operand; break;
+        default: return false;
+    }
+    *result = convert(value, type);
+    return type_is_unsigned(type) || *result == value;
+}
+
+static Value unary_value(Evaluator *e, const ASTNode *node, Value *operand, bool *keep_loads) {
+    Value result = { type_get(TYPE_INT), false, false, 0, NULL };
+    int op = node->data.unary_op.op;
+    switch (op) {
+        case TOK_KW_SIZEOF: {
+            // The operand is never evaluated, so it need not be constant
+            size_t size = operand->type ? type_size(operand->type) : 0;
+            if (size == 0) {
+                fail(e, "sizeof needs an operand of known, complete type");
+                return result;
+            }
+            result.type = type_get(TYPE_UNSIGNED_LONG); // size_t
+            result.constant = result.derived = true;
+            result.value = (int64_t)size;
+            return result;
+        }
+        case TOK_AMP:
+            *keep_loads = true; // A constexpr object still has an address
+            result.type = operand->type ? type_pointer(operand->type) : NULL;
+            return result;
+        case TOK_STAR:
+            result.type = is_pointer(operand->type) ? operand->type->base : NULL;
+            return result;
+        case TOK_PLUS_PLUS:
+        case TOK_MINUS_MINUS:
+            if (operand->load) {
+                fail(e, "constexpr object '%s' cannot be modified", symbol_name(operand->load->data.var_ref.name));
+            }
+            result.type = operand->type;
+            return result;
+        default:
+            if (!is_integer(operand->type)) return result;
+            if (op != TOK_BANG) result.type = promote(operand->type);
+            result.constant = operand->constant && integer_unary(op, result.type, operand->value, &result.value);
+            result.derived = operand->derived;
+            return result;
+    }
+}
+
+static Value binary_value(Evaluator *e, const ASTNode *node, Value *left, Value *right) {
+    Value result = { type_get(TYPE_INT), false, left->derived || right->derived, 0, NULL };
+    int op = node->data.binary_op.op;
+    if (is_compound_assignment(op)) {
+        if (left->load) {
+            fail(e, "constexpr object '%s' cannot be modified", symbol_name(left->load->data.var_ref.name));
+        }
+        result.type = left->type;
+        return result;
+    }
+    switch (op) {
+        case TOK_PLUS:
+        case TOK_MINUS:
+            // Pointer arithmetic; a difference of pointers is a ptrdiff_t, which has no Type here
+            if (is_pointer(left->type) && is_pointer(right->type)) {
+                result.type = NULL;
+            } else if (is_pointer(left->type)) {
+                result.type = type_pointer(left->type->base);
+            } else if (is_pointer(right->type) && op == TOK_PLUS) {
+                result.type = type_pointer(right->type->base);
+            } else if (!left->type || !right->type) {
+                result.type = NULL;
+            }
+            break;
+        case TOK_COMMA:
+            // Not allowed in a constant expression outside an unevaluated operand
+            result.type = right->type;
+            return result;
+        case TOK_AMP_AMP:
+        case TOK_PIPE_PIPE:
+            // A constant left operand that decides the result leaves the right one unevaluated
+            if (left->constant && (op == TOK_AMP_AMP ? left->value == 0 : left->value != 0)) {
+                result.constant = true;
+                result.value = op == TOK_PIPE_PIPE;
+                result.derived = left->derived;
+                return result;
+            }
+            break;
+        default:
+            break;
+    }
+    if (!is_integer(left->type) || !is_integer(right->type)) return result;
+    // A shift has its left operand's promoted type; anything else converts both operands
+    bool shift = op == TOK_LSHIFT || op == TOK_RSHIFT;
+    Type *type = shift ? promote(left->type) : common_type(left->type, right->type);
+    if (!yields_int(op)) result.type = type;
+    result.constant = left->constant && right->constant &&
+                      integer_binary(op, type, convert(left->value, type),
+                                     shift ? right->value : convert(right->value, type), &result.value);
+    return result;
+}
+
+static Value ternary_value(Value *condition, Value *then_value, Value *else_value) {
+    Value result = { then_value->type ? then_value->type : else_value->type, false, false, 0, NULL };
+    if (is_integer(then_value->type) && is_integer(else_value->type)) {
+        result.type = common_type(then_value->type, else_value->type);
+    }
+    if (condition->constant) {
+        const Value *chosen = condition->value ? then_value : else_value;
+        result.constant = chosen->constant;
+        if (chosen->constant && !is_integer(result.type)) result.type = chosen->type; // The other's type is unknown
+        result.value = chosen->constant ? convert(chosen->value, result.type) : 0;
+        result.derived = condition->derived || chosen->derived;
+    }
+    return result;
+}
+
+static ASTWalkAction enter_node(ASTNode *node, const ASTNode *parent, size_t slot, size_t depth, void *context);
+static void leave_node(ASTNode *node, size_t depth, void *context);
+
+static void declare(Evaluator *e, ASTNode *node, Value *init) {
+    Symbol name = node->data.var_decl.name;
+    Type *type = node->data.var_decl.type;
+    ASTNode *array_size = node->data.var_decl.array_size;
+    if (array_size) {
+        // Left to us by the parser; evaluated here, in the scope of the declaration
+        ast_walk(array_size, &(ASTVisitor){ enter_node, leave_node, e });
+        if (e->failed) return;
+        Value size = e->values[--e->value_count];
+        if (!size.constant || size.value <= 0) {
+            fail(e, "array '%s' needs a positive integer constant expression as its size", symbol_name(name));
+            return;
+        }
+        type = node->data.var_decl.type = type_array(type->base, (size_t)size.value);
+        node->data.var_decl.array_size = NULL;
+    }
+    if (!node->data.var_decl.is_constexpr) {
+        bind(e, name, type, false, 0);
+        return;
+    }
+    if (type->kind != TYPE_INT && type->kind != TYPE_CHAR) {
+        fail(e, "constexpr object '%s' must have int or char type", symbol_name(name));
+        return;
+    }
+    if (!init->constant) {
+        fail(e, "constexpr object '%s' needs an integer constant expression as its initializer", symbol_name(name));
+        return;
+    }
+    // C23 asks for the value to be exactly representable, with no implicit conversion
+    bool above_signed = type_is_unsigned(init->type) && init->value < 0; // Past INT64_MAX
+    if (above_signed || convert(init->value, type) != init->value) {
+        fail(e, type_is_unsigned(init->type) ? "constexpr object '%s' cannot hold %llu" : "constexpr object '%s' cannot hold %lld",
+             symbol_name(name), (long long)init->value);
+        return;
+    }
+    ASTNode *value = node->data.var_decl.init_value;
+    if (value->type != NODE_LITERAL || value->data.literal.type != promote(type)) make_literal(e, value, type, init->value);
+    init->load = NULL;
+    bind(e, name, type, true, init->value);
+}
+
+static void check_assertion(Evaluator *e, ASTNode *node, const Value *condition) {
+    const ASTNode *message = node->data.assertion.message;
+    if (!condition->constant) {
+        fail(e, "static assertion needs an integer constant expression");
+        return;
+    }
+    if (condition->value == 0) {
+        if (message) {
+            fail(e, "static assertion failed: %s", (const char *)message->data.literal.value.ptr_value);
+        } else {
+            fail(e, "static assertion failed");
+        }
+        return;
+    }
+    // Checked, so nothing is left to generate
+    node->type = NODE_STMT_LIST;
+    node->data.stmt_list.stmts = NULL;
+    node->data.stmt_list.count = 0;
+}
+
+static ASTWalkAction enter_node(ASTNode *node, const ASTNode *parent, size_t slot, size_t depth, void *context) {
+    (void)parent;
+    (void)slot;
+    (void)depth;
+    Evaluator *e = context;
+    if (e->failed) return AST_WALK_STOP;
+    if (node->type == NODE_FUNCTION_DECL) e->function = node->data.function_decl.name;
+    if (opens_scope(node->type)) {
+        if (e->scope_count == e->scope_capacity) e->scopes = grow_stack(e->scopes, &e->scope_capacity, sizeof(size_t));
+        e->scopes[e->scope_count++] = e->binding_count;
+    }
+    return AST_WALK_CONTINUE;
+}
+
+static void leave_node(ASTNode *node, size_t depth, void *context) {
+    (void)depth;
+    Evaluator *e = context;
+    if (e->failed) return;
+
+    // Values of the children that were entered, spread over their slots for fixed-arity nodes
+    NodeType kind = node->type;
+    size_t slots = ast_child_count(node);
+    size_t present = 0;
+    for (size_t slot = 0; slot < slots; slot++) present += ast_child(node, slot) != NULL;
+    Value *children = e->values + e->value_count - present;
+    Value absent = { NULL, false, false, 0, NULL };
+    Value *slot_values[4] = { &absent, &absent, &absent, &absent };
+    if (!is_list(kind)) {
+        Value *taken = children;
+        for (size_t slot = 0; slot < slots; slot++) {
+            if (ast_child(node, slot)) slot_values[slot] = taken++;
+        }
+    }
+
+    Value result = { NULL, false, false, 0, NULL };
+    bool keep_loads = false;
+    switch (kind) {
+        case NODE_LITERAL:
+            result = literal_value(node);
+            break;
+        case NODE_TYPE_SPECIFIER:
+            result.type = node->data.type_spec.type;
+            break;
+        case NODE_VAR_REF: {
+            const Binding *binding = lookup(e, node->data.var_ref.name);
+            if (binding) {
+                // The parser's type predates sizes that only evaluation settles
+                node->data.var_ref.type = result.type = binding->type;
+                if (binding->constant) result = (Value){ binding->type, true, true, binding->value, node };
+            }
+            break;
+        }
+        case NODE_UNARY_OP:
+            result = unary_value(e, node, slot_values[0], &keep_loads);
+            break;
+        case NODE_BINARY_OP:
+            result = binary_value(e, node, slot_values[0], slot_values[1]);
+            break;
+        case NODE_TERNARY:
+            result = ternary_value(slot_values[0], slot_values[1], slot_values[2]);
+            break;
+        case NODE_ASSIGNMENT: {
+            const Binding *binding = lookup(e, node->data.assignment.name);
+            if (binding && binding->constant) {
+                fail(e, "constexpr object '%s' cannot be modified", symbol_name(binding->name));
+            }
+            result.type = binding ? binding->type : NULL;
+            break;
+        }
+        case NODE_VAR_DECL:
+            declare(e, node, slot_values[0]);
+            break;
+        case NODE_STATIC_ASSERT:
+            check_assertion(e, node, slot_values[0]);
+            break;
+        case NODE_PARAM_LIST:
+            // Array parameters are pointers, whatever size they were declared with
+            for (size_t i = e->binding_count - node->data.param_list.count; i < e->binding_count; i++) {
+                Type *type = e->bindings[i].type;
+                if (type->kind == TYPE_ARRAY) e->bindings[i].type = type_pointer(type->base);
+            }
+            break;
+        default:
+            break;
+    }
+
+    // An operator whose value came out of compile-time evaluation is replaced whole
+    bool is_operator = kind == NODE_UNARY_OP || kind == NODE_BINARY_OP || kind == NODE_TERNARY;
+    if (is_operator && result.constant && result.derived && !e->failed) {
+        make_literal(e, node, result.type, result.value);
+    } else if (!keep_loads) {
+        for (size_t i = 0; i < present; i++) settle(e, &children[i]);
+    }
+
+    if (opens_scope(kind)) e->binding_count = e->scopes[--e->scope_count];
+    e->value_count -= present;
+    if (e->value_count == e->value_capacity) e->values = grow_stack(e->values, &e->value_capacity, sizeof(Value));
+    e->values[e->value_count++] = result;
+}
+
+// Walks root; the root's value is left in *result when the walk succeeds
+static bool evaluate(ASTNode *root, bool quiet, Value *result) {
+    Evaluator e;
+    memset(&e, 0, sizeof(Evaluator));
+    e.function = SYMBOL_NONE;
+    e.quiet = quiet;
+    ast_walk(root, &(ASTVisitor){ enter_node, leave_node, &e });
+    bool evaluated = !e.failed && e.value_count == 1;
+    if (evaluated && result) *result = e.values[0];
+    LOG_INFO("Constant evaluation replaced %zu nodes with literals", e.replaced);
+    free(e.bindings);
+    free(e.scopes);
+    free(e.values);
+    return evaluated;
+}
+
+bool const_eval(ASTNode *root, bool quiet) {
+    return !root || evaluate(root, quiet, NULL);
+}
+
+bool const_eval_integer(ASTNode *expr, long long *value) {
+    Value result;
+    if (!expr || !evaluate(expr, true, &result) || !result.constant) return false;
+    *value = result.value;
+    return true;
+}
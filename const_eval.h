@@ -0,0 +1,87 @@
+/*
+ * File: const_eval.h
+ * Description: Declares the compile-time evaluator for integer constant expressions.
+ * Purpose: Works out sizeof, C23 constexpr objects and static assertions over the AST,
+ *          and puts literals in place of what it evaluates so no code is generated for it.
+ */
+
+#ifndef CONST_EVAL_H
+#define CONST_EVAL_H
+
+#include "ast.h"
+#include "lexer.h"
+#include <stdint.h>
+
+/*
+ * Evaluates a function, or a file-scope static assertion, in place:
+ *   - every sizeof becomes a literal;
+ *   - a constexpr object's initializer must be an integer constant expression whose
+ *     value its type holds exactly; the initializer and every load of the object become
+ *     literals. The declaration stays, as the object's address may still be taken;
+ *   - static assertions are checked and then emptied into empty statement lists.
+ * Returns false, with a diagnostic unless quiet, when an assertion fails, an expression
+ * that must be constant is not, or a constexpr object is modified.
+ */
+bool const_eval(ASTNode *root, bool quiet);
+
+// Value of an integer constant expression that names no objects, such as an array size
+bool const_eval_integer(ASTNode *expr, long long *value);
+
+/*
+ * int arithmetic as C does it, shared with the parser's folding builder. Operations that
+ * C leaves undefined or implementation-defined (signed overflow, division by zero, shifts
+ * out of range or of negative values) have no result, so they are never folded away.
+ */
+static inline bool const_eval_binary(int op, int32_t left, int32_t right, int32_t *result) {
+    int64_t l = left, r = right, value;
+    switch (op) {
+        case TOK_PLUS: value = l + r; break;
+        case TOK_MINUS: value = l - r; break;
+        case TOK_STAR: value = l * r; break;
+        case TOK_SLASH:
+        case TOK_PERCENT:
+            if (r == 0 || (l == INT32_MIN && r == -1)) return false;
+            value = op == TOK_SLASH ? l / r : l % r; // Both truncate toward zero, as in C
+            break;
+        case TOK_LSHIFT:
+            if (r < 0 || r >= 32 || l < 0) return false;
+            value = l << r;
+            break;
+        case TOK_RSHIFT:
+            if (r < 0 || r >= 32 || l < 0) return false;
+            value = l >> r;
+            break;
+        case TOK_AMP: value = l & r; break;
+        case TOK_PIPE: value = l | r; break;
+        case TOK_CARET: value = l ^ r; break;
+        case TOK_EQ_EQ: value = l == r; break;
+        case TOK_BANG_EQ: value = l != r; break;
+        case TOK_LT: value = l < r; break;
+        case TOK_GT: value = l > r; break;
+        case TOK_LT_EQ: value = l <= r; break;
+        case TOK_GT_EQ: value = l >= r; break;
+        case TOK_AMP_AMP: value = l && r; break;
+        case TOK_PIPE_PIPE: value = l || r; break;
+        case TOK_COMMA: value = r; break;
+        default: return false;
+    }
+    if (value < INT32_MIN || value > INT32_MAX) return false; // Signed overflow
+    *result = (int32_t)value;
+    return true;
+}
+
+// Prefix - + ! ~ on an int
+static inline bool const_eval_unary(int op, int32_t operand, int32_t *result) {
+    switch (op) {
+        case TOK_MINUS:
+            if (operand == INT32_MIN) return false;
+            *result = -operand;
+            return true;
+        case TOK_PLUS: *result = operand; return true;
+        case TOK_BANG: *result = !operand; return true;
+        case TOK_TILDE: *result = ~operand; return true;
+        default: return false;
+    }
+}
+
+#endif // CONST_EVAL_H
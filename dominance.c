@@ -5,9 +5,11 @@
  */
 
 #include "cfg.h" 
+#include "liveness.h"
 #include "debug.h" // Include debug.h for logging macros
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 // Helper function to add a block to a dominance frontier
 static void add_to_dominance_frontier(DominanceFrontier *df, BasicBlock *block) {
@@ -33,55 +35,36 @@ void compute_dominance_frontiers(CFG *cfg) {
 
     for (size_t i = 0; i < cfg->block_count; i++) {
         BasicBlock *block = cfg->blocks[i];
-        block->dom_frontier = malloc(sizeof(DominanceFrontier));
-        if (!block->dom_frontier) {
-            LOG_ERROR("Unable to allocate memory for dominance frontier");
+        if (block->dom_frontier) {
+            block->dom_frontier->count = 0; // Recomputing after the CFG changed
             continue;
         }
-        block->dom_frontier->blocks = NULL;
-        block->dom_frontier->count = 0;
-        block->dom_frontier->capacity = 0;
-
-        LOG_INFO("Computing dominance frontiers for block %zu", block->id);
-
-        // Debugging local dominance frontier computation
-        for (size_t j = 0; j < block->succ_count; j++) {
-            BasicBlock *succ = block->succs[j];
-            if (succ->dominator != block) {
-                LOG_INFO("Adding successor Block%zu to dominance frontier of Block%zu", succ->id, block->id);
-                add_to_dominance_frontier(block->dom_frontier, succ);
-            }
-        }
-
-        // Ensure dominator's dominance frontier is initialized
-        if (block->dominator && !block->dominator->dom_frontier) {
-            block->dominator->dom_frontier = malloc(sizeof(DominanceFrontier));
-            if (!block->dominator->dom_frontier) {
-                LOG_ERROR("Unable to allocate memory for dominator's dominance frontier");
-                continue;
-            }
-            block->dominator->dom_frontier->blocks = NULL;
-            block->dominator->dom_frontier->count = 0;
-            block->dominator->dom_frontier->capacity = 0;
+        block->dom_frontier = calloc(1, sizeof(DominanceFrontier));
+        if (!block->dom_frontier) {
+            LOG_ERROR("Unable to allocate memory for dominance frontier");
+            exit(EXIT_FAILURE);
         }
+    }
 
-        // Debugging upward propagation
-        if (block->dominator) {
-            DominanceFrontier *dom_frontier = block->dominator->dom_frontier;
-            for (size_t j = 0; j < dom_frontier->count; j++) {
-                BasicBlock *df_block = dom_frontier->blocks[j];
-                if (df_block->dominator != block) {
-                    LOG_INFO("Propagating Block%zu to dominance frontier of Block%zu", df_block->id, block->id);
-                    add_to_dominance_frontier(block->dom_frontier, df_block);
+    // Cooper, Harvey & Kennedy: a join point is in the frontier of every block on the
+    // dominator-tree path from each predecessor up to (not including) its idom
+    for (size_t i = 0; i < cfg->block_count; i++) {
+        BasicBlock *block = cfg->blocks[i];
+        if (block->pred_count < 2 || !block->dominator) continue;
+        for (size_t p = 0; p < block->pred_count; p++) {
+            BasicBlock *runner = block->preds[p];
+            if (!runner->dominator) continue; // Unreachable predecessor
+            while (runner != block->dominator) {
+                DominanceFrontier *df = runner->dom_frontier;
+                // Two predecessors can share a path; this block is always the last one added
+                if (df->count == 0 || df->blocks[df->count - 1] != block) {
+                    LOG_DEBUG("Adding Block%zu to dominance frontier of Block%zu", block->id, runner->id);
+                    add_to_dominance_frontier(df, block);
                 }
+                if (runner->dominator == runner) break; // Entry block
+                runner = runner->dominator;
             }
         }
-
-        // Debugging final dominance frontier for the block
-        LOG_INFO("Final dominance frontier for Block%zu:", block->id);
-        for (size_t j = 0; j < block->dom_frontier->count; j++) {
-            LOG_INFO("  Block%zu", block->dom_frontier->blocks[j]->id);
-        }
     }
 }
 
@@ -136,196 +119,175 @@ void generate_dominance_frontiers_dot(CFG *cfg, const char *filename) {
     LOG_INFO("Dominance frontiers DOT file generated: %s", filename);
 }
 
-// Helper to check if a variable already has a phi in a block
-static int has_phi_var(char **block_phi_vars, size_t block_phi_var_count, const char *var) {
-    for (size_t _i = 0; _i < block_phi_var_count; _i++) {
-        if (strcmp(block_phi_vars[_i], var) == 0) return 1;
-    }
-    return 0;
-}
-
 // Helper to add a variable to the phi set for a block
-static void add_phi_var(char ***block_phi_vars, size_t *block_phi_var_count, size_t *block_phi_var_cap, const char *var) {
+static void add_phi_var(Symbol **block_phi_vars, size_t *block_phi_var_count, size_t *block_phi_var_cap, Symbol var) {
     if (*block_phi_var_count == *block_phi_var_cap) {
         size_t new_cap = *block_phi_var_cap ? *block_phi_var_cap * 2 : 4;
-        *block_phi_vars = realloc(*block_phi_vars, new_cap * sizeof(char*));
+        *block_phi_vars = realloc(*block_phi_vars, new_cap * sizeof(Symbol));
         *block_phi_var_cap = new_cap;
     }
-    (*block_phi_vars)[(*block_phi_var_count)++] = strdup(var);
+    (*block_phi_vars)[(*block_phi_var_count)++] = var;
+}
+
+// Returns the variable defined by a CFG statement, or SYMBOL_NONE
+static Symbol stmt_defined_var(ASTNode *stmt) {
+    if (stmt->type == NODE_VAR_DECL) return stmt->data.var_decl.name;
+    if (stmt->type == NODE_ASSIGNMENT) return stmt->data.assignment.name;
+    return SYMBOL_NONE;
 }
 
-// Insert φ-functions into the appropriate blocks based on dominance frontiers
+static int compare_block_ids(const void *a, const void *b) {
+    size_t x = *(const size_t *)a, y = *(const size_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Insert φ-functions into the appropriate blocks based on dominance frontiers (minimal SSA)
 void insert_phi_functions(CFG *cfg) {
-    // --- Ensure phi at loop headers for variables assigned in any predecessor (including loop body) ---
-    for (size_t i = 0; i < cfg->block_count; i++) {
-        BasicBlock *header = cfg->blocks[i];
-        if (header->type == BLOCK_LOOP_HEADER && header->pred_count > 1) {
-            LOG_INFO("[PHI-LOOP] Considering loop header block %zu with %zu preds", header->id, header->pred_count);
-            // Collect all variables assigned in any predecessor
-            char **vars = NULL;
-            size_t vars_count = 0, vars_cap = 0;
-            for (size_t p = 0; p < header->pred_count; ++p) {
-                BasicBlock *pred = header->preds[p];
-                LOG_INFO("[PHI-LOOP]   Pred %zu has %zu stmts", pred->id, pred->stmt_count);
-                for (size_t j = 0; j < pred->stmt_count; ++j) {
-                    ASTNode *stmt = pred->stmts[j];
-                    const char *var_name = NULL;
-                    if (stmt->type == NODE_VAR_DECL) {
-                        var_name = stmt->data.var_decl.name;
-                    } else if (stmt->type == NODE_ASSIGNMENT) {
-                        var_name = stmt->data.assignment.name;
-                    }
-                    if (var_name) {
-                        LOG_INFO("[PHI-LOOP]     Found var assignment: %s", var_name);
-                        int found = 0;
-                        for (size_t k = 0; k < vars_count; ++k) {
-                            if (strcmp(vars[k], var_name) == 0) { found = 1; break; }
-                        }
-                        if (!found) {
-                            if (vars_count == vars_cap) {
-                                size_t new_cap = vars_cap ? vars_cap * 2 : 4;
-                                vars = realloc(vars, new_cap * sizeof(char*));
-                                vars_cap = new_cap;
-                            }
-                            vars[vars_count++] = strdup(var_name);
-                            LOG_INFO("[PHI-LOOP]     Added to phi candidate set: %s", var_name);
-                        }
-                    }
-                }
-            }
-            // Insert phi for each such variable if not already present
-            for (size_t v = 0; v < vars_count; ++v) {
-                LOG_INFO("[PHI-LOOP]   Considering phi for var %s in header %zu", vars[v], header->id);
-                if (!has_phi_var(header->phi_vars, header->phi_count, vars[v])) {
-                    LOG_INFO("[PHI-LOOP]   Inserting phi for var %s in header %zu", vars[v], header->id);
-                    // Add phi for this variable at the loop header
-                    size_t new_count = header->phi_count + 1;
-                    header->phi_vars = realloc(header->phi_vars, new_count * sizeof(char*));
-                    header->phi_vars[header->phi_count] = strdup(vars[v]);
-                    header->phi_count = new_count;
-                } else {
-                    LOG_INFO("[PHI-LOOP]   Phi for var %s already present in header %zu", vars[v], header->id);
-                }
-                free(vars[v]);
-            }
-            free(vars);
-        }
-    }
+    insert_phi_functions_with(cfg, SSA_MINIMAL, NULL);
+}
+
+/*
+ * mode selects how many of the frontier phis are kept:
+ *   SSA_MINIMAL     every frontier block of every definition
+ *   SSA_SEMI_PRUNED only variables read before written in some block
+ *   SSA_PRUNED      only where the variable is live on entry to the block
+ */
+void insert_phi_functions_with(CFG *cfg, SSAMode mode, PhiStats *stats) {
     if (!cfg) return;
+    PhiStats counts = { 0, 0 };
+    size_t block_count = cfg->block_count;
 
     LOG_INFO("Starting phi-function insertion");
 
-    // Track which variables have phi functions in each block
-    // We'll use a dynamic array of variable names per block
-    char ***block_phi_vars = calloc(cfg->block_count, sizeof(char **));
-    size_t *block_phi_var_counts = calloc(cfg->block_count, sizeof(size_t));
-    size_t *block_phi_var_caps = calloc(cfg->block_count, sizeof(size_t));
-
-    // Collect all variables assigned anywhere in the CFG
-    // (This is a simple approach; for large CFGs, use a set)
-    char **all_vars = NULL;
-    size_t all_vars_count = 0, all_vars_cap = 0;
-    for (size_t i = 0; i < cfg->block_count; i++) {
+    // One pass over the statements: number the variables and record each
+    // (variable, defining block) pair once
+    VarIndex vars = { 0 };
+    size_t *last_block = NULL;    // Per variable: last block recorded, + 1
+    size_t *site_vars = NULL, *site_blocks = NULL;
+    size_t site_count = 0, site_capacity = 0;
+    for (size_t i = 0; i < block_count; i++) {
         BasicBlock *block = cfg->blocks[i];
         for (size_t j = 0; j < block->stmt_count; j++) {
-            ASTNode *stmt = block->stmts[j];
-            const char *var_name = NULL;
-            if (stmt->type == NODE_VAR_DECL) {
-                var_name = stmt->data.var_decl.name;
-            } else if (stmt->type == NODE_ASSIGNMENT) {
-                var_name = stmt->data.assignment.name;
+            size_t capacity = vars.capacity;
+            size_t v = var_index_add(&vars, stmt_defined_var(block->stmts[j]));
+            if (v == SIZE_MAX) continue;
+            if (vars.capacity != capacity) {
+                last_block = realloc(last_block, sizeof(size_t) * vars.capacity);
+                for (size_t k = capacity; k < vars.capacity; k++) last_block[k] = 0;
             }
-            if (var_name) {
-                // Add to all_vars if not already present
-                int found = 0;
-                for (size_t k = 0; k < all_vars_count; k++) {
-                    if (strcmp(all_vars[k], var_name) == 0) { found = 1; break; }
-                }
-                if (!found) {
-                    if (all_vars_count == all_vars_cap) {
-                        size_t new_cap = all_vars_cap ? all_vars_cap * 2 : 8;
-                        all_vars = realloc(all_vars, new_cap * sizeof(char*));
-                        all_vars_cap = new_cap;
-                    }
-                    all_vars[all_vars_count++] = strdup(var_name);
+            if (last_block[v] == i + 1) continue;
+            last_block[v] = i + 1;
+            if (site_count == site_capacity) {
+                site_capacity = site_capacity ? site_capacity * 2 : 64;
+                site_vars = realloc(site_vars, sizeof(size_t) * site_capacity);
+                site_blocks = realloc(site_blocks, sizeof(size_t) * site_capacity);
+                if (!site_vars || !site_blocks) {
+                    LOG_ERROR("Unable to allocate memory for definition sites");
+                    exit(EXIT_FAILURE);
                 }
             }
+            site_vars[site_count] = v;
+            site_blocks[site_count++] = i;
         }
     }
 
-    // For each variable, insert phi functions in its dominance frontier blocks
-    for (size_t v = 0; v < all_vars_count; v++) {
-        const char *var = all_vars[v];
-        // 1. Collect all blocks that assign to var
-        int *assign_blocks = calloc(cfg->block_count, sizeof(int));
-        for (size_t i = 0; i < cfg->block_count; i++) {
-            BasicBlock *block = cfg->blocks[i];
-            for (size_t j = 0; j < block->stmt_count; j++) {
-                ASTNode *stmt = block->stmts[j];
-                const char *var_name = NULL;
-                if (stmt->type == NODE_VAR_DECL) {
-                    var_name = stmt->data.var_decl.name;
-                } else if (stmt->type == NODE_ASSIGNMENT) {
-                    var_name = stmt->data.assignment.name;
-                }
-                if (var_name && strcmp(var_name, var) == 0) {
-                    assign_blocks[i] = 1;
-                    break;
+    // Group the sites by variable: defs of v are def_sites[def_start[v] .. def_start[v + 1])
+    size_t *def_start = calloc(vars.count + 1, sizeof(size_t));
+    size_t *def_sites = malloc(sizeof(size_t) * (site_count ? site_count : 1));
+    // Scratch shared by every variable; stamps of v + 1 avoid clearing between variables
+    size_t *has_phi = calloc(block_count ? block_count : 1, sizeof(size_t));
+    size_t *on_worklist = calloc(block_count ? block_count : 1, sizeof(size_t));
+    size_t *worklist = malloc(sizeof(size_t) * (block_count ? block_count : 1));
+    size_t *phi_sites = malloc(sizeof(size_t) * (block_count ? block_count : 1));
+    size_t *phi_caps = calloc(block_count ? block_count : 1, sizeof(size_t));
+    if (!def_start || !def_sites || !has_phi || !on_worklist || !worklist || !phi_sites || !phi_caps) {
+        LOG_ERROR("Unable to allocate memory for phi placement");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t s = 0; s < site_count; s++) def_start[site_vars[s] + 1]++;
+    for (size_t v = 0; v < vars.count; v++) def_start[v + 1] += def_start[v];
+    for (size_t s = 0; s < site_count; s++) def_sites[def_start[site_vars[s]]++] = site_blocks[s];
+    for (size_t v = vars.count; v > 0; v--) def_start[v] = def_start[v - 1];
+    def_start[0] = 0;
+
+    for (size_t i = 0; i < block_count; i++) {
+        BasicBlock *block = cfg->blocks[i];
+        free(block->phi_vars);
+        block->phi_vars = NULL;
+        block->phi_count = 0;
+    }
+
+    Liveness *liveness = mode == SSA_MINIMAL ? NULL : compute_liveness(cfg);
+
+    for (size_t v = 0; v < vars.count; v++) {
+        Symbol var = vars.vars[v];
+        size_t stamp = v + 1;
+        // Semi-pruned: a name never read across a block boundary needs no phis at all
+        bool exposed = mode != SSA_SEMI_PRUNED || is_upward_exposed(liveness, var);
+
+        // Iterated dominance frontier: a phi is itself a definition, so its block
+        // goes back on the worklist
+        size_t work_count = 0, phi_site_count = 0;
+        for (size_t d = def_start[v]; d < def_start[v + 1]; d++) {
+            on_worklist[def_sites[d]] = stamp;
+            worklist[work_count++] = def_sites[d];
+        }
+        while (work_count > 0) {
+            DominanceFrontier *df = cfg->blocks[worklist[--work_count]]->dom_frontier;
+            if (!df) continue;
+            for (size_t j = 0; j < df->count; j++) {
+                size_t y = df->blocks[j]->id;
+                if (has_phi[y] == stamp) continue;
+                has_phi[y] = stamp;
+                phi_sites[phi_site_count++] = y;
+                if (on_worklist[y] != stamp) {
+                    on_worklist[y] = stamp;
+                    worklist[work_count++] = y;
                 }
             }
         }
-        // 2. Build a set of all blocks in the dominance frontier of any assign block (phi_blocks)
-        int *phi_blocks = calloc(cfg->block_count, sizeof(int));
-        for (size_t i = 0; i < cfg->block_count; i++) {
-            if (!assign_blocks[i]) continue;
-            BasicBlock *block = cfg->blocks[i];
-            if (!block->dom_frontier) continue;
-            for (size_t j = 0; j < block->dom_frontier->count; j++) {
-                BasicBlock *df_block = block->dom_frontier->blocks[j];
-                phi_blocks[df_block->id] = 1;
+
+        // Visit the phi blocks in id order so the statement layout does not depend on the worklist
+        qsort(phi_sites, phi_site_count, sizeof(size_t), compare_block_ids);
+
+        for (size_t j = 0; j < phi_site_count; j++) {
+            BasicBlock *df_block = cfg->blocks[phi_sites[j]];
+            if (!exposed || (mode == SSA_PRUNED && !is_live_in(liveness, df_block, var))) {
+                counts.avoided++;
+                continue;
             }
-        }
-        // 3. Insert phi for var in each phi_block (only once)
-        for (size_t i = 0; i < cfg->block_count; i++) {
-            if (!phi_blocks[i]) continue;
-            if (!has_phi_var(block_phi_vars[i], block_phi_var_counts[i], var)) {
-                BasicBlock *df_block = cfg->blocks[i];
-                ASTNode *phi_node = malloc(sizeof(ASTNode));
-                phi_node->type = NODE_VAR_DECL; // Represent φ-function as a variable declaration
-                phi_node->data.var_decl.name = strdup(var);
-                phi_node->data.var_decl.type = NULL;
-                phi_node->data.var_decl.init_value = NULL;
-                if (df_block->stmt_count >= df_block->stmt_capacity) {
-                    size_t new_capacity = df_block->stmt_capacity == 0 ? 8 : df_block->stmt_capacity * 2;
-                    df_block->stmts = realloc(df_block->stmts, sizeof(ASTNode *) * new_capacity);
-                    df_block->stmt_capacity = new_capacity;
-                }
-                // Insert phi at the start, but only once per variable per block
-                for (size_t k = df_block->stmt_count; k > 0; k--) {
-                    df_block->stmts[k] = df_block->stmts[k - 1];
-                }
-                df_block->stmts[0] = phi_node;
-                df_block->stmt_count++;
-                add_phi_var(&block_phi_vars[i], &block_phi_var_counts[i], &block_phi_var_caps[i], var);
-                LOG_INFO("Inserted φ-function for variable %s in block %zu", var, (size_t)i);
+            ASTNode *phi_node = calloc(1, sizeof(ASTNode));
+            phi_node->type = NODE_VAR_DECL; // Represent φ-function as a variable declaration
+            phi_node->data.var_decl.name = var;
+            phi_node->data.var_decl.type = NULL;
+            phi_node->data.var_decl.init_value = NULL;
+            if (df_block->stmt_count >= df_block->stmt_capacity) {
+                size_t new_capacity = df_block->stmt_capacity == 0 ? 8 : df_block->stmt_capacity * 2;
+                df_block->stmts = realloc(df_block->stmts, sizeof(ASTNode *) * new_capacity);
+                df_block->stmt_capacity = new_capacity;
             }
+            memmove(&df_block->stmts[1], &df_block->stmts[0], sizeof(ASTNode *) * df_block->stmt_count);
+            df_block->stmts[0] = phi_node;
+            df_block->stmt_count++;
+            add_phi_var(&df_block->phi_vars, &df_block->phi_count, &phi_caps[df_block->id], var);
+            counts.inserted++;
+            LOG_INFO("Inserted φ-function for variable %s in block %zu", symbol_name(var), df_block->id);
         }
-        free(assign_blocks);
-        free(phi_blocks);
     }
 
-    // Assign phi_vars and phi_count to each block, and free temp structures
-    for (size_t i = 0; i < cfg->block_count; i++) {
-        BasicBlock *block = cfg->blocks[i];
-        block->phi_vars = block_phi_vars[i];
-        block->phi_count = block_phi_var_counts[i];
-        // Do not free block_phi_vars[i] here, now owned by block
-    }
-    free(block_phi_vars);
-    free(block_phi_var_counts);
-    free(block_phi_var_caps);
-    for (size_t i = 0; i < all_vars_count; i++) free(all_vars[i]);
-    free(all_vars);
+    free(last_block);
+    free(site_vars);
+    free(site_blocks);
+    free(def_start);
+    free(def_sites);
+    free(has_phi);
+    free(on_worklist);
+    free(worklist);
+    free(phi_sites);
+    free(phi_caps);
+    var_index_free(&vars);
+    free_liveness(liveness);
 
-    LOG_INFO("Phi-function insertion completed");
-}
\ No newline at end of file
+    if (stats) *stats = counts;
+    LOG_INFO("Phi-function insertion completed: %zu inserted, %zu avoided", counts.inserted, counts.avoided);
+}
@@ -0,0 +1,181 @@
+/*
+ * File: intern.c
+ * Description: Implements the global string interner.
+ * Purpose: Stores one copy of every distinct spelling and hands out dense Symbol IDs for it.
+ */
+
+#include "intern.h"
+#include "debug.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INTERN_CHUNK_SIZE (64 * 1024)
+#define INTERN_INITIAL_SLOTS 1024
+#define INTERN_PAGE_SHIFT 12
+#define INTERN_PAGE_SIZE ((size_t)1 << INTERN_PAGE_SHIFT)
+#define INTERN_MAX_PAGES (((size_t)1 << 32) >> INTERN_PAGE_SHIFT)
+
+typedef struct InternChunk {
+    struct InternChunk *next;
+    size_t used;
+    size_t capacity;
+    char data[];
+} InternChunk;
+
+typedef struct {
+    const char *str;
+    uint32_t length;
+    uint32_t hash;
+} InternEntry;
+
+/*
+ * Entries live in fixed-size pages that never move once allocated, so lookups
+ * by Symbol need no lock even while another thread is interning. Writers are
+ * serialised by intern_lock; entry_count is published with release ordering
+ * after the entry is filled in. Page 0, slot 0 is the unused SYMBOL_NONE entry.
+ */
+static InternEntry *pages[INTERN_MAX_PAGES];
+static _Atomic size_t entry_count = 0;
+static pthread_mutex_t intern_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static InternEntry *intern_entry(Symbol sym) {
+    return &pages[sym >> INTERN_PAGE_SHIFT][sym & (INTERN_PAGE_SIZE - 1)];
+}
+
+// Open-addressed table of Symbols, 0 marks an empty slot
+static Symbol *slots = NULL;
+static size_t slot_capacity = 0;
+
+static InternChunk *chunks = NULL;
+
+static uint32_t intern_hash(const char *str, size_t length) {
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        h ^= (unsigned char)str[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static char *intern_store(const char *str, size_t length) {
+    size_t needed = length + 1;
+    if (!chunks || chunks->capacity - chunks->used < needed) {
+        size_t capacity = needed > INTERN_CHUNK_SIZE ? needed : INTERN_CHUNK_SIZE;
+        InternChunk *chunk = malloc(sizeof(InternChunk) + capacity);
+        if (!chunk) {
+            LOG_ERROR("Unable to allocate memory for interned strings");
+            exit(EXIT_FAILURE);
+        }
+        chunk->next = chunks;
+        chunk->used = 0;
+        chunk->capacity = capacity;
+        chunks = chunk;
+    }
+    char *copy = chunks->data + chunks->used;
+    memcpy(copy, str, length);
+    copy[length] = '\0';
+    chunks->used += needed;
+    return copy;
+}
+
+static void intern_grow_slots(void) {
+    size_t new_capacity = slot_capacity == 0 ? INTERN_INITIAL_SLOTS : slot_capacity * 2;
+    Symbol *new_slots = calloc(new_capacity, sizeof(Symbol));
+    if (!new_slots) {
+        LOG_ERROR("Unable to allocate memory for intern table");
+        exit(EXIT_FAILURE);
+    }
+    size_t count = atomic_load_explicit(&entry_count, memory_order_relaxed);
+    for (size_t sym = 1; sym < count; sym++) {
+        size_t i = intern_entry((Symbol)sym)->hash & (new_capacity - 1);
+        while (new_slots[i]) i = (i + 1) & (new_capacity - 1);
+        new_slots[i] = (Symbol)sym;
+    }
+    free(slots);
+    slots = new_slots;
+    slot_capacity = new_capacity;
+}
+
+Symbol intern(const char *str, size_t length) {
+    if (!str) return SYMBOL_NONE;
+
+    uint32_t h = intern_hash(str, length);
+    pthread_mutex_lock(&intern_lock);
+
+    size_t count = atomic_load_explicit(&entry_count, memory_order_relaxed);
+    if (count == 0) count = 1; // Reserve SYMBOL_NONE
+
+    // Keep the load factor below one half
+    if ((count + 1) * 2 > slot_capacity) intern_grow_slots();
+
+    size_t i = h & (slot_capacity - 1);
+    while (slots[i]) {
+        InternEntry *e = intern_entry(slots[i]);
+        if (e->hash == h && e->length == length && memcmp(e->str, str, length) == 0) {
+            Symbol found = slots[i];
+            pthread_mutex_unlock(&intern_lock);
+            return found;
+        }
+        i = (i + 1) & (slot_capacity - 1);
+    }
+
+    Symbol sym = (Symbol)count;
+    if (!pages[sym >> INTERN_PAGE_SHIFT]) {
+        pages[sym >> INTERN_PAGE_SHIFT] = malloc(sizeof(InternEntry) * INTERN_PAGE_SIZE);
+        if (!pages[sym >> INTERN_PAGE_SHIFT]) {
+            LOG_ERROR("Unable to allocate memory for intern entries");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    InternEntry *e = intern_entry(sym);
+    e->str = intern_store(str, length);
+    e->length = (uint32_t)length;
+    e->hash = h;
+    slots[i] = sym;
+    atomic_store_explicit(&entry_count, count + 1, memory_order_release);
+
+    pthread_mutex_unlock(&intern_lock);
+    return sym;
+}
+
+Symbol intern_cstr(const char *str) {
+    return str ? intern(str, strlen(str)) : SYMBOL_NONE;
+}
+
+const char *symbol_name(Symbol sym) {
+    if (sym == SYMBOL_NONE || sym >= atomic_load_explicit(&entry_count, memory_order_acquire)) return NULL;
+    return intern_entry(sym)->str;
+}
+
+size_t symbol_length(Symbol sym) {
+    if (sym == SYMBOL_NONE || sym >= atomic_load_explicit(&entry_count, memory_order_acquire)) return 0;
+    return intern_entry(sym)->length;
+}
+
+size_t symbol_count(void) {
+    size_t count = atomic_load_explicit(&entry_count, memory_order_acquire);
+    return count == 0 ? 1 : count;
+}
+
+void intern_reset(void) {
+    pthread_mutex_lock(&intern_lock);
+    while (chunks) {
+        InternChunk *next = chunks->next;
+        free(chunks);
+        chunks = next;
+    }
+    for (size_t p = 0; p < INTERN_MAX_PAGES && pages[p]; p++) {
+        free(pages[p]);
+        pages[p] = NULL;
+    }
+    free(slots);
+    slots = NULL;
+    slot_capacity = 0;
+    atomic_store_explicit(&entry_count, 0, memory_order_release);
+    pthread_mutex_unlock(&intern_lock);
+}
@@ -0,0 +1,32 @@
+/*
+ * File: intern.h
+ * Description: Declares the global string interner used for identifiers and TAC operands.
+ * Purpose: Maps each distinct spelling to a stable integer Symbol so that later stages
+ *          compare and hash integers instead of heap strings.
+ */
+
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t Symbol;
+
+// Symbol 0 is never handed out, so it can be used as "no name"
+#define SYMBOL_NONE ((Symbol)0)
+
+/* Interning; safe to call from several threads at once */
+Symbol intern(const char *str, size_t length);
+Symbol intern_cstr(const char *str);
+
+/* Lookup */
+const char *symbol_name(Symbol sym);   // NUL-terminated spelling, NULL for SYMBOL_NONE
+size_t symbol_length(Symbol sym);
+size_t symbol_count(void);             // One past the largest Symbol handed out so far
+
+/* Release all interned strings; every Symbol handed out before becomes invalid.
+ * Not safe while other threads may still be looking up symbols. */
+void intern_reset(void);
+
+#endif // INTERN_H
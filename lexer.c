@@ -6,9 +6,10 @@
 
 #include "lexer.h"
 #include "debug.h"
+#include "scan.h"
 #include <stdio.h>
 #include <stdlib.h>
-#include <ctype.h>
+#include <pthread.h>
 #include <string.h>
 
 typedef struct {
@@ -77,7 +78,8 @@ static const Keyword keywords[] = {
     {"true", TOK_KW_TRUE, 4},
     {"nullptr", TOK_KW_NULLPTR, 7},
     {"typeof", TOK_KW_TYPEOF, 6},
-    {"typeof_unqual", TOK_KW_TYPEOF_UNQUAL, 13}
+    {"typeof_unqual", TOK_KW_TYPEOF_UNQUAL, 13},
+    {"constexpr", TOK_KW_CONSTEXPR, 9}
 };
 static const size_t num_keywords = sizeof(keywords)/sizeof(keywords[0]);
 
@@ -145,8 +147,7 @@ static TokenType get_keyword_type(register const char *str, register size_t len)
         [36] = TOK_KW__NORETURN, [37] = TOK_KW_INT, [38] = TOK_KW_FOR, [39] = TOK_KW_FALSE,
         [40] = TOK_KW__COMPLEX, [41] = TOK_KW_AUTO, [42] = TOK_KW__ALIGNAS, [43] = TOK_KW_VOID,
         [44] = TOK_KW_CASE, [45] = TOK_KW_CHAR, [46] = TOK_KW_ELSE, [47] = TOK_KW_UNSIGNED,
-        [48] = TOK_KW_CONTINUE, [49] = TOK_KW_IF,
-          // 50 is constexpr which maps to IDENTIFIER (default)
+        [48] = TOK_KW_CONTINUE, [49] = TOK_KW_IF, [50] = TOK_KW_CONSTEXPR,
         [51] = TOK_KW__ALIGNOF, [52] = TOK_KW_REGISTER, [53] = TOK_KW_EXTERN, [54] = TOK_KW_RETURN,
         [55] = TOK_KW_NULLPTR, [56] = TOK_KW_GOTO, [57] = TOK_KW__COMPLEX, [58] = TOK_KW_WHILE,
         [59] = TOK_KW_ENUM, [60] = TOK_KW__BOOL, [61] = TOK_KW_INLINE, [62] = TOK_KW_BREAK,
@@ -159,114 +160,307 @@ static TokenType get_keyword_type(register const char *str, register size_t len)
     if (len <= MAX_WORD_LENGTH && len >= MIN_WORD_LENGTH) {
         register unsigned int key = hash (str, len);
 
-        LOG_INFO("lexer hash: %u, key: %u, str: %.*s", key, key, (int)len, str);
-
         if ((key <= MAX_HASH_VALUE) && (!strncmp (str, wordlist[key], len)))
             return hash_to_token[key];
     }
     return TOK_IDENTIFIER;
 }
 
+// Character classes for dispatch and number scanning; independent of the locale
+enum {
+    CHAR_ALPHA = 1,     // Letters and '_': may start an identifier
+    CHAR_DIGIT = 2,
+    CHAR_XDIGIT = 4,
+    CHAR_OPERATOR = 8,  // May start an operator or punctuator
+    CHAR_SPACE = 16
+};
+
+static const uint8_t char_class[256] = {
+    ['a' ... 'f'] = CHAR_ALPHA | CHAR_XDIGIT, ['g' ... 'z'] = CHAR_ALPHA,
+    ['A' ... 'F'] = CHAR_ALPHA | CHAR_XDIGIT, ['G' ... 'Z'] = CHAR_ALPHA, ['_'] = CHAR_ALPHA,
+    ['0' ... '9'] = CHAR_DIGIT | CHAR_XDIGIT,
+    ['+'] = CHAR_OPERATOR, ['-'] = CHAR_OPERATOR, ['*'] = CHAR_OPERATOR, ['/'] = CHAR_OPERATOR,
+    ['%'] = CHAR_OPERATOR, ['&'] = CHAR_OPERATOR, ['|'] = CHAR_OPERATOR, ['^'] = CHAR_OPERATOR,
+    ['~'] = CHAR_OPERATOR, ['!'] = CHAR_OPERATOR, ['='] = CHAR_OPERATOR, ['<'] = CHAR_OPERATOR,
+    ['>'] = CHAR_OPERATOR, ['?'] = CHAR_OPERATOR, [':'] = CHAR_OPERATOR, ['.'] = CHAR_OPERATOR,
+    ['('] = CHAR_OPERATOR, [')'] = CHAR_OPERATOR, ['{'] = CHAR_OPERATOR, ['}'] = CHAR_OPERATOR,
+    ['['] = CHAR_OPERATOR, [']'] = CHAR_OPERATOR, [','] = CHAR_OPERATOR, [';'] = CHAR_OPERATOR,
+    ['#'] = CHAR_OPERATOR,
+    [' '] = CHAR_SPACE, ['\t'] = CHAR_SPACE, ['\n'] = CHAR_SPACE, ['\v'] = CHAR_SPACE,
+    ['\f'] = CHAR_SPACE, ['\r'] = CHAR_SPACE
+};
+
+static bool is_digit(char c) {
+    return char_class[(unsigned char)c] & CHAR_DIGIT;
+}
+
+static bool is_xdigit(char c) {
+    return char_class[(unsigned char)c] & CHAR_XDIGIT;
+}
+
+// Operators and punctuators; the DFA below is built from this list
+static const struct {
+    const char* spelling;
+    TokenType type;
+} operator_spellings[] = {
+    {"+", TOK_PLUS}, {"++", TOK_PLUS_PLUS}, {"+=", TOK_PLUS_EQ},
+    {"-", TOK_MINUS}, {"--", TOK_MINUS_MINUS}, {"-=", TOK_MINUS_EQ}, {"->", TOK_ARROW},
+    {"*", TOK_STAR}, {"*=", TOK_STAR_EQ},
+    {"/", TOK_SLASH}, {"/=", TOK_SLASH_EQ},
+    {"%", TOK_PERCENT}, {"%=", TOK_PERCENT_EQ},
+    {"&", TOK_AMP}, {"&&", TOK_AMP_AMP}, {"&=", TOK_AMP_EQ},
+    {"|", TOK_PIPE}, {"||", TOK_PIPE_PIPE}, {"|=", TOK_PIPE_EQ},
+    {"^", TOK_CARET}, {"^=", TOK_CARET_EQ},
+    {"~", TOK_TILDE},
+    {"!", TOK_BANG}, {"!=", TOK_BANG_EQ},
+    {"=", TOK_EQ}, {"==", TOK_EQ_EQ},
+    {"<", TOK_LT}, {"<=", TOK_LT_EQ}, {"<<", TOK_LSHIFT}, {"<<=", TOK_LSHIFT_EQ},
+    {">", TOK_GT}, {">=", TOK_GT_EQ}, {">>", TOK_RSHIFT}, {">>=", TOK_RSHIFT_EQ},
+    {"?", TOK_QUESTION}, {":", TOK_COLON},
+    {".", TOK_DOT}, {"...", TOK_ELLIPSIS},
+    {"(", TOK_LPAREN}, {")", TOK_RPAREN}, {"{", TOK_LBRACE}, {"}", TOK_RBRACE},
+    {"[", TOK_LBRACKET}, {"]", TOK_RBRACKET}, {",", TOK_COMMA}, {";", TOK_SEMICOLON},
+    {"#", TOK_PP_HASH}, {"##", TOK_PP_HASHHASH}
+};
+
+#define OPERATOR_STATES 64
+#define OPERATOR_COLUMNS 32
+
+// Column 0 and state 0 mean "no transition"; state 0 is also the start state
+static uint8_t operator_column[256];
+static uint8_t operator_next[OPERATOR_STATES][OPERATOR_COLUMNS];
+static TokenType operator_accept[OPERATOR_STATES]; // TOK_UNKNOWN if not accepting
+static pthread_once_t operator_dfa_once = PTHREAD_ONCE_INIT;
+
+static void build_operator_dfa(void) {
+    size_t columns = 0, states = 1;
+    for (size_t i = 0; i < OPERATOR_STATES; i++) operator_accept[i] = TOK_UNKNOWN;
+    for (size_t i = 0; i < sizeof(operator_spellings) / sizeof(operator_spellings[0]); i++) {
+        uint8_t state = 0;
+        for (const char* p = operator_spellings[i].spelling; *p; p++) {
+            if (columns + 1 >= OPERATOR_COLUMNS || states >= OPERATOR_STATES) {
+                LOG_ERROR("Operator DFA tables are too small for '%s'", operator_spellings[i].spelling);
+                exit(EXIT_FAILURE);
+            }
+            uint8_t* column = &operator_column[(unsigned char)*p];
+            if (!*column) *column = (uint8_t)++columns;
+            if (!operator_next[state][*column]) operator_next[state][*column] = (uint8_t)states++;
+            state = operator_next[state][*column];
+        }
+        operator_accept[state] = operator_spellings[i].type;
+    }
+}
+
 void lexer_init(Lexer* lexer, const char* source) {
+    pthread_once(&operator_dfa_once, build_operator_dfa);
     lexer->source = source;
     lexer->current = source;
-    lexer->line = 1;
-    lexer->column = 1;
 }
 
-static Token make_token(Lexer* lexer, TokenType type, const char* start, size_t length) {
+static Token make_token(TokenType type, const char* start, size_t length) {
     return (Token){
         .type = type,
         .text = start,
         .length = length,
-        .line = lexer->line,
-        .column = lexer->column - (uint_least32_t)length
+        .symbol = SYMBOL_NONE
     };
 }
 
 static void advance(Lexer* lexer) {
-    if (*lexer->current == '\n') {
-        lexer->line++;
-        lexer->column = 1;
-    } else {
-        lexer->column++;
-    }
     lexer->current++;
 }
 
-static Token lex_identifier(Lexer* lexer) {
+// Lexer errors are rare, so the line table is built just for the message
+static void report_error(Lexer* lexer, const char* message, const char* at) {
+    LineTable lines;
+    line_table_init(&lines, lexer->source);
+    SourceLocation location = line_table_locate(&lines, (size_t)(at - lexer->source));
+    LOG_ERROR("%s at line %u, column %u", message, location.line, location.column);
+    line_table_free(&lines);
+}
+
+static Token lex_identifier(Lexer* lexer, bool intern_name) {
     const char* start = lexer->current;
-    while (isalnum(*lexer->current) || *lexer->current == '_') {
-        advance(lexer);
-    }
+    // Most identifiers are short; hand longer ones to the block scanner
+    const char* end = start + 1;
+    while (end < start + 8 && (char_class[(unsigned char)*end] & (CHAR_ALPHA | CHAR_DIGIT))) end++;
+    if (end == start + 8) end = scan_identifier(end);
+    lexer->current = end;
     size_t length = lexer->current - start;
     TokenType type = get_keyword_type(start, length);
-    return make_token(lexer, type, start, length);
+    Token token = make_token(type, start, length);
+    if (type == TOK_IDENTIFIER && intern_name) {
+        token.symbol = intern(start, length);
+    }
+    return token;
 }
 
-static Token lex_number(Lexer* lexer) {
-    const char* start = lexer->current;
-    bool is_float = false;
+// Value of a hexadecimal digit, or 16 for anything else
+static unsigned digit_value(char c) {
+    if (is_digit(c)) return (unsigned)(c - '0');
+    if (is_xdigit(c)) return (unsigned)((c | 0x20) - 'a' + 10);
+    return 16;
+}
 
-    // Check for hexadecimal prefix
-    if (*lexer->current == '0' && (lexer->current[1] == 'x' || lexer->current[1] == 'X')) {
-        advance(lexer); // Skip '0'
-        advance(lexer); // Skip 'x' or 'X'
-        while (isxdigit(*lexer->current)) {
-            advance(lexer);
+typedef struct {
+    uint64_t value;
+    size_t digits;  // Separators excluded
+    bool overflow;
+    bool separated; // Saw a C23 ' digit separator
+} DigitRun;
+
+// Accumulates digits below base; a ' is a separator only between two digits
+static const char* scan_digits(const char* p, unsigned base, DigitRun* run) {
+    const char* first = p;
+    for (;;) {
+        unsigned digit = digit_value(*p);
+        if (digit < base) {
+            run->overflow |= __builtin_mul_overflow(run->value, base, &run->value);
+            run->overflow |= __builtin_add_overflow(run->value, digit, &run->value);
+            run->digits++;
+            p++;
+        } else if (*p == '\'' && p > first && digit_value(p[1]) < base) {
+            run->separated = true;
+            p++;
+        } else {
+            return p;
         }
-        size_t length = lexer->current - start;
-        return make_token(lexer, TOK_INTEGER, start, length);
     }
+}
 
-    // Check for octal numbers (starting with 0)
-    if (*lexer->current == '0' && isdigit(lexer->current[1])) {
-        advance(lexer); // Skip '0'
-        while (isdigit(*lexer->current) && *lexer->current < '8') {
-            advance(lexer);
-        }
-        size_t length = lexer->current - start;
-        return make_token(lexer, TOK_INTEGER, start, length);
+// Powers of ten that a double holds exactly
+static const double exact_powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Hex floats, long mantissas and large exponents go through strtod
+static double decode_float(const char* start, const char* end, bool separated) {
+    if (!separated) return strtod(start, NULL);
+    size_t length = (size_t)(end - start);
+    char small[64];
+    char* copy = length < sizeof(small) ? small : malloc(length + 1);
+    if (!copy) {
+        LOG_ERROR("Unable to allocate memory for float literal");
+        exit(EXIT_FAILURE);
+    }
+    size_t used = 0;
+    for (const char* p = start; p < end; p++) {
+        if (*p != '\'') copy[used++] = *p;
     }
+    copy[used] = '\0';
+    double value = strtod(copy, NULL);
+    if (copy != small) free(copy);
+    return value;
+}
 
-    // Handle numbers starting with a dot (e.g., .5)
-    if (*lexer->current == '.') {
-        is_float = true;
-        advance(lexer);
-        while (isdigit(*lexer->current)) advance(lexer);
-        size_t length = lexer->current - start;
-        return make_token(lexer, TOK_FLOAT, start, length);
+// Integer suffixes in either order: u with one of l, ll, wb
+static const char* scan_integer_suffix(const char* p, uint8_t* flags) {
+    bool seen_unsigned = false, seen_size = false;
+    for (;;) {
+        if (!seen_unsigned && (*p == 'u' || *p == 'U')) {
+            *flags |= LITERAL_UNSIGNED;
+            seen_unsigned = true;
+            p++;
+        } else if (!seen_size && ((p[0] == 'l' && p[1] == 'l') || (p[0] == 'L' && p[1] == 'L'))) {
+            *flags |= LITERAL_LONG_LONG;
+            seen_size = true;
+            p += 2;
+        } else if (!seen_size && (*p == 'l' || *p == 'L')) {
+            *flags |= LITERAL_LONG;
+            seen_size = true;
+            p++;
+        } else if (!seen_size && ((p[0] == 'w' && p[1] == 'b') || (p[0] == 'W' && p[1] == 'B'))) {
+            *flags |= LITERAL_BIT_PRECISE;
+            seen_size = true;
+            p += 2;
+        } else {
+            return p;
+        }
     }
+}
 
-    while (isdigit(*lexer->current)) advance(lexer);
+/*
+ * Scans and decodes a numeric literal in one pass. Decimal floats whose
+ * mantissa fits in 53 bits and whose exponent is within 10^22 are exact with a
+ * single multiply or divide; everything else falls back to strtod.
+ */
+static Token lex_number(Lexer* lexer) {
+    const char* start = lexer->current;
+    const char* p = start;
+    Literal literal = { .kind = LITERAL_INTEGER };
+    DigitRun mantissa = { 0 };
+    unsigned base = 10;
+
+    if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X') && (is_xdigit(p[2]) || (p[2] == '.' && is_xdigit(p[3])))) {
+        base = 16;
+        p += 2;
+    } else if (p[0] == '0' && (p[1] == 'b' || p[1] == 'B') && (p[2] == '0' || p[2] == '1')) {
+        base = 2;
+        p += 2;
+    }
+    // Octal is scanned as decimal until we know the literal is not a float
+    p = scan_digits(p, base, &mantissa);
 
-    // Handle numbers ending with a dot (e.g., 1.)
-    if (*lexer->current == '.') {
+    bool is_float = false;
+    bool exact = base == 10;
+    int exponent = 0;
+    if (base != 2 && *p == '.') {
         is_float = true;
-        advance(lexer);
-        while (isdigit(*lexer->current)) advance(lexer);
+        size_t integer_digits = mantissa.digits;
+        p = scan_digits(p + 1, base, &mantissa);
+        exponent = -(int)(mantissa.digits - integer_digits);
     }
-
-    if (*lexer->current == 'e' || *lexer->current == 'E') {
+    if ((base == 10 && (*p == 'e' || *p == 'E')) || (base == 16 && (*p == 'p' || *p == 'P'))) {
         is_float = true;
-        advance(lexer);
-        if (*lexer->current == '+' || *lexer->current == '-') advance(lexer);
-        while (isdigit(*lexer->current)) advance(lexer);
+        p++;
+        bool negative = *p == '-';
+        if (*p == '+' || *p == '-') p++;
+        DigitRun power = { 0 };
+        p = scan_digits(p, 10, &power);
+        mantissa.separated |= power.separated;
+        if (power.overflow || power.value > 100000) exact = false;
+        else exponent += negative ? -(int)power.value : (int)power.value;
     }
 
-    if (*lexer->current == 'u' || *lexer->current == 'U') {
-        advance(lexer);
-        if (*lexer->current == 'l' || *lexer->current == 'L') advance(lexer);
-    } else if (*lexer->current == 'l' || *lexer->current == 'L') {
-        advance(lexer);
-        if (*lexer->current == 'u' || *lexer->current == 'U') advance(lexer);
-    } else if (*lexer->current == 'f' || *lexer->current == 'F') {
-        is_float = true;
-        advance(lexer);
+    if (is_float) {
+        const char* end = p;
+        literal.kind = LITERAL_FLOATING;
+        if (*p == 'f' || *p == 'F') {
+            literal.flags |= LITERAL_FLOAT;
+            p++;
+        } else if (*p == 'l' || *p == 'L') {
+            literal.flags |= LITERAL_LONG;
+            p++;
+        }
+        if (exact && !mantissa.overflow && mantissa.value <= (1ull << 53) && exponent >= -22 && exponent <= 22) {
+            double value = (double)mantissa.value;
+            literal.value.floating = exponent < 0 ? value / exact_powers_of_ten[-exponent]
+                                                  : value * exact_powers_of_ten[exponent];
+        } else {
+            literal.value.floating = decode_float(start, end, mantissa.separated);
+        }
+    } else {
+        if (base == 10 && start[0] == '0' && mantissa.digits > 1) {
+            DigitRun octal = { 0 };
+            if (scan_digits(start, 8, &octal) != p) {
+                report_error(lexer, "Invalid digit in octal constant", start);
+            }
+            mantissa.value = octal.value;
+            mantissa.overflow = octal.overflow;
+        }
+        if (mantissa.overflow) {
+            report_error(lexer, "Integer constant is too large", start);
+            literal.flags |= LITERAL_OVERFLOW;
+        }
+        literal.value.integer = mantissa.value;
+        p = scan_integer_suffix(p, &literal.flags);
     }
 
-    size_t length = lexer->current - start;
-    return make_token(lexer, is_float ? TOK_FLOAT : TOK_INTEGER, start, length);
+    lexer->current = p;
+    Token token = make_token(is_float ? TOK_FLOAT : TOK_INTEGER, start, (size_t)(p - start));
+    token.literal = literal;
+    return token;
 }
 
 static Token lex_string(Lexer* lexer, bool raw) {
@@ -283,35 +477,26 @@ static Token lex_string(Lexer* lexer, bool raw) {
 
     if (*lexer->current == '\0') {
         // Handle error: unmatched quote
-        LOG_ERROR("Unmatched quote at line %u, column %u", lexer->line, lexer->column);
-        return make_token(lexer, TOK_UNKNOWN, start, length);
+        report_error(lexer, "Unmatched quote", start);
+        return make_token(TOK_UNKNOWN, start, length);
     }
 
     advance(lexer); // Move past the closing quote
     length = lexer->current - start;
-    return make_token(lexer, raw ? TOK_RAW_STRING : TOK_STRING, start, length);
+    return make_token(raw ? TOK_RAW_STRING : TOK_STRING, start, length);
 }
 
 static Token lex_comment(Lexer* lexer) {
     const char* start = lexer->current - 1;  // -1 to allow for the initial / accepted before lex_comment() called
     if (*lexer->current == '/') {
         advance(lexer); // Skip the second '/'
-        while (*lexer->current != '\n' && *lexer->current != '\0') {
-            advance(lexer); // Skip the rest of the line
-        }
+        lexer->current = scan_line_end(lexer->current); // Skip the rest of the line
     } else if (*lexer->current == '*') {
         advance(lexer); // Skip the '*'
-        while (*lexer->current != '\0') {
-            if (*lexer->current == '*' && lexer->current[1] == '/') {
-                advance(lexer); // Skip the '*'
-                advance(lexer); // Skip the '/'
-                break;
-            }
-            advance(lexer); // Skip other characters
-        }
+        lexer->current = scan_block_comment(lexer->current, NULL); // Past the "*/"
     }
     size_t length = lexer->current - start; 
-    return make_token(lexer, TOK_COMMENT, start, length);
+    return make_token(TOK_COMMENT, start, length);
 }
 
 static Token lex_char(Lexer* lexer) {
@@ -332,196 +517,231 @@ static Token lex_char(Lexer* lexer) {
     if (*lexer->current == '\'') {
         advance(lexer); // Skip the closing single quote
         size_t length = lexer->current - start;
-        return make_token(lexer, TOK_CHAR, start, length);
+        return make_token(TOK_CHAR, start, length);
     } else {
         // Handle error: unmatched single quote or too many characters
-        LOG_ERROR("Invalid character literal at line %u, column %u", lexer->line, lexer->column);
-        return make_token(lexer, TOK_UNKNOWN, start, lexer->current - start);
+        report_error(lexer, "Invalid character literal", start);
+        return make_token(TOK_UNKNOWN, start, lexer->current - start);
     }
 }
 
-Token next_token(Lexer* lexer) {
-    LOG_INFO("Starting next_token: current char='%c' (line=%u, column=%u)", *lexer->current, lexer->line, lexer->column);
+// Maximal munch over the operator DFA: at most three transitions
+static Token lex_operator(Lexer* lexer) {
+    const char* start = lexer->current;
+    TokenType type = TOK_UNKNOWN;
+    size_t length = 0, accepted = 0;
+    uint8_t state = 0;
+    for (;;) {
+        uint8_t column = operator_column[(unsigned char)start[length]];
+        uint8_t next = column ? operator_next[state][column] : 0;
+        if (!next) break;
+        state = next;
+        length++;
+        if (operator_accept[state] != TOK_UNKNOWN) {
+            type = operator_accept[state];
+            accepted = length;
+        }
+    }
+    lexer->current = start + accepted;
+    return make_token(type, start, accepted);
+}
 
-    while (isspace(*lexer->current)) {
-        LOG_INFO("Skipping whitespace: '%c'", *lexer->current);
-        advance(lexer);
+static Token lex_token(Lexer* lexer, bool intern_names) {
+    if (char_class[(unsigned char)*lexer->current] & CHAR_SPACE) {
+        lexer->current = scan_whitespace(lexer->current, NULL);
     }
 
     const char* start = lexer->current;
+    unsigned char c = (unsigned char)*start;
+    uint8_t class = char_class[c];
 
-    if (*lexer->current == '\0') {
-        LOG_INFO("End of input reached");
-        return make_token(lexer, TOK_EOF, start, 0);
+    if (c == '\0') {
+        return make_token(TOK_EOF, start, 0);
     }
 
-    if (isalpha(*lexer->current) || *lexer->current == '_') {
-        LOG_INFO("Lexing identifier starting with '%c'", *lexer->current);
-        Token token = lex_identifier(lexer);
-        LOG_INFO("Lexed identifier: type=%s, text='%.*s'", token_type_to_string(token.type), (int)token.length, token.text);
-        return token;
+    if (class & CHAR_ALPHA) {
+        if (c == 'R' && start[1] == '"') {
+            advance(lexer); // Skip 'R'
+            advance(lexer); // Skip '"'
+            return lex_string(lexer, true); // Handle raw string literal
+        }
+        return lex_identifier(lexer, intern_names);
     }
 
-    if (isdigit(*lexer->current)) {
-        LOG_INFO("Lexing number starting with '%c'", *lexer->current);
-        Token token = lex_number(lexer);
-        LOG_INFO("Lexed number: type=%s, text='%.*s'", token_type_to_string(token.type), (int)token.length, token.text);
-        return token;
+    if ((class & CHAR_DIGIT) || (c == '.' && (char_class[(unsigned char)start[1]] & CHAR_DIGIT))) {
+        return lex_number(lexer);
     }
 
-    LOG_INFO("Processing single-character token or operator: '%c'", *lexer->current);
-
-    switch (*lexer->current) {
-        case '=':
-        advance(lexer);
-        if (*lexer->current == '=') {
+    if (class & CHAR_OPERATOR) {
+        if (c == '/' && (start[1] == '/' || start[1] == '*')) {
             advance(lexer);
-            return make_token(lexer, TOK_EQ_EQ, start, 2);
+            return lex_comment(lexer);
         }
-        return make_token(lexer, TOK_EQ, start, 1);
-        case '!':
-            advance(lexer);
-            if (*lexer->current == '=') {
-                advance(lexer);
-                return make_token(lexer, TOK_BANG_EQ, start, 2);
-            }
-            return make_token(lexer, TOK_BANG, start, 1);
-        case '<':
-            advance(lexer);
-            if (*lexer->current == '=') {
-                advance(lexer);
-                return make_token(lexer, TOK_LT_EQ, start, 2);
-            }
-            return make_token(lexer, TOK_LT, start, 1);
-        case '>':
-            advance(lexer);
-            if (*lexer->current == '=') {
-                advance(lexer);
-                return make_token(lexer, TOK_GT_EQ, start, 2);
-            }
-            return make_token(lexer, TOK_GT, start, 1);
-        case '&':
-            advance(lexer);
-            if (*lexer->current == '&') {
-                advance(lexer);
-                return make_token(lexer, TOK_AMP_AMP, start, 2);
-            }
-            if (*lexer->current == '=') {
-                advance(lexer);
-                return make_token(lexer, TOK_AMP_EQ, start, 2);
-            }
-            return make_token(lexer, TOK_AMP, start, 1);
-        case '|':
-            advance(lexer);
-            if (*lexer->current == '|') {
-                advance(lexer);
-                return make_token(lexer, TOK_PIPE_PIPE, start, 2);
-            }
-            break;
-        case ',': advance(lexer); return make_token(lexer, TOK_COMMA, start, 1);
-        case '(': advance(lexer); return make_token(lexer, TOK_LPAREN, start, 1);
-        case ')': advance(lexer); return make_token(lexer, TOK_RPAREN, start, 1);
-        case '{': advance(lexer); return make_token(lexer, TOK_LBRACE, start, 1);
-        case '}': advance(lexer); return make_token(lexer, TOK_RBRACE, start, 1);
-        case ';': advance(lexer); return make_token(lexer, TOK_SEMICOLON, start, 1);
-        case '[': advance(lexer); return make_token(lexer, TOK_LBRACKET, start, 1);
-        case ']': advance(lexer); return make_token(lexer, TOK_RBRACKET, start, 1);
-        case ':': advance(lexer); return make_token(lexer, TOK_COLON, start, 1);
-        case '?': advance(lexer); return make_token(lexer, TOK_QUESTION, start, 1);
-        case '~': advance(lexer); return make_token(lexer, TOK_TILDE, start, 1);
-        case '%':
-            advance(lexer);
-            if (*lexer->current == '=') {
-                advance(lexer);
-                return make_token(lexer, TOK_PERCENT_EQ, start, 2);
-            }
-            return make_token(lexer, TOK_PERCENT, start, 1);
-        case '^':
-            advance(lexer);
-            if (*lexer->current == '=') {
-                advance(lexer);
-                return make_token(lexer, TOK_CARET_EQ, start, 2);
-            }
-            return make_token(lexer, TOK_CARET, start, 1);
-        
-        case '.':
-            // Check if the dot is part of a floating-point number
-            if (isdigit(lexer->current[1])) {
-                return lex_number(lexer);
-            }
-            advance(lexer);
-            if (*lexer->current == '.' && lexer->current[1] == '.') {
-                advance(lexer); advance(lexer);
-                return make_token(lexer, TOK_ELLIPSIS, start, 3);
-            }
-            return make_token(lexer, TOK_DOT, start, 1);
-        case '-':
-            advance(lexer);
-            if (*lexer->current == '>') {
-                advance(lexer);
-                return make_token(lexer, TOK_ARROW, start, 2);
-            }
-            if (*lexer->current == '-') {
-                advance(lexer);
-                return make_token(lexer, TOK_MINUS_MINUS, start, 2);
-            }
-            if (*lexer->current == '=') {
-                advance(lexer);
-                return make_token(lexer, TOK_MINUS_EQ, start, 2);
-            }
-            return make_token(lexer, TOK_MINUS, start, 1);
-        case '+':
-            advance(lexer);
-            if (*lexer->current == '+') {
-                advance(lexer);
-                return make_token(lexer, TOK_PLUS_PLUS, start, 2);
-            }
-            if (*lexer->current == '=') {
-                advance(lexer);
-                return make_token(lexer, TOK_PLUS_EQ, start, 2);
-            }
-            return make_token(lexer, TOK_PLUS, start, 1);
-        // * is a pain as it can be a pointer, multiplication, power or dereference
-        // apart from *= treat everything as STAR and let the parser figure it out
-        case '*':
-            advance(lexer);
-            if (*lexer->current == '=') {  // *=
-                advance(lexer);
-                return make_token(lexer, TOK_STAR_EQ, start, 2);
-            }
-            return make_token(lexer, TOK_STAR, start, 1);
-        case '/':
-            advance(lexer);
-            if (*lexer->current == '/' || *lexer->current == '*') 
-                return lex_comment(lexer);
-            if (*lexer->current == '=') {
-                advance(lexer);
-                return make_token(lexer, TOK_SLASH_EQ, start, 2);
-            }
-            return make_token(lexer, TOK_SLASH, start, 1);
-        case '\'':
-            return lex_char(lexer);
-        case '"':
-            return lex_string(lexer, false);
-        case 'R':
-            if (lexer->current[1] == '"') {
-                advance(lexer); // Skip 'R'
-                advance(lexer); // Skip '"'
-                return lex_string(lexer, true); // Handle raw string literal
-            }
-            break;
-        case '#':
-            advance(lexer);
-            if (*lexer->current == '#') {
-                advance(lexer);
-                return make_token(lexer, TOK_PP_HASHHASH, start, 2);
-            }
-            return make_token(lexer, TOK_PP_HASH, start, 1);
-            }
+        return lex_operator(lexer);
+    }
+
+    if (c == '\'') return lex_char(lexer);
+    if (c == '"') return lex_string(lexer, false);
 
-    LOG_INFO("Unknown token: '%c'", *lexer->current);
+    LOG_DEBUG("Unknown token: '%c'", c);
     advance(lexer);
-    return make_token(lexer, TOK_UNKNOWN, start, 1);
+    return make_token(TOK_UNKNOWN, start, 1);
+}
+
+Token next_token(Lexer* lexer) {
+    return lex_token(lexer, true);
+}
+
+void token_buffer_init(TokenBuffer* buffer) {
+    buffer->source = NULL;
+    buffer->tokens = NULL;
+    buffer->count = 0;
+    buffer->capacity = 0;
+    buffer->literals = NULL;
+    buffer->literal_count = 0;
+    buffer->literal_capacity = 0;
+}
+
+static void token_buffer_add_literal(TokenBuffer* buffer, Literal literal) {
+    if (buffer->literal_count == buffer->literal_capacity) {
+        buffer->literal_capacity = buffer->literal_capacity ? buffer->literal_capacity * 2 : 64;
+        buffer->literals = realloc(buffer->literals, sizeof(Literal) * buffer->literal_capacity);
+        if (!buffer->literals) {
+            LOG_ERROR("Unable to allocate memory for literal table");
+            exit(EXIT_FAILURE);
+        }
+    }
+    buffer->literals[buffer->literal_count++] = literal;
+}
+
+void token_buffer_append(TokenBuffer* buffer, TokenType type, size_t offset, size_t length, const Literal* literal) {
+    if (buffer->count == buffer->capacity) {
+        buffer->capacity = buffer->capacity ? buffer->capacity * 2 : 64;
+        buffer->tokens = realloc(buffer->tokens, sizeof(CompactToken) * buffer->capacity);
+        if (!buffer->tokens) {
+            LOG_ERROR("Unable to allocate memory for token buffer");
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (literal) {
+        Literal copy = *literal;
+        copy.token = (uint32_t)buffer->count;
+        token_buffer_add_literal(buffer, copy);
+    }
+    buffer->tokens[buffer->count++] = (CompactToken){
+        .offset = (uint32_t)offset,
+        .type = type,
+        .length = (uint32_t)length
+    };
+}
+
+void token_buffer_fill(TokenBuffer* buffer, Lexer* lexer) {
+    size_t remaining = strlen(lexer->current);
+    if ((size_t)(lexer->current - lexer->source) + remaining > COMPACT_SOURCE_MAX_LENGTH) {
+        LOG_ERROR("Source is too large for 32-bit token offsets");
+        exit(EXIT_FAILURE);
+    }
+    buffer->source = lexer->source;
+    if (buffer->capacity == 0) {
+        // Roughly one token per six bytes of source, to avoid most regrowth
+        buffer->capacity = remaining / 6 + 16;
+        buffer->tokens = malloc(sizeof(CompactToken) * buffer->capacity);
+        if (!buffer->tokens) {
+            LOG_ERROR("Unable to allocate memory for token buffer");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (;;) {
+        Token token = lex_token(lexer, false);
+        if (token.type == TOK_COMMENT || token.type == TOK_WHITESPACE) continue;
+        if (token.length > COMPACT_TOKEN_MAX_LENGTH) {
+            report_error(lexer, "Token too long", token.text);
+            token.type = TOK_UNKNOWN;
+            token.length = COMPACT_TOKEN_MAX_LENGTH;
+        }
+        token_buffer_append(buffer, token.type, (size_t)(token.text - lexer->source), token.length,
+                            token.type == TOK_INTEGER || token.type == TOK_FLOAT ? &token.literal : NULL);
+        if (token.type == TOK_EOF) break;
+    }
+    LOG_INFO("Tokenized %zu tokens", buffer->count);
+}
+
+void token_buffer_free(TokenBuffer* buffer) {
+    free(buffer->tokens);
+    free(buffer->literals);
+    token_buffer_init(buffer);
+}
+
+const char* token_buffer_text(const TokenBuffer* buffer, size_t index) {
+    return buffer->source + buffer->tokens[index].offset;
+}
+
+Symbol token_buffer_symbol(const TokenBuffer* buffer, size_t index) {
+    const CompactToken* token = &buffer->tokens[index];
+    if (token->type != TOK_IDENTIFIER) return SYMBOL_NONE;
+    return intern(buffer->source + token->offset, token->length);
+}
+
+// Literals are in token order, so the owner of a token index is found by bisection
+const Literal* token_buffer_literal(const TokenBuffer* buffer, size_t index) {
+    size_t low = 0, high = buffer->literal_count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (buffer->literals[mid].token < index) low = mid + 1;
+        else high = mid;
+    }
+    if (low < buffer->literal_count && buffer->literals[low].token == index) return &buffer->literals[low];
+    return NULL;
+}
+
+void line_table_init(LineTable* table, const char* source) {
+    table->source = source;
+    table->starts = NULL;
+    table->count = 0;
+}
+
+static void build_line_table(LineTable* table) {
+    size_t capacity = 64;
+    table->starts = malloc(sizeof(uint32_t) * capacity);
+    if (!table->starts) {
+        LOG_ERROR("Unable to allocate memory for line table");
+        exit(EXIT_FAILURE);
+    }
+    table->starts[table->count++] = 0;
+    for (const char* p = scan_line_end(table->source); *p == '\n'; p = scan_line_end(p + 1)) {
+        if (table->count == capacity) {
+            capacity *= 2;
+            table->starts = realloc(table->starts, sizeof(uint32_t) * capacity);
+            if (!table->starts) {
+                LOG_ERROR("Unable to allocate memory for line table");
+                exit(EXIT_FAILURE);
+            }
+        }
+        table->starts[table->count++] = (uint32_t)(p + 1 - table->source);
+    }
+}
+
+SourceLocation line_table_locate(LineTable* table, size_t offset) {
+    if (!table->starts) build_line_table(table);
+    // Last line starting at or before offset
+    size_t low = 0, high = table->count;
+    while (high - low > 1) {
+        size_t mid = low + (high - low) / 2;
+        if (table->starts[mid] <= offset) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    return (SourceLocation){
+        .line = (uint32_t)(low + 1),
+        .column = (uint32_t)(offset - table->starts[low] + 1)
+    };
+}
+
+void line_table_free(LineTable* table) {
+    free(table->starts);
+    line_table_init(table, table->source);
 }
 
 const char* token_type_to_string(TokenType type) {
@@ -580,6 +800,7 @@ const char* token_type_to_string(TokenType type) {
         [TOK_KW_NULLPTR] = "KW_NULLPTR",
         [TOK_KW_TYPEOF] = "KW_TYPEOF",
         [TOK_KW_TYPEOF_UNQUAL] = "KW_TYPEOF_UNQUAL",
+        [TOK_KW_CONSTEXPR] = "KW_CONSTEXPR",
         
         // Literals
         [TOK_INTEGER] = "INTEGER",
@@ -648,7 +869,12 @@ const char* token_type_to_string(TokenType type) {
         [TOK_COLON] = "COLON",
         [TOK_ARROW] = "ARROW",
         [TOK_DOT] = "DOT",
-        [TOK_ELLIPSIS] = "ELLIPSIS"
+        [TOK_ELLIPSIS] = "ELLIPSIS",
+
+        // Preprocessor
+        [TOK_PP_HASH] = "PP_HASH",
+        [TOK_PP_HASHHASH] = "PP_HASHHASH",
+        [TOK_COMMENT] = "COMMENT"
     };
     
     // Safety check
@@ -5,7 +5,6 @@
  */
 
 // Missing fro token types are:
-// - constexpr
 // - attribute types [[fallthrough]] etc
 
 #ifndef LEXER_H
@@ -14,6 +13,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include "intern.h"
 
 typedef enum {
     // Keywords (C23)
@@ -32,6 +32,7 @@ typedef enum {
     TOK_KW__THREAD_LOCAL, TOK_KW__BITINT, TOK_KW__DECIMAL128,
     TOK_KW__DECIMAL32, TOK_KW__DECIMAL64, TOK_KW_TRUE,
     TOK_KW_FALSE, TOK_KW_NULLPTR, TOK_KW_TYPEOF, TOK_KW_TYPEOF_UNQUAL,
+    TOK_KW_CONSTEXPR,
     
     // Literals
     TOK_INTEGER, TOK_FLOAT, TOK_CHAR, TOK_STRING, TOK_RAW_STRING,
@@ -61,29 +62,107 @@ typedef enum {
     TOK_EOF, TOK_UNKNOWN, TOK_COMMENT, TOK_WHITESPACE
 } TokenType;
 
-/* Token structure */
+typedef enum {
+    LITERAL_INTEGER,
+    LITERAL_FLOATING
+} LiteralKind;
+
+/* Suffix and diagnostic bits of a Literal */
+enum {
+    LITERAL_UNSIGNED = 1 << 0,     // u, U
+    LITERAL_LONG = 1 << 1,         // l, L; on a float, long double
+    LITERAL_LONG_LONG = 1 << 2,    // ll, LL
+    LITERAL_BIT_PRECISE = 1 << 3,  // wb, WB (C23 _BitInt)
+    LITERAL_FLOAT = 1 << 4,        // f, F
+    LITERAL_OVERFLOW = 1 << 5      // Integer did not fit in 64 bits; value is wrapped
+};
+
+/* Numeric literal value, decoded once while lexing */
+typedef struct {
+    uint8_t kind;
+    uint8_t flags;
+    uint32_t token; // Index of the owning token in its TokenBuffer
+    union {
+        uint64_t integer;
+        double floating;
+    } value;
+} Literal;
+
+/* Token structure; line and column come from a LineTable when needed */
 typedef struct {
     TokenType type;
     const char* text;
     size_t length;
-    uint_least32_t line;
-    uint_least32_t column;
+    Symbol symbol;   // Interned spelling for TOK_IDENTIFIER, SYMBOL_NONE otherwise
+    Literal literal; // Value of TOK_INTEGER and TOK_FLOAT
 } Token;
 
+/* Pre-tokenized form: 8 bytes, spelling found by byte offset into the source */
+typedef struct {
+    uint32_t offset;
+    uint32_t type : 8;
+    uint32_t length : 24;
+} CompactToken;
+
+_Static_assert(sizeof(CompactToken) == 8, "CompactToken should stay 8 bytes");
+
+#define COMPACT_TOKEN_MAX_LENGTH ((1u << 24) - 1)
+#define COMPACT_SOURCE_MAX_LENGTH UINT32_MAX
+
 /* Lexer state structure */
 typedef struct {
     const char* source;
     const char* current;
-    uint_least32_t line;
-    uint_least32_t column;
 } Lexer;
 
+typedef struct {
+    uint32_t line;
+    uint32_t column;
+} SourceLocation;
+
+/* Offsets of the line starts in a source, built on the first lookup */
+typedef struct {
+    const char* source;
+    uint32_t* starts;
+    size_t count;
+} LineTable;
+
+/*
+ * Whole input as one contiguous array, comments dropped, always ending in TOK_EOF.
+ * Numeric literals are decoded into a side table kept in token order, so the
+ * n-th TOK_INTEGER or TOK_FLOAT owns literals[n].
+ */
+typedef struct {
+    const char* source;
+    CompactToken* tokens;
+    size_t count;
+    size_t capacity;
+    Literal* literals;
+    size_t literal_count;
+    size_t literal_capacity;
+} TokenBuffer;
+
 /* Initialization */
 void lexer_init(Lexer* lexer, const char* source);
 
 /* Core lexing function */
 Token next_token(Lexer* lexer);
 
+/* Batch lexing; identifiers are interned by whoever reads them, see token_buffer_symbol */
+void token_buffer_init(TokenBuffer* buffer);
+void token_buffer_fill(TokenBuffer* buffer, Lexer* lexer);
+// Callers building a buffer by hand keep offsets and lengths within the CompactToken limits
+void token_buffer_append(TokenBuffer* buffer, TokenType type, size_t offset, size_t length, const Literal* literal);
+void token_buffer_free(TokenBuffer* buffer);
+const char* token_buffer_text(const TokenBuffer* buffer, size_t index);
+Symbol token_buffer_symbol(const TokenBuffer* buffer, size_t index);
+const Literal* token_buffer_literal(const TokenBuffer* buffer, size_t index);
+
+/* Source locations, for diagnostics only */
+void line_table_init(LineTable* table, const char* source);
+SourceLocation line_table_locate(LineTable* table, size_t offset);
+void line_table_free(LineTable* table);
+
 /* Utility functions */
 const char* token_type_to_string(TokenType type);
 
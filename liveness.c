@@ -0,0 +1,256 @@
+/*
+ * File: liveness.c
+ * Description: Implements live-variable analysis declared in liveness.h.
+ * Purpose: Computes use/def and live-in/live-out bitsets per block with a
+ *          backward worklist-free fixed point over postorder.
+ */
+
+#include "liveness.h"
+#include "debug.h"
+#include <stdlib.h>
+#include <string.h>
+
+static size_t slot_for(const VarIndex *index, Symbol var) {
+    size_t mask = index->slot_capacity - 1;
+    size_t i = ((size_t)var * 2654435761u) & mask;
+    while (index->slots[i] && index->vars[index->slots[i] - 1] != var) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static void grow_slots(VarIndex *index) {
+    size_t old_capacity = index->slot_capacity;
+    uint32_t *old_slots = index->slots;
+    index->slot_capacity = old_capacity ? old_capacity * 2 : 64;
+    index->slots = calloc(index->slot_capacity, sizeof(uint32_t));
+    if (!index->slots) {
+        LOG_ERROR("Unable to allocate memory for variable index");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_slots[i]) {
+            index->slots[slot_for(index, index->vars[old_slots[i] - 1])] = old_slots[i];
+        }
+    }
+    free(old_slots);
+}
+
+size_t var_index_add(VarIndex *index, Symbol var) {
+    if (var == SYMBOL_NONE) return SIZE_MAX;
+    if ((index->count + 1) * 2 > index->slot_capacity) grow_slots(index);
+    size_t slot = slot_for(index, var);
+    if (index->slots[slot]) return index->slots[slot] - 1;
+    if (index->count == index->capacity) {
+        index->capacity = index->capacity ? index->capacity * 2 : 16;
+        index->vars = realloc(index->vars, sizeof(Symbol) * index->capacity);
+        if (!index->vars) {
+            LOG_ERROR("Unable to allocate memory for variable index");
+            exit(EXIT_FAILURE);
+        }
+    }
+    index->vars[index->count++] = var;
+    index->slots[slot] = (uint32_t)index->count;
+    return index->count - 1;
+}
+
+size_t var_index_find(const VarIndex *index, Symbol var) {
+    if (!index || index->slot_capacity == 0) return SIZE_MAX;
+    uint32_t entry = index->slots[slot_for(index, var)];
+    return entry ? entry - 1 : SIZE_MAX;
+}
+
+void var_index_free(VarIndex *index) {
+    free(index->vars);
+    free(index->slots);
+    *index = (VarIndex){ 0 };
+}
+
+size_t liveness_var_index(const Liveness *liveness, Symbol var) {
+    return liveness ? var_index_find(&liveness->index, var) : SIZE_MAX;
+}
+
+static bool test_bit(const uint64_t *set, size_t bit) {
+    return (set[bit / 64] >> (bit % 64)) & 1;
+}
+
+static void set_bit(uint64_t *set, size_t bit) {
+    set[bit / 64] |= (uint64_t)1 << (bit % 64);
+}
+
+// Phi placeholders inserted by insert_phi_functions are not real statements
+static bool is_phi_placeholder(const ASTNode *stmt) {
+    return stmt->type == NODE_VAR_DECL && !stmt->data.var_decl.init_value && !stmt->data.var_decl.type;
+}
+
+typedef void (*VarVisitor)(Liveness *liveness, void *ctx, Symbol var, bool is_def);
+
+// Visit the variables an expression reads
+static void visit_uses(ASTNode *expr, Liveness *liveness, void *ctx, VarVisitor visit) {
+    if (!expr) return;
+    switch (expr->type) {
+        case NODE_VAR_REF:
+            visit(liveness, ctx, expr->data.var_ref.name, false);
+            break;
+        case NODE_BINARY_OP:
+            visit_uses(expr->data.binary_op.left, liveness, ctx, visit);
+            visit_uses(expr->data.binary_op.right, liveness, ctx, visit);
+            break;
+        case NODE_UNARY_OP:
+            visit_uses(expr->data.unary_op.operand, liveness, ctx, visit);
+            break;
+        case NODE_TERNARY:
+            visit_uses(expr->data.ternary.condition, liveness, ctx, visit);
+            visit_uses(expr->data.ternary.then_expr, liveness, ctx, visit);
+            visit_uses(expr->data.ternary.else_expr, liveness, ctx, visit);
+            break;
+        case NODE_FUNCTION_CALL:
+            for (size_t i = 0; i < expr->data.function_call.arg_count; i++) {
+                visit_uses(expr->data.function_call.args[i], liveness, ctx, visit);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// Visit the uses and then the definition of a block statement, in evaluation order
+static void visit_stmt(ASTNode *stmt, Liveness *liveness, void *ctx, VarVisitor visit) {
+    switch (stmt->type) {
+        case NODE_VAR_DECL:
+            if (is_phi_placeholder(stmt)) return;
+            visit_uses(stmt->data.var_decl.init_value, liveness, ctx, visit);
+            visit(liveness, ctx, stmt->data.var_decl.name, true);
+            break;
+        case NODE_ASSIGNMENT:
+            visit_uses(stmt->data.assignment.value, liveness, ctx, visit);
+            visit(liveness, ctx, stmt->data.assignment.name, true);
+            break;
+        case NODE_RETURN:
+            visit_uses(stmt->data.return_stmt.value, liveness, ctx, visit);
+            break;
+        default:
+            visit_uses(stmt, liveness, ctx, visit);
+            break;
+    }
+}
+
+static void collect_var(Liveness *liveness, void *ctx, Symbol var, bool is_def) {
+    (void)ctx;
+    (void)is_def;
+    var_index_add(&liveness->index, var);
+}
+
+static void record_use_def(Liveness *liveness, void *ctx, Symbol var, bool is_def) {
+    size_t block_id = *(size_t *)ctx;
+    size_t index = liveness_var_index(liveness, var);
+    uint64_t *use = &liveness->use[block_id * liveness->words];
+    uint64_t *def = &liveness->def[block_id * liveness->words];
+    if (is_def) {
+        set_bit(def, index);
+    } else if (!test_bit(def, index)) {
+        set_bit(use, index); // Upward exposed: read before any write in this block
+    }
+}
+
+Liveness *compute_liveness(CFG *cfg) {
+    if (!cfg || !cfg->entry) {
+        LOG_ERROR("Invalid CFG or entry block");
+        return NULL;
+    }
+    if (!cfg->rpo) compute_rpo(cfg);
+
+    Liveness *liveness = calloc(1, sizeof(Liveness));
+    if (!liveness) {
+        LOG_ERROR("Unable to allocate memory for liveness");
+        exit(EXIT_FAILURE);
+    }
+    liveness->block_count = cfg->block_count;
+
+    // Dense variable numbering
+    for (size_t i = 0; i < cfg->block_count; i++) {
+        BasicBlock *block = cfg->blocks[i];
+        for (size_t j = 0; j < block->stmt_count; j++) {
+            visit_stmt(block->stmts[j], liveness, NULL, collect_var);
+        }
+    }
+
+    liveness->words = (liveness->index.count + 63) / 64;
+    size_t set_words = liveness->words * cfg->block_count;
+    liveness->use = calloc(set_words ? set_words : 1, sizeof(uint64_t));
+    liveness->def = calloc(set_words ? set_words : 1, sizeof(uint64_t));
+    liveness->live_in = calloc(set_words ? set_words : 1, sizeof(uint64_t));
+    liveness->live_out = calloc(set_words ? set_words : 1, sizeof(uint64_t));
+    liveness->exposed = calloc(liveness->words ? liveness->words : 1, sizeof(uint64_t));
+    if (!liveness->use || !liveness->def || !liveness->live_in || !liveness->live_out || !liveness->exposed) {
+        LOG_ERROR("Unable to allocate memory for liveness sets");
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t i = 0; i < cfg->block_count; i++) {
+        BasicBlock *block = cfg->blocks[i];
+        for (size_t j = 0; j < block->stmt_count; j++) {
+            visit_stmt(block->stmts[j], liveness, &block->id, record_use_def);
+        }
+        const uint64_t *use = &liveness->use[block->id * liveness->words];
+        for (size_t w = 0; w < liveness->words; w++) liveness->exposed[w] |= use[w];
+    }
+
+    // Backward problem: visiting in postorder lets most information flow in one pass
+    size_t words = liveness->words;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        liveness->iterations++;
+        for (size_t r = cfg->rpo_count; r-- > 0;) {
+            BasicBlock *block = cfg->rpo[r];
+            uint64_t *out = &liveness->live_out[block->id * words];
+            uint64_t *in = &liveness->live_in[block->id * words];
+            const uint64_t *use = &liveness->use[block->id * words];
+            const uint64_t *def = &liveness->def[block->id * words];
+            for (size_t s = 0; s < block->succ_count; s++) {
+                const uint64_t *succ_in = &liveness->live_in[block->succs[s]->id * words];
+                for (size_t w = 0; w < words; w++) out[w] |= succ_in[w];
+            }
+            for (size_t w = 0; w < words; w++) {
+                uint64_t new_in = use[w] | (out[w] & ~def[w]);
+                if (new_in != in[w]) {
+                    in[w] = new_in;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    LOG_INFO("Liveness computed for %zu variables in %zu passes", liveness->index.count, liveness->iterations);
+    return liveness;
+}
+
+bool is_live_in(const Liveness *liveness, const BasicBlock *block, Symbol var) {
+    size_t index = liveness_var_index(liveness, var);
+    if (index == SIZE_MAX || block->id >= liveness->block_count) return false;
+    return test_bit(&liveness->live_in[block->id * liveness->words], index);
+}
+
+bool is_live_out(const Liveness *liveness, const BasicBlock *block, Symbol var) {
+    size_t index = liveness_var_index(liveness, var);
+    if (index == SIZE_MAX || block->id >= liveness->block_count) return false;
+    return test_bit(&liveness->live_out[block->id * liveness->words], index);
+}
+
+bool is_upward_exposed(const Liveness *liveness, Symbol var) {
+    size_t index = liveness_var_index(liveness, var);
+    if (index == SIZE_MAX) return false;
+    return test_bit(liveness->exposed, index);
+}
+
+void free_liveness(Liveness *liveness) {
+    if (!liveness) return;
+    var_index_free(&liveness->index);
+    free(liveness->use);
+    free(liveness->def);
+    free(liveness->live_in);
+    free(liveness->live_out);
+    free(liveness->exposed);
+    free(liveness);
+}
@@ -0,0 +1,56 @@
+/*
+ * File: liveness.h
+ * Description: Declares live-variable analysis over a CFG's statement lists.
+ * Purpose: Supplies per-block live-in/live-out sets for pruned SSA construction
+ *          and, later, register allocation.
+ */
+
+#ifndef LIVENESS_H
+#define LIVENESS_H
+
+#include "cfg.h"
+#include "intern.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Dense numbering of the variables of a CFG, shared with phi placement
+typedef struct VarIndex {
+    Symbol *vars;        // Dense variable index -> Symbol
+    size_t count;
+    size_t capacity;
+    uint32_t *slots;     // Open-addressed Symbol -> index + 1, 0 for empty
+    size_t slot_capacity;
+} VarIndex;
+
+// Index of var, adding it the first time it is seen; SIZE_MAX for SYMBOL_NONE
+size_t var_index_add(VarIndex *index, Symbol var);
+// Index of var, or SIZE_MAX if it was never added
+size_t var_index_find(const VarIndex *index, Symbol var);
+void var_index_free(VarIndex *index);
+
+typedef struct Liveness {
+    size_t block_count;
+    VarIndex index;
+    size_t words;        // 64-bit words per set
+    uint64_t *use;       // Upward-exposed uses, block_count * words, indexed by block id
+    uint64_t *def;       // Variables defined in the block
+    uint64_t *live_in;
+    uint64_t *live_out;
+    uint64_t *exposed;   // Union of the use sets: variables read across a block boundary
+    size_t iterations;   // Passes over the CFG until the sets settled
+} Liveness;
+
+// Backward dataflow over the reachable blocks; computes cfg->rpo if needed
+Liveness *compute_liveness(CFG *cfg);
+void free_liveness(Liveness *liveness);
+
+// Dense index of var, or SIZE_MAX if the variable never appears in the CFG
+size_t liveness_var_index(const Liveness *liveness, Symbol var);
+
+bool is_live_in(const Liveness *liveness, const BasicBlock *block, Symbol var);
+bool is_live_out(const Liveness *liveness, const BasicBlock *block, Symbol var);
+
+// True if var is used in some block before being defined there (a "global" name)
+bool is_upward_exposed(const Liveness *liveness, Symbol var);
+
+#endif // LIVENESS_H
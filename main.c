@@ -8,64 +8,183 @@
 #include "ast.h"
 #include "parser.h"
 #include "cfg.h"
+#include "tac.h"
+#include "optimize.h"
+#include "pool.h"
+#include "preprocessor.h"
+#include "cache.h"
+#include "source.h"
 #include "debug.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
+#include <unistd.h>
 
 // Forward declaration of parse function from parser.c
 // ASTNode* parse(Lexer *lexer);
 // now in parser.h
 
-int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <filename>\n", argv[0]);
-        return 1;
-    }
+// Middle-end work for one function; touches no state shared with other functions
+typedef struct {
+    CFG *cfg;
+    TACContext tac;
+    SSAMode ssa_mode;
+    PhiStats phi_stats;
+} FunctionJob;
 
-    // Open the file
-    FILE *file = fopen(argv[1], "rb");
-    if (!file) {
-        LOG_ERROR("Error opening source file");
-        return 1;
-    }
+static void compile_function(void *arg) {
+    FunctionJob *job = arg;
+    compute_dominator_tree(job->cfg);
+    compute_dominance_frontiers(job->cfg);
+    insert_phi_functions_with(job->cfg, job->ssa_mode, &job->phi_stats);
+    create_tac_with(job->cfg, &job->tac);
+    convert_to_ssa(job->cfg);
+    optimize_tac(job->cfg);
+}
 
-    // Determine file size
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    fseek(file, 0, SEEK_SET);
+// Everything besides file contents that changes what a translation unit preprocesses to
+static uint64_t hash_option(uint64_t seed, char option, const char *value) {
+    seed = cache_hash(&option, 1, seed);
+    return cache_hash(value, strlen(value) + 1, seed);
+}
 
-    // Allocate memory for file contents (+1 for null terminator)
-    char *code = malloc(file_size + 1);
-    if (!code) {
-        LOG_ERROR("Memory allocation failed for source code buffer");
-        fclose(file);
-        return 1;
-    }
+// A unit is keyed by its file's contents and the options it was built with; headers are
+// checked against the hashes recorded in the entry
+static bool unit_key(const char *filename, uint64_t options, uint64_t *key) {
+    char cwd[4096];
+    SourceFile source;
+    if (strcmp(filename, "-") == 0 || !getcwd(cwd, sizeof cwd) || !source_open(&source, filename)) return false;
+    uint64_t seed = hash_option(hash_option(options, 'C', cwd), 'F', filename);
+    *key = cache_hash(source.text, source.length, seed);
+    source_close(&source);
+    return true;
+}
 
-    // Read file contents
-    size_t bytes_read = fread(code, 1, file_size, file);
-    if (bytes_read != file_size) {
-        LOG_ERROR("Error reading source code file");
-        free(code);
-        fclose(file);
+int main(int argc, char *argv[]) {
+    size_t jobs = 1;
+    SSAMode ssa_mode = SSA_PRUNED;
+    bool preprocess_only = false;
+    bool lazy = false;
+    bool fold = false;
+    const char *filename = NULL;
+    const char *cache_directory = NULL;
+    uint64_t options = 0;
+    Preprocessor *preprocessor = preprocessor_create();
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-E") == 0) {
+            preprocess_only = true;
+        } else if (strcmp(argv[i], "-lazy") == 0) {
+            lazy = true;
+        } else if (strcmp(argv[i], "-fold") == 0) {
+            // Folded trees are cached apart from unfolded ones
+            fold = true;
+            options = hash_option(options, 'f', "");
+        } else if (strncmp(argv[i], "-I", 2) == 0 && (argv[i][2] || i + 1 < argc)) {
+            const char *directory = argv[i][2] ? argv[i] + 2 : argv[++i];
+            preprocessor_add_include_path(preprocessor, directory);
+            options = hash_option(options, 'I', directory);
+        } else if (strncmp(argv[i], "-D", 2) == 0 && (argv[i][2] || i + 1 < argc)) {
+            // -DNAME or -DNAME=VALUE
+            char *definition = strdup(argv[i][2] ? argv[i] + 2 : argv[++i]);
+            options = hash_option(options, 'D', definition);
+            char *equals = strchr(definition, '=');
+            if (equals) *equals = '\0';
+            preprocessor_define(preprocessor, definition, equals ? equals + 1 : NULL);
+            free(definition);
+        } else if (strcmp(argv[i], "-ssa") == 0 && i + 1 < argc) {
+            const char *mode = argv[++i];
+            if (strcmp(mode, "minimal") == 0) ssa_mode = SSA_MINIMAL;
+            else if (strcmp(mode, "semi-pruned") == 0) ssa_mode = SSA_SEMI_PRUNED;
+            else if (strcmp(mode, "pruned") == 0) ssa_mode = SSA_PRUNED;
+            else { filename = NULL; break; }
+        } else if (strcmp(argv[i], "-cache") == 0 && i + 1 < argc) {
+            cache_directory = argv[++i];
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            jobs = strtoul(argv[++i], NULL, 10);
+        } else if (strncmp(argv[i], "-j", 2) == 0 && isdigit((unsigned char)argv[i][2])) {
+            jobs = strtoul(argv[i] + 2, NULL, 10);
+        } else if (!filename) {
+            filename = argv[i];
+        } else {
+            filename = NULL;
+            break;
+        }
+    }
+    if (!filename) {
+        fprintf(stderr, "Usage: %s [-E] [-lazy] [-fold] [-I dir] [-D name[=value]] [-cache dir] [-j N] [-ssa minimal|semi-pruned|pruned] <filename | ->\n", argv[0]);
+        fprintf(stderr, "  -E      print the preprocessed source and stop\n");
+        fprintf(stderr, "  -lazy   parse a function body only once main reaches it through calls\n");
+        fprintf(stderr, "  -fold   fold constant expressions while parsing\n");
+        fprintf(stderr, "  -I dir  add dir to the include search path\n");
+        fprintf(stderr, "  -D def  define a macro, as NAME or NAME=VALUE\n");
+        fprintf(stderr, "  -cache dir  keep tokens and ASTs in dir, reusing them while their files are unchanged\n");
+        fprintf(stderr, "  -j N    parse and run the middle end on N threads (0 = one per core)\n");
+        fprintf(stderr, "  -ssa M  phi placement, default pruned\n");
+        preprocessor_destroy(preprocessor);
         return 1;
     }
 
-    code[file_size] = '\0'; // Null-terminate the string
+    BuildCache *cache = NULL;
+    uint64_t key = 0;
+    bool keyed = false;
+    if (cache_directory) {
+        cache = build_cache_open(cache_directory);
+        preprocessor_set_cache(preprocessor, cache);
+        keyed = cache && unit_key(filename, options, &key);
+    }
 
-    fclose(file);
+    // An unchanged unit skips preprocessing, lexing and parsing altogether
+    ASTNode *ast = NULL;
+    CachedUnit unit;
+    // Lives until the module is built, since lazily parsed bodies read the tokens and the preprocessed text
+    TokenBuffer tokens;
+    token_buffer_init(&tokens);
+    if (keyed && build_cache_open_unit(cache, key, &unit)) {
+        LOG_INFO("Using cached unit %016llx for %s", (unsigned long long)key, filename);
+        if (preprocess_only) {
+            printf("%s\n", unit.tokens.source);
+            cached_unit_close(&unit);
+            build_cache_close(cache);
+            preprocessor_destroy(preprocessor);
+            return 0;
+        }
+        ast = cached_unit_ast(&unit);
+        cached_unit_close(&unit);
+    }
 
-    // Initialize the lexer
-    Lexer lexer;
-    lexer_init(&lexer, code);
+    if (!ast) {
+        // Preprocess straight into the parser's token buffer; the file is mapped, not copied
+        if (!preprocess_file(preprocessor, filename, &tokens)) {
+            LOG_ERROR("Error preprocessing input");
+            token_buffer_free(&tokens);
+            build_cache_close(cache);
+            preprocessor_destroy(preprocessor);
+            return 1;
+        }
+        if (preprocess_only) {
+            printf("%s\n", preprocessor_output(preprocessor));
+            token_buffer_free(&tokens);
+            build_cache_close(cache);
+            preprocessor_destroy(preprocessor);
+            return 0;
+        }
 
-    // Parse the input into an AST
-    ASTNode *ast = parse(&lexer);
+        // Parse the input into an AST; a lazy tree is incomplete, so it is not cached
+        ParseOptions parse_options = { .lazy = lazy, .fold = fold, .threads = jobs };
+        ast = parse_tokens_with(&tokens, &parse_options);
+        if (ast && fold) printf("Constant folding: %zu operator nodes folded\n", parse_options.folded);
+        if (ast && keyed && !lazy) {
+            const CacheDependency *dependencies;
+            size_t count = preprocessor_dependencies(preprocessor, &dependencies);
+            build_cache_store_unit(cache, key, dependencies, count, &tokens, ast);
+        }
+    }
+    build_cache_close(cache);
     if (!ast) {
         LOG_ERROR("Error parsing input");
-        free(code);
+        token_buffer_free(&tokens);
+        preprocessor_destroy(preprocessor);
         return 1;
     }
 
@@ -75,45 +194,91 @@ int main(int argc, char *argv[]) {
     print_ast(ast, 0);
 
 
-    // Convert AST to CFG
-    printf("\nConverting to Control Flow Graph...\n");
-    CFG *cfg = ast_to_cfg(ast);
-    if (!cfg) {
+    // Convert AST to one CFG per function
+    printf("\nConverting to Control Flow Graphs...\n");
+    Module *module = ast_to_module(ast);
+    token_buffer_free(&tokens);
+    preprocessor_destroy(preprocessor);
+    if (!module) {
         LOG_ERROR("Error creating CFG");
         free_ast(ast);
-        free(code);
         return 1;
     }
-    print_cfg(cfg, stdout);
-
-    generate_dot_file(cfg, "cfg.dot");
-    printf("Control Flow Graph saved to cfg.dot\n");
-
-    // Compute the dominator tree
-    printf("\nComputing Dominator Tree...\n");
-    compute_dominator_tree(cfg);
-    printf("Dominator Tree computed successfully.\n");
-
-    // Compute dominance frontiers
-    printf("\nComputing Dominance Frontiers...\n");
-    compute_dominance_frontiers(cfg);
-    generate_dominance_frontiers_dot(cfg, "df.dot");
-    printf("Dominance Frontiers saved to df.dot\n");
-
-    // Insert φ-functions into the CFG
-    printf("\nInserting φ-functions into the CFG...\n");
-    insert_phi_functions(cfg);
-    printf("φ-functions inserted successfully.\n");
-
-    // Generate DOT file for modified CFG
-    generate_dot_file(cfg, "cfg_with_phi.dot");
-    printf("Modified Control Flow Graph with φ-functions saved to cfg_with_phi.dot\n");
-        
+
+    char dot_filename[256];
+    MODULE_FOREACH(module, cfg) {
+        const char *name = symbol_name(cfg->function_name);
+        printf("\nFunction %s:\n", name);
+        print_cfg(cfg, stdout);
+
+        snprintf(dot_filename, sizeof(dot_filename), "cfg_%s.dot", name);
+        generate_dot_file(cfg, dot_filename);
+        printf("Control Flow Graph saved to %s\n", dot_filename);
+    }
+
+    /*
+     * Each function gets its own TAC context. Label bases are the running block
+     * count, so labels match a sequential compile whatever order jobs finish in.
+     */
+    FunctionJob *function_jobs = malloc(sizeof(FunctionJob) * (module->function_count ? module->function_count : 1));
+    if (!function_jobs) {
+        LOG_ERROR("Memory allocation failed for function jobs");
+        free_module(module);
+        free_ast(ast);
+        return 1;
+    }
+    int label_base = 0;
+    for (size_t i = 0; i < module->function_count; i++) {
+        function_jobs[i].cfg = module->functions[i];
+        tac_context_init(&function_jobs[i].tac, label_base);
+        function_jobs[i].ssa_mode = ssa_mode;
+        label_base += (int)module->functions[i]->block_count;
+    }
+
+    // Dominators, frontiers, phi insertion, TAC, SSA and optimisation per function
+    printf("\nRunning middle end on %zu functions...\n", module->function_count);
+    if (jobs == 1 || module->function_count < 2) {
+        for (size_t i = 0; i < module->function_count; i++) {
+            compile_function(&function_jobs[i]);
+        }
+    } else {
+        ThreadPool *pool = pool_create(jobs);
+        printf("Using %zu threads\n", pool_thread_count(pool));
+        for (size_t i = 0; i < module->function_count; i++) {
+            pool_submit(pool, compile_function, &function_jobs[i]);
+        }
+        pool_destroy(pool);
+    }
+
+    // Report in source order so the output does not depend on scheduling
+    PhiStats phi_total = { 0, 0 };
+    for (size_t i = 0; i < module->function_count; i++) {
+        phi_total.inserted += function_jobs[i].phi_stats.inserted;
+        phi_total.avoided += function_jobs[i].phi_stats.avoided;
+    }
+    printf("φ-functions: %zu inserted, %zu avoided by pruning\n", phi_total.inserted, phi_total.avoided);
+
+    MODULE_FOREACH(module, cfg) {
+        const char *name = symbol_name(cfg->function_name);
+        printf("\nFunction %s:\n", name);
+
+        snprintf(dot_filename, sizeof(dot_filename), "df_%s.dot", name);
+        generate_dominance_frontiers_dot(cfg, dot_filename);
+        printf("Dominance Frontiers saved to %s\n", dot_filename);
+
+        snprintf(dot_filename, sizeof(dot_filename), "cfg_with_phi_%s.dot", name);
+        generate_dot_file(cfg, dot_filename);
+        printf("Modified Control Flow Graph with φ-functions saved to %s\n", dot_filename);
+
+        printf("\nThree-address code (SSA):\n");
+        print_tac(cfg, stdout);
+    }
+    free(function_jobs);
+
     // Clean up
     printf("\nCleaning up ...\n");
-    free_cfg(cfg);
+    free_module(module);
     free_ast(ast);
-    free(code);
 
     printf("\nCompilation completed successfully.\n");
     return 0;
@@ -4,148 +4,348 @@
  * Purpose: Analyzes token streams and builds a structured representation of the source code.
  */
 
+#include "arena.h"
 #include "ast.h"
+#include "const_eval.h"
 #include "lexer.h"
 #include "parser.h"
+#include "pool.h"
 #include "debug.h"
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+// A name declared in the function being parsed, so references to it carry its type
 typedef struct {
-    Lexer *lexer;
-    Token current;
-    Token previous;
+    Symbol name;
+    Type *type;
+} NameBinding;
+
+typedef struct {
+    const TokenBuffer *buffer;
+    const CompactToken *tokens;  // Whole input, ending in TOK_EOF
+    size_t token_count;
+    size_t position;      // Index of current
+    size_t literal_cursor; // Next entry of buffer->literals; literals are read in token order
+    LineTable lines;      // Built on the first diagnostic
+    Arena *arena; // Owns every node, type and array built for this compilation unit
+    const CompactToken *current;
+    const CompactToken *previous;
     bool had_error;
     bool panic_mode;
+    bool lazy; // Record function bodies as token ranges instead of parsing them
+    bool quiet; // Keep diagnostics to had_error; set on worker parsers, whose errors are reparsed serially
+    bool fold; // Build operators through the folding builder
+    bool evaluate; // The function being parsed has sizeof, constexpr or static_assert for const_eval
+    bool rejected; // const_eval turned something down; parsing goes on, but there is no tree
+    size_t folded; // Operator nodes the folding builder left out
+    ASTNode *stripped; // Operand the latest x + 0 style fold returned; an rvalue even if a variable
+    // Explicit stacks, so nesting in the input never becomes C stack depth
+    ASTNode **pending; // Operands, clauses and finished statements awaiting their parent
+    size_t pending_count;
+    size_t pending_capacity;
+    struct ExprFrame *expr_frames;
+    size_t expr_frame_count;
+    size_t expr_frame_capacity;
+    struct StmtFrame *stmt_frames;
+    size_t stmt_frame_count;
+    size_t stmt_frame_capacity;
+    // Names in scope in the function being parsed, innermost last
+    NameBinding *names;
+    size_t name_count;
+    size_t name_capacity;
 } Parser;
 
 typedef enum {
     PREC_NONE,
-    PREC_ASSIGNMENT, // =
+    PREC_COMMA, // ,
+    PREC_ASSIGNMENT, // = += -= *= /= %= &= |= ^= <<= >>=
+    PREC_CONDITIONAL, // ?:
     PREC_OR, // ||
     PREC_AND, // &&
+    PREC_BIT_OR, // |
+    PREC_BIT_XOR, // ^
+    PREC_BIT_AND, // &
     PREC_EQUALITY, // == !=
     PREC_COMPARISON, // < > <= >=
+    PREC_SHIFT, // << >>
     PREC_TERM, // + -
     PREC_FACTOR, // * / %
-    PREC_UNARY, // ! - +
-    PREC_CALL, // . () []
+    PREC_UNARY, // ! - + ~ * & and prefix ++ --
+    PREC_POSTFIX, // postfix ++ --
     PREC_PRIMARY
 } Precedence;
 
-typedef ASTNode* (*PrefixParseFn)(Parser *parser);
-typedef ASTNode (*InfixParseFn)(Parser *parser, ASTNode *left);
+// How a token continues an expression once there is an operand to its left
+typedef enum {
+    INFIX_NONE,
+    INFIX_BINARY, // Left-associative
+    INFIX_ASSIGN, // Right-associative; = needs a variable on its left
+    INFIX_CONDITIONAL, // ? opens the middle operand and : closes it
+    INFIX_POSTFIX // ++ and -- after an operand
+} InfixKind;
 
 typedef struct {
-    PrefixParseFn prefix;
-    InfixParseFn infix;
-    Precedence precedence;
+    bool prefix; // A unary operator where an operand is expected
+    InfixKind infix;
+    Precedence precedence; // Binding power as an infix or postfix operator
 } ParseRule;
 
+/*
+ * Pending work in the expression parser. Operator frames are reduced as soon as an
+ * operator binding looser than min arrives; bracket frames (the expression itself,
+ * a group, a call and the middle of ?:) only end at their closing token.
+ */
+typedef enum {
+    FRAME_EXPRESSION, // Bottom of one parse_precedence call
+    FRAME_GROUP, // ( ... )
+    FRAME_CALL, // name( ... ); the arguments collect on the pending stack
+    FRAME_THEN, // cond ? ... :
+    FRAME_ELSE, // cond ? then : ...
+    FRAME_PREFIX,
+    FRAME_BINARY,
+    FRAME_ASSIGN
+} FrameKind;
+
+typedef struct ExprFrame {
+    FrameKind kind;
+    Precedence min; // Operators binding at least this tightly continue inside the frame
+    int op;
+    Symbol name; // Callee of a FRAME_CALL
+    size_t base; // Pending stack depth when the frame opened
+} ExprFrame;
+
+// Statements that contain statements: a block, and the bodies of if, while and for
+typedef enum {
+    STMT_BLOCK, // Finished statements collect from base
+    STMT_IF, // Condition at base
+    STMT_ELSE, // Condition and then branch at base
+    STMT_WHILE, // Condition at base
+    STMT_FOR // Initializer, condition and update at base
+} StmtKind;
+
+typedef struct StmtFrame {
+    StmtKind kind;
+    size_t base;
+    size_t names; // name_count when the frame's scope opened; the names after it go when it closes
+} StmtFrame;
+
+// A function body skipped by a lazy parse: the tokens between its braces
+typedef struct DeferredBody {
+    const TokenBuffer *tokens;
+    Arena *arena; // The program's, which the body is parsed into
+    size_t start; // Token after '{'
+    size_t end; // The matching '}'
+    bool fold; // Whether the signature was parsed with folding
+} DeferredBody;
+
 // Forward declarations
 static ASTNode* parse_expression(Parser *parser);
-static ASTNode* parse_statement(Parser *parser);
+static ASTNode* parse_assignment(Parser *parser);
 static ASTNode* parse_block(Parser *parser);
 static ASTNode* parse_var_declaration(Parser *parser);
 static Type* parse_type(Parser *parser);
-static Precedence get_precedence(TokenType type);
+
+// Doubles a parser stack; capacity is in elements
+static void *grow_stack(void *items, size_t *capacity, size_t size) {
+    *capacity = *capacity ? *capacity * 2 : 64;
+    items = realloc(items, size * *capacity);
+    if (!items) {
+        LOG_ERROR("Unable to allocate memory for parser stack");
+        exit(EXIT_FAILURE);
+    }
+    return items;
+}
+
+static void push_pending(Parser *parser, ASTNode *node) {
+    if (parser->pending_count == parser->pending_capacity) {
+        parser->pending = grow_stack(parser->pending, &parser->pending_capacity, sizeof(ASTNode *));
+    }
+    parser->pending[parser->pending_count++] = node;
+}
+
+static ASTNode *pop_pending(Parser *parser) {
+    return parser->pending[--parser->pending_count];
+}
+
+// Copies pending[base..] into the arena and drops it from the stack; NULL when empty
+static ASTNode **take_pending(Parser *parser, size_t base, size_t *count) {
+    *count = parser->pending_count - base;
+    ASTNode **items = NULL;
+    if (*count) {
+        items = arena_alloc(parser->arena, sizeof(ASTNode *) * *count);
+        memcpy(items, parser->pending + base, sizeof(ASTNode *) * *count);
+    }
+    parser->pending_count = base;
+    return items;
+}
+
+static ExprFrame *push_expr_frame(Parser *parser, FrameKind kind, Precedence min, int op) {
+    if (parser->expr_frame_count == parser->expr_frame_capacity) {
+        parser->expr_frames = grow_stack(parser->expr_frames, &parser->expr_frame_capacity, sizeof(ExprFrame));
+    }
+    ExprFrame *frame = &parser->expr_frames[parser->expr_frame_count++];
+    frame->kind = kind;
+    frame->min = min;
+    frame->op = op;
+    frame->name = 0;
+    frame->base = parser->pending_count;
+    return frame;
+}
+
+static StmtFrame *push_stmt_frame(Parser *parser, StmtKind kind, size_t base) {
+    if (parser->stmt_frame_count == parser->stmt_frame_capacity) {
+        parser->stmt_frames = grow_stack(parser->stmt_frames, &parser->stmt_frame_capacity, sizeof(StmtFrame));
+    }
+    StmtFrame *frame = &parser->stmt_frames[parser->stmt_frame_count++];
+    frame->kind = kind;
+    frame->base = base;
+    frame->names = parser->name_count;
+    return frame;
+}
+
+static void declare_name(Parser *parser, Symbol name, Type *type) {
+    if (parser->name_count == parser->name_capacity) {
+        parser->names = grow_stack(parser->names, &parser->name_capacity, sizeof(NameBinding));
+    }
+    parser->names[parser->name_count++] = (NameBinding){ name, type };
+}
+
+// The type the innermost declaration of name gave it; NULL for names declared nowhere in the function
+static Type *name_type(const Parser *parser, Symbol name) {
+    for (size_t i = parser->name_count; i-- > 0;) {
+        if (parser->names[i].name == name) return parser->names[i].type;
+    }
+    return NULL;
+}
+
+// Starts the scope of a function's body with its parameters; array parameters are pointers
+static void declare_parameters(Parser *parser, const ASTNode *params) {
+    parser->name_count = 0;
+    for (size_t i = 0; params && i < params->data.param_list.count; i++) {
+        const ASTNode *param = params->data.param_list.params[i];
+        Type *type = param->data.var_decl.type;
+        declare_name(parser, param->data.var_decl.name, type->kind == TYPE_ARRAY ? type_pointer(type->base) : type);
+    }
+}
 
 static void advance(Parser *parser) {
     parser->previous = parser->current;
-    for (;;) {
-        parser->current = next_token(parser->lexer);
-        if (parser->current.type != TOK_COMMENT && parser->current.type != TOK_WHITESPACE) break;
+    if (parser->position + 1 < parser->token_count) parser->position++;
+    parser->current = &parser->tokens[parser->position];
+}
+
+// The cursor hits for in-order reads; anything else falls back to bisection
+static const Literal *token_literal(Parser *parser, const CompactToken *token) {
+    const TokenBuffer *buffer = parser->buffer;
+    size_t index = (size_t)(token - parser->tokens);
+    if (parser->literal_cursor < buffer->literal_count && buffer->literals[parser->literal_cursor].token == index) {
+        return &buffer->literals[parser->literal_cursor++];
     }
+    const Literal *literal = token_buffer_literal(buffer, index);
+    if (literal) parser->literal_cursor = (size_t)(literal - buffer->literals) + 1;
+    return literal;
+}
+
+static const char *token_text(const Parser *parser, const CompactToken *token) {
+    return parser->buffer->source + token->offset;
+}
+
+// Identifiers are interned as the parser consumes them rather than in the lexer
+static Symbol token_symbol(const Parser *parser, const CompactToken *token) {
+    return intern(token_text(parser, token), token->length);
 }
 
 static void synchronize(Parser *parser) {
-    LOG_INFO("Synchronize: Current token type: %s", token_type_to_string(parser->current.type));
-    LOG_INFO("Synchronize: Previous token type: %s", token_type_to_string(parser->previous.type));
+    LOG_INFO("Synchronize: Current token type: %s", token_type_to_string(parser->current->type));
+    LOG_INFO("Synchronize: Previous token type: %s", token_type_to_string(parser->previous->type));
     LOG_INFO("Entering synchronize: current token=%s, previous token=%s", 
-             token_type_to_string(parser->current.type), 
-             token_type_to_string(parser->previous.type));
+             token_type_to_string(parser->current->type), 
+             token_type_to_string(parser->previous->type));
 
     LOG_INFO("Starting synchronization loop");
-    LOG_INFO("Initial token: %s, line: %u, column: %u", token_type_to_string(parser->current.type), parser->current.line, parser->current.column);
-    LOG_INFO("Initial previous token: %s, line: %u, column: %u", token_type_to_string(parser->previous.type), parser->previous.line, parser->previous.column);
+    LOG_INFO("Initial token: %s, offset: %u", token_type_to_string(parser->current->type), parser->current->offset);
+    LOG_INFO("Initial previous token: %s, offset: %u", token_type_to_string(parser->previous->type), parser->previous->offset);
 
     int iteration_count = 0;
     const int max_iterations = 1000; // Safeguard to prevent infinite loops
 
-    while (parser->current.type == TOK_SEMICOLON) {
+    while (parser->current->type == TOK_SEMICOLON) {
         LOG_INFO("Skipping redundant semicolon during synchronization, iteration: %d", iteration_count);
-        LOG_INFO("Current token before advance: %s, line: %u, column: %u", token_type_to_string(parser->current.type), parser->current.line, parser->current.column);
+        LOG_INFO("Current token before advance: %s, offset: %u", token_type_to_string(parser->current->type), parser->current->offset);
         advance(parser);
-        LOG_INFO("Current token after advance: %s, line: %u, column: %u", token_type_to_string(parser->current.type), parser->current.line, parser->current.column);
+        LOG_INFO("Current token after advance: %s, offset: %u", token_type_to_string(parser->current->type), parser->current->offset);
         if (++iteration_count > max_iterations) {
             LOG_ERROR("Exceeded maximum iterations in synchronize while skipping semicolons");
             return;
         }
     }
 
-    if (parser->current.type == TOK_EOF) {
+    if (parser->current->type == TOK_EOF) {
         LOG_INFO("Reached EOF during synchronization");
         return;
     }
 
-    while (parser->current.type == TOK_SEMICOLON || parser->current.type == TOK_UNKNOWN) {
-        LOG_INFO("Skipping invalid or redundant token: %s, iteration: %d", token_type_to_string(parser->current.type), iteration_count);
-        LOG_INFO("Current token before advance: %s, line: %u, column: %u", token_type_to_string(parser->current.type), parser->current.line, parser->current.column);
+    while (parser->current->type == TOK_SEMICOLON || parser->current->type == TOK_UNKNOWN) {
+        LOG_INFO("Skipping invalid or redundant token: %s, iteration: %d", token_type_to_string(parser->current->type), iteration_count);
+        LOG_INFO("Current token before advance: %s, offset: %u", token_type_to_string(parser->current->type), parser->current->offset);
         advance(parser);
-        LOG_INFO("Current token after advance: %s, line: %u, column: %u", token_type_to_string(parser->current.type), parser->current.line, parser->current.column);
+        LOG_INFO("Current token after advance: %s, offset: %u", token_type_to_string(parser->current->type), parser->current->offset);
         if (++iteration_count > max_iterations) {
             LOG_ERROR("Exceeded maximum iterations in synchronize while skipping invalid tokens");
             return;
         }
     }
 
-    while (parser->current.type != TOK_EOF) {
+    while (parser->current->type != TOK_EOF) {
         LOG_INFO("Checking synchronization point: current token=%s, previous token=%s, iteration: %d", 
-                 token_type_to_string(parser->current.type), 
-                 token_type_to_string(parser->previous.type), 
+                 token_type_to_string(parser->current->type), 
+                 token_type_to_string(parser->previous->type), 
                  iteration_count);
 
-        if (parser->previous.type == TOK_SEMICOLON ||
-            parser->current.type == TOK_KW_RETURN ||
-            parser->current.type == TOK_KW_IF ||
-            parser->current.type == TOK_KW_WHILE ||
-            parser->current.type == TOK_KW_FOR ||
-            parser->current.type == TOK_KW_INT ||
-            parser->current.type == TOK_KW_CHAR ||
-            parser->current.type == TOK_KW_VOID) {
-            LOG_INFO("Recovered at valid synchronization point: %s", token_type_to_string(parser->current.type));
+        if (parser->previous->type == TOK_SEMICOLON ||
+            parser->current->type == TOK_KW_RETURN ||
+            parser->current->type == TOK_KW_IF ||
+            parser->current->type == TOK_KW_WHILE ||
+            parser->current->type == TOK_KW_FOR ||
+            parser->current->type == TOK_KW_INT ||
+            parser->current->type == TOK_KW_CHAR ||
+            parser->current->type == TOK_KW_VOID) {
+            LOG_INFO("Recovered at valid synchronization point: %s", token_type_to_string(parser->current->type));
             LOG_INFO("Parser state before resuming: current token=%s, previous token=%s", 
-                     token_type_to_string(parser->current.type), 
-                     token_type_to_string(parser->previous.type));
+                     token_type_to_string(parser->current->type), 
+                     token_type_to_string(parser->previous->type));
             LOG_INFO("Parser panic mode: %s", parser->panic_mode ? "true" : "false");
             return;
         }
 
-        LOG_INFO("Advancing past token: %s, iteration: %d", token_type_to_string(parser->current.type), iteration_count);
-        LOG_INFO("Current token before advance: %s, line: %u, column: %u", token_type_to_string(parser->current.type), parser->current.line, parser->current.column);
+        LOG_INFO("Advancing past token: %s, iteration: %d", token_type_to_string(parser->current->type), iteration_count);
+        LOG_INFO("Current token before advance: %s, offset: %u", token_type_to_string(parser->current->type), parser->current->offset);
         advance(parser);
-        LOG_INFO("Current token after advance: %s, line: %u, column: %u", token_type_to_string(parser->current.type), parser->current.line, parser->current.column);
+        LOG_INFO("Current token after advance: %s, offset: %u", token_type_to_string(parser->current->type), parser->current->offset);
         if (++iteration_count > max_iterations) {
             LOG_ERROR("Exceeded maximum iterations in synchronize while advancing past tokens");
             return;
         }
     }
 
-    LOG_INFO("Exiting synchronize: current token=%s, iteration: %d", token_type_to_string(parser->current.type), iteration_count);
+    LOG_INFO("Exiting synchronize: current token=%s, iteration: %d", token_type_to_string(parser->current->type), iteration_count);
 }
 
 static void error_at_current(Parser *parser, const char *message) {
-    fprintf(stderr, "Error at line %u, column %u: %s\n",
-    parser->current.line, parser->current.column, message);
+    if (!parser->quiet) {
+        SourceLocation location = line_table_locate(&parser->lines, parser->current->offset);
+        fprintf(stderr, "Error at line %u, column %u: %s\n", location.line, location.column, message);
+    }
     parser->had_error = true;
     parser->panic_mode = true;
     synchronize(parser);
 }
     
 static void consume(Parser *parser, TokenType type, const char *message) {
-    LOG_INFO("current token: %s", token_type_to_string(parser->current.type));
-    if (parser->current.type == type) {
+    LOG_INFO("current token: %s", token_type_to_string(parser->current->type));
+    if (parser->current->type == type) {
         advance(parser);
         return;
     }
@@ -153,7 +353,7 @@ static void consume(Parser *parser, TokenType type, const char *message) {
 }
 
 static bool match(Parser *parser, TokenType type) {
-    if (parser->current.type == type) {
+    if (parser->current->type == type) {
         advance(parser);
         return true;
     }
@@ -161,37 +361,16 @@ static bool match(Parser *parser, TokenType type) {
 }
     
 static bool check(Parser *parser, TokenType type) {
-    return parser->current.type == type;
-}
-    
-static Type* create_type(TypeKind kind) {
-    LOG_INFO("creating type %d", kind);
-    Type *type = malloc(sizeof(Type));
-    if (!type) return NULL;
-    type->kind = kind;
-    type->base = NULL;
-    type->array_size = 0;
-    return type;
+    return parser->current->type == type;
 }
 
-static Type* create_pointer_type(Type *base) {
-    Type *type = create_type(TYPE_POINTER);
-    if (!type) return NULL;
-    type->base = base;
-    return type;
+// The type specifiers parse_type accepts
+static bool is_type_name(TokenType type) {
+    return type == TOK_KW_INT || type == TOK_KW_CHAR || type == TOK_KW_VOID;
 }
-
-static Type* create_array_type(Type *base, size_t size) {
-    Type *type = create_type(TYPE_ARRAY);
-    if (!type) return NULL;
-    type->base = base;
-    type->array_size = size;
-    return type;
-}
-
-static ASTNode* create_literal_node(int value, Type *type) {
-    ASTNode *node = malloc(sizeof(ASTNode));
-    if (!node) return NULL;
+    
+static ASTNode* create_literal_node(Arena *arena, long long value, Type *type) {
+    ASTNode *node = arena_alloc(arena, sizeof(ASTNode));
     node->type = NODE_LITERAL;
     node->data.literal.value.int_value = value;
     node->data.literal.type = type;
@@ -199,9 +378,8 @@ static ASTNode* create_literal_node(int value, Type *type) {
     return node;
 }
 
-static ASTNode *create_literal_node_with_ptr(void *ptr, Type *type) {
-    ASTNode *node = malloc(sizeof(ASTNode));
-    if (!node) return NULL;
+static ASTNode *create_literal_node_with_ptr(Arena *arena, void *ptr, Type *type) {
+    ASTNode *node = arena_alloc(arena, sizeof(ASTNode));
     node->type = NODE_LITERAL;
     node->data.literal.value.ptr_value = ptr;
     node->data.literal.type = type;
@@ -209,13 +387,12 @@ static ASTNode *create_literal_node_with_ptr(void *ptr, Type *type) {
     return node;
 }
 
-static ASTNode* create_binary_op_node(int op, ASTNode *left, ASTNode *right) {
+static ASTNode* create_binary_op_node(Arena *arena, int op, ASTNode *left, ASTNode *right) {
     LOG_INFO("Creating binary operation node: op=%s, left=%s, right=%s", 
              token_type_to_string(op), 
              left ? node_type_to_string(left->type) : "NULL", 
              right ? node_type_to_string(right->type) : "NULL");
-    ASTNode *node = malloc(sizeof(ASTNode));
-    if (!node) return NULL;
+    ASTNode *node = arena_alloc(arena, sizeof(ASTNode));
     node->type = NODE_BINARY_OP;
     node->data.binary_op.op = op;
     node->data.binary_op.left = left;
@@ -224,9 +401,8 @@ static ASTNode* create_binary_op_node(int op, ASTNode *left, ASTNode *right) {
     return node;
 }
 
-static ASTNode* create_unary_op_node(int op, ASTNode *operand, bool is_prefix) {
-    ASTNode *node = malloc(sizeof(ASTNode));
-    if (!node) return NULL;
+static ASTNode* create_unary_op_node(Arena *arena, int op, ASTNode *operand, bool is_prefix) {
+    ASTNode *node = arena_alloc(arena, sizeof(ASTNode));
     node->type = NODE_UNARY_OP;
     node->data.unary_op.op = op;
     node->data.unary_op.operand = operand;
@@ -235,61 +411,58 @@ static ASTNode* create_unary_op_node(int op, ASTNode *operand, bool is_prefix) {
     return node;
 }
 
-static ASTNode* create_var_ref_node(const char *name, Type *type) {
-    ASTNode *node = malloc(sizeof(ASTNode));
-    if (!node) return NULL;
+static ASTNode* create_var_ref_node(Arena *arena, Symbol name, Type *type) {
+    ASTNode *node = arena_alloc(arena, sizeof(ASTNode));
     node->type = NODE_VAR_REF;
-    node->data.var_ref.name = strdup(name);
+    node->data.var_ref.name = name;
     node->data.var_ref.type = type;
     LOG_INFO("Creating AST Node: Type=%s", node_type_to_string(node->type));
     return node;
 }
 
-static ASTNode* create_var_decl_node(const char *name, Type *type, ASTNode *init_value) {
-    ASTNode *node = malloc(sizeof(ASTNode));
-    if (!node) return NULL;
+static ASTNode* create_var_decl_node(Arena *arena, Symbol name, Type *type, ASTNode *init_value) {
+    ASTNode *node = arena_alloc(arena, sizeof(ASTNode));
     node->type = NODE_VAR_DECL;
-    node->data.var_decl.name = strdup(name);
+    node->data.var_decl.name = name;
     node->data.var_decl.type = type;
     node->data.var_decl.init_value = init_value;
+    node->data.var_decl.is_constexpr = false;
+    node->data.var_decl.array_size = NULL;
     LOG_INFO("Creating AST Node: Type=%s", node_type_to_string(node->type));
     return node;
 }
 
-static ASTNode* create_assignment_node(const char *name, ASTNode *value) {
-    ASTNode *node = malloc(sizeof(ASTNode));
-    if (!node) return NULL;
+static ASTNode* create_assignment_node(Arena *arena, Symbol name, ASTNode *value) {
+    ASTNode *node = arena_alloc(arena, sizeof(ASTNode));
     node->type = NODE_ASSIGNMENT;
-    node->data.assignment.name = strdup(name);
+    node->data.assignment.name = name;
     node->data.assignment.value = value;
     LOG_INFO("Creating AST Node: Type=%s", node_type_to_string(node->type));
     return node;
 }
 
-static ASTNode* create_function_decl_node(const char *name, Type *return_type, ASTNode *params, ASTNode *body) {
-    ASTNode *node = malloc(sizeof(ASTNode));
-    if (!node) return NULL;
+static ASTNode* create_function_decl_node(Arena *arena, Symbol name, Type *return_type, ASTNode *params, ASTNode *body) {
+    ASTNode *node = arena_alloc(arena, sizeof(ASTNode));
     node->type = NODE_FUNCTION_DECL;
-    node->data.function_decl.name = strdup(name);
+    node->data.function_decl.name = name;
     node->data.function_decl.return_type = return_type;
     node->data.function_decl.params = params;
     node->data.function_decl.body = body;
+    node->data.function_decl.deferred = NULL;
     LOG_INFO("Creating AST Node: Type=%s", node_type_to_string(node->type));
     return node;
 }
 
-static ASTNode* create_return_node(ASTNode *value) {
-    ASTNode *node = malloc(sizeof(ASTNode));
-    if (!node) return NULL;
+static ASTNode* create_return_node(Arena *arena, ASTNode *value) {
+    ASTNode *node = arena_alloc(arena, sizeof(ASTNode));
     node->type = NODE_RETURN;
     node->data.return_stmt.value = value;
     LOG_INFO("Creating AST Node: Type=%s", node_type_to_string(node->type));
     return node;
 }
 
-static ASTNode* create_param_list_node(ASTNode **params, size_t count) {
-    ASTNode *node = malloc(sizeof(ASTNode));
-    if (!node) return NULL;
+static ASTNode* create_param_list_node(Arena *arena, ASTNode **params, size_t count) {
+    ASTNode *node = arena_alloc(arena, sizeof(ASTNode));
     node->type = NODE_PARAM_LIST;
     node->data.param_list.params = params;
     node->data.param_list.count = count;
@@ -297,9 +470,8 @@ static ASTNode* create_param_list_node(ASTNode **params, size_t count) {
     return node;
 }
 
-static ASTNode* create_stmt_list_node(ASTNode **stmts, size_t count) {
-    ASTNode *node = malloc(sizeof(ASTNode));
-    if (!node) return NULL;
+static ASTNode* create_stmt_list_node(Arena *arena, ASTNode **stmts, size_t count) {
+    ASTNode *node = arena_alloc(arena, sizeof(ASTNode));
     node->type = NODE_STMT_LIST;
     node->data.stmt_list.stmts = stmts;
     node->data.stmt_list.count = count;
@@ -307,208 +479,457 @@ static ASTNode* create_stmt_list_node(ASTNode **stmts, size_t count) {
     return node;
 }
 
-static ASTNode* create_type_spec_node(Type *type) {
-    ASTNode *node = malloc(sizeof(ASTNode));
-    if (!node) return NULL;
+static ASTNode* create_type_spec_node(Arena *arena, Type *type) {
+    ASTNode *node = arena_alloc(arena, sizeof(ASTNode));
     node->type = NODE_TYPE_SPECIFIER;
     node->data.type_spec.type = type;
     LOG_INFO("Creating AST Node: Type=%s", node_type_to_string(node->type));
     return node;
 }
 
-static ASTNode* parse_primary(Parser *parser) {
-    LOG_INFO("current token: %s", token_type_to_string(parser->current.type));
-    if (match(parser, TOK_INTEGER)) {
-        int value = atoi(parser->previous.text);
-        return create_literal_node(value, create_type(TYPE_INT));
-    }
+static ASTNode* create_ternary_node(Arena *arena, ASTNode *condition, ASTNode *then_expr, ASTNode *else_expr) {
+    ASTNode *node = arena_alloc(arena, sizeof(ASTNode));
+    node->type = NODE_TERNARY;
+    node->data.ternary.condition = condition;
+    node->data.ternary.then_expr = then_expr;
+    node->data.ternary.else_expr = else_expr;
+    LOG_INFO("Creating AST Node: Type=%s", node_type_to_string(node->type));
+    return node;
+}
+
+static ASTNode* create_static_assert_node(Arena *arena, ASTNode *condition, ASTNode *message) {
+    ASTNode *node = arena_alloc(arena, sizeof(ASTNode));
+    node->type = NODE_STATIC_ASSERT;
+    node->data.assertion.condition = condition;
+    node->data.assertion.message = message;
+    LOG_INFO("Creating AST Node: Type=%s", node_type_to_string(node->type));
+    return node;
+}
+
+static const ParseRule rules[TOK_WHITESPACE + 1];
 
-    if (match(parser, TOK_STRING)) {
-        char *value = strndup(parser->previous.text, parser->previous.length);
-        return create_literal_node_with_ptr(value, create_type(TYPE_POINTER));
+/* ---- Operands: called with the token just consumed ---- */
+
+/*
+ * The first type in C23's list for the constant's suffix that holds its value. Octal, hex
+ * and binary constants may also take the unsigned types; long and long long are both
+ * 64 bits here. A decimal constant too large for long long is unsigned long long, as GCC
+ * makes it.
+ */
+static Type *literal_type(const Literal *literal, bool decimal) {
+    uint64_t value = literal->value.integer;
+    bool is_unsigned = literal->flags & LITERAL_UNSIGNED;
+    bool may_be_unsigned = is_unsigned || !decimal;
+    if (!(literal->flags & (LITERAL_LONG | LITERAL_LONG_LONG))) {
+        if (!is_unsigned && value <= INT32_MAX) return type_get(TYPE_INT);
+        if (may_be_unsigned && value <= UINT32_MAX) return type_get(TYPE_UNSIGNED);
     }
+    bool long_long = literal->flags & LITERAL_LONG_LONG;
+    if (!is_unsigned && value <= INT64_MAX) return type_get(long_long ? TYPE_LONG_LONG : TYPE_LONG);
+    if (!long_long && may_be_unsigned) return type_get(TYPE_UNSIGNED_LONG);
+    return type_get(TYPE_UNSIGNED_LONG_LONG);
+}
 
-    if (match(parser, TOK_IDENTIFIER)) {
-        char *name = strndup(parser->previous.text, parser->previous.length);
-
-        // Check for function call
-        if (match(parser, TOK_LPAREN)) {
-            // Parse arguments
-            ASTNode **args = NULL;
-            size_t arg_count = 0;
-            size_t arg_capacity = 0;
-
-            if (!check(parser, TOK_RPAREN)) {
-                do {
-                    if (arg_count >= arg_capacity) {
-                        arg_capacity = arg_capacity == 0 ? 4 : arg_capacity * 2;
-                        args = realloc(args, sizeof(ASTNode *) * arg_capacity);
-                        if (!args) {
-                            LOG_ERROR("Memory allocation failed");
-                            return NULL;
-                        }
-                    }
+// The value keeps its 64 bits; the type says how to read them
+static ASTNode* parse_number(Parser *parser) {
+    const Literal *literal = token_literal(parser, parser->previous);
+    bool decimal = token_text(parser, parser->previous)[0] != '0' || parser->previous->length == 1;
+    return create_literal_node(parser->arena, (long long)literal->value.integer, literal_type(literal, decimal));
+}
 
-                    ASTNode *arg = parse_expression(parser);
-                    if (!arg) break;
+static ASTNode* parse_string(Parser *parser) {
+    char *value = arena_strndup(parser->arena, token_text(parser, parser->previous), parser->previous->length);
+    return create_literal_node_with_ptr(parser->arena, value, type_pointer(type_get(TYPE_CHAR)));
+}
 
-                    args[arg_count++] = arg;
-                } while (match(parser, TOK_COMMA));
-            }
+// Builds the call from the arguments collected since the frame opened
+static ASTNode* finish_call(Parser *parser, const ExprFrame *frame) {
+    ASTNode *call_node = arena_alloc(parser->arena, sizeof(ASTNode));
+    call_node->type = NODE_FUNCTION_CALL;
+    call_node->data.function_call.name = frame->name;
+    call_node->data.function_call.args = take_pending(parser, frame->base, &call_node->data.function_call.arg_count);
+    LOG_INFO("Creating AST Node: Type=%s", node_type_to_string(call_node->type));
+    return call_node;
+}
 
-            consume(parser, TOK_RPAREN, "Expect ')' after function arguments.");
-
-            // Create function call node
-            ASTNode *call_node = malloc(sizeof(ASTNode));
-            if (!call_node) return NULL;
-            call_node->type = NODE_FUNCTION_CALL;
-            call_node->data.function_call.name = name;
-            call_node->data.function_call.args = args;
-            call_node->data.function_call.arg_count = arg_count;
-            LOG_INFO("Creating AST Node: Type=%s", node_type_to_string(call_node->type));
-            return call_node;
-        }
+/*
+ * Indexed by TokenType. A token's precedence is its binding power as an infix or
+ * postfix operator; tokens that never continue an expression keep PREC_NONE, which
+ * is below every frame's min and so closes whatever is open.
+ */
+static const ParseRule rules[TOK_WHITESPACE + 1] = {
+    [TOK_BANG]          = { true,  INFIX_NONE,        PREC_NONE },
+    [TOK_TILDE]         = { true,  INFIX_NONE,        PREC_NONE },
+    [TOK_KW_SIZEOF]     = { true,  INFIX_NONE,        PREC_NONE },
+    [TOK_PLUS_PLUS]     = { true,  INFIX_POSTFIX,     PREC_POSTFIX },
+    [TOK_MINUS_MINUS]   = { true,  INFIX_POSTFIX,     PREC_POSTFIX },
+    [TOK_COMMA]         = { false, INFIX_BINARY,      PREC_COMMA },
+    [TOK_EQ]            = { false, INFIX_ASSIGN,      PREC_ASSIGNMENT },
+    [TOK_PLUS_EQ]       = { false, INFIX_ASSIGN,      PREC_ASSIGNMENT },
+    [TOK_MINUS_EQ]      = { false, INFIX_ASSIGN,      PREC_ASSIGNMENT },
+    [TOK_STAR_EQ]       = { false, INFIX_ASSIGN,      PREC_ASSIGNMENT },
+    [TOK_SLASH_EQ]      = { false, INFIX_ASSIGN,      PREC_ASSIGNMENT },
+    [TOK_PERCENT_EQ]    = { false, INFIX_ASSIGN,      PREC_ASSIGNMENT },
+    [TOK_AMP_EQ]        = { false, INFIX_ASSIGN,      PREC_ASSIGNMENT },
+    [TOK_PIPE_EQ]       = { false, INFIX_ASSIGN,      PREC_ASSIGNMENT },
+    [TOK_CARET_EQ]      = { false, INFIX_ASSIGN,      PREC_ASSIGNMENT },
+    [TOK_LSHIFT_EQ]     = { false, INFIX_ASSIGN,      PREC_ASSIGNMENT },
+    [TOK_RSHIFT_EQ]     = { false, INFIX_ASSIGN,      PREC_ASSIGNMENT },
+    [TOK_QUESTION]      = { false, INFIX_CONDITIONAL, PREC_CONDITIONAL },
+    [TOK_PIPE_PIPE]     = { false, INFIX_BINARY,      PREC_OR },
+    [TOK_AMP_AMP]       = { false, INFIX_BINARY,      PREC_AND },
+    [TOK_PIPE]          = { false, INFIX_BINARY,      PREC_BIT_OR },
+    [TOK_CARET]         = { false, INFIX_BINARY,      PREC_BIT_XOR },
+    [TOK_AMP]           = { true,  INFIX_BINARY,      PREC_BIT_AND },
+    [TOK_EQ_EQ]         = { false, INFIX_BINARY,      PREC_EQUALITY },
+    [TOK_BANG_EQ]       = { false, INFIX_BINARY,      PREC_EQUALITY },
+    [TOK_LT]            = { false, INFIX_BINARY,      PREC_COMPARISON },
+    [TOK_GT]            = { false, INFIX_BINARY,      PREC_COMPARISON },
+    [TOK_LT_EQ]         = { false, INFIX_BINARY,      PREC_COMPARISON },
+    [TOK_GT_EQ]         = { false, INFIX_BINARY,      PREC_COMPARISON },
+    [TOK_LSHIFT]        = { false, INFIX_BINARY,      PREC_SHIFT },
+    [TOK_RSHIFT]        = { false, INFIX_BINARY,      PREC_SHIFT },
+    [TOK_PLUS]          = { true,  INFIX_BINARY,      PREC_TERM },
+    [TOK_MINUS]         = { true,  INFIX_BINARY,      PREC_TERM },
+    [TOK_STAR]          = { true,  INFIX_BINARY,      PREC_FACTOR },
+    [TOK_SLASH]         = { false, INFIX_BINARY,      PREC_FACTOR },
+    [TOK_PERCENT]       = { false, INFIX_BINARY,      PREC_FACTOR },
+};
 
-        // Otherwise, it's a variable reference
-        return create_var_ref_node(name, NULL); // Type will be resolved later
-    }
-    
-    if (match(parser, TOK_LPAREN)) {
-        ASTNode *expr = parse_expression(parser);
-        consume(parser, TOK_RPAREN, "Expect ')' after expression.");
-        return expr;
-    }
-    
-    error_at_current(parser, "Expect expression.");
-    return NULL;
+/*
+ * Folding builder: with parser->fold set, operators go through build_binary and
+ * build_prefix, which evaluate int constants as C does and skip nodes whose value
+ * is already known. A fold that C leaves undefined or implementation-defined (signed
+ * overflow, division by zero, shifts out of range or of negative values) is not
+ * made, so the operation still happens, and is diagnosed, at run time.
+ */
+
+static bool int_constant(const ASTNode *node, int32_t *value) {
+    if (node->type != NODE_LITERAL || !node->data.literal.type || node->data.literal.type->kind != TYPE_INT) return false;
+    long long wide = node->data.literal.value.int_value;
+    if (wide < INT32_MIN || wide > INT32_MAX) return false;
+    *value = (int32_t)wide;
+    return true;
 }
 
-static ASTNode* parse_unary(Parser *parser) {
-    LOG_INFO("current token: %s", token_type_to_string(parser->current.type));
-    if (match(parser, TOK_MINUS) || match(parser, TOK_BANG)) {
-        Token op = parser->previous;
-        ASTNode *right = parse_unary(parser);
-        return create_unary_op_node(op.type, right, true); // true for prefix
+// The operator that gives the same result with its operands swapped, 0 if there is none
+static int swapped_operator(int op) {
+    switch (op) {
+        case TOK_PLUS:
+        case TOK_STAR:
+        case TOK_AMP:
+        case TOK_PIPE:
+        case TOK_CARET:
+        case TOK_EQ_EQ:
+        case TOK_BANG_EQ: return op;
+        case TOK_LT: return TOK_GT;
+        case TOK_GT: return TOK_LT;
+        case TOK_LT_EQ: return TOK_GT_EQ;
+        case TOK_GT_EQ: return TOK_LT_EQ;
+        default: return 0;
     }
+}
 
-    if (match(parser, TOK_MINUS_MINUS)) {
-        // Handle prefix decrement
-        Token op = parser->previous;
-        ASTNode *operand = parse_primary(parser);
-        return create_unary_op_node(op.type, operand, true); // true for prefix
-    }
+// Turns a spent literal node into the folded constant, so no node is allocated for it
+static ASTNode *fold_into(Parser *parser, ASTNode *literal, int32_t value) {
+    literal->data.literal.value.int_value = value;
+    literal->data.literal.type = type_get(TYPE_INT);
+    parser->folded++;
+    return literal;
+}
 
-    if (match(parser, TOK_PLUS_PLUS)) {
-        // Handle prefix increment
-        Token op = parser->previous;
-        ASTNode *operand = parse_primary(parser);
-        return create_unary_op_node(op.type, operand, true); // true for prefix
+// An operand's type where it needs no conversions to work out, NULL otherwise
+static Type *operand_type(const ASTNode *node) {
+    switch (node->type) {
+        case NODE_LITERAL: return node->data.literal.type;
+        case NODE_VAR_REF: return node->data.var_ref.type;
+        case NODE_BINARY_OP: {
+            int op = node->data.binary_op.op;
+            if (op == TOK_EQ_EQ || op == TOK_BANG_EQ || op == TOK_LT || op == TOK_GT || op == TOK_LT_EQ ||
+                op == TOK_GT_EQ || op == TOK_AMP_AMP || op == TOK_PIPE_PIPE) {
+                return type_get(TYPE_INT);
+            }
+            // One level only, so a long chain costs no recursion
+            const ASTNode *left = node->data.binary_op.left;
+            const ASTNode *right = node->data.binary_op.right;
+            bool int_leaves = (left->type == NODE_LITERAL || left->type == NODE_VAR_REF) &&
+                              (right->type == NODE_LITERAL || right->type == NODE_VAR_REF) &&
+                              operand_type(left) == type_get(TYPE_INT) && operand_type(right) == type_get(TYPE_INT);
+            return int_leaves && op != TOK_COMMA ? type_get(TYPE_INT) : NULL;
+        }
+        default: return NULL;
     }
+}
 
-    return parse_primary(parser);
+/*
+ * Whether dropping op from an identity leaves an operand of the same type and value. It
+ * does for an int, and for a pointer under + and -; a char would lose its promotion to
+ * int and an array its decay to a pointer, which sizeof can tell apart.
+ */
+static bool identity_keeps_type(const ASTNode *operand, int op) {
+    const Type *type = operand_type(operand);
+    if (!type) return false;
+    return type->kind == TYPE_INT || (type->kind == TYPE_POINTER && (op == TOK_PLUS || op == TOK_MINUS));
 }
 
-static ASTNode* parse_binary(Parser *parser, ASTNode *left, Precedence precedence) {
-    while (1) {
-        Precedence current_prec = get_precedence(parser->current.type);
-        if (current_prec < precedence) break;
-        Token op = parser->current;
-        advance(parser);
+// The operand of an identity such as x + 0; kept from becoming an assignment target
+static ASTNode *strip_to(Parser *parser, ASTNode *operand) {
+    parser->folded++;
+    parser->stripped = operand;
+    return operand;
+}
 
-        // Special case for assignment operator '='
-        if (op.type == TOK_EQ && precedence == PREC_ASSIGNMENT) {
-            LOG_INFO("Detected assignment operator in parse_binary");
-            ASTNode *right = parse_expression(parser);
-            if (!right) {
-                synchronize(parser);
-                return NULL;
+static ASTNode *build_binary(Parser *parser, int op, ASTNode *left, ASTNode *right) {
+    if (!parser->fold) return create_binary_op_node(parser->arena, op, left, right);
+
+    int32_t l = 0, r = 0, value;
+    bool left_constant = int_constant(left, &l);
+    bool right_constant = int_constant(right, &r);
+    if (left_constant && right_constant && const_eval_binary(op, l, r, &value)) return fold_into(parser, left, value);
+    // The left operand decides these without evaluating the right one
+    if (left_constant && op == TOK_AMP_AMP && l == 0) return fold_into(parser, left, 0);
+    if (left_constant && op == TOK_PIPE_PIPE && l != 0) return fold_into(parser, left, 1);
+
+    // Constants go on the right, so later stages only look for them there
+    if (left_constant && !right_constant && swapped_operator(op)) {
+        ASTNode *swap = left;
+        left = right;
+        right = swap;
+        op = swapped_operator(op);
+        r = l;
+        right_constant = true;
+    }
+    if (right_constant) {
+        bool zero_identity = r == 0 && (op == TOK_PLUS || op == TOK_MINUS || op == TOK_PIPE || op == TOK_CARET ||
+                                        op == TOK_LSHIFT || op == TOK_RSHIFT);
+        bool one_identity = r == 1 && (op == TOK_STAR || op == TOK_SLASH);
+        if ((zero_identity || one_identity) && identity_keeps_type(left, op)) return strip_to(parser, left);
+    }
+    return create_binary_op_node(parser->arena, op, left, right);
+}
+
+static ASTNode *build_prefix(Parser *parser, int op, ASTNode *operand) {
+    int32_t value;
+    if (!parser->fold) return create_unary_op_node(parser->arena, op, operand, true);
+    if (op == TOK_PLUS && identity_keeps_type(operand, 0)) return strip_to(parser, operand);
+    if (int_constant(operand, &value) && const_eval_unary(op, value, &value)) return fold_into(parser, operand, value);
+    return create_unary_op_node(parser->arena, op, operand, true);
+}
+
+// Folds the top operator frame and its operands into one node; false on an invalid assignment
+static bool reduce(Parser *parser) {
+    ExprFrame *frame = &parser->expr_frames[--parser->expr_frame_count];
+    ASTNode *node = NULL;
+    switch (frame->kind) {
+        case FRAME_PREFIX: {
+            ASTNode *operand = pop_pending(parser);
+            node = build_prefix(parser, frame->op, operand);
+            break;
+        }
+        case FRAME_BINARY: {
+            ASTNode *right = pop_pending(parser);
+            ASTNode *left = pop_pending(parser);
+            LOG_INFO("Creating binary operation node with operator: %s", token_type_to_string(frame->op));
+            node = build_binary(parser, frame->op, left, right);
+            break;
+        }
+        case FRAME_ASSIGN: {
+            // Compound assignments stay binary operations on their target
+            ASTNode *value = pop_pending(parser);
+            ASTNode *target = pop_pending(parser);
+            if (frame->op != TOK_EQ) {
+                node = create_binary_op_node(parser->arena, frame->op, target, value);
+            } else if (target->type == NODE_VAR_REF) {
+                node = create_assignment_node(parser->arena, target->data.var_ref.name, value);
+            } else {
+                error_at_current(parser, "Invalid assignment target.");
+                return false;
             }
-            return create_assignment_node(left->data.var_ref.name, right);
+            break;
         }
+        case FRAME_ELSE: {
+            ASTNode *else_expr = pop_pending(parser);
+            ASTNode *then_expr = pop_pending(parser);
+            ASTNode *condition = pop_pending(parser);
+            node = create_ternary_node(parser->arena, condition, then_expr, else_expr);
+            break;
+        }
+        default:
+            break;
+    }
+    push_pending(parser, node);
+    return true;
+}
 
-        ASTNode *right = parse_unary(parser);
-        if (!right) {
-            synchronize(parser);
+/*
+ * Parses an expression whose operators all bind at least as tightly as precedence.
+ * This is operator precedence parsing on explicit stacks (shunting-yard): operands
+ * wait on the pending stack and open operators and brackets on the frame stack, so
+ * a million-term chain or a deeply parenthesized input takes no C stack.
+ *
+ * The loop alternates between two positions. Where an operand is expected, prefix
+ * operators and opening brackets push frames until a primary arrives. Where an
+ * operator is expected, frames binding tighter than the next token are reduced;
+ * the token then either continues the innermost open frame as an operator or
+ * closes it.
+ */
+static ASTNode* parse_operators(Parser *parser, Precedence precedence) {
+    push_expr_frame(parser, FRAME_EXPRESSION, precedence, 0);
+
+    for (;;) {
+        /* Operand position */
+        TokenType type = parser->current->type;
+        // sizeof ( type-name ) is an operand of its own; sizeof before an expression is a prefix operator
+        bool sizeof_type = type == TOK_KW_SIZEOF && parser->tokens[parser->position + 1].type == TOK_LPAREN &&
+                           is_type_name((TokenType)parser->tokens[parser->position + 2].type);
+        if (type == TOK_KW_SIZEOF) parser->evaluate = true;
+        if (rules[type].prefix && !sizeof_type) {
+            push_expr_frame(parser, FRAME_PREFIX, PREC_UNARY, type);
+            advance(parser);
+            continue;
+        }
+        if (type == TOK_LPAREN) {
+            push_expr_frame(parser, FRAME_GROUP, PREC_COMMA, 0);
+            advance(parser);
+            continue;
+        }
+        if (type == TOK_IDENTIFIER && parser->tokens[parser->position + 1].type == TOK_LPAREN) {
+            // Calls name their callee directly; an argument is an assignment expression
+            ExprFrame *frame = push_expr_frame(parser, FRAME_CALL, PREC_ASSIGNMENT, 0);
+            frame->name = token_symbol(parser, parser->current);
+            advance(parser);
+            advance(parser);
+            if (!match(parser, TOK_RPAREN)) continue;
+            push_pending(parser, finish_call(parser, frame));
+            parser->expr_frame_count--;
+        } else if (sizeof_type) {
+            advance(parser);
+            advance(parser);
+            Type *operand = parse_type(parser);
+            if (!operand) return NULL;
+            if (!match(parser, TOK_RPAREN)) {
+                error_at_current(parser, "Expect ')' after type name.");
+                return NULL;
+            }
+            push_pending(parser, create_unary_op_node(parser->arena, TOK_KW_SIZEOF, create_type_spec_node(parser->arena, operand), true));
+        } else if (type == TOK_IDENTIFIER) {
+            advance(parser);
+            push_pending(parser, create_var_ref_node(parser->arena, token_symbol(parser, parser->previous),
+                                                     name_type(parser, token_symbol(parser, parser->previous))));
+        } else if (type == TOK_INTEGER) {
+            if (token_literal(parser, parser->current)->flags & LITERAL_BIT_PRECISE) {
+                error_at_current(parser, "Bit-precise integer constants are not supported.");
+                return NULL;
+            }
+            advance(parser);
+            push_pending(parser, parse_number(parser));
+        } else if (type == TOK_STRING) {
+            advance(parser);
+            push_pending(parser, parse_string(parser));
+        } else {
+            error_at_current(parser, "Expect expression.");
             return NULL;
         }
 
-        current_prec = get_precedence(parser->current.type);
-        while (current_prec > get_precedence(op.type)) {
-            right = parse_binary(parser, right, current_prec);
-            current_prec = get_precedence(parser->current.type);
-        }
+        /* Operator position */
+        for (;;) {
+            const ParseRule *rule = &rules[parser->current->type];
+            ExprFrame *top = &parser->expr_frames[parser->expr_frame_count - 1];
+            // Operator frames follow the brackets in FrameKind
+            while (top->kind >= FRAME_ELSE && rule->precedence < top->min) {
+                if (!reduce(parser)) return NULL;
+                top = &parser->expr_frames[parser->expr_frame_count - 1];
+            }
 
-        LOG_INFO("Creating binary operation node with operator: %s", token_type_to_string(op.type));
-        left = create_binary_op_node(op.type, left, right);
-    }
+            if (rule->infix != INFIX_NONE && rule->precedence >= top->min) {
+                TokenType op = parser->current->type;
+                advance(parser);
+                if (rule->infix == INFIX_POSTFIX) {
+                    ASTNode *operand = pop_pending(parser);
+                    push_pending(parser, create_unary_op_node(parser->arena, op, operand, false)); // false for postfix
+                    continue;
+                }
+                if (rule->infix == INFIX_BINARY) {
+                    push_expr_frame(parser, FRAME_BINARY, rule->precedence + 1, op);
+                } else if (rule->infix == INFIX_ASSIGN) {
+                    // The left operand is complete, so a fold that made it would be the latest
+                    if (parser->stripped && parser->pending[parser->pending_count - 1] == parser->stripped) {
+                        error_at_current(parser, "Invalid assignment target.");
+                        return NULL;
+                    }
+                    push_expr_frame(parser, FRAME_ASSIGN, PREC_ASSIGNMENT, op);
+                } else {
+                    // The middle operand is a full expression, and a chain of ?: groups to the right
+                    push_expr_frame(parser, FRAME_THEN, PREC_COMMA, op);
+                }
+                break;
+            }
 
-    return left;
-}
-
-static Precedence get_precedence(TokenType type) {
-    switch (type) {
-        case TOK_EQ: 
-        case TOK_PLUS_EQ:
-        case TOK_MINUS_EQ:
-        case TOK_STAR_EQ:
-        case TOK_SLASH_EQ:
-        case TOK_PERCENT_EQ:
-            return PREC_ASSIGNMENT; // Same precedence as '='
-        case TOK_PIPE_PIPE: 
-            return PREC_OR;
-        case TOK_AMP_AMP: 
-            return PREC_AND;
-        case TOK_EQ_EQ:
-        case TOK_BANG_EQ: 
-            return PREC_EQUALITY;
-        case TOK_LT:
-        case TOK_LT_EQ:
-        case TOK_GT:
-        case TOK_GT_EQ: 
-            return PREC_COMPARISON;
-        case TOK_PLUS:
-        case TOK_MINUS: 
-            return PREC_TERM;
-        case TOK_STAR:
-        case TOK_SLASH:
-        case TOK_PERCENT: 
-            return PREC_FACTOR;
-        default: 
-            return PREC_NONE;
+            // The token closes the innermost bracket, or ends the expression
+            if (top->kind == FRAME_EXPRESSION) {
+                parser->expr_frame_count--;
+                return pop_pending(parser);
+            }
+            if (top->kind == FRAME_GROUP) {
+                if (!match(parser, TOK_RPAREN)) {
+                    error_at_current(parser, "Expect ')' after expression.");
+                    return NULL;
+                }
+                parser->expr_frame_count--;
+                continue;
+            }
+            if (top->kind == FRAME_CALL) {
+                if (match(parser, TOK_COMMA)) break; // The argument stays pending
+                if (!match(parser, TOK_RPAREN)) {
+                    error_at_current(parser, "Expect ')' after function arguments.");
+                    return NULL;
+                }
+                ASTNode *call_node = finish_call(parser, top);
+                parser->expr_frame_count--;
+                push_pending(parser, call_node);
+                continue;
+            }
+            // FRAME_THEN: the else operand binds like another ?: to its right
+            if (!match(parser, TOK_COLON)) {
+                error_at_current(parser, "Expect ':' in conditional expression.");
+                return NULL;
+            }
+            top->kind = FRAME_ELSE;
+            top->min = PREC_CONDITIONAL;
+            break;
+        }
     }
 }
 
-static ASTNode* parse_expression(Parser *parser) {
-    LOG_INFO("Parsing expression: current token='%s'", token_type_to_string(parser->current.type));
-    
-    ASTNode *left = parse_unary(parser);
-    if (!left) {
-        synchronize(parser);
-        return NULL;
-    }
-
-    // Check for postfix decrement
-    if (match(parser, TOK_MINUS_MINUS)) {
-        return create_unary_op_node(TOK_MINUS_MINUS, left, false); // false for postfix
-    }
-
-    // Check for postfix increment
-    if (match(parser, TOK_PLUS_PLUS)) {
-        return create_unary_op_node(TOK_PLUS_PLUS, left, false); // false for postfix
+// On an error the frames and operands of the failed expression are dropped
+static ASTNode* parse_precedence(Parser *parser, Precedence precedence) {
+    size_t frame_floor = parser->expr_frame_count;
+    size_t pending_floor = parser->pending_count;
+    ASTNode *expr = parse_operators(parser, precedence);
+    if (!expr) {
+        parser->expr_frame_count = frame_floor;
+        parser->pending_count = pending_floor;
     }
+    return expr;
+}
 
-    if (match(parser, TOK_PLUS_EQ) || match(parser, TOK_MINUS_EQ) || match(parser, TOK_STAR_EQ) ||
-        match(parser, TOK_SLASH_EQ) || match(parser, TOK_PERCENT_EQ)) {
-        Token op = parser->previous;
-        ASTNode *value = parse_expression(parser);
-        return create_binary_op_node(op.type, left, value);
-    }
+// A full expression, comma operator included
+static ASTNode* parse_expression(Parser *parser) {
+    LOG_INFO("Parsing expression: current token='%s'", token_type_to_string(parser->current->type));
+    ASTNode *expr = parse_precedence(parser, PREC_COMMA);
+    if (!expr) synchronize(parser);
+    return expr;
+}
 
-    return parse_binary(parser, left, PREC_ASSIGNMENT);
+// An assignment expression: what a call argument or an initializer may be
+static ASTNode* parse_assignment(Parser *parser) {
+    ASTNode *expr = parse_precedence(parser, PREC_ASSIGNMENT);
+    if (!expr) synchronize(parser);
+    return expr;
 }
     
 static ASTNode* parse_var_declaration(Parser *parser) {
-    LOG_INFO("current token: %s", token_type_to_string(parser->current.type));
+    LOG_INFO("current token: %s", token_type_to_string(parser->current->type));
     Type *type = parse_type(parser);
     if (!type) return NULL;
 
@@ -523,22 +944,28 @@ static ASTNode* parse_var_declaration(Parser *parser) {
     LOG_INFO("parse_var_declaration: Type kind = %d, Array size = %zu", type->kind, type->array_size);
 
     consume(parser, TOK_IDENTIFIER, "Expect variable name.");
-    char *name = strndup(parser->previous.text, parser->previous.length);
+    Symbol name = token_symbol(parser, parser->previous);
 
     // Check for array syntax
+    ASTNode *array_size = NULL;
     if (match(parser, TOK_LBRACKET)) {
         if (match(parser, TOK_RBRACKET)) {
             // Array with unspecified size
             LOG_INFO("Detected array with unspecified size in parse_var_declaration");
-            type->kind = TYPE_ARRAY;
-            type->array_size = 0;
+            type = type_array(type, 0);
         } else {
             // Array with specified size
-            ASTNode *size_expr = parse_expression(parser);
-            if (size_expr && size_expr->type == NODE_LITERAL) {
-                LOG_INFO("Detected array with specified size in parse_var_declaration: size=%d", size_expr->data.literal.value.int_value);
-                type->kind = TYPE_ARRAY;
-                type->array_size = size_expr->data.literal.value.int_value;
+            ASTNode *size_expr = parse_assignment(parser);
+            long long size;
+            if (size_expr && const_eval_integer(size_expr, &size) && size > 0) {
+                LOG_INFO("Detected array with specified size in parse_var_declaration: size=%lld", size);
+                type = type_array(type, (size_t)size);
+                consume(parser, TOK_RBRACKET, "Expect ']' after array size.");
+            } else if (size_expr) {
+                // It may name constexpr objects, which only const_eval has in scope
+                type = type_array(type, 0);
+                array_size = size_expr;
+                parser->evaluate = true;
                 consume(parser, TOK_RBRACKET, "Expect ']' after array size.");
             } else {
                 error_at_current(parser, "Array size must be a constant expression.");
@@ -547,65 +974,68 @@ static ASTNode* parse_var_declaration(Parser *parser) {
         }
     }
 
+    // In scope from the end of its declarator, so its own initializer already sees it
+    declare_name(parser, name, type);
     ASTNode *init = NULL;
     if (match(parser, TOK_EQ)) {
-        init = parse_expression(parser);
+        init = parse_assignment(parser);
     }
 
     consume(parser, TOK_SEMICOLON, "Expect ';' after variable declaration.");
-    LOG_INFO("parsed variable declaration: %s", name);
-    return create_var_decl_node(name, type, init);
+    LOG_INFO("parsed variable declaration: %s", symbol_name(name));
+    ASTNode *decl = create_var_decl_node(parser->arena, name, type, init);
+    decl->data.var_decl.array_size = array_size;
+    return decl;
 }
 
-static ASTNode* parse_if_statement(Parser *parser) {
-    LOG_INFO("current token: %s", token_type_to_string(parser->current.type));
-
-    // Parse the condition
-    consume(parser, TOK_LPAREN, "Expect '(' after 'if'.");
-    ASTNode *condition = parse_expression(parser);
-    consume(parser, TOK_RPAREN, "Expect ')' after condition.");
-
-    // Parse the then branch
-    ASTNode *then_branch = parse_statement(parser);
-
-    // Parse the else branch if it exists
-    ASTNode *else_branch = NULL;
-    if (match(parser, TOK_KW_ELSE)) {
-        else_branch = parse_statement(parser);
+// After constexpr: an ordinary declaration, which must have an initializer
+static ASTNode* parse_constexpr_declaration(Parser *parser) {
+    parser->evaluate = true;
+    ASTNode *decl = parse_var_declaration(parser);
+    if (!decl) return NULL;
+    if (!decl->data.var_decl.init_value) {
+        error_at_current(parser, "Expect initializer for constexpr object.");
+        return NULL;
     }
+    decl->data.var_decl.is_constexpr = true;
+    return decl;
+}
 
-    // Create and return the if statement node
-    ASTNode *if_node = malloc(sizeof(ASTNode));
-    if (!if_node) return NULL;
-    if_node->type = NODE_IF_STMT;
-    if_node->data.if_stmt.condition = condition;
-    if_node->data.if_stmt.then_branch = then_branch;
-    if_node->data.if_stmt.else_branch = else_branch;
-    LOG_INFO("Creating AST Node: Type=%s", node_type_to_string(if_node->type));
-    return if_node;
-}
-
-static ASTNode* parse_while_statement(Parser *parser) {
-    // Parse the condition
-    consume(parser, TOK_LPAREN, "Expect '(' after 'while'.");
-    ASTNode *condition = parse_expression(parser);
-    consume(parser, TOK_RPAREN, "Expect ')' after condition.");
+// After static_assert or _Static_assert: ( constant-expression [, string-literal] ) ;
+static ASTNode* parse_static_assert(Parser *parser) {
+    parser->evaluate = true;
+    consume(parser, TOK_LPAREN, "Expect '(' after static_assert.");
+    ASTNode *condition = parse_assignment(parser);
+    if (!condition) return NULL;
+    ASTNode *message = NULL;
+    if (match(parser, TOK_COMMA)) {
+        if (!match(parser, TOK_STRING)) {
+            error_at_current(parser, "Expect string literal message in static_assert.");
+            return NULL;
+        }
+        message = parse_string(parser);
+    }
+    consume(parser, TOK_RPAREN, "Expect ')' after static_assert.");
+    consume(parser, TOK_SEMICOLON, "Expect ';' after static_assert.");
+    return create_static_assert_node(parser->arena, condition, message);
+}
 
-    // Parse the body
-    ASTNode *body = parse_statement(parser);
+// A static_assert between functions is checked on the spot and leaves nothing in the tree
+static void parse_file_assertion(Parser *parser) {
+    ASTNode *assertion = parse_static_assert(parser);
+    if (assertion && !parser->had_error && !const_eval(assertion, parser->quiet)) parser->rejected = true;
+    parser->evaluate = false;
+}
 
-    // Create and return the while statement node
-    ASTNode *while_node = malloc(sizeof(ASTNode));
-    if (!while_node) return NULL;
-    while_node->type = NODE_WHILE_STMT;
-    while_node->data.while_stmt.condition = condition;
-    while_node->data.while_stmt.body = body;
-    LOG_INFO("Creating AST Node: Type=%s", node_type_to_string(while_node->type));
-    return while_node;
+// Pushes the condition of if or while, which follows the keyword already consumed
+static void parse_condition(Parser *parser, const char *keyword_message) {
+    consume(parser, TOK_LPAREN, keyword_message);
+    push_pending(parser, parse_expression(parser));
+    consume(parser, TOK_RPAREN, "Expect ')' after condition.");
 }
 
-static ASTNode* parse_for_statement(Parser *parser) {
-    // Parse the initializer
+// Pushes the initializer, condition and update of a for statement
+static void parse_for_clauses(Parser *parser) {
     consume(parser, TOK_LPAREN, "Expect '(' after 'for'.");
     ASTNode *init = NULL;
     if (!check(parser, TOK_SEMICOLON)) {
@@ -613,139 +1043,171 @@ static ASTNode* parse_for_statement(Parser *parser) {
     } else {
         consume(parser, TOK_SEMICOLON, "Expect ';' after initializer.");
     }
+    push_pending(parser, init);
 
-    // Parse the condition
     ASTNode *condition = NULL;
     if (!check(parser, TOK_SEMICOLON)) {
         condition = parse_expression(parser);
     }
     consume(parser, TOK_SEMICOLON, "Expect ';' after condition.");
+    push_pending(parser, condition);
 
-    // Parse the update
     ASTNode *update = NULL;
     if (!check(parser, TOK_RPAREN)) {
         update = parse_expression(parser);
     }
     consume(parser, TOK_RPAREN, "Expect ')' after for clauses.");
+    push_pending(parser, update);
+}
 
-    // Parse the body
-    ASTNode *body = parse_statement(parser);
-
-    // Create and return the for statement node
-    ASTNode *for_node = malloc(sizeof(ASTNode));
-    if (!for_node) return NULL;
-    for_node->type = NODE_FOR_STMT;
-    for_node->data.for_stmt.init = init;
-    for_node->data.for_stmt.condition = condition;
-    for_node->data.for_stmt.update = update;
-    for_node->data.for_stmt.body = body;
-    LOG_INFO("Creating AST Node: Type=%s", node_type_to_string(for_node->type));
-    return for_node;
-}
-
-static ASTNode* parse_statement(Parser *parser) {
-    LOG_INFO("current token: %s", token_type_to_string(parser->current.type));
-    if (parser->had_error) {
-        synchronize(parser);
-        return NULL;
-    }
-
-    // Check for variable declarations first
-    if (check(parser, TOK_KW_INT) || check(parser, TOK_KW_CHAR) || check(parser, TOK_KW_VOID)) {
-        return parse_var_declaration(parser);
-    }
-
-    if (match(parser, TOK_KW_RETURN)) {
-        ASTNode *value = parse_expression(parser);
-        consume(parser, TOK_SEMICOLON, "Expect ';' after return statement.");
-        return create_return_node(value);
-    }
-
-    if (match(parser, TOK_KW_IF)) {
-        return parse_if_statement(parser);
-    }
-
-    if (match(parser, TOK_KW_WHILE)) {
-        return parse_while_statement(parser);
-    }
-
-    if (match(parser, TOK_KW_FOR)) {
-        return parse_for_statement(parser);
-    }
-
-    if (match(parser, TOK_LBRACE)) {
-        LOG_INFO("parsing block");
-        return parse_block(parser);
-    }
-
-    // Try to parse as expression statement
-    ASTNode *expr = parse_expression(parser);
-    if (expr && expr->type == NODE_VAR_REF && match(parser, TOK_EQ)) {
-        // It's an assignment
-        LOG_INFO("Detected assignment: variable=%s", expr->data.var_ref.name);
-        ASTNode *value = parse_expression(parser);
-        consume(parser, TOK_SEMICOLON, "Expect ';' after assignment.");
-        return create_assignment_node(expr->data.var_ref.name, value);
+// Builds the if, while or for whose clauses and body are pending, and closes its frame
+static ASTNode* finish_compound(Parser *parser, const StmtFrame *frame) {
+    ASTNode *node = arena_alloc(parser->arena, sizeof(ASTNode));
+    ASTNode **clauses = parser->pending + frame->base;
+    switch (frame->kind) {
+        case STMT_IF:
+        case STMT_ELSE:
+            node->type = NODE_IF_STMT;
+            node->data.if_stmt.condition = clauses[0];
+            node->data.if_stmt.then_branch = clauses[1];
+            node->data.if_stmt.else_branch = frame->kind == STMT_ELSE ? clauses[2] : NULL;
+            break;
+        case STMT_WHILE:
+            node->type = NODE_WHILE_STMT;
+            node->data.while_stmt.condition = clauses[0];
+            node->data.while_stmt.body = clauses[1];
+            break;
+        default:
+            node->type = NODE_FOR_STMT;
+            node->data.for_stmt.init = clauses[0];
+            node->data.for_stmt.condition = clauses[1];
+            node->data.for_stmt.update = clauses[2];
+            node->data.for_stmt.body = clauses[3];
+            break;
     }
-
-    // Otherwise it's an expression statement
-    LOG_INFO("Parsing as expression statement");
-    consume(parser, TOK_SEMICOLON, "Expect ';' after expression.");
-    return expr;
+    parser->pending_count = frame->base;
+    parser->name_count = frame->names;
+    parser->stmt_frame_count--;
+    LOG_INFO("Creating AST Node: Type=%s", node_type_to_string(node->type));
+    return node;
 }
 
-static ASTNode* parse_block(Parser *parser) {
-    LOG_INFO("Entering parse_block: current token=%s", token_type_to_string(parser->current.type));
+static ASTNode* finish_block(Parser *parser, const StmtFrame *frame) {
+    consume(parser, TOK_RBRACE, "Expect '}' after block.");
+    size_t count;
+    ASTNode **stmts = take_pending(parser, frame->base, &count);
+    parser->name_count = frame->names;
+    parser->stmt_frame_count--;
+    LOG_INFO("Exiting parse_block: current token=%s", token_type_to_string(parser->current->type));
+    return create_stmt_list_node(parser->arena, stmts, count);
+}
 
-    ASTNode **stmts = NULL;
-    size_t count = 0;
-    size_t capacity = 0;
+/*
+ * Parses one statement, or with block set the rest of a block whose '{' has been
+ * consumed. Blocks and the bodies of if, while and for nest without recursion: each
+ * open construct is a frame, and a finished statement is handed to the innermost
+ * frame, completing frames outwards until one still needs more input.
+ */
+static ASTNode* parse_statement_tree(Parser *parser, bool block) {
+    size_t floor = parser->stmt_frame_count;
+    if (block) push_stmt_frame(parser, STMT_BLOCK, parser->pending_count);
 
-    while (!check(parser, TOK_RBRACE) && !check(parser, TOK_EOF)) {
-        LOG_INFO("About to parse a statement: current token=%s", token_type_to_string(parser->current.type));
-        ASTNode *stmt = parse_statement(parser);
-        if (!stmt) {
-            LOG_INFO("parse_statement returned NULL, advancing to avoid infinite loop");
-            advance(parser); // Ensure the parser moves forward
+    for (;;) {
+        StmtFrame *top = parser->stmt_frame_count > floor ? &parser->stmt_frames[parser->stmt_frame_count - 1] : NULL;
+        ASTNode *statement;
+
+        /* Start a statement, or close the innermost block */
+        LOG_INFO("current token: %s", token_type_to_string(parser->current->type));
+        if (top && top->kind == STMT_BLOCK && (check(parser, TOK_RBRACE) || check(parser, TOK_EOF))) {
+            statement = finish_block(parser, top);
+        } else if (parser->had_error) {
+            synchronize(parser);
+            statement = NULL;
+        } else if (check(parser, TOK_KW_INT) || check(parser, TOK_KW_CHAR) || check(parser, TOK_KW_VOID)) {
+            statement = parse_var_declaration(parser);
+        } else if (match(parser, TOK_KW_CONSTEXPR)) {
+            statement = parse_constexpr_declaration(parser);
+        } else if (match(parser, TOK_KW__STATIC_ASSERT)) {
+            statement = parse_static_assert(parser);
+        } else if (match(parser, TOK_KW_RETURN)) {
+            ASTNode *value = parse_expression(parser);
+            consume(parser, TOK_SEMICOLON, "Expect ';' after return statement.");
+            statement = create_return_node(parser->arena, value);
+        } else if (match(parser, TOK_KW_IF)) {
+            size_t base = parser->pending_count;
+            parse_condition(parser, "Expect '(' after 'if'.");
+            push_stmt_frame(parser, STMT_IF, base);
+            continue;
+        } else if (match(parser, TOK_KW_WHILE)) {
+            size_t base = parser->pending_count;
+            parse_condition(parser, "Expect '(' after 'while'.");
+            push_stmt_frame(parser, STMT_WHILE, base);
             continue;
+        } else if (match(parser, TOK_KW_FOR)) {
+            size_t base = parser->pending_count;
+            size_t names = parser->name_count;
+            parse_for_clauses(parser);
+            push_stmt_frame(parser, STMT_FOR, base)->names = names; // The initializer's name ends with the loop
+            continue;
+        } else if (match(parser, TOK_LBRACE)) {
+            LOG_INFO("parsing block");
+            push_stmt_frame(parser, STMT_BLOCK, parser->pending_count);
+            continue;
+        } else {
+            // Expression statement; assignments are expressions too, so x = 1, y = 2; is one comma expression
+            LOG_INFO("Parsing as expression statement");
+            statement = parse_expression(parser);
+            consume(parser, TOK_SEMICOLON, "Expect ';' after expression.");
         }
 
-        if (count >= capacity) {
-            capacity = capacity == 0 ? 8 : capacity * 2;
-            stmts = realloc(stmts, sizeof(ASTNode*) * capacity);
-            if (!stmts) {
-                LOG_ERROR("Memory allocation failed in parse_block");
-                return NULL;
+        /* Hand the statement outwards until a frame needs more input */
+        for (;;) {
+            if (parser->stmt_frame_count == floor) return statement;
+            top = &parser->stmt_frames[parser->stmt_frame_count - 1];
+            if (top->kind == STMT_BLOCK) {
+                if (statement) {
+                    push_pending(parser, statement);
+                } else {
+                    LOG_INFO("No statement parsed, advancing to avoid infinite loop");
+                    advance(parser); // Ensure the parser moves forward
+                }
+                break;
+            }
+            push_pending(parser, statement);
+            if (top->kind == STMT_IF && match(parser, TOK_KW_ELSE)) {
+                top->kind = STMT_ELSE;
+                break;
             }
+            statement = finish_compound(parser, top);
         }
-
-        stmts[count++] = stmt;
     }
+}
 
-    consume(parser, TOK_RBRACE, "Expect '}' after block.");
-    LOG_INFO("Exiting parse_block: current token=%s", token_type_to_string(parser->current.type));
-    return create_stmt_list_node(stmts, count);
+static ASTNode* parse_block(Parser *parser) {
+    LOG_INFO("Entering parse_block: current token=%s", token_type_to_string(parser->current->type));
+    return parse_statement_tree(parser, true);
 }
 
 static ASTNode* parse_parameter(Parser *parser) {
     Type *type = parse_type(parser);
     if (!type) return NULL;
     consume(parser, TOK_IDENTIFIER, "Expect parameter name.");
-    char *name = strndup(parser->previous.text, parser->previous.length);
+    Symbol name = token_symbol(parser, parser->previous);
 
     // Check for array syntax
     if (match(parser, TOK_LBRACKET)) {
         if (match(parser, TOK_RBRACKET)) {
             // Array with unspecified size
-            Type *array_type = create_array_type(type, 0);
-            return create_var_decl_node(name, array_type, NULL);
+            Type *array_type = type_array(type, 0);
+            return create_var_decl_node(parser->arena, name, array_type, NULL);
         } else {
             // Array with specified size
-            ASTNode *size_expr = parse_expression(parser);
-            if (size_expr && size_expr->type == NODE_LITERAL) {
-                Type *array_type = create_array_type(type, size_expr->data.literal.value.int_value);
+            ASTNode *size_expr = parse_assignment(parser);
+            long long size;
+            if (size_expr && const_eval_integer(size_expr, &size) && size > 0) {
+                Type *array_type = type_array(type, (size_t)size);
                 consume(parser, TOK_RBRACKET, "Expect ']' after array size.");
-                return create_var_decl_node(name, array_type, NULL);
+                return create_var_decl_node(parser->arena, name, array_type, NULL);
             } else {
                 error_at_current(parser, "Array size must be a constant expression.");
                 return NULL;
@@ -753,7 +1215,7 @@ static ASTNode* parse_parameter(Parser *parser) {
         }
     }
 
-    return create_var_decl_node(name, type, NULL);
+    return create_var_decl_node(parser->arena, name, type, NULL);
 }
 
 static ASTNode* parse_parameter_list(Parser *parser) {
@@ -763,12 +1225,9 @@ static ASTNode* parse_parameter_list(Parser *parser) {
     if (!check(parser, TOK_RPAREN)) {
         do {
             if (count >= capacity) {
-                capacity = capacity == 0 ? 4 : capacity * 2;
-                params = realloc(params, sizeof(ASTNode*) * capacity);
-                if (!params) {
-                    fprintf(stderr, "Memory allocation failed\n");
-                    return NULL;
-                }
+                size_t new_capacity = capacity == 0 ? 4 : capacity * 2;
+                params = arena_realloc(parser->arena, params, sizeof(ASTNode*) * capacity, sizeof(ASTNode*) * new_capacity);
+                capacity = new_capacity;
             }
             
             ASTNode *param = parse_parameter(parser);
@@ -779,17 +1238,17 @@ static ASTNode* parse_parameter_list(Parser *parser) {
     }
     
     consume(parser, TOK_RPAREN, "Expect ')' after parameters.");
-    return create_param_list_node(params, count);
+    return create_param_list_node(parser->arena, params, count);
 }
 
 static Type* parse_type(Parser *parser) {
     Type *type = NULL;
     if (match(parser, TOK_KW_INT)) {
-        type = create_type(TYPE_INT);
+        type = type_get(TYPE_INT);
     } else if (match(parser, TOK_KW_CHAR)) {
-        type = create_type(TYPE_CHAR);
+        type = type_get(TYPE_CHAR);
     } else if (match(parser, TOK_KW_VOID)) {
-        type = create_type(TYPE_VOID);
+        type = type_get(TYPE_VOID);
     } else {
         error_at_current(parser, "Expect type specifier.");
         return NULL;
@@ -797,30 +1256,68 @@ static Type* parse_type(Parser *parser) {
     
     // Handle pointers
     while (match(parser, TOK_STAR)) {
-        type = create_pointer_type(type);
+        type = type_pointer(type);
     }
     
     return type;
 }
 
+// Brace-matches a body whose '{' has been consumed, leaving the parser after its '}'
+static DeferredBody* skip_body(Parser *parser) {
+    size_t start = parser->position;
+    size_t depth = 1;
+    for (size_t i = start; parser->tokens[i].type != TOK_EOF; i++) {
+        TokenType type = parser->tokens[i].type;
+        if (type == TOK_LBRACE) {
+            depth++;
+        } else if (type == TOK_RBRACE && --depth == 0) {
+            parser->position = i;
+            parser->current = &parser->tokens[i];
+            advance(parser);
+            DeferredBody *deferred = arena_alloc(parser->arena, sizeof(DeferredBody));
+            deferred->tokens = parser->buffer;
+            deferred->arena = parser->arena;
+            deferred->start = start;
+            deferred->end = i;
+            deferred->fold = parser->fold;
+            return deferred;
+        }
+    }
+    parser->position = parser->token_count - 1;
+    parser->current = &parser->tokens[parser->position];
+    error_at_current(parser, "Expect '}' after block.");
+    return NULL;
+}
+
 static ASTNode* parse_function(Parser *parser) {
     LOG_INFO("about to parse a type");
     Type *return_type = parse_type(parser);
     if (!return_type) return NULL;
     consume(parser, TOK_IDENTIFIER, "Expect function name.");
-    char *name = strndup(parser->previous.text, parser->previous.length);
+    Symbol name = token_symbol(parser, parser->previous);
 
     consume(parser, TOK_LPAREN, "Expect '(' after function name.");
     ASTNode *params = parse_parameter_list(parser);
 
     consume(parser, TOK_LBRACE, "Expect '{' before function body.");
+    if (parser->lazy) {
+        DeferredBody *deferred = skip_body(parser);
+        if (!deferred) return NULL;
+        ASTNode *function = create_function_decl_node(parser->arena, name, return_type, params, NULL);
+        function->data.function_decl.deferred = deferred;
+        return function;
+    }
+    parser->evaluate = false;
+    declare_parameters(parser, params);
     ASTNode *body = parse_block(parser);
-
-    return create_function_decl_node(name, return_type, params, body);
+    ASTNode *function = create_function_decl_node(parser->arena, name, return_type, params, body);
+    // A failed static assertion fails the parse, as a syntax error would
+    if (parser->evaluate && !parser->had_error && !const_eval(function, parser->quiet)) parser->rejected = true;
+    return function;
 }
 
 static ASTNode* parse_program(Parser *parser) {
-    if (parser->current.type == TOK_EOF) {
+    if (parser->current->type == TOK_EOF) {
         LOG_INFO("Empty input detected, returning NULL AST");
         return NULL;
     }
@@ -829,150 +1326,297 @@ static ASTNode* parse_program(Parser *parser) {
     size_t count = 0;
     size_t capacity = 0;
     while (!check(parser, TOK_EOF)) {
+        if (match(parser, TOK_KW__STATIC_ASSERT)) {
+            parse_file_assertion(parser);
+            continue;
+        }
         LOG_INFO("about to parse a function");
+        size_t start = parser->position;
         ASTNode *function = parse_function(parser);
-        if (!function) continue;
+        if (!function) {
+            // Recovery can stop on a statement keyword, which no function starts with
+            if (parser->position == start) advance(parser);
+            continue;
+        }
         
         if (count >= capacity) {
-            capacity = capacity == 0 ? 4 : capacity * 2;
-            functions = realloc(functions, sizeof(ASTNode*) * capacity);
-            if (!functions) {
-                fprintf(stderr, "Memory allocation failed\n");
-                return NULL;
-            }
+            size_t new_capacity = capacity == 0 ? 4 : capacity * 2;
+            functions = arena_realloc(parser->arena, functions, sizeof(ASTNode*) * capacity, sizeof(ASTNode*) * new_capacity);
+            capacity = new_capacity;
         }
         
         functions[count++] = function;
     }
     
-    ASTNode *program = malloc(sizeof(ASTNode));
-    if (!program) return NULL;
+    ASTNode *program = arena_alloc(parser->arena, sizeof(ASTNode));
     
     program->type = NODE_PROGRAM;
-    program->data.stmt_list.stmts = functions;
-    program->data.stmt_list.count = count;
+    program->data.program.stmts = functions;
+    program->data.program.count = count;
+    program->data.program.arena = parser->arena;
     LOG_INFO("Creating AST Node: Type=%s", node_type_to_string(program->type));
     return program;
 }
 
 ASTNode* parse(Lexer *lexer) {
+    TokenBuffer tokens;
+    token_buffer_init(&tokens);
+    token_buffer_fill(&tokens, lexer);
+    ASTNode *program = parse_tokens(&tokens);
+    token_buffer_free(&tokens);
+    return program;
+}
+
+// Positions a parser on token start of tokens, building into arena
+static void parser_init(Parser *parser, const TokenBuffer *tokens, Arena *arena, size_t start) {
+    parser->buffer = tokens;
+    line_table_init(&parser->lines, tokens->source);
+    parser->tokens = tokens->tokens;
+    parser->token_count = tokens->count;
+    parser->position = start;
+    parser->literal_cursor = 0;
+    parser->current = &tokens->tokens[start];
+    parser->previous = &tokens->tokens[start ? start - 1 : 0];
+    parser->arena = arena;
+    parser->had_error = false;
+    parser->panic_mode = false;
+    parser->lazy = false;
+    parser->quiet = false;
+    parser->fold = false;
+    parser->evaluate = false;
+    parser->rejected = false;
+    parser->folded = 0;
+    parser->stripped = NULL;
+    parser->pending = NULL;
+    parser->pending_count = parser->pending_capacity = 0;
+    parser->expr_frames = NULL;
+    parser->expr_frame_count = parser->expr_frame_capacity = 0;
+    parser->stmt_frames = NULL;
+    parser->stmt_frame_count = parser->stmt_frame_capacity = 0;
+    parser->names = NULL;
+    parser->name_count = parser->name_capacity = 0;
+}
+
+static void parser_release(Parser *parser) {
+    line_table_free(&parser->lines);
+    free(parser->pending);
+    free(parser->expr_frames);
+    free(parser->stmt_frames);
+    free(parser->names);
+}
+
+// Parses the whole buffer on the calling thread
+static ASTNode* parse_unit(const TokenBuffer *tokens, ParseOptions *options) {
     Parser parser;
-    parser.lexer = lexer;
-    parser.had_error = false;
-    parser.panic_mode = false;
-    advance(&parser);
+    parser_init(&parser, tokens, arena_create(), 0);
+    parser.lazy = options->lazy;
+    parser.fold = options->fold;
     ASTNode *program = parse_program(&parser);
+    parser_release(&parser);
+    options->folded = parser.folded;
 
-    if (parser.had_error) {
-        free_ast(program);
+    if (!program || parser.had_error || parser.rejected) {
+        // The program node owns the arena, so drop it directly when there is no usable tree
+        arena_destroy(parser.arena);
         return NULL;
     }
 
     return program;
 }
 
-void free_ast(ASTNode *node) {
-    if (!node) return;
+// A run of whole functions, parsed on a worker into its own arena
+typedef struct {
+    const TokenBuffer *tokens;
+    size_t start; // First token of the first function
+    size_t end; // One past the closing brace of the last function
+    Arena *arena;
+    bool fold;
+    ASTNode **functions;
+    size_t count;
+    size_t folded;
+    bool had_error;
+} ParseRange;
 
-    switch (node->type) {
-        case NODE_LITERAL:
-            if (node->data.literal.type) free(node->data.literal.type);
-            break;
-            
-        case NODE_BINARY_OP:
-            free_ast(node->data.binary_op.left);
-            free_ast(node->data.binary_op.right);
-            break;
-            
-        case NODE_UNARY_OP:
-            free_ast(node->data.unary_op.operand);
-            break;
+static void parse_range(void *arg) {
+    ParseRange *range = arg;
+    Parser parser;
+    parser_init(&parser, range->tokens, range->arena, range->start);
+    parser.quiet = true;
+    parser.fold = range->fold;
+    size_t capacity = 0;
+    while (parser.position < range->end && !check(&parser, TOK_EOF)) {
+        if (match(&parser, TOK_KW__STATIC_ASSERT)) {
+            parse_file_assertion(&parser);
+            continue;
+        }
+        size_t start = parser.position;
+        ASTNode *function = parse_function(&parser);
+        if (!function) {
+            if (parser.position == start) advance(&parser);
+            continue;
+        }
+        if (range->count >= capacity) {
+            size_t new_capacity = capacity == 0 ? 4 : capacity * 2;
+            range->functions = arena_realloc(range->arena, range->functions, sizeof(ASTNode*) * capacity, sizeof(ASTNode*) * new_capacity);
+            capacity = new_capacity;
+        }
+        range->functions[range->count++] = function;
+    }
+    // A function running past the range means the pre-scan split it somewhere the grammar does not
+    range->had_error = parser.had_error || parser.rejected || parser.position != range->end;
+    range->folded = parser.folded;
+    parser_release(&parser);
+}
 
-        case NODE_VAR_REF:
-            free(node->data.var_ref.name);
-            if (node->data.var_ref.type) free(node->data.var_ref.type);
-            break;
-            
-        case NODE_VAR_DECL:
-            free(node->data.var_decl.name);
-            if (node->data.var_decl.type) free(node->data.var_decl.type);
-            free_ast(node->data.var_decl.init_value);
-            break;
-            
-        case NODE_ASSIGNMENT:
-            free(node->data.assignment.name);
-            free_ast(node->data.assignment.value);
-            break;
-        
-        case NODE_IF_STMT:
-            free_ast(node->data.if_stmt.condition);
-            free_ast(node->data.if_stmt.then_branch);
-            free_ast(node->data.if_stmt.else_branch); // This can be NULL
-            break;
+/*
+ * Splits the input after top-level closing braces, where one function ends and the
+ * next begins, into about four ranges per thread of similar token counts. Returns the
+ * number of ranges, each ending at a split point, with the last one at end.
+ */
+static size_t split_ranges(const TokenBuffer *tokens, size_t target, size_t **ends) {
+    size_t end = tokens->count - 1; // The TOK_EOF
+    size_t per_range = end / target + 1;
+    size_t *splits = malloc(sizeof(size_t) * (target + 1));
+    if (!splits) {
+        LOG_ERROR("Memory allocation failed for parse ranges");
+        exit(EXIT_FAILURE);
+    }
+    size_t count = 0;
+    size_t from = 0;
+    size_t depth = 0;
+    for (size_t i = 0; i < end && count < target; i++) {
+        TokenType type = (TokenType)tokens->tokens[i].type;
+        if (type == TOK_LBRACE) {
+            depth++;
+        } else if (type == TOK_RBRACE && depth > 0 && --depth == 0 && i + 1 - from >= per_range && i + 1 < end) {
+            splits[count++] = i + 1;
+            from = i + 1;
+        }
+    }
+    splits[count++] = end;
+    *ends = splits;
+    return count;
+}
 
-        case NODE_WHILE_STMT:
-            free_ast(node->data.while_stmt.condition);
-            free_ast(node->data.while_stmt.body);
-            break;
+static ASTNode* parse_parallel(const TokenBuffer *tokens, ParseOptions *options) {
+    ThreadPool *pool = pool_create(options->threads);
+    size_t *ends = NULL;
+    size_t range_count = pool_thread_count(pool) > 1 ? split_ranges(tokens, pool_thread_count(pool) * 4, &ends) : 1;
+    if (range_count < 2) {
+        pool_destroy(pool);
+        free(ends);
+        return parse_unit(tokens, options);
+    }
 
-        case NODE_FOR_STMT:
-            free_ast(node->data.for_stmt.init);      // Can be NULL
-            free_ast(node->data.for_stmt.condition); // Can be NULL
-            free_ast(node->data.for_stmt.update);    // Can be NULL
-            free_ast(node->data.for_stmt.body);
-            break;
+    ParseRange *ranges = calloc(range_count, sizeof(ParseRange));
+    if (!ranges) {
+        LOG_ERROR("Memory allocation failed for parse ranges");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < range_count; i++) {
+        ranges[i].tokens = tokens;
+        ranges[i].start = i == 0 ? 0 : ends[i - 1];
+        ranges[i].end = ends[i];
+        ranges[i].arena = arena_create();
+        ranges[i].fold = options->fold;
+        pool_submit(pool, parse_range, &ranges[i]);
+    }
+    pool_destroy(pool);
+    free(ends);
+
+    size_t total = 0;
+    size_t folded = 0;
+    bool had_error = false;
+    for (size_t i = 0; i < range_count; i++) {
+        total += ranges[i].count;
+        folded += ranges[i].folded;
+        had_error |= ranges[i].had_error;
+    }
+    if (had_error) {
+        // Worker diagnostics were held back; a serial pass reports them once, in order
+        LOG_INFO("Syntax problem in a parse range, reparsing serially");
+        for (size_t i = 0; i < range_count; i++) arena_destroy(ranges[i].arena);
+        free(ranges);
+        return parse_unit(tokens, options);
+    }
 
-        case NODE_FUNCTION_DECL:
-            free(node->data.function_decl.name);
-            if (node->data.function_decl.return_type) free(node->data.function_decl.return_type);
-            free_ast(node->data.function_decl.params);
-            free_ast(node->data.function_decl.body);
-            break;
-            
-        case NODE_RETURN:
-            free_ast(node->data.return_stmt.value);
-            break;
-            
-        case NODE_PARAM_LIST:
-            for (size_t i = 0; i < node->data.param_list.count; i++) {
-                free_ast(node->data.param_list.params[i]);
-            }
-            free(node->data.param_list.params);
-            break;
-            
-        case NODE_STMT_LIST:
-            for (size_t i = 0; i < node->data.stmt_list.count; i++) {
-                free_ast(node->data.stmt_list.stmts[i]);
-            }
-            free(node->data.stmt_list.stmts);
-            break;
-            
-        case NODE_TYPE_SPECIFIER:
-            if (node->data.type_spec.type) free(node->data.type_spec.type);
-            break;
-            
-        case NODE_PROGRAM:
-            for (size_t i = 0; i < node->data.stmt_list.count; i++) {
-                free_ast(node->data.stmt_list.stmts[i]);
-            }
-            free(node->data.stmt_list.stmts);
-            break;
+    // Stitch the ranges together in source order; the program adopts each worker arena
+    Arena *arena = arena_create();
+    ASTNode **functions = total ? arena_alloc(arena, sizeof(ASTNode*) * total) : NULL;
+    size_t count = 0;
+    for (size_t i = 0; i < range_count; i++) {
+        memcpy(functions + count, ranges[i].functions, sizeof(ASTNode*) * ranges[i].count);
+        count += ranges[i].count;
+    }
+    ASTNode *program = arena_alloc(arena, sizeof(ASTNode));
+    program->type = NODE_PROGRAM;
+    program->data.program.stmts = functions;
+    program->data.program.count = count;
+    program->data.program.arena = arena;
+    for (size_t i = 0; i < range_count; i++) arena_adopt(arena, ranges[i].arena);
+    free(ranges);
+    options->folded = folded;
+    LOG_INFO("Parsed %zu functions in %zu ranges", count, range_count);
+    return program;
+}
 
-        case NODE_FUNCTION_CALL:
-            free(node->data.function_call.name);
-            for (size_t i = 0; i < node->data.function_call.arg_count; i++) {
-                free_ast(node->data.function_call.args[i]);
-            }
-            free(node->data.function_call.args);
-            break;
+ASTNode* parse_tokens_with(const TokenBuffer *tokens, ParseOptions *options) {
+    options->folded = 0;
+    if (!tokens || tokens->count == 0) {
+        LOG_ERROR("Token buffer is empty; it must at least hold TOK_EOF");
+        return NULL;
+    }
+    if (options->lazy || options->threads == 1) return parse_unit(tokens, options);
+    return parse_parallel(tokens, options);
+}
 
-        case INVALID_NODE_TYPE:
-        case UNKNOWN_NODE_TYPE:
-            LOG_ERROR("Invalid or unknown node type encountered during AST cleanup\n");
-            break;
+ASTNode* parse_tokens(const TokenBuffer *tokens) {
+    return parse_tokens_with(tokens, &(ParseOptions){ .threads = 1 });
+}
+
+ASTNode* parse_tokens_lazy(const TokenBuffer *tokens) {
+    return parse_tokens_with(tokens, &(ParseOptions){ .lazy = true, .threads = 1 });
+}
+
+ASTNode* parse_tokens_parallel(const TokenBuffer *tokens, size_t threads) {
+    return parse_tokens_with(tokens, &(ParseOptions){ .threads = threads });
+}
+
+ASTNode* function_body(ASTNode *function) {
+    DeferredBody *deferred = function->data.function_decl.deferred;
+    if (!deferred) return function->data.function_decl.body;
+
+    LOG_INFO("Parsing deferred body of %s", symbol_name(function->data.function_decl.name));
+    Parser parser;
+    parser_init(&parser, deferred->tokens, deferred->arena, deferred->start);
+    parser.fold = deferred->fold;
+    declare_parameters(&parser, function->data.function_decl.params);
+    ASTNode *body = parse_block(&parser);
+    bool parsed = !parser.had_error && parser.position == deferred->end + 1;
+    parser_release(&parser);
+    if (!parsed) return NULL; // Left deferred; the nodes built so far stay in the arena until the program goes
+
+    function->data.function_decl.body = body;
+    if (parser.evaluate && !const_eval(function, false)) {
+        function->data.function_decl.body = NULL;
+        return NULL;
     }
-    
-    free(node);
+    function->data.function_decl.deferred = NULL;
+    return body;
+}
+
+// Every node, type and child array lives in the program's arena, so freeing the tree
+// is a single arena teardown rather than a recursive walk. Subtrees cannot be freed
+// on their own; they go away with the program that owns them.
+void free_ast(ASTNode *node) {
+    if (!node) return;
+
+    if (node->type != NODE_PROGRAM) {
+        LOG_INFO("free_ast called on a %s node, memory is released with its program", node_type_to_string(node->type));
+        return;
+    }
+
+    arena_destroy(node->data.program.arena);
 }
 
 const char *node_type_to_string(NodeType type) {
@@ -992,7 +1636,9 @@ const char *node_type_to_string(NodeType type) {
         [NODE_IF_STMT] = "IF_STMT",
         [NODE_WHILE_STMT] = "WHILE_STMT",
         [NODE_FOR_STMT] = "FOR_STMT",
-        [NODE_FUNCTION_CALL] = "FUNCTION_CALL"
+        [NODE_FUNCTION_CALL] = "FUNCTION_CALL",
+        [NODE_TERNARY] = "TERNARY",
+        [NODE_STATIC_ASSERT] = "STATIC_ASSERT"
     };
 
     // Handle invalid type values
@@ -1004,179 +1650,259 @@ const char *node_type_to_string(NodeType type) {
     return names[type] ? names[type] : "UNKNOWN_NODE_TYPE";
 }
 
-void print_ast(ASTNode *node, int indent) {
-    if (!node) return;
+size_t ast_child_count(const ASTNode *node) {
+    switch (node->type) {
+        case NODE_PROGRAM: return node->data.program.count;
+        case NODE_STMT_LIST: return node->data.stmt_list.count;
+        case NODE_PARAM_LIST: return node->data.param_list.count;
+        case NODE_FUNCTION_CALL: return node->data.function_call.arg_count;
+        case NODE_FOR_STMT: return 4;
+        case NODE_IF_STMT:
+        case NODE_TERNARY: return 3;
+        case NODE_FUNCTION_DECL:
+        case NODE_BINARY_OP:
+        case NODE_WHILE_STMT:
+        case NODE_STATIC_ASSERT: return 2;
+        case NODE_VAR_DECL:
+        case NODE_ASSIGNMENT:
+        case NODE_UNARY_OP:
+        case NODE_RETURN: return 1;
+        default: return 0;
+    }
+}
+
+ASTNode *ast_child(const ASTNode *node, size_t slot) {
+    switch (node->type) {
+        case NODE_PROGRAM: return node->data.program.stmts[slot];
+        case NODE_STMT_LIST: return node->data.stmt_list.stmts[slot];
+        case NODE_PARAM_LIST: return node->data.param_list.params[slot];
+        case NODE_FUNCTION_CALL: return node->data.function_call.args[slot];
+        case NODE_FUNCTION_DECL: return slot == 0 ? node->data.function_decl.params : node->data.function_decl.body;
+        case NODE_VAR_DECL: return node->data.var_decl.init_value;
+        case NODE_ASSIGNMENT: return node->data.assignment.value;
+        case NODE_RETURN: return node->data.return_stmt.value;
+        case NODE_UNARY_OP: return node->data.unary_op.operand;
+        case NODE_BINARY_OP: return slot == 0 ? node->data.binary_op.left : node->data.binary_op.right;
+        case NODE_WHILE_STMT: return slot == 0 ? node->data.while_stmt.condition : node->data.while_stmt.body;
+        case NODE_STATIC_ASSERT: return slot == 0 ? node->data.assertion.condition : node->data.assertion.message;
+        case NODE_IF_STMT: {
+            ASTNode *slots[] = { node->data.if_stmt.condition, node->data.if_stmt.then_branch, node->data.if_stmt.else_branch };
+            return slots[slot];
+        }
+        case NODE_TERNARY: {
+            ASTNode *slots[] = { node->data.ternary.condition, node->data.ternary.then_expr, node->data.ternary.else_expr };
+            return slots[slot];
+        }
+        case NODE_FOR_STMT: {
+            ASTNode *slots[] = { node->data.for_stmt.init, node->data.for_stmt.condition, node->data.for_stmt.update, node->data.for_stmt.body };
+            return slots[slot];
+        }
+        default: return NULL;
+    }
+}
+
+typedef struct {
+    ASTNode *node;
+    size_t next; // Next child slot to enter
+} WalkEntry;
+
+bool ast_walk(ASTNode *root, const ASTVisitor *visitor) {
+    if (!root) return true;
+
+    WalkEntry *stack = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    bool completed = true;
+
+    ASTNode *node = root;
+    const ASTNode *parent = NULL;
+    size_t slot = 0;
+    while (node) {
+        ASTWalkAction action = visitor->enter ? visitor->enter(node, parent, slot, count, visitor->context) : AST_WALK_CONTINUE;
+        if (action == AST_WALK_STOP) {
+            completed = false;
+            break;
+        }
+        if (count == capacity) stack = grow_stack(stack, &capacity, sizeof(WalkEntry));
+        stack[count++] = (WalkEntry){ node, action == AST_WALK_SKIP ? ast_child_count(node) : 0 };
+
+        // The next node to enter is the first unvisited child on the way back up
+        node = NULL;
+        while (count > 0) {
+            WalkEntry *top = &stack[count - 1];
+            size_t children = ast_child_count(top->node);
+            while (top->next < children && !(node = ast_child(top->node, top->next))) top->next++;
+            if (node) {
+                parent = top->node;
+                slot = top->next++;
+                break;
+            }
+            if (visitor->leave) visitor->leave(top->node, count - 1, visitor->context);
+            count--;
+        }
+    }
+
+    free(stack);
+    return completed;
+}
+
+typedef struct {
+    int *indents; // Indent of the open node at each depth
+    size_t capacity;
+    int indent;
+} PrintState;
+
+// Labels printed above a child, one level in from the parent; NULL for plain children
+static const char *child_label(const ASTNode *parent, size_t slot) {
+    static const char *const function_labels[] = { "Parameters:", "Body:" };
+    static const char *const if_labels[] = { "Condition:", "Then:", "Else:" };
+    static const char *const while_labels[] = { "Condition:", "Body:" };
+    static const char *const for_labels[] = { "Initializer:", "Condition:", "Update:", "Body:" };
+    switch (parent->type) {
+        case NODE_FUNCTION_DECL: return function_labels[slot];
+        case NODE_IF_STMT:
+        case NODE_TERNARY: return if_labels[slot];
+        case NODE_WHILE_STMT: return while_labels[slot];
+        case NODE_FOR_STMT: return for_labels[slot];
+        default: return NULL;
+    }
+}
+
+static void print_indent(int indent) {
     for (int i = 0; i < indent; i++) printf("  ");
+}
+
+static ASTWalkAction print_node(ASTNode *node, const ASTNode *parent, size_t slot, size_t depth, void *context) {
+    PrintState *state = context;
+    int indent = state->indent;
+    if (parent) {
+        const char *label = child_label(parent, slot);
+        indent = state->indents[depth - 1];
+        if (label) {
+            print_indent(indent + 1);
+            printf("%s\n", label);
+            indent += 2;
+        } else if (parent->type != NODE_STMT_LIST && parent->type != NODE_PARAM_LIST) {
+            indent += 1; // List items line up with their list
+        }
+    }
+    if (depth == state->capacity) state->indents = grow_stack(state->indents, &state->capacity, sizeof(int));
+    state->indents[depth] = indent;
+    print_indent(indent);
 
     switch (node->type) {
         case NODE_PROGRAM:
             printf("Program\n");
-            for (size_t i = 0; i < node->data.stmt_list.count; i++) {
-                print_ast(node->data.stmt_list.stmts[i], indent + 1);
-            }
             break;
 
         case NODE_FUNCTION_DECL:
-            printf("Function: %s\n", node->data.function_decl.name);
-            if (node->data.function_decl.params) {
-                for (int i = 0; i < indent + 1; i++) printf("  ");
-                printf("Parameters:\n");
-                print_ast(node->data.function_decl.params, indent + 2);
-            }
-            if (node->data.function_decl.body) {
-                for (int i = 0; i < indent + 1; i++) printf("  ");
-                printf("Body:\n");
-                print_ast(node->data.function_decl.body, indent + 2);
-            }
+            printf("Function: %s\n", symbol_name(node->data.function_decl.name));
             break;
 
         case NODE_VAR_DECL:
-            printf("VarDecl: %s\n", node->data.var_decl.name);
-            if (node->data.var_decl.init_value) {
-                print_ast(node->data.var_decl.init_value, indent + 1);
-            }
+            printf("VarDecl: %s%s\n", symbol_name(node->data.var_decl.name), node->data.var_decl.is_constexpr ? " (constexpr)" : "");
             break;
 
         case NODE_RETURN:
             printf("Return\n");
-            print_ast(node->data.return_stmt.value, indent + 1);
             break;
 
         case NODE_LITERAL:
             if (node->data.literal.type->kind == TYPE_POINTER) {
                 printf("Literal (pointer): %p\n", node->data.literal.value.ptr_value);
             } else {
-                printf("Literal: %d\n", node->data.literal.value.int_value);
+                printf(type_is_unsigned(node->data.literal.type) ? "Literal: %llu\n" : "Literal: %lld\n",
+                       node->data.literal.value.int_value);
             }
             break;
 
-        case NODE_BINARY_OP: {
-            const char *op_str = token_type_to_string(node->data.binary_op.op);
-            printf("BinaryOp: %s\n", op_str);
-            print_ast(node->data.binary_op.left, indent + 1);
-            print_ast(node->data.binary_op.right, indent + 1);
+        case NODE_BINARY_OP:
+            printf("BinaryOp: %s\n", token_type_to_string(node->data.binary_op.op));
             break;
-        }
 
-        case NODE_UNARY_OP: {
-            const char *op_str = token_type_to_string(node->data.unary_op.op);
-            printf("UnaryOp: %s (%s)\n", op_str, node->data.unary_op.is_prefix ? "prefix" : "postfix");
-            print_ast(node->data.unary_op.operand, indent + 1);
+        case NODE_UNARY_OP:
+            printf("UnaryOp: %s (%s)\n", token_type_to_string(node->data.unary_op.op), node->data.unary_op.is_prefix ? "prefix" : "postfix");
             break;
-        }
 
         case NODE_VAR_REF:
-            printf("VarRef: %s\n", node->data.var_ref.name);
+            printf("VarRef: %s\n", symbol_name(node->data.var_ref.name));
             break;
-            
+
         case NODE_PARAM_LIST:
             printf("ParamList of size %zu\n", node->data.param_list.count);
-            for (size_t i = 0; i < node->data.param_list.count; i++) {
-                print_ast(node->data.param_list.params[i], indent);
-            }
             break;
-            
+
         case NODE_STMT_LIST:
             printf("StmtList of size %zu\n", node->data.stmt_list.count);
-            for (size_t i = 0; i < node->data.stmt_list.count; i++) {
-                print_ast(node->data.stmt_list.stmts[i], indent);
-            }
             break;
 
         case NODE_IF_STMT:
             printf("IfStatement\n");
-            // Print condition
-            for (int i = 0; i < indent+1; i++) printf("  ");
-            printf("Condition:\n");
-            print_ast(node->data.if_stmt.condition, indent + 2);
-            
-            // Print then branch
-            for (int i = 0; i < indent+1; i++) printf("  ");
-            printf("Then:\n");
-            print_ast(node->data.if_stmt.then_branch, indent + 2);
-            
-            // Print else branch if exists
-            if (node->data.if_stmt.else_branch) {
-                for (int i = 0; i < indent+1; i++) printf("  ");
-                printf("Else:\n");
-                print_ast(node->data.if_stmt.else_branch, indent + 2);
-            }
             break;
 
         case NODE_WHILE_STMT:
             printf("WhileStatement\n");
-            // Print condition
-            for (int i = 0; i < indent+1; i++) printf("  ");
-            printf("Condition:\n");
-            print_ast(node->data.while_stmt.condition, indent + 2);
-            
-            // Print body
-            for (int i = 0; i < indent+1; i++) printf("  ");
-            printf("Body:\n");
-            print_ast(node->data.while_stmt.body, indent + 2);
             break;
 
         case NODE_FOR_STMT:
             printf("ForStatement\n");
-            // Print init if exists
-            if (node->data.for_stmt.init) {
-                for (int i = 0; i < indent+1; i++) printf("  ");
-                printf("Initializer:\n");
-                print_ast(node->data.for_stmt.init, indent + 2);
-            }
-            
-            // Print condition if exists
-            if (node->data.for_stmt.condition) {
-                for (int i = 0; i < indent+1; i++) printf("  ");
-                printf("Condition:\n");
-                print_ast(node->data.for_stmt.condition, indent + 2);
-            }
-            
-            // Print update if exists
-            if (node->data.for_stmt.update) {
-                for (int i = 0; i < indent+1; i++) printf("  ");
-                printf("Update:\n");
-                print_ast(node->data.for_stmt.update, indent + 2);
-            }
-
-            // Print body
-            for (int i = 0; i < indent+1; i++) printf("  ");
-            printf("Body:\n");
-            print_ast(node->data.for_stmt.body, indent + 2);
             break;
-            
-        case NODE_TYPE_SPECIFIER:
+
+        case NODE_TYPE_SPECIFIER: {
+            // Pointer and array types print their base on the same line
+            Type *type = node->data.type_spec.type;
             printf("TypeSpecifier: ");
-            switch (node->data.type_spec.type->kind) {
+            while (type->kind == TYPE_POINTER || type->kind == TYPE_ARRAY) {
+                if (type->kind == TYPE_POINTER) {
+                    printf("pointer to TypeSpecifier: ");
+                } else {
+                    printf("array[%zu] of TypeSpecifier: ", type->array_size);
+                }
+                type = type->base;
+            }
+            switch (type->kind) {
                 case TYPE_INT: printf("int\n"); break;
                 case TYPE_CHAR: printf("char\n"); break;
                 case TYPE_VOID: printf("void\n"); break;
-                case TYPE_POINTER: 
-                    printf("pointer to ");
-                    print_ast(create_type_spec_node(node->data.type_spec.type->base), 0);
-                    break;
-                case TYPE_ARRAY:
-                    printf("array[%zu] of ", node->data.type_spec.type->array_size);
-                    print_ast(create_type_spec_node(node->data.type_spec.type->base), 0);
-                    break;
                 default: printf("unknown\n"); break;
             }
             break;
+        }
 
         case NODE_FUNCTION_CALL:
-            printf("FunctionCall: %s\n", node->data.function_call.name);
-            for (size_t i = 0; i < node->data.function_call.arg_count; i++) {
-                print_ast(node->data.function_call.args[i], indent + 1);
-            }
+            printf("FunctionCall: %s\n", symbol_name(node->data.function_call.name));
             break;
-            
+
+        case NODE_TERNARY:
+            printf("Ternary\n");
+            break;
+
+        case NODE_STATIC_ASSERT:
+            printf("StaticAssert\n");
+            break;
+
         case INVALID_NODE_TYPE:
         case UNKNOWN_NODE_TYPE:
             LOG_ERROR("Invalid or unknown node type encountered during AST print\n");
-            break;
+            return AST_WALK_SKIP;
 
         default:
             printf("Unknown node type\n");
-            break;
+            return AST_WALK_SKIP;
     }
-}
\ No newline at end of file
+    return AST_WALK_CONTINUE;
+}
+
+// A deferred body is not a child, so it is noted after the parameters
+static void print_deferred_body(ASTNode *node, size_t depth, void *context) {
+    PrintState *state = context;
+    if (node->type != NODE_FUNCTION_DECL || !node->data.function_decl.deferred) return;
+    print_indent(state->indents[depth] + 1);
+    printf("Body: (not parsed)\n");
+}
+
+void print_ast(ASTNode *node, int indent) {
+    PrintState state = { NULL, 0, indent };
+    ast_walk(node, &(ASTVisitor){ print_node, print_deferred_body, &state });
+    free(state.indents);
+}
@@ -7,7 +7,63 @@
 void print_ast(ASTNode *node, int indent);
 const char *node_type_to_string(NodeType type);
 void free_ast(ASTNode *node);
+
+/*
+ * Iterative traversal. Children are addressed by slot: a fixed position such as the
+ * condition of an if, or an index into a list. Optional slots may be empty, in which
+ * case ast_child returns NULL and ast_walk passes over them.
+ */
+size_t ast_child_count(const ASTNode *node);
+ASTNode *ast_child(const ASTNode *node, size_t slot);
+
+typedef enum {
+    AST_WALK_CONTINUE, // Visit the node's children
+    AST_WALK_SKIP, // Leave the children out
+    AST_WALK_STOP // End the walk
+} ASTWalkAction;
+
+typedef struct {
+    // Before the children; parent is NULL and slot 0 for the root
+    ASTWalkAction (*enter)(ASTNode *node, const ASTNode *parent, size_t slot, size_t depth, void *context);
+    // After the children, for every entered node unless the walk was stopped
+    void (*leave)(ASTNode *node, size_t depth, void *context);
+    void *context;
+} ASTVisitor;
+
+// Depth-first on an explicit stack, so tree depth is bounded only by memory; false if stopped
+bool ast_walk(ASTNode *root, const ASTVisitor *visitor);
+
+typedef struct {
+    bool lazy; // Defer function bodies, as parse_tokens_lazy does; lazy parses are serial
+    // Evaluate int constant subexpressions as C does and canonicalize operands (constants
+    // to the right, x + 0 and the like dropped) as nodes are built
+    bool fold;
+    size_t threads; // As for parse_tokens_parallel: 1 parses on the calling thread, 0 on every core
+    size_t folded; // Set by the parse: operator nodes that folding left out, lazy bodies not counted
+} ParseOptions;
+
+// Tokenizes the whole input with token_buffer_fill, then parses the buffer
 ASTNode* parse(Lexer *lexer);
+// Parses a pre-tokenized input; the buffer can be freed once this returns
+ASTNode* parse_tokens(const TokenBuffer *tokens);
+/*
+ * Parses signatures only: each function body is brace-matched and kept as a token
+ * range until function_body asks for it. The buffer and its source text must outlive
+ * every function_body call. Bodies allocate from the program's arena, so they are
+ * parsed from one thread.
+ */
+ASTNode* parse_tokens_lazy(const TokenBuffer *tokens);
+/*
+ * Parses on threads (0 = one per core): the input is split after top-level closing
+ * braces, runs of whole functions are parsed into per-thread arenas, and the results are
+ * joined in source order, giving the same tree as parse_tokens. On a syntax error the
+ * input is reparsed serially so diagnostics come out once and in order.
+ */
+ASTNode* parse_tokens_parallel(const TokenBuffer *tokens, size_t threads);
+// The general form of the parse_tokens calls
+ASTNode* parse_tokens_with(const TokenBuffer *tokens, ParseOptions *options);
+// A function's body, parsed on first use if it was deferred; NULL if it does not parse
+ASTNode* function_body(ASTNode *function);
 
 #endif // PARSER_H
 
@@ -0,0 +1,221 @@
+/*
+ * File: pool.c
+ * Description: Implements the work-stealing thread pool declared in pool.h.
+ * Purpose: Each worker owns a deque; it pops its own work LIFO from the back
+ *          and steals FIFO from the front of other workers' deques when idle.
+ */
+
+#include "pool.h"
+#include "debug.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+typedef struct {
+    PoolTask task;
+    void *arg;
+} PoolJob;
+
+typedef struct {
+    pthread_mutex_t lock;
+    PoolJob *jobs;     // Ring buffer
+    size_t head;       // Steal end
+    size_t count;
+    size_t capacity;
+} WorkQueue;
+
+typedef struct {
+    ThreadPool *pool;
+    size_t index;
+} Worker;
+
+struct ThreadPool {
+    size_t thread_count;
+    pthread_t *threads;
+    Worker *workers;
+    WorkQueue *queues;
+    size_t next_queue;         // Round-robin target for pool_submit
+
+    atomic_size_t queued;      // Jobs sitting in some queue
+    atomic_size_t pending;     // Jobs submitted but not yet finished
+    pthread_mutex_t lock;      // Guards sleeping/waking only
+    pthread_cond_t work_ready;
+    pthread_cond_t all_done;
+    bool shutdown;
+};
+
+static void queue_push(WorkQueue *queue, PoolJob job) {
+    pthread_mutex_lock(&queue->lock);
+    if (queue->count == queue->capacity) {
+        size_t new_capacity = queue->capacity == 0 ? 16 : queue->capacity * 2;
+        PoolJob *new_jobs = malloc(sizeof(PoolJob) * new_capacity);
+        if (!new_jobs) {
+            LOG_ERROR("Unable to allocate memory for work queue");
+            exit(EXIT_FAILURE);
+        }
+        for (size_t i = 0; i < queue->count; i++) {
+            new_jobs[i] = queue->jobs[(queue->head + i) % queue->capacity];
+        }
+        free(queue->jobs);
+        queue->jobs = new_jobs;
+        queue->head = 0;
+        queue->capacity = new_capacity;
+    }
+    queue->jobs[(queue->head + queue->count) % queue->capacity] = job;
+    queue->count++;
+    pthread_mutex_unlock(&queue->lock);
+}
+
+// Owner end: most recently queued job first
+static bool queue_pop(WorkQueue *queue, PoolJob *job) {
+    pthread_mutex_lock(&queue->lock);
+    bool found = queue->count > 0;
+    if (found) {
+        queue->count--;
+        *job = queue->jobs[(queue->head + queue->count) % queue->capacity];
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return found;
+}
+
+// Thief end: oldest job first
+static bool queue_steal(WorkQueue *queue, PoolJob *job) {
+    if (pthread_mutex_trylock(&queue->lock) != 0) return false;
+    bool found = queue->count > 0;
+    if (found) {
+        *job = queue->jobs[queue->head];
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count--;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return found;
+}
+
+static bool find_job(ThreadPool *pool, size_t self, PoolJob *job) {
+    if (queue_pop(&pool->queues[self], job)) return true;
+    for (size_t i = 1; i < pool->thread_count; i++) {
+        if (queue_steal(&pool->queues[(self + i) % pool->thread_count], job)) return true;
+    }
+    return false;
+}
+
+static void *worker_main(void *arg) {
+    Worker *worker = arg;
+    ThreadPool *pool = worker->pool;
+
+    for (;;) {
+        PoolJob job;
+        if (find_job(pool, worker->index, &job)) {
+            atomic_fetch_sub(&pool->queued, 1);
+            job.task(job.arg);
+            if (atomic_fetch_sub(&pool->pending, 1) == 1) {
+                pthread_mutex_lock(&pool->lock);
+                pthread_cond_broadcast(&pool->all_done);
+                pthread_mutex_unlock(&pool->lock);
+            }
+            continue;
+        }
+
+        // Nothing found; a failed trylock may have hidden work, so only sleep when none is queued
+        pthread_mutex_lock(&pool->lock);
+        while (atomic_load(&pool->queued) == 0 && !pool->shutdown) {
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        }
+        bool stop = pool->shutdown && atomic_load(&pool->queued) == 0;
+        pthread_mutex_unlock(&pool->lock);
+        if (stop) return NULL;
+    }
+}
+
+ThreadPool *pool_create(size_t thread_count) {
+    if (thread_count == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = online > 0 ? (size_t)online : 1;
+    }
+
+    ThreadPool *pool = malloc(sizeof(ThreadPool));
+    if (!pool) {
+        LOG_ERROR("Unable to allocate memory for thread pool");
+        exit(EXIT_FAILURE);
+    }
+    pool->thread_count = thread_count;
+    pool->threads = malloc(sizeof(pthread_t) * thread_count);
+    pool->workers = malloc(sizeof(Worker) * thread_count);
+    pool->queues = calloc(thread_count, sizeof(WorkQueue));
+    if (!pool->threads || !pool->workers || !pool->queues) {
+        LOG_ERROR("Unable to allocate memory for thread pool workers");
+        exit(EXIT_FAILURE);
+    }
+    pool->next_queue = 0;
+    atomic_init(&pool->queued, 0);
+    atomic_init(&pool->pending, 0);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->all_done, NULL);
+    pool->shutdown = false;
+
+    for (size_t i = 0; i < thread_count; i++) {
+        pthread_mutex_init(&pool->queues[i].lock, NULL);
+    }
+    for (size_t i = 0; i < thread_count; i++) {
+        pool->workers[i] = (Worker){ pool, i };
+        if (pthread_create(&pool->threads[i], NULL, worker_main, &pool->workers[i]) != 0) {
+            LOG_ERROR("Unable to start thread pool worker %zu", i);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    LOG_INFO("Started thread pool with %zu workers", thread_count);
+    return pool;
+}
+
+void pool_submit(ThreadPool *pool, PoolTask task, void *arg) {
+    // Count the job before it becomes visible, so queued never drops below the real number
+    atomic_fetch_add(&pool->pending, 1);
+    atomic_fetch_add(&pool->queued, 1);
+    queue_push(&pool->queues[pool->next_queue], (PoolJob){ task, arg });
+    pool->next_queue = (pool->next_queue + 1) % pool->thread_count;
+
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_signal(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void pool_wait(ThreadPool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    while (atomic_load(&pool->pending) > 0) {
+        pthread_cond_wait(&pool->all_done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void pool_destroy(ThreadPool *pool) {
+    if (!pool) return;
+    pool_wait(pool);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (size_t i = 0; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    for (size_t i = 0; i < pool->thread_count; i++) {
+        pthread_mutex_destroy(&pool->queues[i].lock);
+        free(pool->queues[i].jobs);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_cond_destroy(&pool->all_done);
+    free(pool->queues);
+    free(pool->workers);
+    free(pool->threads);
+    free(pool);
+}
+
+size_t pool_thread_count(const ThreadPool *pool) {
+    return pool->thread_count;
+}
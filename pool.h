@@ -0,0 +1,30 @@
+/*
+ * File: pool.h
+ * Description: Declares a small work-stealing thread pool.
+ * Purpose: Runs independent per-function compilation jobs on all available cores.
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+
+typedef void (*PoolTask)(void *arg);
+
+typedef struct ThreadPool ThreadPool;
+
+// Start thread_count workers; 0 picks the number of online processors
+ThreadPool *pool_create(size_t thread_count);
+
+// Queue a task; tasks are dealt round-robin and idle workers steal from busy ones
+void pool_submit(ThreadPool *pool, PoolTask task, void *arg);
+
+// Block until every task submitted so far has finished
+void pool_wait(ThreadPool *pool);
+
+// Wait for outstanding tasks, then stop and join the workers
+void pool_destroy(ThreadPool *pool);
+
+size_t pool_thread_count(const ThreadPool *pool);
+
+#endif // POOL_H
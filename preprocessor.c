@@ -0,0 +1,1692 @@
+/*
+ * File: preprocessor.c
+ * Description: Implements the token-level preprocessor declared in preprocessor.h.
+ * Purpose: Each file is lexed once into an array of PPTokens that records line
+ *          starts and spacing. Text lines are expanded with Prosser's hide-set
+ *          algorithm; directives are read straight from the array. Tokenized headers
+ *          live in a process-wide cache keyed by interned path, together with the
+ *          include guard or #pragma once found when they were first read. With a
+ *          build cache attached, token arrays also persist on disk between runs.
+ */
+
+#include "preprocessor.h"
+#include "arena.h"
+#include "debug.h"
+#include "source.h"
+#include <limits.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define MAX_INCLUDE_DEPTH 200
+
+enum {
+    PP_LINE_START = 1 << 0,  // First token on its line
+    PP_SPACE_BEFORE = 1 << 1 // Whitespace or a comment comes before the token
+};
+
+typedef struct HideSet {
+    Symbol name;
+    const struct HideSet *next;
+} HideSet;
+
+struct PPFile;
+
+typedef struct PPToken {
+    struct PPToken *next;    // Links tokens in expansion lists
+    const char *text;
+    const Literal *literal;  // TOK_INTEGER and TOK_FLOAT
+    const HideSet *hideset;  // Macros this token came out of, which must not expand again
+    const struct PPFile *file;
+    uint32_t length;
+    uint32_t line;
+    Symbol symbol;           // Identifiers and keywords, SYMBOL_NONE otherwise
+    uint8_t type;
+    uint8_t flags;
+} PPToken;
+
+// A tokenized file; immutable once built, so cached headers are shared between threads
+typedef struct PPFile {
+    char *path;          // As found on the search path; used for __FILE__ and diagnostics
+    char *directory;     // Prefix for "..." includes, empty or ending in '/'
+    SourceFile source;   // Not used for text supplied by the caller
+    bool owns_source;
+    Arena *arena;        // Literal values
+    PPToken *tokens;     // Ends in TOK_EOF
+    size_t count;
+    Symbol guard;        // Macro of an include guard around the whole file, or SYMBOL_NONE
+    bool pragma_once;
+    uint64_t hash;       // cache_hash of the source text
+} PPFile;
+
+typedef enum {
+    BUILTIN_NONE,
+    BUILTIN_FILE,
+    BUILTIN_LINE
+} Builtin;
+
+typedef struct {
+    Symbol name;
+    Builtin builtin;
+    bool function_like;
+    bool variadic;       // The last parameter is __VA_ARGS__
+    Symbol *params;
+    size_t param_count;
+    const PPToken *body; // Points into the defining file's tokens
+    size_t body_count;
+} Macro;
+
+typedef struct {
+    bool taken;     // A branch of this #if group has been processed
+    bool seen_else;
+} Conditional;
+
+// Directive and builtin names, interned once per preprocessor
+typedef struct {
+    Symbol define, undef, include, if_, ifdef, ifndef, elif, elifdef, elifndef, else_, endif;
+    Symbol error, warning, pragma, line, once, defined, va_args, va_opt, file, line_macro;
+} Names;
+
+struct Preprocessor {
+    Arena *arena;             // Macros, expansion lists, hide sets and pasted spellings
+    Names names;
+    Macro **macros;           // Indexed by Symbol
+    size_t macro_capacity;
+    bool *included_once;      // Indexed by the Symbol of a #pragma once file's path
+    size_t included_capacity;
+    char **include_paths;
+    size_t include_count;
+    size_t include_capacity;
+    PPFile **owned;           // Main file and -D definitions; headers belong to the cache
+    size_t owned_count;
+    size_t owned_capacity;
+    BuildCache *cache;        // On-disk token cache, or NULL
+    CacheDependency *dependencies; // Files read by the current run
+    size_t dependency_count;
+    size_t dependency_capacity;
+    bool *recorded;           // Indexed by the Symbol of a path already in dependencies
+    size_t recorded_capacity;
+    Conditional *conditions;
+    size_t condition_count;
+    size_t condition_capacity;
+    size_t include_depth;
+    const PPFile *main_file;
+    TokenBuffer *out;
+    char *text;               // Output spellings
+    size_t text_length;
+    size_t text_capacity;
+    uint32_t out_line;
+    bool had_error;
+    PreprocessorStats stats;
+};
+
+typedef struct {
+    PPToken *head;
+    PPToken *tail;
+} TokenList;
+
+typedef struct {
+    PPToken *pending;     // Expansion output still to be rescanned
+    const PPFile *file;   // NULL while expanding a macro argument
+    size_t position;
+} Input;
+
+typedef struct {
+    PPToken *raw;        // As written in the invocation
+    PPToken *expanded;   // Fully macro-replaced, built on first use
+    bool expanded_ready;
+} Argument;
+
+// Process-wide header cache, indexed by the interned path of every name a header was found under
+static struct {
+    pthread_mutex_t lock;
+    PPFile **by_path;
+    size_t capacity;
+} header_cache = { PTHREAD_MUTEX_INITIALIZER, NULL, 0 };
+
+static const PPToken *next_expanded(Preprocessor *pp, Input *in);
+static void process_file(Preprocessor *pp, const PPFile *file);
+
+static void pp_report(Preprocessor *pp, const char *kind, const PPToken *at, const char *format, va_list args) {
+    if (at && at->file) {
+        fprintf(stderr, "%s in %s at line %u: ", kind, at->file->path, at->line);
+    } else {
+        fprintf(stderr, "%s: ", kind);
+    }
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    (void)pp;
+}
+
+static void pp_error(Preprocessor *pp, const PPToken *at, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    pp_report(pp, "Error", at, format, args);
+    va_end(args);
+    pp->had_error = true;
+}
+
+static void pp_warning(Preprocessor *pp, const PPToken *at, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    pp_report(pp, "Warning", at, format, args);
+    va_end(args);
+}
+
+static void *grow_array(void *array, size_t *capacity, size_t needed, size_t element_size) {
+    if (needed <= *capacity) return array;
+    size_t new_capacity = *capacity ? *capacity : 16;
+    while (new_capacity < needed) new_capacity *= 2;
+    array = realloc(array, element_size * new_capacity);
+    if (!array) {
+        LOG_ERROR("Unable to allocate memory for preprocessor tables");
+        exit(EXIT_FAILURE);
+    }
+    // Tables indexed by Symbol rely on unused slots being zero
+    memset((char *)array + element_size * *capacity, 0, element_size * (new_capacity - *capacity));
+    *capacity = new_capacity;
+    return array;
+}
+
+/* ---- Tokenizing files ---- */
+
+static bool is_keyword(TokenType type) {
+    return type <= TOK_KW_CONSTEXPR;
+}
+
+static PPFile *file_create(const char *path) {
+    PPFile *file = calloc(1, sizeof(PPFile));
+    if (!file) {
+        LOG_ERROR("Unable to allocate memory for preprocessor file");
+        exit(EXIT_FAILURE);
+    }
+    file->path = strdup(path);
+    const char *slash = strrchr(path, '/');
+    size_t directory_length = slash ? (size_t)(slash - path + 1) : 0;
+    file->directory = malloc(directory_length + 1);
+    if (!file->path || !file->directory) {
+        LOG_ERROR("Unable to allocate memory for preprocessor file");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(file->directory, path, directory_length);
+    file->directory[directory_length] = '\0';
+    file->arena = arena_create();
+    return file;
+}
+
+static void file_free(PPFile *file) {
+    if (!file) return;
+    if (file->owns_source) source_close(&file->source);
+    arena_destroy(file->arena);
+    free(file->tokens);
+    free(file->directory);
+    free(file->path);
+    free(file);
+}
+
+// A lone backslash followed only by blanks up to the newline splices the next line on
+static bool is_line_splice(const Token *token) {
+    if (token->type != TOK_UNKNOWN || token->length != 1 || token->text[0] != '\\') return false;
+    const char *p = token->text + 1;
+    while (*p == ' ' || *p == '\t' || *p == '\r') p++;
+    return *p == '\n';
+}
+
+static void tokenize_file(PPFile *file, const char *text) {
+    Lexer lexer;
+    lexer_init(&lexer, text);
+    size_t capacity = strlen(text) / 6 + 16;
+    file->tokens = malloc(sizeof(PPToken) * capacity);
+    if (!file->tokens) {
+        LOG_ERROR("Unable to allocate memory for preprocessor tokens");
+        exit(EXIT_FAILURE);
+    }
+
+    const char *previous_end = text;
+    uint32_t line = 1;
+    uint8_t flags = PP_LINE_START;
+    bool spliced = false;
+    for (;;) {
+        Token token = next_token(&lexer);
+        if (token.text > previous_end) flags |= PP_SPACE_BEFORE;
+        for (const char *p = previous_end; p < token.text; p++) {
+            if (*p != '\n') continue;
+            line++;
+            if (spliced) spliced = false;
+            else flags |= PP_LINE_START;
+        }
+        previous_end = token.text + token.length;
+
+        // Comments become spacing; newlines inside block comments do not end a line
+        if (token.type == TOK_COMMENT || token.type == TOK_WHITESPACE) {
+            for (size_t i = 0; i < token.length; i++) line += token.text[i] == '\n';
+            flags |= PP_SPACE_BEFORE;
+            continue;
+        }
+        if (is_line_splice(&token)) {
+            spliced = true;
+            flags |= PP_SPACE_BEFORE;
+            continue;
+        }
+
+        if (file->count == capacity) {
+            capacity *= 2;
+            file->tokens = realloc(file->tokens, sizeof(PPToken) * capacity);
+            if (!file->tokens) {
+                LOG_ERROR("Unable to allocate memory for preprocessor tokens");
+                exit(EXIT_FAILURE);
+            }
+        }
+        PPToken *pp_token = &file->tokens[file->count++];
+        *pp_token = (PPToken){
+            .text = token.text,
+            .file = file,
+            .length = (uint32_t)token.length,
+            .line = line,
+            .symbol = token.symbol,
+            .type = (uint8_t)token.type,
+            .flags = flags
+        };
+        if (is_keyword(token.type)) pp_token->symbol = intern(token.text, token.length);
+        if (token.type == TOK_INTEGER || token.type == TOK_FLOAT) {
+            Literal *literal = arena_alloc(file->arena, sizeof(Literal));
+            *literal = token.literal;
+            pp_token->literal = literal;
+        }
+        flags = 0;
+        if (token.type == TOK_EOF) break;
+    }
+}
+
+// Index of the first token after the directive or text line starting at position
+static size_t line_end(const PPFile *file, size_t position) {
+    size_t end = position + 1;
+    while (file->tokens[end].type != TOK_EOF && !(file->tokens[end].flags & PP_LINE_START)) end++;
+    return end;
+}
+
+static bool is_directive(const PPToken *token) {
+    return token->type == TOK_PP_HASH && (token->flags & PP_LINE_START);
+}
+
+/*
+ * Finds #pragma once, and an include guard: the file's first directive is
+ * #ifndef X or #if !defined X, and its #endif is the last thing in the file.
+ * Once X is defined such a file expands to nothing, so it need not be read again.
+ */
+static void analyze_file(PPFile *file, const Names *names) {
+    const PPToken *tokens = file->tokens;
+    Symbol guard = SYMBOL_NONE;
+    if (file->count > 3 && is_directive(&tokens[0])) {
+        size_t end = line_end(file, 0);
+        if (tokens[1].symbol == names->ifndef && end == 3 && tokens[2].symbol) {
+            guard = tokens[2].symbol;
+        } else if (tokens[1].symbol == names->if_ && tokens[2].type == TOK_BANG && tokens[3].symbol == names->defined) {
+            if (end == 5 && tokens[4].symbol) guard = tokens[4].symbol;
+            else if (end == 7 && tokens[4].type == TOK_LPAREN && tokens[5].symbol && tokens[6].type == TOK_RPAREN) guard = tokens[5].symbol;
+        }
+    }
+
+    int depth = 0;
+    bool guarded = guard != SYMBOL_NONE;
+    for (size_t i = 0; i < file->count - 1; i++) {
+        if (!is_directive(&tokens[i])) {
+            if (depth == 0) guarded = false; // Text outside the guard
+            continue;
+        }
+        size_t end = line_end(file, i);
+        Symbol name = tokens[i + 1].flags & PP_LINE_START ? SYMBOL_NONE : tokens[i + 1].symbol;
+        if (name == names->pragma && end > i + 2 && tokens[i + 2].symbol == names->once) {
+            file->pragma_once = true;
+        }
+        if (name == names->if_ || name == names->ifdef || name == names->ifndef) {
+            if (depth == 0 && i != 0) guarded = false;
+            depth++;
+        } else if (name == names->endif) {
+            depth--;
+            if (depth == 0 && file->tokens[end].type != TOK_EOF) guarded = false;
+        } else if (depth == 1 && (name == names->else_ || name == names->elif || name == names->elifdef || name == names->elifndef)) {
+            guarded = false;
+        } else if (depth == 0) {
+            guarded = false;
+        }
+        i = end - 1;
+    }
+    file->guard = guarded && depth == 0 ? guard : SYMBOL_NONE;
+}
+
+/* ---- Build cache ---- */
+
+/*
+ * A file's tokens are stored under the hash of its text. Spellings are offsets into
+ * that text, and each distinct name is stored once so that loading interns names
+ * rather than every identifier occurrence.
+ */
+#define TOKEN_CACHE_VERSION 1
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t token_count;
+    uint64_t hash;
+    uint64_t length;       // Of the text, which must match as well as the hash
+    uint32_t name_count;
+    uint32_t literal_count;
+    uint32_t guard;        // Name index + 1, or 0
+    uint32_t pragma_once;
+} TokenCacheHeader;
+
+typedef struct {
+    uint32_t offset;
+    uint32_t length;
+    uint32_t line;
+    uint32_t name;         // Name index + 1, or 0
+    uint8_t type;
+    uint8_t flags;
+    uint16_t unused;
+} TokenRecord;
+
+typedef struct {
+    uint32_t offset;       // First spelling in the text
+    uint32_t length;
+} NameRecord;
+
+static const char token_cache_magic[8] = "CCOMPTK";
+
+static bool load_cached_tokens(BuildCache *cache, PPFile *file) {
+    CacheBlob blob;
+    if (!build_cache_read(cache, "tokens", file->hash, &blob)) return false;
+
+    const TokenCacheHeader *header = (const TokenCacheHeader *)blob.data;
+    size_t length = file->source.length;
+    bool valid = blob.size >= sizeof(TokenCacheHeader) &&
+                 memcmp(header->magic, token_cache_magic, sizeof token_cache_magic) == 0 &&
+                 header->version == TOKEN_CACHE_VERSION && header->hash == file->hash &&
+                 header->length == length && header->token_count > 0 &&
+                 cache_align(sizeof(TokenCacheHeader)) + cache_align((size_t)header->token_count * sizeof(TokenRecord)) +
+                 cache_align((size_t)header->name_count * sizeof(NameRecord)) +
+                 cache_align((size_t)header->literal_count * sizeof(Literal)) == blob.size &&
+                 header->guard <= header->name_count;
+    if (!valid) {
+        cache_blob_release(&blob);
+        return false;
+    }
+
+    const unsigned char *at = blob.data + cache_align(sizeof(TokenCacheHeader));
+    const TokenRecord *records = (const TokenRecord *)at;
+    at += cache_align((size_t)header->token_count * sizeof(TokenRecord));
+    const NameRecord *names = (const NameRecord *)at;
+    at += cache_align((size_t)header->name_count * sizeof(NameRecord));
+    const Literal *literals = (const Literal *)at;
+
+    Symbol *symbols = malloc(((size_t)header->name_count + 1) * sizeof(Symbol));
+    file->tokens = malloc((size_t)header->token_count * sizeof(PPToken));
+    if (!symbols || !file->tokens) {
+        LOG_ERROR("Unable to allocate memory for preprocessor tokens");
+        exit(EXIT_FAILURE);
+    }
+    symbols[0] = SYMBOL_NONE;
+    for (uint32_t i = 0; i < header->name_count && valid; i++) {
+        valid = names[i].offset <= length && names[i].length <= length - names[i].offset;
+        if (valid) symbols[i + 1] = intern(file->source.text + names[i].offset, names[i].length);
+    }
+
+    Literal *values = header->literal_count ? arena_alloc(file->arena, header->literal_count * sizeof(Literal)) : NULL;
+    size_t literal = 0;
+    for (uint32_t i = 0; i < header->token_count && valid; i++) {
+        const TokenRecord *record = &records[i];
+        valid = record->offset <= length && record->length <= length - record->offset &&
+                record->name <= header->name_count && record->type < TOK_COMMENT;
+        if (!valid) break;
+        PPToken *token = &file->tokens[i];
+        *token = (PPToken){
+            .text = file->source.text + record->offset,
+            .file = file,
+            .length = record->length,
+            .line = record->line,
+            .symbol = symbols[record->name],
+            .type = record->type,
+            .flags = record->flags
+        };
+        if (record->type == TOK_INTEGER || record->type == TOK_FLOAT) {
+            valid = literal < header->literal_count && literals[literal].token == i;
+            if (!valid) break;
+            values[literal] = literals[literal];
+            token->literal = &values[literal++];
+        }
+    }
+    valid = valid && literal == header->literal_count && file->tokens[header->token_count - 1].type == TOK_EOF;
+
+    if (valid) {
+        file->count = header->token_count;
+        file->guard = symbols[header->guard];
+        file->pragma_once = header->pragma_once != 0;
+    } else {
+        LOG_INFO("Ignoring damaged token cache entry for %s", file->path);
+        free(file->tokens);
+        file->tokens = NULL;
+    }
+    free(symbols);
+    cache_blob_release(&blob);
+    return valid;
+}
+
+static void store_cached_tokens(BuildCache *cache, const PPFile *file) {
+    size_t length = file->source.length;
+    if (length > UINT32_MAX) return;
+
+    // Symbol -> name index + 1
+    uint32_t *name_of = calloc(symbol_count() + 1, sizeof(uint32_t));
+    TokenRecord *records = calloc(file->count, sizeof(TokenRecord));
+    NameRecord *names = NULL;
+    Literal *literals = NULL;
+    size_t name_count = 0, name_capacity = 0, literal_count = 0, literal_capacity = 0;
+    if (!name_of || !records) {
+        LOG_ERROR("Unable to allocate memory for the token cache");
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t i = 0; i < file->count; i++) {
+        const PPToken *token = &file->tokens[i];
+        TokenRecord *record = &records[i];
+        record->offset = (uint32_t)(token->text - file->source.text);
+        record->length = token->length;
+        record->line = token->line;
+        record->type = token->type;
+        record->flags = token->flags;
+        if (token->symbol != SYMBOL_NONE) {
+            if (name_of[token->symbol] == 0) {
+                names = grow_array(names, &name_capacity, name_count + 1, sizeof(NameRecord));
+                names[name_count++] = (NameRecord){ record->offset, record->length };
+                name_of[token->symbol] = (uint32_t)name_count;
+            }
+            record->name = name_of[token->symbol];
+        }
+        if (token->literal) {
+            literals = grow_array(literals, &literal_capacity, literal_count + 1, sizeof(Literal));
+            literals[literal_count] = *token->literal;
+            literals[literal_count++].token = (uint32_t)i;
+        }
+    }
+
+    TokenCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, token_cache_magic, sizeof token_cache_magic);
+    header.version = TOKEN_CACHE_VERSION;
+    header.token_count = (uint32_t)file->count;
+    header.hash = file->hash;
+    header.length = length;
+    header.name_count = (uint32_t)name_count;
+    header.literal_count = (uint32_t)literal_count;
+    // A guard macro is an identifier of the file, so it always has a name
+    header.guard = file->guard != SYMBOL_NONE ? name_of[file->guard] : 0;
+    header.pragma_once = file->pragma_once;
+
+    CacheChunk chunks[] = {
+        { &header, sizeof(header) },
+        { records, file->count * sizeof(TokenRecord) },
+        { names, name_count * sizeof(NameRecord) },
+        { literals, literal_count * sizeof(Literal) },
+    };
+    build_cache_write(cache, "tokens", file->hash, chunks, sizeof(chunks) / sizeof(chunks[0]));
+
+    free(name_of);
+    free(records);
+    free(names);
+    free(literals);
+}
+
+// Maps path and tokenizes it, or takes its tokens from the build cache
+static PPFile *load_file(Preprocessor *pp, const char *path, const char *name) {
+    PPFile *file = file_create(name);
+    if (!source_open(&file->source, path)) {
+        file_free(file);
+        return NULL;
+    }
+    file->owns_source = true;
+    file->hash = cache_hash(file->source.text, file->source.length, 0);
+    if (pp->cache && load_cached_tokens(pp->cache, file)) {
+        pp->stats.cached_files++;
+        return file;
+    }
+    tokenize_file(file, file->source.text);
+    analyze_file(file, &pp->names);
+    if (pp->cache) store_cached_tokens(pp->cache, file);
+    return file;
+}
+
+/* ---- Header cache ---- */
+
+static PPFile *cache_lookup(Symbol key) {
+    return key < header_cache.capacity ? header_cache.by_path[key] : NULL;
+}
+
+static void cache_store(Symbol key, PPFile *file) {
+    header_cache.by_path = grow_array(header_cache.by_path, &header_cache.capacity, (size_t)key + 1, sizeof(PPFile *));
+    header_cache.by_path[key] = file;
+}
+
+// Repeated includes of the same spelling are one interned lookup; new spellings are canonicalised
+static const PPFile *find_header(Preprocessor *pp, const char *path) {
+    Symbol key = intern_cstr(path);
+    pthread_mutex_lock(&header_cache.lock);
+    PPFile *file = cache_lookup(key);
+    if (file) {
+        pthread_mutex_unlock(&header_cache.lock);
+        pp->stats.cache_hits++;
+        return file;
+    }
+
+    struct stat info;
+    char resolved[PATH_MAX];
+    if (stat(path, &info) != 0 || !S_ISREG(info.st_mode) || !realpath(path, resolved)) {
+        pthread_mutex_unlock(&header_cache.lock);
+        return NULL;
+    }
+    Symbol canonical = intern_cstr(resolved);
+    file = cache_lookup(canonical);
+    if (file) {
+        pp->stats.cache_hits++;
+    } else {
+        file = load_file(pp, path, path);
+        if (file) {
+            cache_store(canonical, file);
+            pp->stats.files_loaded++;
+        }
+    }
+    if (file) cache_store(key, file);
+    pthread_mutex_unlock(&header_cache.lock);
+    return file;
+}
+
+void preprocessor_cache_reset(void) {
+    pthread_mutex_lock(&header_cache.lock);
+    // A header is stored under several names; free each one once, under its canonical slot
+    for (size_t i = 0; i < header_cache.capacity; i++) {
+        PPFile *file = header_cache.by_path[i];
+        if (!file) continue;
+        for (size_t j = i; j < header_cache.capacity; j++) {
+            if (header_cache.by_path[j] == file) header_cache.by_path[j] = NULL;
+        }
+        file_free(file);
+    }
+    free(header_cache.by_path);
+    header_cache.by_path = NULL;
+    header_cache.capacity = 0;
+    pthread_mutex_unlock(&header_cache.lock);
+}
+
+/* ---- Hide sets and token lists ---- */
+
+static bool hideset_contains(const HideSet *set, Symbol name) {
+    for (; set; set = set->next) {
+        if (set->name == name) return true;
+    }
+    return false;
+}
+
+static const HideSet *hideset_add(Preprocessor *pp, const HideSet *set, Symbol name) {
+    if (hideset_contains(set, name)) return set;
+    HideSet *node = arena_alloc(pp->arena, sizeof(HideSet));
+    node->name = name;
+    node->next = set;
+    return node;
+}
+
+static const HideSet *hideset_union(Preprocessor *pp, const HideSet *a, const HideSet *b) {
+    if (!a) return b;
+    for (; b; b = b->next) a = hideset_add(pp, a, b->name);
+    return a;
+}
+
+static const HideSet *hideset_intersection(Preprocessor *pp, const HideSet *a, const HideSet *b) {
+    const HideSet *result = NULL;
+    for (; a; a = a->next) {
+        if (hideset_contains(b, a->name)) result = hideset_add(pp, result, a->name);
+    }
+    return result;
+}
+
+static PPToken *copy_token(Preprocessor *pp, const PPToken *token) {
+    PPToken *copy = arena_alloc(pp->arena, sizeof(PPToken));
+    *copy = *token;
+    copy->next = NULL;
+    return copy;
+}
+
+static void list_append(TokenList *list, PPToken *token) {
+    if (list->tail) list->tail->next = token;
+    else list->head = token;
+    list->tail = token;
+}
+
+static void list_append_copies(Preprocessor *pp, TokenList *list, const PPToken *tokens) {
+    for (; tokens; tokens = tokens->next) list_append(list, copy_token(pp, tokens));
+}
+
+/* ---- Input ---- */
+
+// Next token without consuming it; NULL at the end of the input and before a directive
+static const PPToken *input_peek(const Input *in) {
+    if (in->pending) return in->pending;
+    if (!in->file) return NULL;
+    const PPToken *token = &in->file->tokens[in->position];
+    if (token->type == TOK_EOF || is_directive(token)) return NULL;
+    return token;
+}
+
+static const PPToken *input_next(Input *in) {
+    const PPToken *token = input_peek(in);
+    if (!token) return NULL;
+    if (in->pending) in->pending = in->pending->next;
+    else in->position++;
+    return token;
+}
+
+/* ---- Macro expansion ---- */
+
+static Macro *find_macro(const Preprocessor *pp, Symbol name) {
+    return name < pp->macro_capacity ? pp->macros[name] : NULL;
+}
+
+static int param_index(const Macro *macro, const PPToken *token) {
+    if (!token->symbol) return -1;
+    for (size_t i = 0; i < macro->param_count; i++) {
+        if (macro->params[i] == token->symbol) return (int)i;
+    }
+    return -1;
+}
+
+// Lexes text that must form exactly one token; NULL if it does not
+static PPToken *make_token_from_text(Preprocessor *pp, char *text, size_t length, const PPToken *origin) {
+    Lexer lexer;
+    lexer_init(&lexer, text);
+    Token token = next_token(&lexer);
+    if (token.length != length || token.type == TOK_COMMENT || token.type == TOK_UNKNOWN) return NULL;
+    PPToken *result = copy_token(pp, origin);
+    result->text = text;
+    result->length = (uint32_t)length;
+    result->type = (uint8_t)token.type;
+    result->symbol = is_keyword(token.type) ? intern(text, length) : token.symbol;
+    result->literal = NULL;
+    if (token.type == TOK_INTEGER || token.type == TOK_FLOAT) {
+        Literal *literal = arena_alloc(pp->arena, sizeof(Literal));
+        *literal = token.literal;
+        result->literal = literal;
+    }
+    return result;
+}
+
+// Replaces lhs in place with the token spelled lhs followed by rhs
+static void paste_tokens(Preprocessor *pp, PPToken *lhs, const PPToken *rhs) {
+    size_t length = lhs->length + rhs->length;
+    char *text = arena_alloc(pp->arena, length + 1);
+    memcpy(text, lhs->text, lhs->length);
+    memcpy(text + lhs->length, rhs->text, rhs->length);
+    PPToken *pasted = make_token_from_text(pp, text, length, lhs);
+    if (!pasted) {
+        pp_error(pp, lhs, "Pasting \"%.*s\" and \"%.*s\" does not give a valid token",
+                 (int)lhs->length, lhs->text, (int)rhs->length, rhs->text);
+        return;
+    }
+    *lhs = *pasted;
+}
+
+static PPToken *stringize(Preprocessor *pp, const PPToken *tokens, const PPToken *hash) {
+    size_t capacity = 3;
+    for (const PPToken *t = tokens; t; t = t->next) capacity += 2 * t->length + 1;
+    char *text = arena_alloc(pp->arena, capacity);
+    size_t length = 0;
+    text[length++] = '"';
+    for (const PPToken *t = tokens; t; t = t->next) {
+        if (t != tokens && (t->flags & (PP_SPACE_BEFORE | PP_LINE_START))) text[length++] = ' ';
+        bool quoted = t->type == TOK_STRING || t->type == TOK_CHAR;
+        for (uint32_t i = 0; i < t->length; i++) {
+            char c = t->text[i];
+            if (quoted && (c == '"' || c == '\\')) text[length++] = '\\';
+            text[length++] = c;
+        }
+    }
+    text[length++] = '"';
+    PPToken *result = copy_token(pp, hash);
+    result->text = text;
+    result->length = (uint32_t)length;
+    result->type = TOK_STRING;
+    result->symbol = SYMBOL_NONE;
+    result->literal = NULL;
+    return result;
+}
+
+static PPToken *expand_argument(Preprocessor *pp, Argument *argument) {
+    if (!argument->expanded_ready) {
+        Input in = { .pending = argument->raw };
+        TokenList list = { 0 };
+        const PPToken *token;
+        while ((token = next_expanded(pp, &in))) list_append(&list, copy_token(pp, token));
+        argument->expanded = list.head;
+        argument->expanded_ready = true;
+    }
+    return argument->expanded;
+}
+
+// Index just past the ')' matching the '(' at body[open], or end if unbalanced
+static size_t matching_paren(const PPToken *body, size_t open, size_t end) {
+    int depth = 0;
+    for (size_t i = open; i < end; i++) {
+        if (body[i].type == TOK_LPAREN) depth++;
+        else if (body[i].type == TOK_RPAREN && --depth == 0) return i;
+    }
+    return end;
+}
+
+// The replacement list body[begin, end) with parameters, #, ## and __VA_OPT__ applied
+static void substitute(Preprocessor *pp, const Macro *macro, Argument *args, size_t begin, size_t end, TokenList *out) {
+    const PPToken *body = macro->body;
+    bool placemarker = false; // An empty argument is the left operand of the next ##
+    for (size_t i = begin; i < end; i++) {
+        const PPToken *token = &body[i];
+
+        if (token->type == TOK_PP_HASH && i + 1 < end && param_index(macro, &body[i + 1]) >= 0) {
+            PPToken *string = stringize(pp, args[param_index(macro, &body[i + 1])].raw, token);
+            list_append(out, string);
+            placemarker = false;
+            i++;
+            continue;
+        }
+
+        if (token->type == TOK_PP_HASHHASH && i + 1 < end) {
+            const PPToken *rhs = &body[++i];
+            int param = param_index(macro, rhs);
+            bool lhs_present = out->tail && !placemarker;
+            placemarker = false;
+            if (param < 0) {
+                if (lhs_present) paste_tokens(pp, out->tail, rhs);
+                else list_append(out, copy_token(pp, rhs));
+                continue;
+            }
+            PPToken *raw = args[param].raw;
+            // GNU extension: ", ## __VA_ARGS__" drops the comma when there are no variadic arguments
+            if (macro->variadic && (size_t)param == macro->param_count - 1 && lhs_present && out->tail->type == TOK_COMMA) {
+                if (raw) {
+                    list_append_copies(pp, out, raw);
+                } else {
+                    PPToken *last = out->head;
+                    if (last == out->tail) {
+                        out->head = out->tail = NULL;
+                    } else {
+                        while (last->next != out->tail) last = last->next;
+                        last->next = NULL;
+                        out->tail = last;
+                    }
+                }
+                continue;
+            }
+            if (!raw) {
+                placemarker = !lhs_present;
+                continue;
+            }
+            if (lhs_present) {
+                paste_tokens(pp, out->tail, raw);
+                list_append_copies(pp, out, raw->next);
+            } else {
+                list_append_copies(pp, out, raw);
+            }
+            continue;
+        }
+
+        if (token->symbol == pp->names.va_opt && macro->variadic && i + 1 < end && body[i + 1].type == TOK_LPAREN) {
+            size_t close = matching_paren(body, i + 1, end);
+            if (args[macro->param_count - 1].raw) substitute(pp, macro, args, i + 2, close, out);
+            i = close;
+            continue;
+        }
+
+        int param = param_index(macro, token);
+        if (param >= 0) {
+            bool pasted = i + 1 < end && body[i + 1].type == TOK_PP_HASHHASH;
+            PPToken *tokens = pasted ? args[param].raw : expand_argument(pp, &args[param]);
+            PPToken *before = out->tail;
+            list_append_copies(pp, out, tokens);
+            PPToken *first = before ? before->next : out->head;
+            if (first) first->flags = (first->flags & ~PP_SPACE_BEFORE) | (token->flags & PP_SPACE_BEFORE);
+            placemarker = pasted && !tokens;
+            continue;
+        }
+
+        list_append(out, copy_token(pp, token));
+        placemarker = false;
+    }
+}
+
+// Reads the arguments of a function-like macro whose '(' has been consumed
+static bool collect_arguments(Preprocessor *pp, Input *in, const PPToken *name, const Macro *macro,
+                              Argument **arguments, const PPToken **rparen) {
+    size_t capacity = macro->param_count ? macro->param_count : 1;
+    Argument *args = arena_alloc(pp->arena, sizeof(Argument) * capacity);
+    size_t count = 0;
+    TokenList current = { 0 };
+    int depth = 0;
+    for (;;) {
+        const PPToken *token = input_next(in);
+        if (!token) {
+            pp_error(pp, name, "Unterminated argument list invoking macro \"%s\"", symbol_name(macro->name));
+            return false;
+        }
+        bool in_variadic = macro->variadic && count == macro->param_count - 1;
+        if (depth == 0 && (token->type == TOK_RPAREN || (token->type == TOK_COMMA && !in_variadic))) {
+            if (count == capacity) {
+                args = arena_realloc(pp->arena, args, sizeof(Argument) * capacity, sizeof(Argument) * capacity * 2);
+                capacity *= 2;
+            }
+            args[count++] = (Argument){ .raw = current.head };
+            current = (TokenList){ 0 };
+            if (token->type == TOK_RPAREN) {
+                *rparen = token;
+                break;
+            }
+            continue;
+        }
+        if (token->type == TOK_LPAREN) depth++;
+        else if (token->type == TOK_RPAREN) depth--;
+        list_append(&current, copy_token(pp, token));
+    }
+
+    // F() passes one empty argument, which is no argument at all for a macro without parameters
+    if (macro->param_count == 0 && count == 1 && !args[0].raw) count = 0;
+    // The variadic arguments may be left out entirely
+    if (macro->variadic && count == macro->param_count - 1) args[count++] = (Argument){ 0 };
+    if (count != macro->param_count) {
+        pp_error(pp, name, "Macro \"%s\" expects %zu arguments, but %zu were given",
+                 symbol_name(macro->name), macro->variadic ? macro->param_count - 1 : macro->param_count, count);
+        return false;
+    }
+    *arguments = args;
+    return true;
+}
+
+static PPToken *builtin_token(Preprocessor *pp, const PPToken *name, Builtin builtin) {
+    char buffer[PATH_MAX + 32];
+    int length;
+    if (builtin == BUILTIN_FILE) {
+        length = snprintf(buffer, sizeof(buffer), "\"%s\"", name->file ? name->file->path : "");
+    } else {
+        length = snprintf(buffer, sizeof(buffer), "%u", name->line);
+    }
+    char *text = arena_strndup(pp->arena, buffer, (size_t)length);
+    return make_token_from_text(pp, text, (size_t)length, name);
+}
+
+// Pushes the replacement of name onto the input; false for a function-like macro without '('
+static bool expand_macro(Preprocessor *pp, Input *in, const PPToken *name, const Macro *macro) {
+    TokenList list = { 0 };
+    if (macro->builtin != BUILTIN_NONE) {
+        PPToken *token = builtin_token(pp, name, macro->builtin);
+        if (token) list_append(&list, token);
+    } else if (!macro->function_like) {
+        const HideSet *hideset = hideset_add(pp, name->hideset, macro->name);
+        for (size_t i = 0; i < macro->body_count; i++) {
+            PPToken *token = copy_token(pp, &macro->body[i]);
+            token->hideset = hideset;
+            list_append(&list, token);
+        }
+    } else {
+        const PPToken *paren = input_peek(in);
+        if (!paren || paren->type != TOK_LPAREN) return false;
+        input_next(in);
+        Argument *args;
+        const PPToken *rparen;
+        if (!collect_arguments(pp, in, name, macro, &args, &rparen)) return true;
+        const HideSet *hideset = hideset_add(pp, hideset_intersection(pp, name->hideset, rparen->hideset), macro->name);
+        substitute(pp, macro, args, 0, macro->body_count, &list);
+        for (PPToken *token = list.head; token; token = token->next) {
+            token->hideset = hideset_union(pp, token->hideset, hideset);
+        }
+    }
+
+    // The expansion takes the invocation's place, for spacing and for __LINE__
+    for (PPToken *token = list.head; token; token = token->next) {
+        token->file = name->file;
+        token->line = name->line;
+        token->flags &= ~PP_LINE_START;
+    }
+    if (list.head) {
+        list.head->flags = (list.head->flags & ~(PP_LINE_START | PP_SPACE_BEFORE)) |
+                           (name->flags & (PP_LINE_START | PP_SPACE_BEFORE));
+        list.tail->next = in->pending;
+        in->pending = list.head;
+    }
+    return true;
+}
+
+// The next fully macro-replaced token; NULL at the end of the input or before a directive
+static const PPToken *next_expanded(Preprocessor *pp, Input *in) {
+    for (;;) {
+        const PPToken *token = input_next(in);
+        if (!token || !token->symbol) return token;
+        const Macro *macro = find_macro(pp, token->symbol);
+        if (!macro || hideset_contains(token->hideset, token->symbol)) return token;
+        if (!expand_macro(pp, in, token, macro)) return token;
+    }
+}
+
+/* ---- Output ---- */
+
+static void output_reserve(Preprocessor *pp, size_t extra) {
+    size_t needed = pp->text_length + extra + 1;
+    if (needed <= pp->text_capacity) return;
+    size_t capacity = pp->text_capacity ? pp->text_capacity : 4096;
+    while (capacity < needed) capacity *= 2;
+    pp->text = realloc(pp->text, capacity);
+    if (!pp->text) {
+        LOG_ERROR("Unable to allocate memory for preprocessor output");
+        exit(EXIT_FAILURE);
+    }
+    pp->text_capacity = capacity;
+}
+
+// Main-file tokens keep their line numbers, so parser diagnostics point at the right line
+static void emit(Preprocessor *pp, const PPToken *token) {
+    if (token->length > COMPACT_TOKEN_MAX_LENGTH) {
+        pp_error(pp, token, "Token too long");
+        return;
+    }
+    uint32_t newlines = 0;
+    if (token->file == pp->main_file && token->line > pp->out_line) {
+        newlines = token->line - pp->out_line;
+    } else if (pp->text_length > 0 && (token->flags & PP_LINE_START)) {
+        newlines = 1;
+    }
+    output_reserve(pp, newlines + 1 + token->length);
+    if (newlines) {
+        memset(pp->text + pp->text_length, '\n', newlines);
+        pp->text_length += newlines;
+        pp->out_line += newlines;
+    } else if (pp->text_length > 0) {
+        pp->text[pp->text_length++] = ' ';
+    }
+    if (pp->text_length + token->length > COMPACT_SOURCE_MAX_LENGTH) {
+        LOG_ERROR("Preprocessed output is too large for 32-bit token offsets");
+        exit(EXIT_FAILURE);
+    }
+    token_buffer_append(pp->out, (TokenType)token->type, pp->text_length, token->length, token->literal);
+    memcpy(pp->text + pp->text_length, token->text, token->length);
+    pp->text_length += token->length;
+}
+
+/* ---- #if expressions ---- */
+
+typedef struct {
+    uint64_t bits;
+    bool is_unsigned;
+} PPValue;
+
+typedef struct {
+    Preprocessor *pp;
+    const PPToken **tokens;
+    size_t count;
+    size_t position;
+    const PPToken *directive;
+    int unevaluated; // Inside the untaken side of &&, || or ?:, where division by zero is not an error
+    bool failed;
+} Expr;
+
+static PPValue eval_conditional(Expr *e);
+
+static const PPToken *expr_peek(const Expr *e) {
+    return e->position < e->count ? e->tokens[e->position] : NULL;
+}
+
+static void expr_fail(Expr *e, const char *message) {
+    if (!e->failed) {
+        const PPToken *at = expr_peek(e);
+        pp_error(e->pp, at ? at : e->directive, "%s in #if", message);
+    }
+    e->failed = true;
+}
+
+static PPValue signed_value(int64_t value) {
+    return (PPValue){ (uint64_t)value, false };
+}
+
+static uint64_t char_value(const PPToken *token) {
+    const char *p = token->text;
+    while (*p != '\'') p++;
+    p++;
+    if (*p != '\\') return (unsigned char)*p;
+    switch (p[1]) {
+        case 'n': return '\n';
+        case 't': return '\t';
+        case 'r': return '\r';
+        case '0': return 0;
+        case 'a': return '\a';
+        case 'b': return '\b';
+        case 'f': return '\f';
+        case 'v': return '\v';
+        default: return (unsigned char)p[1];
+    }
+}
+
+static PPValue eval_unary(Expr *e) {
+    const PPToken *token = expr_peek(e);
+    if (!token) {
+        expr_fail(e, "Expected an expression");
+        return signed_value(0);
+    }
+    e->position++;
+    switch (token->type) {
+        case TOK_PLUS: return eval_unary(e);
+        case TOK_MINUS: {
+            PPValue value = eval_unary(e);
+            value.bits = 0 - value.bits;
+            return value;
+        }
+        case TOK_TILDE: {
+            PPValue value = eval_unary(e);
+            value.bits = ~value.bits;
+            return value;
+        }
+        case TOK_BANG: return signed_value(eval_unary(e).bits == 0);
+        case TOK_LPAREN: {
+            PPValue value = eval_conditional(e);
+            const PPToken *close = expr_peek(e);
+            if (!close || close->type != TOK_RPAREN) expr_fail(e, "Expected ')'");
+            else e->position++;
+            return value;
+        }
+        case TOK_INTEGER: {
+            const Literal *literal = token->literal;
+            bool is_unsigned = (literal->flags & LITERAL_UNSIGNED) || literal->value.integer > INT64_MAX;
+            return (PPValue){ literal->value.integer, is_unsigned };
+        }
+        case TOK_CHAR: return signed_value((int64_t)char_value(token));
+        case TOK_KW_TRUE: return signed_value(1);
+        default:
+            // Identifiers left after macro replacement, false included, are 0
+            if (token->symbol) return signed_value(0);
+            e->position--;
+            expr_fail(e, "Unexpected token");
+            e->position = e->count;
+            return signed_value(0);
+    }
+}
+
+static int binary_precedence(TokenType type) {
+    switch (type) {
+        case TOK_PIPE_PIPE: return 1;
+        case TOK_AMP_AMP: return 2;
+        case TOK_PIPE: return 3;
+        case TOK_CARET: return 4;
+        case TOK_AMP: return 5;
+        case TOK_EQ_EQ: case TOK_BANG_EQ: return 6;
+        case TOK_LT: case TOK_GT: case TOK_LT_EQ: case TOK_GT_EQ: return 7;
+        case TOK_LSHIFT: case TOK_RSHIFT: return 8;
+        case TOK_PLUS: case TOK_MINUS: return 9;
+        case TOK_STAR: case TOK_SLASH: case TOK_PERCENT: return 10;
+        default: return 0;
+    }
+}
+
+static PPValue apply_binary(Expr *e, TokenType op, PPValue lhs, PPValue rhs) {
+    bool is_unsigned = lhs.is_unsigned || rhs.is_unsigned;
+    uint64_t a = lhs.bits, b = rhs.bits;
+    int64_t sa = (int64_t)a, sb = (int64_t)b;
+    switch (op) {
+        case TOK_PLUS: return (PPValue){ a + b, is_unsigned };
+        case TOK_MINUS: return (PPValue){ a - b, is_unsigned };
+        case TOK_STAR: return (PPValue){ a * b, is_unsigned };
+        case TOK_SLASH:
+        case TOK_PERCENT:
+            if (b == 0) {
+                if (!e->unevaluated) expr_fail(e, "Division by zero");
+                return (PPValue){ 0, is_unsigned };
+            }
+            if (is_unsigned) return (PPValue){ op == TOK_SLASH ? a / b : a % b, true };
+            if (sa == INT64_MIN && sb == -1) return signed_value(op == TOK_SLASH ? INT64_MIN : 0);
+            return signed_value(op == TOK_SLASH ? sa / sb : sa % sb);
+        case TOK_LSHIFT: return (PPValue){ b >= 64 ? 0 : a << b, lhs.is_unsigned };
+        case TOK_RSHIFT:
+            if (lhs.is_unsigned) return (PPValue){ b >= 64 ? 0 : a >> b, true };
+            return signed_value(b >= 64 ? (sa < 0 ? -1 : 0) : sa >> b);
+        case TOK_LT: return signed_value(is_unsigned ? a < b : sa < sb);
+        case TOK_GT: return signed_value(is_unsigned ? a > b : sa > sb);
+        case TOK_LT_EQ: return signed_value(is_unsigned ? a <= b : sa <= sb);
+        case TOK_GT_EQ: return signed_value(is_unsigned ? a >= b : sa >= sb);
+        case TOK_EQ_EQ: return signed_value(a == b);
+        case TOK_BANG_EQ: return signed_value(a != b);
+        case TOK_AMP: return (PPValue){ a & b, is_unsigned };
+        case TOK_CARET: return (PPValue){ a ^ b, is_unsigned };
+        case TOK_PIPE: return (PPValue){ a | b, is_unsigned };
+        default: return signed_value(0);
+    }
+}
+
+static PPValue eval_binary(Expr *e, int min_precedence) {
+    PPValue lhs = eval_unary(e);
+    for (;;) {
+        const PPToken *op = expr_peek(e);
+        int precedence = op ? binary_precedence((TokenType)op->type) : 0;
+        if (precedence == 0 || precedence < min_precedence) return lhs;
+        e->position++;
+        if (op->type == TOK_AMP_AMP || op->type == TOK_PIPE_PIPE) {
+            bool decided = op->type == TOK_AMP_AMP ? lhs.bits == 0 : lhs.bits != 0;
+            e->unevaluated += decided;
+            PPValue rhs = eval_binary(e, precedence + 1);
+            e->unevaluated -= decided;
+            lhs = signed_value(op->type == TOK_AMP_AMP ? (lhs.bits && rhs.bits) : (lhs.bits || rhs.bits));
+        } else {
+            PPValue rhs = eval_binary(e, precedence + 1);
+            lhs = apply_binary(e, (TokenType)op->type, lhs, rhs);
+        }
+    }
+}
+
+static PPValue eval_conditional(Expr *e) {
+    PPValue condition = eval_binary(e, 1);
+    const PPToken *question = expr_peek(e);
+    if (!question || question->type != TOK_QUESTION) return condition;
+    e->position++;
+    bool taken = condition.bits != 0;
+    e->unevaluated += !taken;
+    PPValue then_value = eval_conditional(e);
+    e->unevaluated -= !taken;
+    const PPToken *colon = expr_peek(e);
+    if (!colon || colon->type != TOK_COLON) {
+        expr_fail(e, "Expected ':'");
+        return signed_value(0);
+    }
+    e->position++;
+    e->unevaluated += taken;
+    PPValue else_value = eval_conditional(e);
+    e->unevaluated -= taken;
+    PPValue result = taken ? then_value : else_value;
+    result.is_unsigned = then_value.is_unsigned || else_value.is_unsigned;
+    return result;
+}
+
+static const PPToken *number_token(Preprocessor *pp, const PPToken *origin, bool value) {
+    return make_token_from_text(pp, arena_strndup(pp->arena, value ? "1" : "0", 1), 1, origin);
+}
+
+// Applies defined, macro-replaces the rest of the line, then evaluates it
+static bool evaluate_condition(Preprocessor *pp, const PPToken *directive, const PPToken *tokens, size_t count) {
+    TokenList list = { 0 };
+    for (size_t i = 0; i < count; i++) {
+        if (tokens[i].symbol != pp->names.defined) {
+            list_append(&list, copy_token(pp, &tokens[i]));
+            continue;
+        }
+        size_t name = i + 1;
+        bool parenthesised = name < count && tokens[name].type == TOK_LPAREN;
+        if (parenthesised) name++;
+        if (name >= count || !tokens[name].symbol || (parenthesised && (name + 1 >= count || tokens[name + 1].type != TOK_RPAREN))) {
+            pp_error(pp, &tokens[i], "Operator \"defined\" requires an identifier");
+            return false;
+        }
+        list_append(&list, copy_token(pp, number_token(pp, &tokens[i], find_macro(pp, tokens[name].symbol) != NULL)));
+        i = parenthesised ? name + 1 : name;
+    }
+
+    Input in = { .pending = list.head };
+    size_t capacity = count + 16, expanded_count = 0;
+    const PPToken **expanded = malloc(sizeof(PPToken *) * capacity);
+    if (!expanded) {
+        LOG_ERROR("Unable to allocate memory for #if expression");
+        exit(EXIT_FAILURE);
+    }
+    const PPToken *token;
+    while ((token = next_expanded(pp, &in))) {
+        if (expanded_count == capacity) {
+            capacity *= 2;
+            expanded = realloc(expanded, sizeof(PPToken *) * capacity);
+            if (!expanded) {
+                LOG_ERROR("Unable to allocate memory for #if expression");
+                exit(EXIT_FAILURE);
+            }
+        }
+        if (token->type == TOK_FLOAT) {
+            pp_error(pp, token, "Floating constant in #if");
+            free(expanded);
+            return false;
+        }
+        expanded[expanded_count++] = token;
+    }
+
+    Expr e = { .pp = pp, .tokens = expanded, .count = expanded_count, .directive = directive };
+    PPValue value = eval_conditional(&e);
+    if (!e.failed && e.position != e.count) expr_fail(&e, "Unexpected token");
+    free(expanded);
+    return !e.failed && value.bits != 0;
+}
+
+/* ---- Directives ---- */
+
+static Symbol directive_name(const PPFile *file, size_t hash) {
+    const PPToken *name = &file->tokens[hash + 1];
+    return name->flags & PP_LINE_START ? SYMBOL_NONE : name->symbol;
+}
+
+/*
+ * Skips a group whose condition is false, stopping at the #elif, #else or #endif
+ * that ends it. With to_endif, alternatives are skipped too, as after a taken branch.
+ */
+static void skip_group(Preprocessor *pp, Input *in, bool to_endif) {
+    const PPFile *file = in->file;
+    const Names *n = &pp->names;
+    int depth = 0;
+    size_t i = in->position;
+    for (; file->tokens[i].type != TOK_EOF; i++) {
+        if (!is_directive(&file->tokens[i])) continue;
+        Symbol name = directive_name(file, i);
+        if (name == n->if_ || name == n->ifdef || name == n->ifndef) {
+            depth++;
+        } else if (name == n->endif) {
+            if (depth == 0) break;
+            depth--;
+        } else if (depth == 0 && !to_endif &&
+                   (name == n->elif || name == n->else_ || name == n->elifdef || name == n->elifndef)) {
+            break;
+        }
+    }
+    in->position = i;
+}
+
+static Conditional *push_condition(Preprocessor *pp, bool taken) {
+    pp->conditions = grow_array(pp->conditions, &pp->condition_capacity, pp->condition_count + 1, sizeof(Conditional));
+    Conditional *condition = &pp->conditions[pp->condition_count++];
+    condition->taken = taken;
+    condition->seen_else = false;
+    return condition;
+}
+
+static void define_macro(Preprocessor *pp, const PPToken *directive, const PPToken *tokens, size_t count) {
+    if (count == 0 || !tokens[0].symbol) {
+        pp_error(pp, directive, "Macro name must be an identifier");
+        return;
+    }
+    Macro *macro = arena_alloc(pp->arena, sizeof(Macro));
+    macro->name = tokens[0].symbol;
+    size_t i = 1;
+
+    // A '(' directly after the name, with no space, starts a parameter list
+    if (i < count && tokens[i].type == TOK_LPAREN && !(tokens[i].flags & PP_SPACE_BEFORE)) {
+        macro->function_like = true;
+        size_t capacity = 4;
+        macro->params = arena_alloc(pp->arena, sizeof(Symbol) * capacity);
+        i++;
+        bool expect_name = true;
+        for (;;) {
+            if (i >= count) {
+                pp_error(pp, directive, "Unterminated parameter list for macro \"%s\"", symbol_name(macro->name));
+                return;
+            }
+            const PPToken *token = &tokens[i++];
+            if (token->type == TOK_RPAREN && (!expect_name || macro->param_count == 0)) break;
+            if (!expect_name && token->type == TOK_COMMA && !macro->variadic) {
+                expect_name = true;
+                continue;
+            }
+            if (!expect_name || macro->variadic || (!token->symbol && token->type != TOK_ELLIPSIS)) {
+                pp_error(pp, token, "Invalid parameter list for macro \"%s\"", symbol_name(macro->name));
+                return;
+            }
+            if (macro->param_count == capacity) {
+                macro->params = arena_realloc(pp->arena, macro->params, sizeof(Symbol) * capacity, sizeof(Symbol) * capacity * 2);
+                capacity *= 2;
+            }
+            if (token->type == TOK_ELLIPSIS) {
+                macro->variadic = true;
+                macro->params[macro->param_count++] = pp->names.va_args;
+            } else {
+                macro->params[macro->param_count++] = token->symbol;
+            }
+            expect_name = false;
+        }
+    }
+
+    macro->body = &tokens[i];
+    macro->body_count = count - i;
+    if (macro->body_count > 0 && (macro->body[0].type == TOK_PP_HASHHASH || macro->body[macro->body_count - 1].type == TOK_PP_HASHHASH)) {
+        pp_error(pp, directive, "'##' cannot appear at either end of a macro expansion");
+        return;
+    }
+    pp->macros = grow_array(pp->macros, &pp->macro_capacity, (size_t)macro->name + 1, sizeof(Macro *));
+    pp->macros[macro->name] = macro;
+}
+
+static const PPFile *resolve_include(Preprocessor *pp, const char *name, bool angled, const PPFile *from) {
+    char path[PATH_MAX];
+    if (name[0] == '/') return find_header(pp, name);
+    if (!angled && snprintf(path, sizeof(path), "%s%s", from->directory, name) < (int)sizeof(path)) {
+        const PPFile *file = find_header(pp, path);
+        if (file) return file;
+    }
+    for (size_t i = 0; i < pp->include_count; i++) {
+        if (snprintf(path, sizeof(path), "%s/%s", pp->include_paths[i], name) >= (int)sizeof(path)) continue;
+        const PPFile *file = find_header(pp, path);
+        if (file) return file;
+    }
+    return NULL;
+}
+
+static void include_file(Preprocessor *pp, const PPFile *from, const PPToken *directive, const PPToken *tokens, size_t count) {
+    // A line that is neither "name" nor <name> is macro-replaced first
+    const PPToken **line = malloc(sizeof(PPToken *) * (count + 1));
+    if (!line) {
+        LOG_ERROR("Unable to allocate memory for #include");
+        exit(EXIT_FAILURE);
+    }
+    size_t line_count = 0;
+    if (count > 0 && (tokens[0].type == TOK_STRING || tokens[0].type == TOK_LT)) {
+        for (size_t i = 0; i < count; i++) line[line_count++] = &tokens[i];
+    } else {
+        TokenList list = { 0 };
+        for (size_t i = 0; i < count; i++) list_append(&list, copy_token(pp, &tokens[i]));
+        Input in = { .pending = list.head };
+        const PPToken *token;
+        while ((token = next_expanded(pp, &in))) {
+            line = realloc(line, sizeof(PPToken *) * (line_count + 1));
+            if (!line) {
+                LOG_ERROR("Unable to allocate memory for #include");
+                exit(EXIT_FAILURE);
+            }
+            line[line_count++] = token;
+        }
+    }
+
+    char name[PATH_MAX];
+    size_t length = 0;
+    bool angled = false, valid = false;
+    if (line_count == 1 && line[0]->type == TOK_STRING && line[0]->length >= 2 && line[0]->length - 2 < sizeof(name)) {
+        length = line[0]->length - 2;
+        memcpy(name, line[0]->text + 1, length);
+        valid = length > 0;
+    } else if (line_count >= 3 && line[0]->type == TOK_LT && line[line_count - 1]->type == TOK_GT) {
+        angled = valid = true;
+        for (size_t i = 1; i + 1 < line_count && valid; i++) {
+            const PPToken *token = line[i];
+            bool space = i > 1 && (token->flags & PP_SPACE_BEFORE);
+            if (length + space + token->length >= sizeof(name)) valid = false;
+            else {
+                if (space) name[length++] = ' ';
+                memcpy(name + length, token->text, token->length);
+                length += token->length;
+            }
+        }
+    }
+    free(line);
+    if (!valid) {
+        pp_error(pp, directive, "#include expects \"FILENAME\" or <FILENAME>");
+        return;
+    }
+    name[length] = '\0';
+
+    const PPFile *file = resolve_include(pp, name, angled, from);
+    if (!file) {
+        pp_error(pp, directive, "Cannot find include file '%s'", name);
+        return;
+    }
+    Symbol path = intern_cstr(file->path);
+    if ((file->pragma_once && path < pp->included_capacity && pp->included_once[path]) ||
+        (file->guard != SYMBOL_NONE && find_macro(pp, file->guard))) {
+        pp->stats.guard_skips++;
+        return;
+    }
+    if (pp->include_depth >= MAX_INCLUDE_DEPTH) {
+        pp_error(pp, directive, "#include nested more than %d deep", MAX_INCLUDE_DEPTH);
+        return;
+    }
+    if (file->pragma_once) {
+        pp->included_once = grow_array(pp->included_once, &pp->included_capacity, (size_t)path + 1, sizeof(bool));
+        pp->included_once[path] = true;
+    }
+    pp->include_depth++;
+    process_file(pp, file);
+    pp->include_depth--;
+}
+
+static void handle_directive(Preprocessor *pp, Input *in) {
+    const PPFile *file = in->file;
+    const Names *n = &pp->names;
+    size_t hash = in->position;
+    size_t end = line_end(file, hash);
+    in->position = end;
+    if (end == hash + 1) return; // Null directive
+
+    const PPToken *directive = &file->tokens[hash + 1];
+    const PPToken *args = directive + 1;
+    size_t count = end - hash - 2;
+    Symbol name = directive->symbol;
+
+    if (name == n->define) {
+        define_macro(pp, directive, args, count);
+    } else if (name == n->undef) {
+        if (count == 0 || !args[0].symbol) pp_error(pp, directive, "Macro name must be an identifier");
+        else if (args[0].symbol < pp->macro_capacity) pp->macros[args[0].symbol] = NULL;
+    } else if (name == n->include) {
+        include_file(pp, file, directive, args, count);
+    } else if (name == n->if_ || name == n->ifdef || name == n->ifndef) {
+        bool taken;
+        if (name == n->if_) {
+            taken = evaluate_condition(pp, directive, args, count);
+        } else if (count == 0 || !args[0].symbol) {
+            pp_error(pp, directive, "Macro name must be an identifier");
+            taken = false;
+        } else {
+            taken = (find_macro(pp, args[0].symbol) != NULL) == (name == n->ifdef);
+        }
+        push_condition(pp, taken);
+        if (!taken) skip_group(pp, in, false);
+    } else if (name == n->elif || name == n->elifdef || name == n->elifndef || name == n->else_) {
+        if (pp->condition_count == 0) {
+            pp_error(pp, directive, "#%s without #if", symbol_name(name));
+            return;
+        }
+        Conditional *condition = &pp->conditions[pp->condition_count - 1];
+        if (condition->seen_else) {
+            pp_error(pp, directive, "#%s after #else", symbol_name(name));
+            skip_group(pp, in, true);
+            return;
+        }
+        if (name == n->else_) condition->seen_else = true;
+        if (condition->taken) {
+            skip_group(pp, in, true);
+            return;
+        }
+        bool taken;
+        if (name == n->else_) {
+            taken = true;
+        } else if (name == n->elif) {
+            taken = evaluate_condition(pp, directive, args, count);
+        } else if (count == 0 || !args[0].symbol) {
+            pp_error(pp, directive, "Macro name must be an identifier");
+            taken = false;
+        } else {
+            taken = (find_macro(pp, args[0].symbol) != NULL) == (name == n->elifdef);
+        }
+        condition->taken = taken;
+        if (!taken) skip_group(pp, in, false);
+    } else if (name == n->endif) {
+        if (pp->condition_count == 0) pp_error(pp, directive, "#endif without #if");
+        else pp->condition_count--;
+    } else if (name == n->error || name == n->warning) {
+        int length = count ? (int)(args[count - 1].text + args[count - 1].length - args[0].text) : 0;
+        const char *message = count ? args[0].text : "";
+        if (name == n->error) pp_error(pp, directive, "#error %.*s", length, message);
+        else pp_warning(pp, directive, "#warning %.*s", length, message);
+    } else if (name == n->pragma || name == n->line) {
+        // #pragma once was recorded when the file was read; other pragmas and #line are ignored
+    } else {
+        pp_error(pp, directive, "Invalid preprocessing directive #%.*s", (int)directive->length, directive->text);
+    }
+}
+
+static void record_dependency(Preprocessor *pp, const PPFile *file) {
+    Symbol path = intern_cstr(file->path);
+    if (path < pp->recorded_capacity && pp->recorded[path]) return;
+    pp->recorded = grow_array(pp->recorded, &pp->recorded_capacity, (size_t)path + 1, sizeof(bool));
+    pp->recorded[path] = true;
+    pp->dependencies = grow_array(pp->dependencies, &pp->dependency_capacity, pp->dependency_count + 1, sizeof(CacheDependency));
+    pp->dependencies[pp->dependency_count++] = (CacheDependency){ file->path, file->hash };
+}
+
+static void process_file(Preprocessor *pp, const PPFile *file) {
+    if (file->owns_source) record_dependency(pp, file);
+    Input in = { .file = file };
+    size_t conditions_at_entry = pp->condition_count;
+    for (;;) {
+        const PPToken *token = next_expanded(pp, &in);
+        if (token) {
+            emit(pp, token);
+            continue;
+        }
+        if (file->tokens[in.position].type == TOK_EOF) break;
+        handle_directive(pp, &in);
+    }
+    if (pp->condition_count > conditions_at_entry) {
+        pp_error(pp, &file->tokens[file->count - 1], "Unterminated conditional directive");
+        pp->condition_count = conditions_at_entry;
+    }
+}
+
+/* ---- Public interface ---- */
+
+static void adopt_file(Preprocessor *pp, PPFile *file) {
+    pp->owned = grow_array(pp->owned, &pp->owned_capacity, pp->owned_count + 1, sizeof(PPFile *));
+    pp->owned[pp->owned_count++] = file;
+}
+
+Preprocessor *preprocessor_create(void) {
+    Preprocessor *pp = calloc(1, sizeof(Preprocessor));
+    if (!pp) {
+        LOG_ERROR("Unable to allocate memory for preprocessor");
+        exit(EXIT_FAILURE);
+    }
+    pp->arena = arena_create();
+    Names *n = &pp->names;
+    n->define = intern_cstr("define");
+    n->undef = intern_cstr("undef");
+    n->include = intern_cstr("include");
+    n->if_ = intern_cstr("if");
+    n->ifdef = intern_cstr("ifdef");
+    n->ifndef = intern_cstr("ifndef");
+    n->elif = intern_cstr("elif");
+    n->elifdef = intern_cstr("elifdef");
+    n->elifndef = intern_cstr("elifndef");
+    n->else_ = intern_cstr("else");
+    n->endif = intern_cstr("endif");
+    n->error = intern_cstr("error");
+    n->warning = intern_cstr("warning");
+    n->pragma = intern_cstr("pragma");
+    n->line = intern_cstr("line");
+    n->once = intern_cstr("once");
+    n->defined = intern_cstr("defined");
+    n->va_args = intern_cstr("__VA_ARGS__");
+    n->va_opt = intern_cstr("__VA_OPT__");
+    n->file = intern_cstr("__FILE__");
+    n->line_macro = intern_cstr("__LINE__");
+
+    const Builtin builtins[] = { BUILTIN_FILE, BUILTIN_LINE };
+    const Symbol builtin_names[] = { n->file, n->line_macro };
+    for (size_t i = 0; i < 2; i++) {
+        Macro *macro = arena_alloc(pp->arena, sizeof(Macro));
+        macro->name = builtin_names[i];
+        macro->builtin = builtins[i];
+        pp->macros = grow_array(pp->macros, &pp->macro_capacity, (size_t)macro->name + 1, sizeof(Macro *));
+        pp->macros[macro->name] = macro;
+    }
+    preprocessor_define(pp, "__STDC__", "1");
+    preprocessor_define(pp, "__STDC_VERSION__", "202311L");
+    preprocessor_define(pp, "__STDC_HOSTED__", "1");
+    return pp;
+}
+
+void preprocessor_destroy(Preprocessor *pp) {
+    if (!pp) return;
+    for (size_t i = 0; i < pp->owned_count; i++) file_free(pp->owned[i]);
+    for (size_t i = 0; i < pp->include_count; i++) free(pp->include_paths[i]);
+    free(pp->owned);
+    free(pp->include_paths);
+    free(pp->macros);
+    free(pp->included_once);
+    free(pp->dependencies);
+    free(pp->recorded);
+    free(pp->conditions);
+    free(pp->text);
+    arena_destroy(pp->arena);
+    free(pp);
+}
+
+void preprocessor_add_include_path(Preprocessor *pp, const char *directory) {
+    pp->include_paths = grow_array(pp->include_paths, &pp->include_capacity, pp->include_count + 1, sizeof(char *));
+    pp->include_paths[pp->include_count] = strdup(directory);
+    if (!pp->include_paths[pp->include_count]) {
+        LOG_ERROR("Unable to allocate memory for include path");
+        exit(EXIT_FAILURE);
+    }
+    pp->include_count++;
+}
+
+void preprocessor_set_cache(Preprocessor *pp, BuildCache *cache) {
+    pp->cache = cache;
+}
+
+void preprocessor_define(Preprocessor *pp, const char *name, const char *value) {
+    if (!value) value = "1";
+    size_t length = strlen(name) + strlen(value) + 2;
+    char *definition = arena_alloc(pp->arena, length);
+    snprintf(definition, length, "%s %s", name, value);
+
+    PPFile *file = file_create("<command line>");
+    tokenize_file(file, definition);
+    adopt_file(pp, file);
+    define_macro(pp, NULL, file->tokens, file->count - 1);
+}
+
+static bool run(Preprocessor *pp, const PPFile *file, TokenBuffer *out) {
+    pp->main_file = file;
+    pp->out = out;
+    pp->text_length = 0;
+    pp->out_line = 1;
+    pp->condition_count = 0;
+    pp->had_error = false;
+    pp->dependency_count = 0;
+    if (pp->recorded) memset(pp->recorded, 0, pp->recorded_capacity * sizeof(bool));
+    process_file(pp, file);
+
+    output_reserve(pp, 0);
+    pp->text[pp->text_length] = '\0';
+    token_buffer_append(out, TOK_EOF, pp->text_length, 0, NULL);
+    out->source = pp->text;
+    LOG_INFO("Preprocessed %s into %zu tokens", file->path, out->count);
+    return !pp->had_error;
+}
+
+bool preprocess_file(Preprocessor *pp, const char *path, TokenBuffer *out) {
+    PPFile *file = load_file(pp, path, strcmp(path, "-") == 0 ? "<stdin>" : path);
+    if (!file) return false;
+    adopt_file(pp, file);
+    return run(pp, file, out);
+}
+
+bool preprocess_source(Preprocessor *pp, const char *source, const char *name, TokenBuffer *out) {
+    PPFile *file = file_create(name);
+    tokenize_file(file, source);
+    adopt_file(pp, file);
+    return run(pp, file, out);
+}
+
+const char *preprocessor_output(const Preprocessor *pp) {
+    return pp->text ? pp->text : "";
+}
+
+PreprocessorStats preprocessor_stats(const Preprocessor *pp) {
+    return pp->stats;
+}
+
+size_t preprocessor_dependencies(const Preprocessor *pp, const CacheDependency **dependencies) {
+    *dependencies = pp->dependencies;
+    return pp->dependency_count;
+}
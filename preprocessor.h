@@ -0,0 +1,55 @@
+/*
+ * File: preprocessor.h
+ * Description: Declares the token-level C preprocessor.
+ * Purpose: Expands macros, follows #include and evaluates conditionals directly on
+ *          lexer tokens, producing a TokenBuffer the parser reads as it is. Headers
+ *          are tokenized once per process, and a header protected by #pragma once
+ *          or an include guard is skipped on later includes without being rescanned.
+ */
+
+#ifndef PREPROCESSOR_H
+#define PREPROCESSOR_H
+
+#include "cache.h"
+#include "lexer.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct Preprocessor Preprocessor;
+
+typedef struct {
+    size_t files_loaded; // Headers read and tokenized by this preprocessor
+    size_t cache_hits;   // Includes served from the process-wide header cache
+    size_t guard_skips;  // Includes skipped because of #pragma once or an include guard
+    size_t cached_files; // Files whose tokens came from the build cache instead of the lexer
+} PreprocessorStats;
+
+Preprocessor *preprocessor_create(void);
+void preprocessor_destroy(Preprocessor *pp);
+
+// Searched in order for <...> includes, and after the includer's directory for "..."
+void preprocessor_add_include_path(Preprocessor *pp, const char *directory);
+// Tokenized files are read from and stored in cache; NULL (the default) turns that off
+void preprocessor_set_cache(Preprocessor *pp, BuildCache *cache);
+// As -D: name may carry a parameter list, "MAX(a,b)"; a NULL value defines it as 1
+void preprocessor_define(Preprocessor *pp, const char *name, const char *value);
+
+/*
+ * Preprocess a file ("-" is stdin) or NUL-terminated text owned by the caller into
+ * out, which must be initialised. Output spellings are owned by the preprocessor and
+ * stay valid until the next preprocess call or preprocessor_destroy. Returns false
+ * if any error was reported; out still holds everything that could be produced.
+ */
+bool preprocess_file(Preprocessor *pp, const char *path, TokenBuffer *out);
+bool preprocess_source(Preprocessor *pp, const char *source, const char *name, TokenBuffer *out);
+
+// The text behind out->source: one line per source line of the main file, as -E prints it
+const char *preprocessor_output(const Preprocessor *pp);
+PreprocessorStats preprocessor_stats(const Preprocessor *pp);
+// Every file the last preprocess call read, with the hash of its contents; valid until the next call
+size_t preprocessor_dependencies(const Preprocessor *pp, const CacheDependency **dependencies);
+
+// Drop every cached header. Must not race with preprocessing, and must run before intern_reset.
+void preprocessor_cache_reset(void);
+
+#endif // PREPROCESSOR_H
@@ -0,0 +1,323 @@
+/*
+ * File: scan.c
+ * Description: Implements the block scanners declared in scan.h.
+ * Purpose: Each implementation turns an aligned 32-byte block into one bit per
+ *          byte for the classes the lexer skips over; the loops that walk the
+ *          masks are shared. AVX2 or SSE2 is picked at runtime on x86-64, with
+ *          a SWAR fallback everywhere else.
+ */
+
+#include "scan.h"
+#include "debug.h"
+#include <stdatomic.h>
+#include <stdint.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#define SCAN_BLOCK 32
+
+/*
+ * The kernels read whole aligned blocks, so they see bytes before the start of the text
+ * and past its NUL. That cannot fault (see align_block), but AddressSanitizer would stop
+ * on it, so the functions that load blocks are left uninstrumented.
+ */
+#define BLOCK_READER __attribute__((no_sanitize_address))
+
+typedef struct {
+    const char *name;
+    void (*space)(const char *block, uint32_t *space, uint32_t *newline);
+    uint32_t (*ident)(const char *block);
+    void (*comment)(const char *block, uint32_t *star, uint32_t *slash, uint32_t *newline, uint32_t *nul);
+} ScanKernels;
+
+// --- SWAR: eight bytes per 64-bit word ---
+
+#define SWAR_ONES 0x0101010101010101ull
+#define SWAR_HIGHS 0x8080808080808080ull
+
+// Blocks are aligned, so every word is too; may_alias lets it overlay the char data
+typedef uint64_t __attribute__((may_alias)) SwarWord;
+
+BLOCK_READER static uint64_t swar_load(const char *p) {
+    uint64_t word = *(const SwarWord *)p;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+}
+
+// High bit of each byte equal to c
+static uint64_t swar_eq(uint64_t x, unsigned char c) {
+    uint64_t t = x ^ (SWAR_ONES * c);
+    return ~(((t & ~SWAR_HIGHS) + ~SWAR_HIGHS) | t) & SWAR_HIGHS;
+}
+
+// High bit of each byte in [lo, hi], for 1 <= lo <= hi <= 0x7f
+static uint64_t swar_range(uint64_t x, unsigned char lo, unsigned char hi) {
+    uint64_t low7 = x & ~SWAR_HIGHS;
+    uint64_t at_least_lo = low7 + SWAR_ONES * (0x80 - lo);
+    uint64_t above_hi = low7 + SWAR_ONES * (0x7f - hi);
+    return at_least_lo & ~above_hi & ~x & SWAR_HIGHS;
+}
+
+// Gather the high bit of byte i into bit i
+static uint32_t swar_bits(uint64_t highs) {
+    return (uint32_t)(((highs >> 7) * 0x0102040810204080ull) >> 56);
+}
+
+static void swar_space(const char *block, uint32_t *space, uint32_t *newline) {
+    *space = *newline = 0;
+    for (int w = 0; w < SCAN_BLOCK / 8; w++) {
+        uint64_t x = swar_load(block + 8 * w);
+        uint64_t nl = swar_eq(x, '\n');
+        *space |= swar_bits(swar_eq(x, ' ') | swar_range(x, '\t', '\r')) << (8 * w);
+        *newline |= swar_bits(nl) << (8 * w);
+    }
+}
+
+static uint32_t swar_ident(const char *block) {
+    uint32_t mask = 0;
+    for (int w = 0; w < SCAN_BLOCK / 8; w++) {
+        uint64_t x = swar_load(block + 8 * w);
+        uint64_t folded = x | (SWAR_ONES * 0x20); // Lower-case letters; keeps the high bit
+        uint64_t ident = swar_range(folded, 'a', 'z') | swar_range(x, '0', '9') | swar_eq(x, '_');
+        mask |= swar_bits(ident) << (8 * w);
+    }
+    return mask;
+}
+
+static void swar_comment(const char *block, uint32_t *star, uint32_t *slash, uint32_t *newline, uint32_t *nul) {
+    *star = *slash = *newline = *nul = 0;
+    for (int w = 0; w < SCAN_BLOCK / 8; w++) {
+        uint64_t x = swar_load(block + 8 * w);
+        *star |= swar_bits(swar_eq(x, '*')) << (8 * w);
+        *slash |= swar_bits(swar_eq(x, '/')) << (8 * w);
+        *newline |= swar_bits(swar_eq(x, '\n')) << (8 * w);
+        *nul |= swar_bits(swar_eq(x, 0)) << (8 * w);
+    }
+}
+
+static const ScanKernels swar_kernels = { "swar", swar_space, swar_ident, swar_comment };
+
+#if defined(__x86_64__)
+
+// --- SSE2: baseline on x86-64, two 16-byte halves per block ---
+
+static uint32_t sse2_mask(__m128i lo, __m128i hi) {
+    return (uint32_t)_mm_movemask_epi8(lo) | ((uint32_t)_mm_movemask_epi8(hi) << 16);
+}
+
+static __m128i sse2_space_bytes(__m128i b) {
+    // Signed compares: bytes >= 0x80 are negative and never match
+    __m128i control = _mm_and_si128(_mm_cmpgt_epi8(b, _mm_set1_epi8('\t' - 1)), _mm_cmplt_epi8(b, _mm_set1_epi8('\r' + 1)));
+    return _mm_or_si128(_mm_cmpeq_epi8(b, _mm_set1_epi8(' ')), control);
+}
+
+static __m128i sse2_ident_bytes(__m128i b) {
+    __m128i folded = _mm_or_si128(b, _mm_set1_epi8(0x20));
+    __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(folded, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(folded, _mm_set1_epi8('z' + 1)));
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(b, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(b, _mm_set1_epi8('9' + 1)));
+    return _mm_or_si128(_mm_or_si128(alpha, digit), _mm_cmpeq_epi8(b, _mm_set1_epi8('_')));
+}
+
+BLOCK_READER static void sse2_space(const char *block, uint32_t *space, uint32_t *newline) {
+    __m128i lo = _mm_load_si128((const __m128i *)block);
+    __m128i hi = _mm_load_si128((const __m128i *)(block + 16));
+    __m128i nl = _mm_set1_epi8('\n');
+    *space = sse2_mask(sse2_space_bytes(lo), sse2_space_bytes(hi));
+    *newline = sse2_mask(_mm_cmpeq_epi8(lo, nl), _mm_cmpeq_epi8(hi, nl));
+}
+
+BLOCK_READER static uint32_t sse2_ident(const char *block) {
+    __m128i lo = _mm_load_si128((const __m128i *)block);
+    __m128i hi = _mm_load_si128((const __m128i *)(block + 16));
+    return sse2_mask(sse2_ident_bytes(lo), sse2_ident_bytes(hi));
+}
+
+BLOCK_READER static void sse2_comment(const char *block, uint32_t *star, uint32_t *slash, uint32_t *newline, uint32_t *nul) {
+    __m128i lo = _mm_load_si128((const __m128i *)block);
+    __m128i hi = _mm_load_si128((const __m128i *)(block + 16));
+    __m128i c = _mm_set1_epi8('*');
+    *star = sse2_mask(_mm_cmpeq_epi8(lo, c), _mm_cmpeq_epi8(hi, c));
+    c = _mm_set1_epi8('/');
+    *slash = sse2_mask(_mm_cmpeq_epi8(lo, c), _mm_cmpeq_epi8(hi, c));
+    c = _mm_set1_epi8('\n');
+    *newline = sse2_mask(_mm_cmpeq_epi8(lo, c), _mm_cmpeq_epi8(hi, c));
+    c = _mm_setzero_si128();
+    *nul = sse2_mask(_mm_cmpeq_epi8(lo, c), _mm_cmpeq_epi8(hi, c));
+}
+
+static const ScanKernels sse2_kernels = { "sse2", sse2_space, sse2_ident, sse2_comment };
+
+// --- AVX2: one 32-byte register per block, compiled for AVX2 only here ---
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 BLOCK_READER static void avx2_space(const char *block, uint32_t *space, uint32_t *newline) {
+    __m256i b = _mm256_load_si256((const __m256i *)block);
+    __m256i control = _mm256_and_si256(_mm256_cmpgt_epi8(b, _mm256_set1_epi8('\t' - 1)),
+                                       _mm256_cmpgt_epi8(_mm256_set1_epi8('\r' + 1), b));
+    __m256i spaces = _mm256_or_si256(_mm256_cmpeq_epi8(b, _mm256_set1_epi8(' ')), control);
+    *space = (uint32_t)_mm256_movemask_epi8(spaces);
+    *newline = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(b, _mm256_set1_epi8('\n')));
+}
+
+AVX2 BLOCK_READER static uint32_t avx2_ident(const char *block) {
+    __m256i b = _mm256_load_si256((const __m256i *)block);
+    __m256i folded = _mm256_or_si256(b, _mm256_set1_epi8(0x20));
+    __m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(folded, _mm256_set1_epi8('a' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), folded));
+    __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(b, _mm256_set1_epi8('0' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), b));
+    __m256i ident = _mm256_or_si256(_mm256_or_si256(alpha, digit), _mm256_cmpeq_epi8(b, _mm256_set1_epi8('_')));
+    return (uint32_t)_mm256_movemask_epi8(ident);
+}
+
+AVX2 BLOCK_READER static void avx2_comment(const char *block, uint32_t *star, uint32_t *slash, uint32_t *newline, uint32_t *nul) {
+    __m256i b = _mm256_load_si256((const __m256i *)block);
+    *star = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(b, _mm256_set1_epi8('*')));
+    *slash = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(b, _mm256_set1_epi8('/')));
+    *newline = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(b, _mm256_set1_epi8('\n')));
+    *nul = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(b, _mm256_setzero_si256()));
+}
+
+static const ScanKernels avx2_kernels = { "avx2", avx2_space, avx2_ident, avx2_comment };
+
+#endif // __x86_64__
+
+static const ScanKernels *_Atomic active_kernels;
+
+bool scan_select(ScanImpl impl) {
+    const ScanKernels *chosen = NULL;
+    switch (impl) {
+        case SCAN_SWAR:
+            chosen = &swar_kernels;
+            break;
+#if defined(__x86_64__)
+        case SCAN_SSE2:
+            chosen = &sse2_kernels;
+            break;
+        case SCAN_AVX2:
+            if (__builtin_cpu_supports("avx2")) chosen = &avx2_kernels;
+            break;
+        case SCAN_AUTO:
+            chosen = __builtin_cpu_supports("avx2") ? &avx2_kernels : &sse2_kernels;
+            break;
+#else
+        case SCAN_AUTO:
+            chosen = &swar_kernels;
+            break;
+        default:
+            break;
+#endif
+    }
+    if (!chosen) return false;
+    atomic_store_explicit(&active_kernels, chosen, memory_order_relaxed);
+    LOG_INFO("Lexer scanning with %s", chosen->name);
+    return true;
+}
+
+static const ScanKernels *kernels(void) {
+    const ScanKernels *k = atomic_load_explicit(&active_kernels, memory_order_relaxed);
+    if (!k) {
+        scan_select(SCAN_AUTO);
+        k = atomic_load_explicit(&active_kernels, memory_order_relaxed);
+    }
+    return k;
+}
+
+const char *scan_impl_name(void) {
+    return kernels()->name;
+}
+
+// Aligned blocks never straddle a page, so reading past the NUL cannot fault
+static const char *align_block(const char *p, unsigned *skip) {
+    uintptr_t offset = (uintptr_t)p & (SCAN_BLOCK - 1);
+    *skip = (unsigned)offset;
+    return p - offset;
+}
+
+static void count_lines(ScanLines *lines, const char *block, uint32_t newlines) {
+    if (!lines || !newlines) return;
+    lines->newlines += (size_t)__builtin_popcount(newlines);
+    lines->line_start = block + (31 - __builtin_clz(newlines)) + 1;
+}
+
+static bool is_space_byte(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+const char *scan_whitespace(const char *p, ScanLines *lines) {
+    // Most gaps between tokens are a single space
+    if (!is_space_byte(p[0])) return p;
+    if (p[0] == ' ' && !is_space_byte(p[1])) return p + 1;
+
+    const ScanKernels *k = kernels();
+    unsigned skip;
+    const char *block = align_block(p, &skip);
+    for (;;) {
+        uint32_t space, newline;
+        k->space(block, &space, &newline);
+        uint32_t valid = ~0u << skip;
+        uint32_t stop = ~space & valid;
+        uint32_t run = stop ? ((stop & -stop) - 1) & valid : valid;
+        count_lines(lines, block, newline & run);
+        if (stop) return block + __builtin_ctz(stop);
+        block += SCAN_BLOCK;
+        skip = 0;
+    }
+}
+
+const char *scan_identifier(const char *p) {
+    const ScanKernels *k = kernels();
+    unsigned skip;
+    const char *block = align_block(p, &skip);
+    for (;;) {
+        uint32_t stop = ~k->ident(block) & (~0u << skip);
+        if (stop) return block + __builtin_ctz(stop);
+        block += SCAN_BLOCK;
+        skip = 0;
+    }
+}
+
+const char *scan_block_comment(const char *p, ScanLines *lines) {
+    const ScanKernels *k = kernels();
+    unsigned skip;
+    const char *block = align_block(p, &skip);
+    uint32_t carry = 0; // The previous block ended in '*'
+    for (;;) {
+        uint32_t star, slash, newline, nul;
+        k->comment(block, &star, &slash, &newline, &nul);
+        uint32_t valid = ~0u << skip;
+        star &= valid;
+        // Bit i set where block[i] is the '/' of "*/"
+        uint32_t close = slash & valid & ((star << 1) | carry);
+        uint32_t stop = close | (nul & valid);
+        if (stop) {
+            uint32_t first = stop & -stop;
+            count_lines(lines, block, newline & valid & (first - 1));
+            const char *at = block + __builtin_ctz(stop);
+            return (close & first) ? at + 1 : at;
+        }
+        count_lines(lines, block, newline & valid);
+        carry = star >> 31;
+        block += SCAN_BLOCK;
+        skip = 0;
+    }
+}
+
+const char *scan_line_end(const char *p) {
+    const ScanKernels *k = kernels();
+    unsigned skip;
+    const char *block = align_block(p, &skip);
+    for (;;) {
+        uint32_t star, slash, newline, nul;
+        k->comment(block, &star, &slash, &newline, &nul);
+        uint32_t stop = (newline | nul) & (~0u << skip);
+        if (stop) return block + __builtin_ctz(stop);
+        block += SCAN_BLOCK;
+        skip = 0;
+    }
+}
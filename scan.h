@@ -0,0 +1,47 @@
+/*
+ * File: scan.h
+ * Description: Declares the block-at-a-time character scanners used by the lexer.
+ * Purpose: Skips runs of whitespace, identifier characters and comment bodies
+ *          32 bytes at a time, counting the newlines crossed in bulk.
+ */
+
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef enum {
+    SCAN_AUTO,  // Best implementation the CPU supports
+    SCAN_SWAR,  // Portable 64-bit words
+    SCAN_SSE2,
+    SCAN_AVX2
+} ScanImpl;
+
+// Newlines crossed by a scan; line_start is the byte after the last one.
+// Scanners take NULL when the caller does not need them.
+typedef struct {
+    size_t newlines;
+    const char *line_start;
+} ScanLines;
+
+/*
+ * Every scanner reads whole aligned 32-byte blocks, which may extend past the
+ * terminating NUL but never into the next page. The source must therefore be a
+ * NUL-terminated string; the NUL always ends a scan.
+ */
+
+// First byte at or after p that is not isspace() in the C locale
+const char *scan_whitespace(const char *p, ScanLines *lines);
+// First byte at or after p that is not [A-Za-z0-9_]
+const char *scan_identifier(const char *p);
+// p is just past "/*": returns the byte after the closing "*/", or the NUL if unterminated
+const char *scan_block_comment(const char *p, ScanLines *lines);
+// First '\n' or NUL at or after p
+const char *scan_line_end(const char *p);
+
+// Force an implementation (tests and benchmarks); false if the CPU lacks it
+bool scan_select(ScanImpl impl);
+const char *scan_impl_name(void);
+
+#endif // SCAN_H
@@ -0,0 +1,113 @@
+/*
+ * File: source.c
+ * Description: Implements the source input layer declared in source.h.
+ * Purpose: A regular file is mapped over a reserved anonymous region one byte
+ *          longer than the file, so the byte after the text is always a zero
+ *          the file does not own. Pipes and stdin fall back to reading.
+ */
+
+#include "source.h"
+#include "debug.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static bool map_file(SourceFile *source, int fd, size_t length) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    // Room for the NUL: when the file fills its last page exactly, this adds a zero page
+    size_t reserved = (length + 1 + page - 1) / page * page;
+
+    char *region = mmap(NULL, reserved, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED) return false;
+    if (mmap(region, length, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(region, reserved);
+        return false;
+    }
+    madvise(region, length, MADV_SEQUENTIAL);
+
+    source->text = region;
+    source->length = length;
+    source->mapping = region;
+    source->mapping_length = reserved;
+    return true;
+}
+
+static bool read_stream(SourceFile *source, int fd) {
+    size_t capacity = 1 << 16, length = 0;
+    char *buffer = malloc(capacity);
+    if (!buffer) {
+        LOG_ERROR("Unable to allocate memory for source buffer");
+        return false;
+    }
+    for (;;) {
+        if (length + 1 == capacity) {
+            capacity *= 2;
+            char *grown = realloc(buffer, capacity);
+            if (!grown) {
+                LOG_ERROR("Unable to allocate memory for source buffer");
+                free(buffer);
+                return false;
+            }
+            buffer = grown;
+        }
+        ssize_t got = read(fd, buffer + length, capacity - 1 - length);
+        if (got == 0) break;
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("Error reading source: %s", strerror(errno));
+            free(buffer);
+            return false;
+        }
+        length += (size_t)got;
+    }
+    buffer[length] = '\0';
+
+    source->text = buffer;
+    source->length = length;
+    source->mapping = NULL;
+    source->mapping_length = 0;
+    return true;
+}
+
+bool source_open_fd(SourceFile *source, int fd) {
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        LOG_ERROR("Unable to stat source: %s", strerror(errno));
+        return false;
+    }
+    // Empty files cannot be mapped; the read path hands back an empty string
+    if (S_ISREG(info.st_mode) && info.st_size > 0) {
+        if (map_file(source, fd, (size_t)info.st_size)) return true;
+        LOG_INFO("mmap failed (%s), reading the source instead", strerror(errno));
+    }
+    return read_stream(source, fd);
+}
+
+bool source_open(SourceFile *source, const char *path) {
+    if (strcmp(path, "-") == 0) return source_open_fd(source, STDIN_FILENO);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        LOG_ERROR("Error opening source file %s: %s", path, strerror(errno));
+        return false;
+    }
+    bool opened = source_open_fd(source, fd);
+    close(fd); // A mapping stays valid after its descriptor is closed
+    return opened;
+}
+
+void source_close(SourceFile *source) {
+    if (source->mapping) {
+        munmap(source->mapping, source->mapping_length);
+    } else {
+        free((char *)source->text);
+    }
+    source->text = NULL;
+    source->length = 0;
+    source->mapping = NULL;
+    source->mapping_length = 0;
+}
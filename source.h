@@ -0,0 +1,26 @@
+/*
+ * File: source.h
+ * Description: Declares the source file input layer used by the driver.
+ * Purpose: Maps source files read-only, without copying them, and guarantees a
+ *          NUL after the last byte so the lexer can run straight off the mapping.
+ */
+
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct {
+    const char *text;       // Always NUL-terminated; tokens point into it
+    size_t length;          // Bytes of source, excluding the NUL
+    void *mapping;          // mmap'd region, or NULL when text was read into a buffer
+    size_t mapping_length;
+} SourceFile;
+
+// Regular files are mapped; anything else (pipes, terminals) is read. "-" is stdin.
+bool source_open(SourceFile *source, const char *path);
+bool source_open_fd(SourceFile *source, int fd);
+void source_close(SourceFile *source);
+
+#endif // SOURCE_H
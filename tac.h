@@ -2,10 +2,12 @@
 #define TAC_H
 
 #include "cfg.h"
+#include "intern.h"
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
-// TAC instruction types
+// TAC opcodes
 typedef enum {
     TAC_ASSIGN,      // x = y
     TAC_BINARY_OP,   // x = y op z
@@ -17,26 +19,100 @@ typedef enum {
     TAC_PHI,         // x = phi(y, z)
     TAC_CALL,        // Function call
     TAC_FN_ENTER,    // __enter = function_name
-    TAC_HALT         // halt instruction
-} TACType;
+    TAC_HALT,        // halt instruction
+    TAC_PARAM        // param = x (argument for the next call)
+} TACOpcode;
 
-// TAC instruction structure
+typedef enum {
+    OPERAND_NONE,
+    OPERAND_VAR,     // Variable or temporary, renamed by SSA
+    OPERAND_CONST,   // Integer constant
+    OPERAND_LABEL,   // Block label number
+    OPERAND_FUNC,    // Function name, never renamed
+    OPERAND_PHI_ARGS // Phi inputs, one slot per predecessor in the block's phi_args
+} OperandKind;
+
+typedef struct Operand {
+    OperandKind kind;
+    union {
+        Symbol var;       // OPERAND_VAR and OPERAND_FUNC
+        int64_t constant; // OPERAND_CONST, as wide as the AST's literals
+        int32_t label;    // OPERAND_LABEL
+        uint32_t phi_args; // OPERAND_PHI_ARGS: index of the first slot in block->phi_args
+    };
+} Operand;
+
+/*
+ * Fixed-size TAC instruction, stored by value in a per-block array.
+ * dst is the defined variable, the jump target (GOTO, IF_GOTO), or the label
+ * itself (LABEL). src1/src2 are the instruction's inputs.
+ */
 typedef struct TAC {
-    TACType type;
-    char *result;    // Result variable
-    char *arg1;      // First argument
-    char *arg2;      // Second argument (if applicable)
-    char *op;        // Operator (if applicable)
-    int *int_label;  // Integer label (for block labels, NULL if not used)
-    char *str_label; // String label (for function names, NULL if not used)
-    int int_value;   // Integer value (if applicable)
-    void *ptr_value; // Pointer value (if applicable)
-    struct TAC *next; // Pointer to the next TAC instruction
+    TACOpcode opcode;
+    int op;          // Operator token for BINARY_OP / UNARY_OP
+    Operand dst;
+    Operand src1;
+    Operand src2;
 } TAC;
 
+#define NO_OPERAND ((Operand){ .kind = OPERAND_NONE })
+
+static inline Operand var_operand(Symbol var) {
+    return (Operand){ .kind = OPERAND_VAR, .var = var };
+}
+
+static inline Operand const_operand(int64_t value) {
+    return (Operand){ .kind = OPERAND_CONST, .constant = value };
+}
+
+static inline Operand label_operand(int32_t label) {
+    return (Operand){ .kind = OPERAND_LABEL, .label = label };
+}
+
+static inline Operand func_operand(Symbol name) {
+    return (Operand){ .kind = OPERAND_FUNC, .var = name };
+}
+
+/* Iteration: TAC_FOREACH(block, t) visits every instruction of a block in order */
+#define TAC_FOREACH(block, t) \
+    for (TAC *t = (block)->tac; t < (block)->tac + (block)->tac_count; ++t)
+
+static inline TAC *tac_last(BasicBlock *block) {
+    return block->tac_count ? &block->tac[block->tac_count - 1] : NULL;
+}
+
+/*
+ * Phi inputs: slot i holds the value flowing in from block->preds[i], so the
+ * array returned here has block->pred_count entries.
+ */
+static inline Operand *tac_phi_args(BasicBlock *block, const TAC *phi) {
+    return &block->phi_args[phi->src1.phi_args];
+}
+
+/* Editing: returned pointers stay valid until the block's array is next modified */
+TAC *tac_append(BasicBlock *block, TAC ins);
+TAC *tac_insert(BasicBlock *block, size_t index, TAC ins);
+void tac_remove(BasicBlock *block, size_t index);
+
+/*
+ * Numbering state for TAC generation. Each function lowered with its own
+ * context can be converted on any thread; giving contexts disjoint label bases
+ * keeps labels unique across the module. Temporaries (t0, t1, ...) are
+ * function-local and restart at zero in every context.
+ */
+typedef struct TACContext {
+    int next_label; // Next block label to hand out
+    int next_temp;  // Suffix of the next compiler temporary
+} TACContext;
+
+void tac_context_init(TACContext *ctx, int label_base);
+
 // Function declarations
-void create_tac(CFG *cfg);
+void create_tac(CFG *cfg); // Shared default context: numbering continues across calls, not thread safe
+void create_tac_with(CFG *cfg, TACContext *ctx);
+void convert_to_ssa(CFG *cfg); // Reentrant: all renaming state is local to the call
 void print_tac(CFG *cfg, FILE *stream);
-void free_tac(TAC *tac);
+void print_tac_bb(BasicBlock *block, FILE *stream);
+void free_tac(BasicBlock *block);
 
-#endif // TAC_H
\ No newline at end of file
+#endif // TAC_H
@@ -0,0 +1,115 @@
+#include "arena.h"
+#include "lexer.h"
+#include "parser.h"
+#include "minunit.h"
+#include <stdint.h>
+#include <string.h>
+
+MU_TEST(test_arena_alloc_zeroed_and_aligned) {
+    Arena *arena = arena_create();
+    for (size_t i = 1; i < 64; i++) {
+        unsigned char *p = arena_alloc(arena, i);
+        mu_assert(((uintptr_t)p % sizeof(void *)) == 0, "Arena allocations should be pointer aligned");
+        for (size_t j = 0; j < i; j++) {
+            mu_assert(p[j] == 0, "Arena allocations should be zero filled");
+        }
+        memset(p, 0xAB, i);
+    }
+    arena_destroy(arena);
+}
+
+MU_TEST(test_arena_large_allocation) {
+    Arena *arena = arena_create();
+    size_t size = 1024 * 1024;
+    char *big = arena_alloc(arena, size);
+    big[0] = 'a';
+    big[size - 1] = 'z';
+    char *small = arena_alloc(arena, 16);
+    mu_assert(small != NULL, "Allocation after an oversized chunk should succeed");
+    mu_assert(big[0] == 'a' && big[size - 1] == 'z', "Oversized allocation should keep its contents");
+    arena_destroy(arena);
+}
+
+MU_TEST(test_arena_realloc_in_place) {
+    Arena *arena = arena_create();
+    int *values = arena_alloc(arena, sizeof(int) * 4);
+    for (int i = 0; i < 4; i++) values[i] = i;
+    int *grown = arena_realloc(arena, values, sizeof(int) * 4, sizeof(int) * 8);
+    mu_assert(grown == values, "Growing the latest allocation should extend it in place");
+    for (int i = 0; i < 4; i++) mu_assert_int_eq(i, grown[i]);
+    mu_assert_int_eq(0, grown[7]);
+
+    // Once something else is allocated, growth must copy
+    arena_alloc(arena, 8);
+    int *moved = arena_realloc(arena, grown, sizeof(int) * 8, sizeof(int) * 16);
+    mu_assert(moved != grown, "Growing an older allocation should copy it");
+    for (int i = 0; i < 4; i++) mu_assert_int_eq(i, moved[i]);
+    arena_destroy(arena);
+}
+
+MU_TEST(test_arena_reset_reuses_memory) {
+    Arena *arena = arena_create();
+    void *first = arena_alloc(arena, 32);
+    for (int i = 0; i < 100; i++) arena_alloc(arena, 4096);
+    arena_reset(arena);
+    mu_assert_int_eq(0, (int)arena->total_allocated);
+    void *again = arena_alloc(arena, 32);
+    mu_assert(first == again, "Reset should rewind to the start of the first chunk");
+    arena_destroy(arena);
+}
+
+MU_TEST(test_arena_adopt) {
+    Arena *arena = arena_create();
+    Arena *other = arena_create();
+    char *mine = arena_strndup(arena, "mine", 4);
+    char *theirs = arena_strndup(other, "theirs", 6);
+    for (int i = 0; i < 100; i++) arena_alloc(other, 4096);
+    size_t expected = arena->total_allocated + other->total_allocated;
+    arena_adopt(arena, other);
+    mu_assert_int_eq((int)expected, (int)arena->total_allocated);
+    mu_assert_string_eq("mine", mine);
+    mu_assert_string_eq("theirs", theirs);
+
+    // Allocation carries on after the adopted chunks, and reset still rewinds to the first
+    int *values = arena_alloc(arena, sizeof(int) * 4);
+    int *grown = arena_realloc(arena, values, sizeof(int) * 4, sizeof(int) * 8);
+    mu_assert(grown == values, "The adopted head should take new allocations");
+    arena_reset(arena);
+    mu_assert(arena_alloc(arena, 4) == (void *)mine, "Reset should rewind to the original first chunk");
+    arena_destroy(arena);
+}
+
+MU_TEST(test_arena_strndup) {
+    Arena *arena = arena_create();
+    char *copy = arena_strndup(arena, "hello world", 5);
+    mu_assert_string_eq("hello", copy);
+    arena_destroy(arena);
+}
+
+MU_TEST(test_arena_owns_program) {
+    const char *input = "int main() { int x = \"s\"; return foo(x, 1, 2, 3, 4, 5); }";
+    Lexer lexer;
+    lexer_init(&lexer, input);
+    ASTNode *ast = parse(&lexer);
+    mu_assert(ast != NULL, "Program should parse");
+    mu_assert(ast->data.program.arena != NULL, "Program node should own an arena");
+    mu_assert(ast->data.program.arena->total_allocated > 0, "AST nodes should come from the arena");
+    mu_assert(ast->data.program.stmts == ast->data.stmt_list.stmts, "Program and stmt_list views should alias");
+    free_ast(ast);
+}
+
+MU_TEST_SUITE(arena_suite) {
+    MU_RUN_TEST(test_arena_alloc_zeroed_and_aligned);
+    MU_RUN_TEST(test_arena_large_allocation);
+    MU_RUN_TEST(test_arena_realloc_in_place);
+    MU_RUN_TEST(test_arena_reset_reuses_memory);
+    MU_RUN_TEST(test_arena_adopt);
+    MU_RUN_TEST(test_arena_strndup);
+    MU_RUN_TEST(test_arena_owns_program);
+}
+
+int main() {
+    MU_RUN_SUITE(arena_suite);
+    MU_REPORT();
+    return MU_EXIT_CODE;
+}
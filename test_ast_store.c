@@ -0,0 +1,237 @@
+#include "ast_store.h"
+#include "lexer.h"
+#include "parser.h"
+#include "minunit.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+MU_TEST(test_ast_store_build) {
+    ASTStore store;
+    ast_store_init(&store);
+    Type *int_type = type_get(TYPE_INT);
+    Symbol x = intern_cstr("x");
+
+    // if (x + 1) return -x;
+    ASTId ref = ast_store_add_named(&store, NODE_VAR_REF, x, int_type, NULL, 0);
+    ASTId one = ast_store_add_literal(&store, 1, int_type);
+    ASTId sum = ast_store_add_operator(&store, NODE_BINARY_OP, TOK_PLUS, false, (ASTId[]){ ref, one }, 2);
+    ASTId negated = ast_store_add_operator(&store, NODE_UNARY_OP, TOK_MINUS, true,
+                                           (ASTId[]){ ast_store_add_named(&store, NODE_VAR_REF, x, int_type, NULL, 0) }, 1);
+    ASTId ret = ast_store_add(&store, NODE_RETURN, &negated, 1);
+    ASTId branch = ast_store_add(&store, NODE_IF_STMT, (ASTId[]){ sum, ret, AST_NONE }, 3);
+
+    mu_assert(ref != AST_NONE, "Real nodes never get the AST_NONE id");
+    mu_assert_int_eq(NODE_IF_STMT, ast_store_kind(&store, branch));
+    mu_assert_int_eq(3, (int)ast_store_child_count(&store, branch));
+    mu_assert_int_eq((int)sum, (int)ast_store_child(&store, branch, 0));
+    mu_assert_int_eq(AST_NONE, (int)ast_store_child(&store, branch, 2));
+    mu_assert_int_eq(TOK_PLUS, ast_store_op(&store, sum));
+    mu_assert(!ast_store_is_prefix(&store, sum), "Binary operators have no prefix form");
+    mu_assert_int_eq(TOK_MINUS, ast_store_op(&store, negated));
+    mu_assert(ast_store_is_prefix(&store, negated), "The prefix flag should survive packing");
+    mu_assert(ast_store_name(&store, ref) == x, "References keep their name");
+    mu_assert(ast_store_type(&store, ref) == int_type, "References keep their type");
+    mu_assert(ast_store_name(&store, sum) == SYMBOL_NONE, "Operators have no name");
+    mu_assert_int_eq(1, (int)ast_store_literal(&store, one).int_value);
+    mu_assert(ast_store_type(&store, one) == int_type, "Literals keep their type");
+    mu_assert_int_eq(0, (int)ast_store_child_count(&store, one));
+
+    // Children come before parents, so one forward scan is a bottom-up pass
+    for (ASTId id = 1; id < store.count; id++) {
+        for (size_t slot = 0; slot < ast_store_child_count(&store, id); slot++) {
+            mu_assert(ast_store_child(&store, id, slot) < id, "Children should have smaller ids than their parent");
+        }
+    }
+
+    ASTId limit = ast_store_add_var_decl(&store, x, int_type, true, (ASTId[]){ ast_store_add_literal(&store, 8, int_type) }, 1);
+    mu_assert(ast_store_is_constexpr(&store, limit), "The constexpr flag should survive packing");
+    mu_assert(ast_store_name(&store, limit) == x, "Declarations keep their name beside the flag");
+    mu_assert(ast_store_type(&store, limit) == int_type, "Declarations keep their type beside the flag");
+    ASTId plain = ast_store_add_named(&store, NODE_VAR_DECL, x, int_type, NULL, 0);
+    mu_assert(!ast_store_is_constexpr(&store, plain) && ast_store_name(&store, plain) == x, "Named declarations are not constexpr");
+    mu_assert(!ast_store_is_constexpr(&store, ref), "Only declarations can be constexpr");
+
+    Symbol temp = intern_cstr("t0");
+    ast_store_set_temp(&store, sum, temp);
+    mu_assert(ast_store_temp(&store, sum) == temp, "Temp names live beside the nodes");
+    mu_assert(ast_store_temp(&store, one) == SYMBOL_NONE, "Temps start unset");
+    ast_store_free(&store);
+}
+
+// Walks a pointer tree and its copy side by side on an explicit stack
+static bool same_tree(const ASTStore *store, ASTNode *root, ASTId root_id) {
+    typedef struct {
+        ASTNode *node;
+        ASTId id;
+    } Pair;
+    size_t capacity = 64;
+    Pair *stack = malloc(sizeof(Pair) * capacity);
+    size_t count = 0;
+    stack[count++] = (Pair){ root, root_id };
+    bool same = true;
+    while (same && count > 0) {
+        Pair pair = stack[--count];
+        ASTNode *node = pair.node;
+        ASTId id = pair.id;
+        if (!node || id == AST_NONE) {
+            same = !node && id == AST_NONE;
+            continue;
+        }
+        same = ast_store_kind(store, id) == node->type && ast_store_child_count(store, id) == ast_child_count(node) &&
+               ast_store_temp(store, id) == node->temp_var;
+        switch (node->type) {
+            case NODE_LITERAL:
+                same = same && ast_store_type(store, id) == node->data.literal.type;
+                if (node->data.literal.type->kind == TYPE_POINTER) {
+                    same = same && strcmp(ast_store_literal(store, id).ptr_value, node->data.literal.value.ptr_value) == 0;
+                } else {
+                    same = same && ast_store_literal(store, id).int_value == node->data.literal.value.int_value;
+                }
+                break;
+            case NODE_BINARY_OP:
+                same = same && ast_store_op(store, id) == node->data.binary_op.op;
+                break;
+            case NODE_UNARY_OP:
+                same = same && ast_store_op(store, id) == node->data.unary_op.op &&
+                       ast_store_is_prefix(store, id) == node->data.unary_op.is_prefix;
+                break;
+            case NODE_FUNCTION_DECL:
+                same = same && ast_store_name(store, id) == node->data.function_decl.name &&
+                       ast_store_type(store, id) == node->data.function_decl.return_type;
+                break;
+            case NODE_VAR_DECL:
+                same = same && ast_store_name(store, id) == node->data.var_decl.name &&
+                       ast_store_type(store, id) == node->data.var_decl.type &&
+                       ast_store_is_constexpr(store, id) == node->data.var_decl.is_constexpr;
+                break;
+            case NODE_VAR_REF:
+                same = same && ast_store_name(store, id) == node->data.var_ref.name &&
+                       ast_store_type(store, id) == node->data.var_ref.type;
+                break;
+            case NODE_ASSIGNMENT:
+                same = same && ast_store_name(store, id) == node->data.assignment.name;
+                break;
+            case NODE_FUNCTION_CALL:
+                same = same && ast_store_name(store, id) == node->data.function_call.name;
+                break;
+            default:
+                break;
+        }
+        for (size_t slot = 0; same && slot < ast_child_count(node); slot++) {
+            if (count == capacity) stack = realloc(stack, sizeof(Pair) * (capacity *= 2));
+            stack[count++] = (Pair){ ast_child(node, slot), ast_store_child(store, id, slot) };
+        }
+    }
+    free(stack);
+    return same;
+}
+
+static const char *const sample =
+    "int add(int a, int b) { return a + b; }\n"
+    "int main() {\n"
+    "    int x = 1;\n"
+    "    constexpr int limit = 10;\n"
+    "    char *s = \"hello\";\n"
+    "    int y;\n"
+    "    for (;;) { x++; if (x > limit) return 0; }\n"
+    "    for (int i = 0; i < 10; i = i + 1) { y = -x * (i << 2); }\n"
+    "    while (x != 0) { --x; }\n"
+    "    if (x) { y = 1; } else { y = x ? add(x, 2) : 3; }\n"
+    "    return add(x, y);\n"
+    "}\n";
+
+MU_TEST(test_ast_store_copies_tree) {
+    Lexer lexer;
+    lexer_init(&lexer, sample);
+    ASTNode *program = parse(&lexer);
+    mu_assert(program != NULL, "Sample should parse");
+    // Temps are set by TAC generation; fake one so it is carried over too
+    program->data.program.stmts[0]->data.function_decl.body->data.stmt_list.stmts[0]->temp_var = intern_cstr("t1");
+
+    ASTStore store;
+    ast_store_init(&store);
+    ASTId root = ast_store_add_tree(&store, program);
+    mu_assert_int_eq(NODE_PROGRAM, ast_store_kind(&store, root));
+    mu_assert_int_eq((int)store.count - 1, (int)root);
+    mu_assert(same_tree(&store, program, root), "The store should hold the same tree");
+    mu_assert_int_eq(AST_NONE, ast_store_add_tree(&store, NULL));
+
+    // The store owns its strings
+    free_ast(program);
+    bool found = false;
+    for (ASTId id = 1; id < store.count; id++) {
+        if (ast_store_kind(&store, id) == NODE_LITERAL && ast_store_type(&store, id)->kind == TYPE_POINTER) {
+            found = strcmp(ast_store_literal(&store, id).ptr_value, "\"hello\"") == 0; // Spelling as written
+        }
+    }
+    mu_assert(found, "String literals should outlive the pointer tree");
+    ast_store_free(&store);
+}
+
+MU_TEST(test_ast_store_lazy_bodies) {
+    Lexer lexer;
+    lexer_init(&lexer, sample);
+    TokenBuffer tokens;
+    token_buffer_init(&tokens);
+    token_buffer_fill(&tokens, &lexer);
+    ASTNode *program = parse_tokens_lazy(&tokens);
+    mu_assert(program != NULL, "Sample should parse lazily");
+    function_body(program->data.program.stmts[1]);
+
+    ASTStore store;
+    ast_store_init(&store);
+    ASTId root = ast_store_add_tree(&store, program);
+    ASTId add = ast_store_child(&store, root, 0);
+    ASTId main_function = ast_store_child(&store, root, 1);
+    mu_assert_int_eq(AST_NONE, (int)ast_store_child(&store, add, 1));
+    mu_assert_int_eq(NODE_STMT_LIST, ast_store_kind(&store, ast_store_child(&store, main_function, 1)));
+    ast_store_free(&store);
+    free_ast(program);
+    token_buffer_free(&tokens);
+}
+
+typedef struct {
+    size_t nodes;
+    size_t list_slots;
+} TreeSize;
+
+static void measure(ASTNode *node, size_t depth, void *context) {
+    (void)depth;
+    TreeSize *size = context;
+    size->nodes++;
+    if (node->type == NODE_PROGRAM || node->type == NODE_STMT_LIST || node->type == NODE_PARAM_LIST ||
+        node->type == NODE_FUNCTION_CALL) {
+        size->list_slots += ast_child_count(node);
+    }
+}
+
+MU_TEST(test_ast_store_memory) {
+    Lexer lexer;
+    lexer_init(&lexer, sample);
+    ASTNode *program = parse(&lexer);
+    ASTStore store;
+    ast_store_init(&store);
+    ast_store_add_tree(&store, program);
+
+    TreeSize size = { 0, 0 };
+    ast_walk(program, &(ASTVisitor){ NULL, measure, &size });
+    size_t tree_bytes = size.nodes * sizeof(ASTNode) + size.list_slots * sizeof(ASTNode *);
+    mu_assert_int_eq((int)size.nodes, (int)store.count - 1);
+    mu_assert(ast_store_bytes(&store) * 2 < tree_bytes, "The store should take less than half the memory of the tree");
+    ast_store_free(&store);
+    free_ast(program);
+}
+
+MU_TEST_SUITE(ast_store_suite) {
+    MU_RUN_TEST(test_ast_store_build);
+    MU_RUN_TEST(test_ast_store_copies_tree);
+    MU_RUN_TEST(test_ast_store_lazy_bodies);
+    MU_RUN_TEST(test_ast_store_memory);
+}
+
+int main() {
+    MU_RUN_SUITE(ast_store_suite);
+    MU_REPORT();
+    return MU_EXIT_CODE;
+}
@@ -0,0 +1,296 @@
+#include "cache.h"
+#include "preprocessor.h"
+#include "parser.h"
+#include "minunit.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CACHE_DIR "cache_test_dir/cache"
+
+static const char *unit_source =
+    "#include \"defs.h\"\n"
+    "#include \"defs.h\"\n"
+    "int add(int a, int b) { return a + b; }\n"
+    "int main() {\n"
+    "    int x = LIMIT;\n"
+    "    int values[4];\n"
+    "    for (int i = 0; i < 10; i++) { x = x - 1; }\n"
+    "    while (x > 0) --x;\n"
+    "    if (!x) { print(\"done\"); } else { x++; }\n"
+    "    return add(x, -2);\n"
+    "}\n";
+
+static void write_file(const char *path, const char *text) {
+    FILE *file = fopen(path, "w");
+    fputs(text, file);
+    fclose(file);
+}
+
+static void remove_directory(const char *path) {
+    DIR *dir = opendir(path);
+    if (!dir) return;
+    struct dirent *entry;
+    char child[1024];
+    while ((entry = readdir(dir))) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+        snprintf(child, sizeof child, "%s/%s", path, entry->d_name);
+        struct stat info;
+        if (stat(child, &info) == 0 && S_ISDIR(info.st_mode)) remove_directory(child);
+        else remove(child);
+    }
+    closedir(dir);
+    rmdir(path);
+}
+
+static void setup(void) {
+    remove_directory("cache_test_dir");
+    mkdir("cache_test_dir", 0755);
+    write_file("cache_test_dir/defs.h", "#ifndef DEFS_H\n#define DEFS_H\n#define LIMIT 42\n#endif\n");
+    write_file("cache_test_dir/main.c", unit_source);
+    preprocessor_cache_reset();
+}
+
+static void teardown(void) {
+    preprocessor_cache_reset();
+    remove_directory("cache_test_dir");
+}
+
+static bool ast_equal(const ASTNode *a, const ASTNode *b);
+
+static bool list_equal(ASTNode *const *a, size_t a_count, ASTNode *const *b, size_t b_count) {
+    if (a_count != b_count) return false;
+    for (size_t i = 0; i < a_count; i++) {
+        if (!ast_equal(a[i], b[i])) return false;
+    }
+    return true;
+}
+
+static bool ast_equal(const ASTNode *a, const ASTNode *b) {
+    if (!a || !b) return a == b;
+    if (a->type != b->type || a->temp_var != b->temp_var) return false;
+    switch (a->type) {
+        case NODE_PROGRAM:
+        case NODE_STMT_LIST:
+            return list_equal(a->data.stmt_list.stmts, a->data.stmt_list.count, b->data.stmt_list.stmts, b->data.stmt_list.count);
+        case NODE_PARAM_LIST:
+            return list_equal(a->data.param_list.params, a->data.param_list.count, b->data.param_list.params, b->data.param_list.count);
+        case NODE_FUNCTION_CALL:
+            return a->data.function_call.name == b->data.function_call.name &&
+                   list_equal(a->data.function_call.args, a->data.function_call.arg_count,
+                              b->data.function_call.args, b->data.function_call.arg_count);
+        case NODE_FUNCTION_DECL:
+            return a->data.function_decl.name == b->data.function_decl.name &&
+                   a->data.function_decl.return_type == b->data.function_decl.return_type &&
+                   ast_equal(a->data.function_decl.params, b->data.function_decl.params) &&
+                   ast_equal(a->data.function_decl.body, b->data.function_decl.body);
+        case NODE_VAR_DECL:
+            return a->data.var_decl.name == b->data.var_decl.name && a->data.var_decl.type == b->data.var_decl.type &&
+                   ast_equal(a->data.var_decl.init_value, b->data.var_decl.init_value);
+        case NODE_VAR_REF:
+            return a->data.var_ref.name == b->data.var_ref.name && a->data.var_ref.type == b->data.var_ref.type;
+        case NODE_ASSIGNMENT:
+            return a->data.assignment.name == b->data.assignment.name &&
+                   ast_equal(a->data.assignment.value, b->data.assignment.value);
+        case NODE_BINARY_OP:
+            return a->data.binary_op.op == b->data.binary_op.op &&
+                   ast_equal(a->data.binary_op.left, b->data.binary_op.left) &&
+                   ast_equal(a->data.binary_op.right, b->data.binary_op.right);
+        case NODE_UNARY_OP:
+            return a->data.unary_op.op == b->data.unary_op.op && a->data.unary_op.is_prefix == b->data.unary_op.is_prefix &&
+                   ast_equal(a->data.unary_op.operand, b->data.unary_op.operand);
+        case NODE_RETURN:
+            return ast_equal(a->data.return_stmt.value, b->data.return_stmt.value);
+        case NODE_LITERAL:
+            if (a->data.literal.type != b->data.literal.type) return false;
+            if (a->data.literal.type->kind == TYPE_POINTER) {
+                return strcmp(a->data.literal.value.ptr_value, b->data.literal.value.ptr_value) == 0;
+            }
+            return a->data.literal.value.int_value == b->data.literal.value.int_value;
+        case NODE_TYPE_SPECIFIER:
+            return a->data.type_spec.type == b->data.type_spec.type;
+        case NODE_IF_STMT:
+            return ast_equal(a->data.if_stmt.condition, b->data.if_stmt.condition) &&
+                   ast_equal(a->data.if_stmt.then_branch, b->data.if_stmt.then_branch) &&
+                   ast_equal(a->data.if_stmt.else_branch, b->data.if_stmt.else_branch);
+        case NODE_WHILE_STMT:
+            return ast_equal(a->data.while_stmt.condition, b->data.while_stmt.condition) &&
+                   ast_equal(a->data.while_stmt.body, b->data.while_stmt.body);
+        case NODE_FOR_STMT:
+            return ast_equal(a->data.for_stmt.init, b->data.for_stmt.init) &&
+                   ast_equal(a->data.for_stmt.condition, b->data.for_stmt.condition) &&
+                   ast_equal(a->data.for_stmt.update, b->data.for_stmt.update) &&
+                   ast_equal(a->data.for_stmt.body, b->data.for_stmt.body);
+        default:
+            return false;
+    }
+}
+
+// Preprocess and parse the test unit, storing it in the cache under key
+static ASTNode *build_unit(BuildCache *cache, uint64_t key, TokenBuffer *tokens) {
+    Preprocessor *pp = preprocessor_create();
+    preprocessor_set_cache(pp, cache);
+    token_buffer_init(tokens);
+    ASTNode *ast = NULL;
+    if (preprocess_file(pp, "cache_test_dir/main.c", tokens)) {
+        ast = parse_tokens(tokens);
+        const CacheDependency *dependencies;
+        size_t count = preprocessor_dependencies(pp, &dependencies);
+        if (ast) build_cache_store_unit(cache, key, dependencies, count, tokens, ast);
+    }
+    // The text behind tokens belongs to the preprocessor, so keep a copy
+    tokens->source = strdup(tokens->source);
+    preprocessor_destroy(pp);
+    return ast;
+}
+
+MU_TEST(test_cache_hash) {
+    // Reference values of XXH64 with seed 0
+    mu_assert(cache_hash("", 0, 0) == 0xEF46DB3751D8E999ull, "Hash of empty input");
+    mu_assert(cache_hash("abc", 3, 0) == 0x44BC2CF5AD770999ull, "Hash of short input");
+
+    const char *text = "The quick brown fox jumps over the lazy dog, several times over.";
+    uint64_t hash = cache_hash(text, strlen(text), 0);
+    mu_assert(hash == cache_hash(text, strlen(text), 0), "Hash should be deterministic");
+    mu_assert(hash != cache_hash(text, strlen(text), 1), "Seed should change the hash");
+    mu_assert(hash != cache_hash(text, strlen(text) - 1, 0), "Length should change the hash");
+}
+
+MU_TEST(test_cache_unit_round_trip) {
+    setup();
+    BuildCache *cache = build_cache_open(CACHE_DIR);
+    mu_assert(cache != NULL, "Cache directory should be created");
+
+    CachedUnit unit;
+    mu_assert(!build_cache_open_unit(cache, 1234, &unit), "Empty cache should miss");
+
+    TokenBuffer tokens;
+    ASTNode *parsed = build_unit(cache, 1234, &tokens);
+    mu_assert(parsed != NULL, "Unit should parse");
+
+    mu_assert(build_cache_open_unit(cache, 1234, &unit), "Stored unit should hit");
+    mu_assert_int_eq((int)tokens.count, (int)unit.tokens.count);
+    mu_assert(memcmp(tokens.tokens, unit.tokens.tokens, tokens.count * sizeof(CompactToken)) == 0, "Tokens should match");
+    mu_assert_int_eq((int)tokens.literal_count, (int)unit.tokens.literal_count);
+    mu_assert_string_eq(tokens.source, unit.tokens.source);
+
+    ASTNode *cached = cached_unit_ast(&unit);
+    cached_unit_close(&unit);
+    mu_assert(cached != NULL, "Cached AST should decode");
+    mu_assert(cached != parsed, "Cached AST should be a fresh tree");
+    mu_assert(ast_equal(parsed, cached), "Cached AST should match the parsed one");
+
+    // The decoded tree stands on its own once the entry is unmapped
+    ASTNode *main_function = cached->data.program.stmts[1];
+    mu_assert_string_eq("main", symbol_name(main_function->data.function_decl.name));
+
+    free_ast(cached);
+    free_ast(parsed);
+    free((char *)tokens.source);
+    token_buffer_free(&tokens);
+    build_cache_close(cache);
+    teardown();
+}
+
+MU_TEST(test_cache_unit_invalidated_by_header) {
+    setup();
+    BuildCache *cache = build_cache_open(CACHE_DIR);
+    TokenBuffer tokens;
+    ASTNode *parsed = build_unit(cache, 99, &tokens);
+    mu_assert(parsed != NULL, "Unit should parse");
+    free_ast(parsed);
+    free((char *)tokens.source);
+    token_buffer_free(&tokens);
+
+    CachedUnit unit;
+    mu_assert(build_cache_open_unit(cache, 99, &unit), "Unchanged unit should hit");
+    cached_unit_close(&unit);
+
+    // Only the header changes, so the key of the main file stays the same
+    write_file("cache_test_dir/defs.h", "#ifndef DEFS_H\n#define DEFS_H\n#define LIMIT 7\n#endif\n");
+    mu_assert(!build_cache_open_unit(cache, 99, &unit), "Changed header should make the unit stale");
+
+    remove("cache_test_dir/defs.h");
+    mu_assert(!build_cache_open_unit(cache, 99, &unit), "Missing header should make the unit stale");
+
+    build_cache_close(cache);
+    teardown();
+}
+
+MU_TEST(test_cache_damaged_entry_ignored) {
+    setup();
+    BuildCache *cache = build_cache_open(CACHE_DIR);
+    TokenBuffer tokens;
+    ASTNode *parsed = build_unit(cache, 7, &tokens);
+    free_ast(parsed);
+    free((char *)tokens.source);
+    token_buffer_free(&tokens);
+
+    // Cut the entry short
+    const char *path = CACHE_DIR "/unit-0000000000000007";
+    struct stat info;
+    mu_assert(stat(path, &info) == 0, "Unit entry should be named after its key");
+    mu_assert(truncate(path, info.st_size / 2) == 0, "Entry should be truncated");
+
+    CachedUnit unit;
+    mu_assert(!build_cache_open_unit(cache, 7, &unit), "Truncated entry should miss");
+    build_cache_close(cache);
+    teardown();
+}
+
+MU_TEST(test_cache_token_reuse) {
+    setup();
+    BuildCache *cache = build_cache_open(CACHE_DIR);
+
+    Preprocessor *pp = preprocessor_create();
+    preprocessor_set_cache(pp, cache);
+    TokenBuffer first;
+    token_buffer_init(&first);
+    mu_assert(preprocess_file(pp, "cache_test_dir/main.c", &first), "Should preprocess");
+    mu_assert_int_eq(0, (int)preprocessor_stats(pp).cached_files);
+    char *first_text = strdup(preprocessor_output(pp));
+    preprocessor_destroy(pp);
+
+    // A fresh process would find the headers only on disk
+    preprocessor_cache_reset();
+    pp = preprocessor_create();
+    preprocessor_set_cache(pp, cache);
+    TokenBuffer second;
+    token_buffer_init(&second);
+    mu_assert(preprocess_file(pp, "cache_test_dir/main.c", &second), "Should preprocess from cached tokens");
+    mu_assert_int_eq(2, (int)preprocessor_stats(pp).cached_files);
+    mu_assert_int_eq((int)first.count, (int)second.count);
+    mu_assert_int_eq((int)first.literal_count, (int)second.literal_count);
+    mu_assert_string_eq(first_text, preprocessor_output(pp));
+    // The guard was stored with the tokens, so the second include is still skipped
+    mu_assert_int_eq(1, (int)preprocessor_stats(pp).guard_skips);
+
+    const CacheDependency *dependencies;
+    mu_assert_int_eq(2, (int)preprocessor_dependencies(pp, &dependencies));
+    mu_assert_string_eq("cache_test_dir/main.c", dependencies[0].path);
+    mu_assert_string_eq("cache_test_dir/defs.h", dependencies[1].path);
+
+    preprocessor_destroy(pp);
+    free(first_text);
+    token_buffer_free(&first);
+    token_buffer_free(&second);
+    build_cache_close(cache);
+    teardown();
+}
+
+MU_TEST_SUITE(cache_suite) {
+    MU_RUN_TEST(test_cache_hash);
+    MU_RUN_TEST(test_cache_unit_round_trip);
+    MU_RUN_TEST(test_cache_unit_invalidated_by_header);
+    MU_RUN_TEST(test_cache_damaged_entry_ignored);
+    MU_RUN_TEST(test_cache_token_reuse);
+}
+
+int main() {
+    MU_RUN_SUITE(cache_suite);
+    MU_REPORT();
+    return MU_EXIT_CODE;
+}
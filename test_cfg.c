@@ -408,7 +408,7 @@ MU_TEST(test_cfg_multiple_functions) {
             if (stmt->type == NODE_VAR_DECL && stmt->data.var_decl.init_value) {
                 ASTNode *init_value = stmt->data.var_decl.init_value;
                 if (init_value->type == NODE_FUNCTION_CALL) {
-                    const char *func_name = init_value->data.function_call.name;
+                    const char *func_name = symbol_name(init_value->data.function_call.name);
                     if (strcmp(func_name, "func1") == 0) {
                         found_func1_call = true;
                     } else if (strcmp(func_name, "func2") == 0) {
@@ -427,6 +427,92 @@ MU_TEST(test_cfg_multiple_functions) {
     free_ast(ast);
 }
 
+MU_TEST(test_module_per_function_cfgs) {
+    const char *input = "int add(int a, int b) { return a + b; }\n"
+                        "int main() { int x = 1; if (x) { x = add(x, 2); } return x; }";
+    Lexer lexer;
+    lexer_init(&lexer, input);
+
+    ASTNode *ast = parse(&lexer);
+    mu_assert(ast != NULL, "AST should not be NULL");
+
+    Module *module = ast_to_module(ast);
+    mu_assert(module != NULL, "Module should not be NULL");
+    mu_assert_int_eq(2, (int)module->function_count);
+    mu_assert_string_eq("add", symbol_name(module->functions[0]->function_name));
+    mu_assert_string_eq("main", symbol_name(module->functions[1]->function_name));
+
+    size_t visited = 0;
+    MODULE_FOREACH(module, cfg) {
+        mu_assert(cfg->entry->type == BLOCK_ENTRY, "Each function should have its own entry block");
+        mu_assert(cfg->exit->type == BLOCK_EXIT, "Each function should have its own exit block");
+        mu_assert_int_eq(1, (int)cfg->entry->succ_count);
+        mu_assert(cfg->entry->succs[0]->function_name == cfg->function_name, "Entry should lead to the function body");
+        for (size_t i = 0; i < cfg->block_count; i++) {
+            mu_assert(cfg->blocks[i]->id == i, "Block ids should be local to the function");
+        }
+        visited++;
+    }
+    mu_assert_int_eq(2, (int)visited);
+
+    // The single-block function stays small no matter what else is in the file
+    mu_assert_int_eq(3, (int)module_find_function(module, intern_cstr("add"))->block_count);
+    mu_assert(module_find_function(module, intern_cstr("missing")) == NULL, "Unknown function should not be found");
+
+    module_for_each(module, compute_dominator_tree);
+    MODULE_FOREACH(module, cfg) {
+        mu_assert(cfg->exit->dominator != NULL, "Exit block should be reachable");
+        mu_assert(cfg->entry->dominator == cfg->entry, "Entry block should dominate itself");
+    }
+
+    free_module(module);
+    free_ast(ast);
+}
+
+// Only what main calls, directly or not, gets a CFG; other bodies stay unparsed
+MU_TEST(test_module_lazy_bodies) {
+    const char *input =
+        "int unused() { return 1 + ; }\n" // Never parsed, so the error goes unnoticed
+        "int leaf(int x) { return x; }\n"
+        "int helper(int x) { return leaf(x) + 1; }\n"
+        "int main() { return helper(2); }\n";
+    Lexer lexer;
+    lexer_init(&lexer, input);
+    TokenBuffer tokens;
+    token_buffer_init(&tokens);
+    token_buffer_fill(&tokens, &lexer);
+    ASTNode *ast = parse_tokens_lazy(&tokens);
+    mu_assert(ast != NULL, "Signatures should parse");
+
+    Module *module = ast_to_module(ast);
+    mu_assert(module != NULL, "Module should not be NULL");
+    mu_assert_int_eq(3, (int)module->function_count);
+    mu_assert_string_eq("leaf", symbol_name(module->functions[0]->function_name));
+    mu_assert_string_eq("helper", symbol_name(module->functions[1]->function_name));
+    mu_assert_string_eq("main", symbol_name(module->functions[2]->function_name));
+    ASTNode *unused = ast->data.program.stmts[0];
+    mu_assert(unused->data.function_decl.deferred != NULL, "An unreached body should not be parsed");
+    mu_assert(ast->data.program.stmts[1]->data.function_decl.deferred == NULL, "A reached body should be parsed");
+
+    free_module(module);
+    free_ast(ast);
+    token_buffer_free(&tokens);
+
+    // A reached body that does not parse fails the module
+    lexer_init(&lexer, "int broken() { return 1 + ; } int main() { return broken(); }");
+    token_buffer_init(&tokens);
+    token_buffer_fill(&tokens, &lexer);
+    ast = parse_tokens_lazy(&tokens);
+    mu_assert(ast != NULL, "Signatures should parse");
+    mu_assert(ast_to_module(ast) == NULL, "A broken reached body should fail the module");
+    free_ast(ast);
+    token_buffer_free(&tokens);
+}
+
+MU_TEST(test_module_invalid_root) {
+    mu_assert(ast_to_module(NULL) == NULL, "Module should not be built from a NULL AST");
+}
+
 MU_TEST_SUITE(cfg_suite) {
     MU_RUN_TEST(test_cfg_creation);
     MU_RUN_TEST(test_cfg_detailed_structure);
@@ -440,6 +526,9 @@ MU_TEST_SUITE(cfg_suite) {
     MU_RUN_TEST(test_cfg_printing);
     MU_RUN_TEST(test_cfg_printing_func_call);
     MU_RUN_TEST(test_cfg_multiple_functions);
+    MU_RUN_TEST(test_module_per_function_cfgs);
+    MU_RUN_TEST(test_module_invalid_root);
+    MU_RUN_TEST(test_module_lazy_bodies);
 }
 
 int main() {
@@ -0,0 +1,324 @@
+#include "const_eval.h"
+#include "parser.h"
+#include "lexer.h"
+#include "minunit.h"
+#include <stdio.h>
+#include <string.h>
+
+static ASTNode *parse_with(const char *source, ParseOptions options) {
+    Lexer lexer;
+    lexer_init(&lexer, source);
+    TokenBuffer tokens;
+    token_buffer_init(&tokens);
+    token_buffer_fill(&tokens, &lexer);
+    ASTNode *program = parse_tokens_with(&tokens, &options);
+    token_buffer_free(&tokens);
+    return program;
+}
+
+static ASTNode *parse_source(const char *source) {
+    return parse_with(source, (ParseOptions){ .threads = 1 });
+}
+
+static ASTNode *statement(ASTNode *program, size_t function, size_t index) {
+    return program->data.program.stmts[function]->data.function_decl.body->data.stmt_list.stmts[index];
+}
+
+static bool is_literal(const ASTNode *node, TypeKind kind, long long value) {
+    return node && node->type == NODE_LITERAL && node->data.literal.type->kind == kind &&
+           node->data.literal.value.int_value == value;
+}
+
+static bool is_int_literal(const ASTNode *node, long long value) {
+    return is_literal(node, TYPE_INT, value);
+}
+
+// sizeof is a size_t
+static bool is_size_literal(const ASTNode *node, long long value) {
+    return is_literal(node, TYPE_UNSIGNED_LONG, value);
+}
+
+MU_TEST(test_const_eval_constexpr_loads) {
+    ASTNode *program = parse_source(
+        "int main(int n) {\n"
+        "    constexpr int size = 4 * 8;\n"
+        "    constexpr int mask = size - 1;\n"
+        "    int x = n & mask;\n"
+        "    int *p = &size;\n"
+        "    return x + size;\n"
+        "}\n");
+    mu_assert(program != NULL, "constexpr objects should parse");
+
+    ASTNode *size = statement(program, 0, 0);
+    mu_assert(size->data.var_decl.is_constexpr, "The declaration keeps its constexpr flag");
+    mu_assert(is_int_literal(size->data.var_decl.init_value, 32), "The initializer is evaluated");
+    ASTNode *mask = statement(program, 0, 1);
+    mu_assert(is_int_literal(mask->data.var_decl.init_value, 31), "An initializer may use earlier constexpr objects");
+
+    ASTNode *x = statement(program, 0, 2)->data.var_decl.init_value;
+    mu_assert_int_eq(NODE_BINARY_OP, x->type);
+    mu_assert_int_eq(NODE_VAR_REF, x->data.binary_op.left->type);
+    mu_assert(is_int_literal(x->data.binary_op.right, 31), "Loads become literals");
+
+    ASTNode *address = statement(program, 0, 3)->data.var_decl.init_value;
+    mu_assert_int_eq(NODE_VAR_REF, address->data.unary_op.operand->type);
+
+    ASTNode *result = statement(program, 0, 4)->data.return_stmt.value;
+    mu_assert(is_int_literal(result->data.binary_op.right, 32), "Loads become literals");
+    free_ast(program);
+}
+
+MU_TEST(test_const_eval_shadowing) {
+    ASTNode *program = parse_source(
+        "int main() {\n"
+        "    constexpr int n = 3;\n"
+        "    for (int n = 0; n < 10; n++) { n = n + 1; }\n"
+        "    { int n = 5; n = 6; }\n"
+        "    return n;\n"
+        "}\n");
+    mu_assert(program != NULL, "Inner declarations may hide a constexpr object");
+    ASTNode *loop = statement(program, 0, 1);
+    mu_assert_int_eq(NODE_VAR_REF, loop->data.for_stmt.condition->data.binary_op.left->type);
+    ASTNode *block = statement(program, 0, 2);
+    mu_assert_int_eq(NODE_ASSIGNMENT, block->data.stmt_list.stmts[1]->type);
+    mu_assert(is_int_literal(statement(program, 0, 3)->data.return_stmt.value, 3), "The outer object is back in scope");
+    free_ast(program);
+}
+
+MU_TEST(test_const_eval_sizeof) {
+    static const struct {
+        const char *expression;
+        long long size;
+    } sizes[] = {
+        { "sizeof(int)", 4 },
+        { "sizeof(char)", 1 },
+        { "sizeof(char **)", 8 },
+        { "sizeof buffer", 16 },
+        { "sizeof(pointer)", 8 },
+        { "sizeof *pointer", 4 },
+        { "sizeof(x + 1)", 4 },
+        { "sizeof \"a\\n\"", 3 },
+        { "sizeof table / sizeof(int)", 6 },
+        { "sizeof(pointer + 1)", 8 },
+        { "sizeof array", 8 }, // Array parameters are pointers
+        { "sizeof(x = 7)", 4 },
+    };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        char source[256];
+        snprintf(source, sizeof(source),
+                 "int f(int array[4]) { char buffer[16]; int table[sizeof(int) + 2]; int *pointer; int x; return %s; }",
+                 sizes[i].expression);
+        ASTNode *program = parse_source(source);
+        mu_assert(program != NULL, sizes[i].expression);
+        mu_assert(is_size_literal(statement(program, 0, 4)->data.return_stmt.value, sizes[i].size), sizes[i].expression);
+        free_ast(program);
+    }
+
+    // The operand is not evaluated, so its side effects go with it
+    ASTNode *program = parse_source("int f() { int x; x = 1; return sizeof(x = 7) + x; }");
+    ASTNode *sum = statement(program, 0, 2)->data.return_stmt.value;
+    mu_assert(is_size_literal(sum->data.binary_op.left, 4), "sizeof of an assignment is the target's size");
+    mu_assert_int_eq(NODE_VAR_REF, sum->data.binary_op.right->type);
+    free_ast(program);
+
+    // Arithmetic with a size_t is unsigned, so it wraps rather than going negative
+    program = parse_source("int f() { int a; if (sizeof(int) - 5 < 0) { a = 1; } return 0; }");
+    mu_assert(program != NULL, "A comparison with sizeof should parse");
+    mu_assert(is_int_literal(statement(program, 0, 1)->data.if_stmt.condition, 0), "sizeof(int) - 5 is not negative");
+    free_ast(program);
+    program = parse_source("int f() { static_assert(sizeof(int) - 5 > 0, \"x\"); return 0; }");
+    mu_assert(program != NULL, "sizeof(int) - 5 is a large unsigned value");
+    free_ast(program);
+    program = parse_source("int f() { constexpr int n = sizeof(int) * 2; return n; }");
+    mu_assert(program != NULL, "A size that fits an int may initialize a constexpr int");
+    mu_assert(is_int_literal(statement(program, 0, 0)->data.var_decl.init_value, 8), "The initializer takes the object's type");
+    free_ast(program);
+
+    mu_assert(parse_source("int f() { return sizeof g(); }") == NULL, "A call's type is not known here");
+    mu_assert(parse_source("int f() { return sizeof(void); }") == NULL, "void has no size");
+}
+
+MU_TEST(test_const_eval_static_assert) {
+    ASTNode *program = parse_source(
+        "static_assert(sizeof(int) == 4, \"int is 32 bits\");\n"
+        "int main() {\n"
+        "    constexpr int limit = 100;\n"
+        "    _Static_assert(limit > 10 && limit % 10 == 0, \"limit is a multiple of ten\");\n"
+        "    static_assert(limit);\n"
+        "    return 0;\n"
+        "}\n"
+        "_Static_assert(0 || 1, \"after the functions\");\n");
+    mu_assert(program != NULL, "Assertions that hold should parse");
+    mu_assert_int_eq(1, (int)program->data.program.count);
+    ASTNode *checked = statement(program, 0, 1);
+    mu_assert_int_eq(NODE_STMT_LIST, checked->type);
+    mu_assert_int_eq(0, (int)checked->data.stmt_list.count);
+    free_ast(program);
+
+    mu_assert(parse_source("static_assert(sizeof(int) == 8, \"int is 64 bits\");\nint main() { return 0; }") == NULL,
+              "A false file-scope assertion fails the parse");
+    mu_assert(parse_source("int main() { constexpr int n = 2; static_assert(n > 2, \"n > 2\"); return n; }") == NULL,
+              "A false assertion in a body fails the parse");
+    mu_assert(parse_source("int main(int n) { static_assert(n, \"n\"); return n; }") == NULL,
+              "The condition must be a constant expression");
+    mu_assert(parse_source("int main() { static_assert(1, 2); return 0; }") == NULL, "The message must be a string");
+
+    // Unsigned and long constants are evaluated in their own types
+    mu_assert(parse_source("static_assert(-1 < 0u, \"-1 < 0u\");\nint main() { return 0; }") == NULL,
+              "-1 < 0u is false in C, as -1 converts to unsigned");
+    static const char *const held[] = {
+        "1u == 1",
+        "0xFFFFFFFFFFFFFFFF == -1",
+        "-1l < 0u",
+        "0xFFFFFFFF + 1 == 0",
+        "4294967295 + 1 == 4294967296",
+        "-1u > 0 && -1u == 4294967295",
+        "(1ull << 63) > 0",
+        "sizeof(1u) == 4 && sizeof(4294967297) == 8 && sizeof(1u + 1l) == 8",
+    };
+    for (size_t i = 0; i < sizeof(held) / sizeof(held[0]); i++) {
+        char source[128];
+        snprintf(source, sizeof(source), "int main() { static_assert(%s); return 0; }", held[i]);
+        program = parse_source(source);
+        mu_assert(program != NULL, held[i]);
+        free_ast(program);
+    }
+    program = parse_source("int main() { constexpr int n = 1l; constexpr char c = 2u; int a[n + 3ul]; return sizeof a; }");
+    mu_assert(program != NULL, "constexpr objects and array sizes may use suffixed constants");
+    mu_assert(is_int_literal(statement(program, 0, 0)->data.var_decl.init_value, 1), "1l becomes an int initializer");
+    mu_assert(is_size_literal(statement(program, 0, 3)->data.return_stmt.value, 16), "The size is worked out in unsigned long");
+    free_ast(program);
+}
+
+MU_TEST(test_const_eval_rejects) {
+    static const char *const rejected[] = {
+        "int main() { constexpr int n = 1; n = 2; return n; }",
+        "int main() { constexpr int n = 1; n++; return n; }",
+        "int main() { constexpr int n = 1; n += 2; return n; }",
+        "int main(int m) { constexpr int n = m; return n; }",
+        "int main() { constexpr int n = g(); return n; }",
+        "int main() { constexpr int n = 1 / 0; return n; }",
+        "int main() { constexpr int n = 2147483647 + 1; return n; }",
+        "int main() { constexpr char c = 200; return c; }",
+        "int main() { constexpr int n = sizeof(int) - 5; return n; }",
+        "int main() { constexpr int n = 4294967296; return n; }",
+        "int main() { constexpr int n = -1u; return n; }",
+        "int main() { constexpr char c = 255u; return c; }",
+        "int main() { constexpr int n = 1u / 0; return n; }",
+        "int main() { constexpr int n = 9223372036854775807 + 1; return n; }",
+        "int main() { constexpr int *p = 0; return 0; }",
+        "int main() { constexpr int n; return n; }",
+    };
+    for (size_t i = 0; i < sizeof(rejected) / sizeof(rejected[0]); i++) {
+        mu_assert(parse_source(rejected[i]) == NULL, rejected[i]);
+    }
+    ASTNode *program = parse_source("int main() { constexpr char c = -128; return c; }");
+    mu_assert(program != NULL, "-128 fits a char");
+    free_ast(program);
+}
+
+MU_TEST(test_const_eval_integer) {
+    static const struct {
+        const char *expression;
+        bool constant;
+        long long value;
+    } cases[] = {
+        { "1 << 4", true, 16 },
+        { "(3 > 2) ? -5 : x", true, -5 },
+        { "0 && g()", true, 0 },
+        { "1 || x", true, 1 },
+        { "~0 + !7", true, -1 },
+        { "1u - 2", true, 4294967295 },
+        { "10 / 3ul", true, 3 },
+        { "-7 % 3l", true, -1 },
+        { "x + 1", false, 0 },
+        { "1 / 0", false, 0 },
+        { "2, 3", false, 0 },
+        { "g()", false, 0 },
+        { "\"text\"", false, 0 },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        char source[128];
+        snprintf(source, sizeof(source), "int f(int x) { return %s; }", cases[i].expression);
+        ASTNode *program = parse_source(source);
+        mu_assert(program != NULL, cases[i].expression);
+        long long value = 0;
+        bool constant = const_eval_integer(statement(program, 0, 0)->data.return_stmt.value, &value);
+        mu_assert(constant == cases[i].constant, cases[i].expression);
+        mu_assert(value == cases[i].value, cases[i].expression);
+        free_ast(program);
+    }
+
+    ASTNode *program = parse_source("int f() { int a[2 * 3 + 1]; return 0; }");
+    mu_assert(program != NULL, "An array size may be any integer constant expression");
+    mu_assert_int_eq(7, (int)statement(program, 0, 0)->data.var_decl.type->array_size);
+    free_ast(program);
+
+    program = parse_source("int f() { constexpr int n = 4; int table[n * 2]; return sizeof table; }");
+    mu_assert(program != NULL, "An array size may name constexpr objects");
+    ASTNode *table = statement(program, 0, 1);
+    mu_assert_int_eq(8, (int)table->data.var_decl.type->array_size);
+    mu_assert(table->data.var_decl.array_size == NULL, "The size is settled once evaluated");
+    mu_assert(is_size_literal(statement(program, 0, 2)->data.return_stmt.value, 32), "sizeof sees the evaluated size");
+    free_ast(program);
+    mu_assert(parse_source("int f(int n) { int a[n]; return 0; }") == NULL, "Variable-length arrays are not supported");
+    mu_assert(parse_source("int f() { constexpr int n = -1; int a[n]; return 0; }") == NULL,
+              "Array sizes must be positive");
+}
+
+static const char *const functions =
+    "int one() { constexpr int k = 7; return k; }\n"
+    "int two() { return sizeof(int); }\n"
+    "int three() { static_assert(sizeof(char) == 1, \"char\"); return 3; }\n"
+    "int four() { constexpr int k = 4; return k * k; }\n";
+
+MU_TEST(test_const_eval_lazy_and_parallel) {
+    // Deferred bodies are parsed from the token buffer, so it has to outlive the program
+    Lexer lexer;
+    lexer_init(&lexer, functions);
+    TokenBuffer tokens;
+    token_buffer_init(&tokens);
+    token_buffer_fill(&tokens, &lexer);
+    ASTNode *lazy = parse_tokens_lazy(&tokens);
+    mu_assert(lazy != NULL, "Signatures should parse lazily");
+    mu_assert(function_body(lazy->data.program.stmts[3]) != NULL, "Deferred bodies are evaluated as they are parsed");
+    mu_assert(is_int_literal(statement(lazy, 3, 1)->data.return_stmt.value, 16), "A square of a constexpr object is folded");
+    free_ast(lazy);
+    token_buffer_free(&tokens);
+
+    lexer_init(&lexer, "int f() { return 1; }\nint g() { static_assert(0, \"never\"); return 0; }");
+    token_buffer_init(&tokens);
+    token_buffer_fill(&tokens, &lexer);
+    ASTNode *failing = parse_tokens_lazy(&tokens);
+    mu_assert(failing != NULL, "A lazy parse only checks signatures");
+    mu_assert(function_body(failing->data.program.stmts[1]) == NULL, "A failing assertion fails its body");
+    mu_assert(failing->data.program.stmts[1]->data.function_decl.body == NULL, "The body is left unset");
+    free_ast(failing);
+    token_buffer_free(&tokens);
+
+    ASTNode *parallel = parse_with(functions, (ParseOptions){ .threads = 2 });
+    mu_assert(parallel != NULL, "Functions should parse on threads");
+    mu_assert(is_int_literal(statement(parallel, 0, 1)->data.return_stmt.value, 7), "Workers evaluate too");
+    mu_assert(is_size_literal(statement(parallel, 1, 0)->data.return_stmt.value, 4), "Workers evaluate too");
+    free_ast(parallel);
+
+    mu_assert(parse_with("int f() { return 1; }\nint g() { static_assert(0, \"never\"); return 0; }",
+                         (ParseOptions){ .threads = 2 }) == NULL,
+              "A failing assertion fails a parallel parse");
+}
+
+MU_TEST_SUITE(const_eval_suite) {
+    MU_RUN_TEST(test_const_eval_constexpr_loads);
+    MU_RUN_TEST(test_const_eval_shadowing);
+    MU_RUN_TEST(test_const_eval_sizeof);
+    MU_RUN_TEST(test_const_eval_static_assert);
+    MU_RUN_TEST(test_const_eval_rejects);
+    MU_RUN_TEST(test_const_eval_integer);
+    MU_RUN_TEST(test_const_eval_lazy_and_parallel);
+}
+
+int main() {
+    MU_RUN_SUITE(const_eval_suite);
+    MU_REPORT();
+    return MU_EXIT_CODE;
+}
@@ -1,4 +1,5 @@
 #include "cfg.h"
+#include "liveness.h"
 #include "lexer.h"
 #include "parser.h"
 #include "minunit.h"
@@ -157,7 +158,7 @@ MU_TEST(test_phi_function_insertion) {
             ASTNode *stmt = block->stmts[j];
             if (stmt->type == NODE_VAR_DECL && stmt->data.var_decl.init_value == NULL) {
                 mu_assert(j == 0, "Phi functions should be the first statements in the block");
-                mu_assert(stmt->data.var_decl.name != NULL, "Phi function variable name should not be NULL");
+                mu_assert(stmt->data.var_decl.name != SYMBOL_NONE, "Phi function variable name should not be NULL");
             }
         }
     }
@@ -166,11 +167,256 @@ MU_TEST(test_phi_function_insertion) {
     free_ast(ast);
 }
 
+/*
+ * Irreducible graph from Cooper, Harvey and Kennedy's paper:
+ *   6 -> 5, 6 -> 4;  5 -> 1;  4 -> 2, 4 -> 3;  1 -> 2;  2 -> 1, 2 -> 3;  3 -> 2
+ * Every block is immediately dominated by 6. Block 7 is unreachable.
+ */
+static CFG *build_irreducible_cfg(BasicBlock **b) {
+    CFG *cfg = create_cfg();
+    for (int i = 0; i < 8; i++) {
+        b[i] = cfg_add_block(cfg, BLOCK_NORMAL);
+    }
+    cfg->entry = b[6];
+    cfg_add_edge(b[6], b[5]);
+    cfg_add_edge(b[6], b[4]);
+    cfg_add_edge(b[5], b[1]);
+    cfg_add_edge(b[4], b[2]);
+    cfg_add_edge(b[4], b[3]);
+    cfg_add_edge(b[1], b[2]);
+    cfg_add_edge(b[2], b[1]);
+    cfg_add_edge(b[2], b[3]);
+    cfg_add_edge(b[3], b[2]);
+    cfg_add_edge(b[7], b[2]);
+    return cfg;
+}
+
+MU_TEST(test_rpo_numbering) {
+    BasicBlock *b[8];
+    CFG *cfg = build_irreducible_cfg(b);
+    compute_rpo(cfg);
+
+    mu_assert_int_eq(6, (int)cfg->rpo_count);
+    mu_assert(cfg->rpo[0] == cfg->entry, "Entry block should be first in reverse postorder");
+    mu_assert(b[7]->rpo_index == SIZE_MAX, "Unreachable block should not be numbered");
+    mu_assert(b[0]->rpo_index == SIZE_MAX, "Unreachable block should not be numbered");
+    for (size_t i = 0; i < cfg->rpo_count; i++) {
+        mu_assert(cfg->rpo[i]->rpo_index == i, "rpo_index should match position in cfg->rpo");
+    }
+    // Forward edges go to higher RPO numbers unless they close a cycle
+    mu_assert(b[5]->rpo_index < b[1]->rpo_index, "5 should precede 1");
+    mu_assert(b[4]->rpo_index < b[3]->rpo_index, "4 should precede 3");
+
+    free_cfg(cfg);
+}
+
+MU_TEST(test_dominators_irreducible) {
+    DominatorAlgorithm algorithms[] = { DOM_ITERATIVE, DOM_SEMI_NCA };
+    for (size_t a = 0; a < 2; a++) {
+        BasicBlock *b[8];
+        CFG *cfg = build_irreducible_cfg(b);
+        compute_dominator_tree_with(cfg, algorithms[a]);
+
+        mu_assert(b[6]->dominator == b[6], "Entry block should dominate itself");
+        for (int i = 1; i <= 5; i++) {
+            mu_assert(b[i]->dominator == b[6], "Every reachable block should be dominated by the entry");
+        }
+        mu_assert(b[0]->dominator == NULL, "Unreachable block should have no dominator");
+        mu_assert(b[7]->dominator == NULL, "Unreachable block should have no dominator");
+        mu_assert_int_eq(6, (int)b[6]->dominated_count); // Itself plus blocks 1-5
+
+        // Recomputing must rebuild, not append to, the dominated arrays
+        compute_dominator_tree_with(cfg, algorithms[a]);
+        mu_assert_int_eq(6, (int)b[6]->dominated_count); // Itself plus blocks 1-5
+
+        free_cfg(cfg);
+    }
+}
+
+MU_TEST(test_dominator_algorithms_agree) {
+    const char *input = "int main() {\n"
+                        "  int x = 0;\n"
+                        "  int i = 0;\n"
+                        "  while (i < 10) {\n"
+                        "    if (i > 5) {\n"
+                        "      x = x + i;\n"
+                        "    } else {\n"
+                        "      while (x < 3) { x = x + 1; }\n"
+                        "    }\n"
+                        "    i = i + 1;\n"
+                        "  }\n"
+                        "  return x;\n"
+                        "}\n"
+                        "int f(int a) { if (a) { return 1; } return 2; }";
+
+    Lexer lexer;
+    lexer_init(&lexer, input);
+    ASTNode *ast = parse(&lexer);
+    mu_assert(ast != NULL, "AST should not be NULL");
+    CFG *cfg = ast_to_cfg(ast);
+    mu_assert(cfg != NULL, "CFG should not be NULL");
+
+    compute_dominator_tree_with(cfg, DOM_ITERATIVE);
+    BasicBlock **expected = malloc(sizeof(BasicBlock *) * cfg->block_count);
+    for (size_t i = 0; i < cfg->block_count; i++) {
+        expected[i] = cfg->blocks[i]->dominator;
+    }
+
+    compute_dominator_tree_with(cfg, DOM_SEMI_NCA);
+    for (size_t i = 0; i < cfg->block_count; i++) {
+        mu_assert(cfg->blocks[i]->dominator == expected[i], "Iterative and semi-NCA dominators should match");
+    }
+
+    free(expected);
+    free_cfg(cfg);
+    free_ast(ast);
+}
+
+static const char *dead_merge_input = "int main() {\n"
+                                      "  int x = 1;\n"
+                                      "  int y = 0;\n"
+                                      "  if (x > 0) {\n"
+                                      "    y = 2;\n"
+                                      "    x = 3;\n"
+                                      "  } else {\n"
+                                      "    y = 4;\n"
+                                      "  }\n"
+                                      "  return x;\n"
+                                      "}";
+
+// Build main's CFG with dominance frontiers, ready for phi insertion
+static Module *prepare_module(const char *input, ASTNode **ast) {
+    Lexer lexer;
+    lexer_init(&lexer, input);
+    *ast = parse(&lexer);
+    if (!*ast) return NULL;
+    Module *module = ast_to_module(*ast);
+    MODULE_FOREACH(module, cfg) {
+        compute_dominator_tree(cfg);
+        compute_dominance_frontiers(cfg);
+    }
+    return module;
+}
+
+static BasicBlock *find_block(CFG *cfg, BlockType type, size_t nth) {
+    for (size_t i = 0; i < cfg->block_count; i++) {
+        if (cfg->blocks[i]->type == type && nth-- == 0) return cfg->blocks[i];
+    }
+    return NULL;
+}
+
+MU_TEST(test_liveness_loop) {
+    ASTNode *ast;
+    Module *module = prepare_module("int main() { int i = 0; int s = 0; while (i < 10) { s = s + i; i = i + 1; } return s; }", &ast);
+    mu_assert(module != NULL, "Module should not be NULL");
+    CFG *cfg = module->functions[0];
+
+    Liveness *liveness = compute_liveness(cfg);
+    mu_assert_int_eq(2, (int)liveness->index.count);
+    BasicBlock *header = find_block(cfg, BLOCK_LOOP_HEADER, 0);
+    BasicBlock *body = find_block(cfg, BLOCK_LOOP_BODY, 0);
+    mu_assert(header && body, "Loop blocks should exist");
+
+    mu_assert(is_live_in(liveness, header, intern_cstr("i")), "i should be live into the loop header");
+    mu_assert(is_live_in(liveness, header, intern_cstr("s")), "s should be live into the loop header");
+    mu_assert(is_live_out(liveness, body, intern_cstr("i")), "i should be live around the back edge");
+    mu_assert(!is_live_in(liveness, cfg->entry, intern_cstr("i")), "i is defined before any use");
+    mu_assert(!is_live_in(liveness, cfg->exit, intern_cstr("s")), "Nothing is live at the exit");
+    mu_assert(liveness_var_index(liveness, intern_cstr("nope")) == SIZE_MAX, "Unknown variable should have no index");
+
+    free_liveness(liveness);
+    free_module(module);
+    free_ast(ast);
+}
+
+MU_TEST(test_pruned_phi_insertion) {
+    SSAMode modes[] = { SSA_MINIMAL, SSA_SEMI_PRUNED, SSA_PRUNED };
+    size_t expected_inserted[] = { 2, 1, 1 };
+    size_t expected_avoided[] = { 0, 1, 1 };
+
+    for (size_t m = 0; m < 3; m++) {
+        ASTNode *ast;
+        Module *module = prepare_module(dead_merge_input, &ast);
+        mu_assert(module != NULL, "Module should not be NULL");
+        CFG *cfg = module->functions[0];
+
+        PhiStats stats;
+        insert_phi_functions_with(cfg, modes[m], &stats);
+        mu_assert_int_eq((int)expected_inserted[m], (int)stats.inserted);
+        mu_assert_int_eq((int)expected_avoided[m], (int)stats.avoided);
+
+        // The merge block needs x in every mode; y is dead after the if
+        BasicBlock *merge = cfg->blocks[cfg->block_count - 1];
+        mu_assert_int_eq((int)expected_inserted[m], (int)merge->phi_count);
+        mu_assert(merge->phi_vars[0] == intern_cstr("x") || merge->phi_vars[merge->phi_count - 1] == intern_cstr("x"),
+                  "x should get a phi at the merge block");
+        if (modes[m] != SSA_MINIMAL) {
+            mu_assert(merge->phi_vars[0] == intern_cstr("x"), "Only x should get a phi when pruning");
+        }
+
+        free_module(module);
+        free_ast(ast);
+    }
+}
+
+// The inner merge's phi is a new definition of x that reaches the outer merge
+MU_TEST(test_iterated_frontier_phis) {
+    ASTNode *ast;
+    Module *module = prepare_module("int main() {\n"
+                                    "  int x = 0;\n"
+                                    "  int y = 0;\n"
+                                    "  if (x > 0)\n"
+                                    "    if (y > 0)\n"
+                                    "      x = 1;\n"
+                                    "    else\n"
+                                    "      x = 2;\n"
+                                    "  return x;\n"
+                                    "}", &ast);
+    mu_assert(module != NULL, "Module should not be NULL");
+    CFG *cfg = module->functions[0];
+
+    // Recomputing must not duplicate frontier entries
+    size_t frontier_total = 0, recomputed_total = 0;
+    for (size_t i = 0; i < cfg->block_count; i++) frontier_total += cfg->blocks[i]->dom_frontier->count;
+    compute_dominance_frontiers(cfg);
+    for (size_t i = 0; i < cfg->block_count; i++) recomputed_total += cfg->blocks[i]->dom_frontier->count;
+    mu_assert_int_eq((int)frontier_total, (int)recomputed_total);
+
+    PhiStats stats;
+    insert_phi_functions_with(cfg, SSA_MINIMAL, &stats);
+    mu_assert_int_eq(2, (int)stats.inserted);
+
+    BasicBlock *return_block = NULL;
+    for (size_t i = 0; i < cfg->block_count; i++) {
+        BasicBlock *block = cfg->blocks[i];
+        for (size_t j = 0; j < block->stmt_count; j++) {
+            if (block->stmts[j]->type == NODE_RETURN) return_block = block;
+        }
+        if (block->phi_count) {
+            mu_assert_int_eq(1, (int)block->phi_count);
+            mu_assert(block->phi_vars[0] == intern_cstr("x"), "Only x is assigned on the branches");
+        }
+    }
+    mu_assert(return_block != NULL, "Return block should exist");
+    mu_assert_int_eq(1, (int)return_block->phi_count);
+    mu_assert(return_block->stmts[0]->type == NODE_VAR_DECL && !return_block->stmts[0]->data.var_decl.init_value,
+              "The phi should be the first statement of the outer merge");
+
+    free_module(module);
+    free_ast(ast);
+}
+
 MU_TEST_SUITE(dominance_suite) {
     MU_RUN_TEST(test_dominator_tree_basic);
     MU_RUN_TEST(test_dominator_tree_with_df);
     MU_RUN_TEST(test_generate_df_dot_file);
     MU_RUN_TEST(test_phi_function_insertion);
+    MU_RUN_TEST(test_rpo_numbering);
+    MU_RUN_TEST(test_dominators_irreducible);
+    MU_RUN_TEST(test_dominator_algorithms_agree);
+    MU_RUN_TEST(test_liveness_loop);
+    MU_RUN_TEST(test_pruned_phi_insertion);
+    MU_RUN_TEST(test_iterated_frontier_phis);
 }
 
 int main() {
@@ -1,6 +1,9 @@
 #include "lexer.h"
+#include "scan.h"
 #include "minunit.h"
 #include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 static int mu_assert_token_eq(TokenType expected_type, const char* expected_text, const Token token) {
     if (expected_type != token.type) {
@@ -241,6 +244,78 @@ MU_TEST(test_lexer_edge_case_numbers) {
     mu_assert(mu_assert_token_eq(TOK_FLOAT, ".5", token), "Expected floating-point number .5");
 }
 
+MU_TEST(test_lexer_integer_values) {
+    const char *input = "42 0x1F 0755 0b1011 1'000'000 0xFFFF'FFFF 18446744073709551615u "
+                        "10uLL 7ll 3LU 5wb 6uwb 0 0u 0x7fffffffffffffff";
+    const struct { const char *text; uint64_t value; uint8_t flags; } expected[] = {
+        { "42", 42, 0 },
+        { "0x1F", 31, 0 },
+        { "0755", 493, 0 },
+        { "0b1011", 11, 0 },
+        { "1'000'000", 1000000, 0 },
+        { "0xFFFF'FFFF", 0xFFFFFFFFu, 0 },
+        { "18446744073709551615u", UINT64_MAX, LITERAL_UNSIGNED },
+        { "10uLL", 10, LITERAL_UNSIGNED | LITERAL_LONG_LONG },
+        { "7ll", 7, LITERAL_LONG_LONG },
+        { "3LU", 3, LITERAL_LONG | LITERAL_UNSIGNED },
+        { "5wb", 5, LITERAL_BIT_PRECISE },
+        { "6uwb", 6, LITERAL_UNSIGNED | LITERAL_BIT_PRECISE },
+        { "0", 0, 0 },
+        { "0u", 0, LITERAL_UNSIGNED },
+        { "0x7fffffffffffffff", 0x7fffffffffffffffull, 0 },
+    };
+    Lexer lexer;
+    lexer_init(&lexer, input);
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        Token token = next_token(&lexer);
+        mu_assert(mu_assert_token_eq(TOK_INTEGER, expected[i].text, token), expected[i].text);
+        mu_assert_int_eq(LITERAL_INTEGER, token.literal.kind);
+        mu_assert(token.literal.value.integer == expected[i].value, expected[i].text);
+        mu_assert_int_eq(expected[i].flags, token.literal.flags);
+    }
+    mu_assert_int_eq(TOK_EOF, next_token(&lexer).type);
+
+    // Separators only sit between digits; a trailing quote starts a char literal
+    lexer_init(&lexer, "12'a'");
+    Token token = next_token(&lexer);
+    mu_assert(mu_assert_token_eq(TOK_INTEGER, "12", token), "Separator needs a digit after it");
+    mu_assert_int_eq(TOK_CHAR, next_token(&lexer).type);
+
+    lexer_init(&lexer, "18446744073709551616");
+    token = next_token(&lexer);
+    mu_assert(token.literal.flags & LITERAL_OVERFLOW, "Too-large constant should be flagged");
+}
+
+MU_TEST(test_lexer_float_values) {
+    const char *input = "3.14 1. .5 1.23e4 5E-2 2.5f 1e-5L 0.1 1'024.5 123456789.123456789 1e300 0x1.8p3 6.02214076e23";
+    const struct { const char *text; double value; uint8_t flags; } expected[] = {
+        { "3.14", 3.14, 0 },
+        { "1.", 1.0, 0 },
+        { ".5", 0.5, 0 },
+        { "1.23e4", 1.23e4, 0 },
+        { "5E-2", 5E-2, 0 },
+        { "2.5f", 2.5, LITERAL_FLOAT },
+        { "1e-5L", 1e-5, LITERAL_LONG },
+        { "0.1", 0.1, 0 },
+        { "1'024.5", 1024.5, 0 },
+        { "123456789.123456789", 123456789.123456789, 0 },
+        { "1e300", 1e300, 0 },
+        { "0x1.8p3", 12.0, 0 },
+        { "6.02214076e23", 6.02214076e23, 0 },
+    };
+    Lexer lexer;
+    lexer_init(&lexer, input);
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        Token token = next_token(&lexer);
+        mu_assert(mu_assert_token_eq(TOK_FLOAT, expected[i].text, token), expected[i].text);
+        mu_assert_int_eq(LITERAL_FLOATING, token.literal.kind);
+        // Decoding must be correctly rounded, so compare exactly
+        mu_assert(token.literal.value.floating == expected[i].value, expected[i].text);
+        mu_assert_int_eq(expected[i].flags, token.literal.flags);
+    }
+    mu_assert_int_eq(TOK_EOF, next_token(&lexer).type);
+}
+
 MU_TEST(test_lexer_unmatched_string) {
     const char *input = "\"unterminated string";
     Lexer lexer;
@@ -370,6 +445,171 @@ MU_TEST(test_lexer_operators) {
     mu_assert(mu_assert_token_eq(TOK_SLASH_EQ, "/=", token), "Expected operator /=");
 }
 
+MU_TEST(test_lexer_line_tracking) {
+    const char *input = "int\n\n   x /* one\ntwo\n */ y // tail\n\tz";
+    Lexer lexer;
+    lexer_init(&lexer, input);
+    LineTable lines;
+    line_table_init(&lines, input);
+
+    Token token = next_token(&lexer);
+    SourceLocation location = line_table_locate(&lines, (size_t)(token.text - input));
+    mu_assert_int_eq(1, (int)location.line);
+    token = next_token(&lexer); // x
+    location = line_table_locate(&lines, (size_t)(token.text - input));
+    mu_assert_int_eq(3, (int)location.line);
+    mu_assert_int_eq(4, (int)location.column);
+    token = next_token(&lexer); // Block comment
+    mu_assert(token.type == TOK_COMMENT, "Expected block comment");
+    token = next_token(&lexer); // y
+    mu_assert(mu_assert_token_eq(TOK_IDENTIFIER, "y", token), "Expected y after the comment");
+    location = line_table_locate(&lines, (size_t)(token.text - input));
+    mu_assert_int_eq(5, (int)location.line);
+    mu_assert_int_eq(5, (int)location.column);
+    token = next_token(&lexer); // Line comment
+    mu_assert(mu_assert_token_eq(TOK_COMMENT, "// tail", token), "Expected line comment");
+    token = next_token(&lexer); // z
+    location = line_table_locate(&lines, (size_t)(token.text - input));
+    mu_assert_int_eq(6, (int)location.line);
+    mu_assert_int_eq(2, (int)location.column);
+
+    // The table is only built by the first lookup, and covers every line
+    mu_assert_int_eq(6, (int)lines.count);
+    location = line_table_locate(&lines, strlen(input)); // The terminating NUL
+    mu_assert_int_eq(6, (int)location.line);
+    line_table_free(&lines);
+}
+
+MU_TEST(test_lexer_shift_and_bitwise_operators) {
+    const char *input = "| |= << >> <<= >>= ^ ~ # ## <<<";
+    TokenType expected[] = { TOK_PIPE, TOK_PIPE_EQ, TOK_LSHIFT, TOK_RSHIFT, TOK_LSHIFT_EQ, TOK_RSHIFT_EQ,
+                             TOK_CARET, TOK_TILDE, TOK_PP_HASH, TOK_PP_HASHHASH, TOK_LSHIFT, TOK_LT, TOK_EOF };
+    Lexer lexer;
+    lexer_init(&lexer, input);
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        Token token = next_token(&lexer);
+        mu_assert_string_eq(token_type_to_string(expected[i]), token_type_to_string(token.type));
+    }
+}
+
+// The longest operator wins, backing off when a longer spelling does not complete
+MU_TEST(test_lexer_maximal_munch) {
+    const char *input = "a+++b..c->d>>=e";
+    const char *expected[] = { "a", "++", "+", "b", ".", ".", "c", "->", "d", ">>=", "e" };
+    Lexer lexer;
+    lexer_init(&lexer, input);
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        Token token = next_token(&lexer);
+        mu_assert(token.length == strlen(expected[i]) && strncmp(token.text, expected[i], token.length) == 0,
+                  "Operator split should follow maximal munch");
+    }
+    mu_assert(next_token(&lexer).type == TOK_EOF, "Expected end of input");
+}
+
+MU_TEST(test_lexer_c23_keywords) {
+    const char *input = "constexpr static_assert _Static_assert sizeof constexpr_x";
+    TokenType expected[] = { TOK_KW_CONSTEXPR, TOK_KW__STATIC_ASSERT, TOK_KW__STATIC_ASSERT, TOK_KW_SIZEOF,
+                             TOK_IDENTIFIER, TOK_EOF };
+    Lexer lexer;
+    lexer_init(&lexer, input);
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        Token token = next_token(&lexer);
+        mu_assert_string_eq(token_type_to_string(expected[i]), token_type_to_string(token.type));
+    }
+}
+
+// Byte-at-a-time versions of the scanners to check the block implementations against
+static const char *reference_whitespace(const char *p, size_t *newlines) {
+    for (; *p == ' ' || (*p >= '\t' && *p <= '\r'); p++) {
+        if (*p == '\n') (*newlines)++;
+    }
+    return p;
+}
+
+static const char *reference_identifier(const char *p) {
+    while ((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z') || (*p >= '0' && *p <= '9') || *p == '_') p++;
+    return p;
+}
+
+static const char *reference_block_comment(const char *p, size_t *newlines) {
+    for (; *p; p++) {
+        if (p[0] == '*' && p[1] == '/') return p + 2;
+        if (*p == '\n') (*newlines)++;
+    }
+    return p;
+}
+
+MU_TEST(test_scan_implementations_agree) {
+    static const char alphabet[] = "  \t\n\r\v\fab_Z09*/*@[`{\x80\xff";
+    static char buffer[4096 + 1];
+    unsigned seed = 12345;
+    for (size_t i = 0; i < sizeof(buffer) - 1; i++) {
+        seed = seed * 1103515245u + 12345u;
+        // Long runs of one class, so the scanners cross block boundaries
+        size_t pick = (seed >> 16) % (sizeof(alphabet) - 1);
+        size_t run = 1 + (seed >> 8) % 40;
+        for (; run > 0 && i < sizeof(buffer) - 1; run--, i++) {
+            buffer[i] = alphabet[(pick + (run % 3 == 0)) % (sizeof(alphabet) - 1)];
+        }
+        i--;
+    }
+    buffer[sizeof(buffer) - 1] = '\0';
+
+    ScanImpl impls[] = { SCAN_SWAR, SCAN_SSE2, SCAN_AVX2 };
+    for (size_t m = 0; m < sizeof(impls) / sizeof(impls[0]); m++) {
+        if (!scan_select(impls[m])) continue; // Not available on this CPU
+        for (size_t start = 0; start < sizeof(buffer) - 1; start++) {
+            const char *p = buffer + start;
+            size_t expected_lines = 0;
+            ScanLines lines = { 0, NULL };
+            const char *end = scan_whitespace(p, &lines);
+            mu_assert(end == reference_whitespace(p, &expected_lines), "Whitespace scan should stop at the same byte");
+            mu_assert(lines.newlines == expected_lines, "Whitespace scan should count every newline");
+            if (lines.newlines) mu_assert(lines.line_start[-1] == '\n', "line_start should follow a newline");
+
+            mu_assert(scan_identifier(p) == reference_identifier(p), "Identifier scan should stop at the same byte");
+
+            expected_lines = 0;
+            lines = (ScanLines){ 0, NULL };
+            end = scan_block_comment(p, &lines);
+            mu_assert(end == reference_block_comment(p, &expected_lines), "Comment scan should stop after the same */");
+            mu_assert(lines.newlines == expected_lines, "Comment scan should count every newline");
+
+            const char *newline = strchr(p, '\n');
+            mu_assert(scan_line_end(p) == (newline ? newline : p + strlen(p)), "Line scan should stop at the newline");
+        }
+    }
+    mu_assert(scan_select(SCAN_AUTO), "Automatic selection should always succeed");
+}
+
+// Source ending right at a page boundary: the block reads must not touch the next page
+MU_TEST(test_scan_page_boundary) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    char *pages = mmap(NULL, 2 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    mu_assert(pages != MAP_FAILED, "mmap should succeed");
+    mprotect(pages + page, page, PROT_NONE);
+
+    const char *text = "  \n\t name_1 /* open";
+    size_t length = strlen(text) + 1;
+    char *source = pages + page - length;
+    memcpy(source, text, length);
+
+    Lexer lexer;
+    lexer_init(&lexer, source);
+    Token token = next_token(&lexer);
+    mu_assert(mu_assert_token_eq(TOK_IDENTIFIER, "name_1", token), "Expected identifier before the page end");
+    LineTable lines;
+    line_table_init(&lines, source);
+    mu_assert_int_eq(2, (int)line_table_locate(&lines, (size_t)(token.text - source)).line);
+    line_table_free(&lines);
+    token = next_token(&lexer);
+    mu_assert(mu_assert_token_eq(TOK_COMMENT, "/* open", token), "Unterminated comment should stop at the NUL");
+    token = next_token(&lexer);
+    mu_assert(token.type == TOK_EOF, "Expected end of input");
+
+    munmap(pages, 2 * page);
+}
+
 MU_TEST_SUITE(lexer_suite) {
     MU_RUN_TEST(test_lexer_single_token);
     MU_RUN_TEST(test_lexer_multiple_tokens);
@@ -380,6 +620,8 @@ MU_TEST_SUITE(lexer_suite) {
     MU_RUN_TEST(test_lexer_operators_and_punctuation);
     MU_RUN_TEST(test_lexer_char_literals_with_escape_sequences);
     MU_RUN_TEST(test_lexer_edge_case_numbers);
+    MU_RUN_TEST(test_lexer_integer_values);
+    MU_RUN_TEST(test_lexer_float_values);
     MU_RUN_TEST(test_lexer_unmatched_string);
     MU_RUN_TEST(test_lexer_unmatched_char);
     MU_RUN_TEST(test_lexer_complex_operators);
@@ -389,6 +631,12 @@ MU_TEST_SUITE(lexer_suite) {
     // MU_RUN_TEST(test_lexer_unrecognized_escape_sequences);
     // MU_RUN_TEST(test_lexer_multiline_comment_unterminated);
     MU_RUN_TEST(test_lexer_operators);
+    MU_RUN_TEST(test_lexer_line_tracking);
+    MU_RUN_TEST(test_lexer_shift_and_bitwise_operators);
+    MU_RUN_TEST(test_lexer_maximal_munch);
+    MU_RUN_TEST(test_lexer_c23_keywords);
+    MU_RUN_TEST(test_scan_implementations_agree);
+    MU_RUN_TEST(test_scan_page_boundary);
 }
 
 int main() {
@@ -65,7 +65,7 @@ MU_TEST(test_optimize_noop) {
         mu_assert(strcmp(expected_line, actual_line) == 0, "TAC output mismatch");
     }
 
-    for (size_t i = 0; i < cfg->block_count; ++i) free_tac(cfg->blocks[i]->tac_head);
+    for (size_t i = 0; i < cfg->block_count; ++i) free_tac(cfg->blocks[i]);
     free_cfg(cfg);
     free_ast(ast);
 }
@@ -7,6 +7,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <pthread.h>
 
 MU_TEST(test_parser_simple_program) {
     LOG_TRACE("Running test_parser_simple_program");
@@ -22,7 +23,7 @@ MU_TEST(test_parser_simple_program) {
 
     ASTNode *function = ast->data.stmt_list.stmts[0];
     mu_assert_int_eq(NODE_FUNCTION_DECL, function->type);
-    mu_assert_string_eq("main", function->data.function_decl.name);
+    mu_assert_string_eq("main", symbol_name(function->data.function_decl.name));
 
     ASTNode *body = function->data.function_decl.body;
     mu_assert_int_eq(NODE_STMT_LIST, body->type);
@@ -55,7 +56,7 @@ MU_TEST(test_parser_nested_program) {
 
     ASTNode *function = ast->data.stmt_list.stmts[0];
     mu_assert_int_eq(NODE_FUNCTION_DECL, function->type);
-    mu_assert_string_eq("main", function->data.function_decl.name);
+    mu_assert_string_eq("main", symbol_name(function->data.function_decl.name));
 
     ASTNode *body = function->data.function_decl.body;
     mu_assert_int_eq(NODE_STMT_LIST, body->type);
@@ -138,14 +139,14 @@ MU_TEST(test_parser_variable_declaration) {
 
     ASTNode *var_decl = body->data.stmt_list.stmts[0];
     mu_assert_int_eq(NODE_VAR_DECL, var_decl->type);
-    mu_assert_string_eq("x", var_decl->data.var_decl.name);
+    mu_assert_string_eq("x", symbol_name(var_decl->data.var_decl.name));
     mu_assert_int_eq(NODE_LITERAL, var_decl->data.var_decl.init_value->type);
     mu_assert_int_eq(42, var_decl->data.var_decl.init_value->data.literal.value.int_value);
 
     ASTNode *return_stmt = body->data.stmt_list.stmts[1];
     mu_assert_int_eq(NODE_RETURN, return_stmt->type);
     mu_assert_int_eq(NODE_VAR_REF, return_stmt->data.return_stmt.value->type);
-    mu_assert_string_eq("x", return_stmt->data.return_stmt.value->data.var_ref.name);
+    mu_assert_string_eq("x", symbol_name(return_stmt->data.return_stmt.value->data.var_ref.name));
 
     free_ast(ast);
 }
@@ -232,7 +233,7 @@ MU_TEST(test_parser_for_statement) {
 
     ASTNode *init = for_stmt->data.for_stmt.init;
     mu_assert_int_eq(NODE_VAR_DECL, init->type);
-    mu_assert_string_eq("i", init->data.var_decl.name);
+    mu_assert_string_eq("i", symbol_name(init->data.var_decl.name));
     mu_assert_int_eq(0, init->data.var_decl.init_value->data.literal.value.int_value);
 
     ASTNode *condition = for_stmt->data.for_stmt.condition;
@@ -246,7 +247,7 @@ MU_TEST(test_parser_for_statement) {
     ASTNode *loop_body = for_stmt->data.for_stmt.body;
     mu_assert_int_eq(NODE_RETURN, loop_body->type);
     mu_assert_int_eq(NODE_VAR_REF, loop_body->data.return_stmt.value->type);
-    mu_assert_string_eq("i", loop_body->data.return_stmt.value->data.var_ref.name);
+    mu_assert_string_eq("i", symbol_name(loop_body->data.return_stmt.value->data.var_ref.name));
 
     free_ast(ast);
 }
@@ -268,7 +269,7 @@ MU_TEST(test_parser_function_call) {
     ASTNode *body = function->data.function_decl.body;
     ASTNode *call_stmt = body->data.stmt_list.stmts[0];
     mu_assert_int_eq(NODE_FUNCTION_CALL, call_stmt->type);
-    mu_assert_string_eq("foo", call_stmt->data.function_call.name);
+    mu_assert_string_eq("foo", symbol_name(call_stmt->data.function_call.name));
     mu_assert_int_eq(3, call_stmt->data.function_call.arg_count);
 
     ASTNode *arg1 = call_stmt->data.function_call.args[0];
@@ -303,7 +304,7 @@ MU_TEST(test_parser_assignment) {
     ASTNode *body = function->data.function_decl.body;
     ASTNode *assignment = body->data.stmt_list.stmts[0];
     mu_assert_int_eq(NODE_ASSIGNMENT, assignment->type);
-    mu_assert_string_eq("x", assignment->data.assignment.name);
+    mu_assert_string_eq("x", symbol_name(assignment->data.assignment.name));
     mu_assert_int_eq(NODE_LITERAL, assignment->data.assignment.value->type);
     mu_assert_int_eq(42, assignment->data.assignment.value->data.literal.value.int_value);
 
@@ -410,12 +411,12 @@ MU_TEST(test_type_parsing) {
     ASTNode *body = function->data.function_decl.body;
     ASTNode *var_decl1 = body->data.stmt_list.stmts[0];
     mu_assert_int_eq(NODE_VAR_DECL, var_decl1->type);
-    mu_assert_string_eq("x", var_decl1->data.var_decl.name);
+    mu_assert_string_eq("x", symbol_name(var_decl1->data.var_decl.name));
     mu_assert_int_eq(TYPE_CHAR, var_decl1->data.var_decl.type->kind);
 
     ASTNode *var_decl2 = body->data.stmt_list.stmts[1];
     mu_assert_int_eq(NODE_VAR_DECL, var_decl2->type);
-    mu_assert_string_eq("y", var_decl2->data.var_decl.name);
+    mu_assert_string_eq("y", symbol_name(var_decl2->data.var_decl.name));
     mu_assert_int_eq(TYPE_POINTER, var_decl2->data.var_decl.type->kind);
     mu_assert_int_eq(TYPE_VOID, var_decl2->data.var_decl.type->base->kind);
 
@@ -438,18 +439,18 @@ MU_TEST(test_unary_operations) {
     ASTNode *body = function->data.function_decl.body;
     ASTNode *var_decl = body->data.stmt_list.stmts[0];
     mu_assert_int_eq(NODE_VAR_DECL, var_decl->type);
-    mu_assert_string_eq("x", var_decl->data.var_decl.name);
+    mu_assert_string_eq("x", symbol_name(var_decl->data.var_decl.name));
     mu_assert_int_eq(0, var_decl->data.var_decl.init_value->data.literal.value.int_value);
 
     ASTNode *prefix_inc = body->data.stmt_list.stmts[1];
     mu_assert_int_eq(NODE_UNARY_OP, prefix_inc->type);
     mu_assert_int_eq(TOK_PLUS_PLUS, prefix_inc->data.unary_op.op);
-    mu_assert_string_eq("x", prefix_inc->data.unary_op.operand->data.var_ref.name);
+    mu_assert_string_eq("x", symbol_name(prefix_inc->data.unary_op.operand->data.var_ref.name));
 
     ASTNode *postfix_dec = body->data.stmt_list.stmts[2];
     mu_assert_int_eq(NODE_UNARY_OP, postfix_dec->type);
     mu_assert_int_eq(TOK_MINUS_MINUS, postfix_dec->data.unary_op.op);
-    mu_assert_string_eq("x", postfix_dec->data.unary_op.operand->data.var_ref.name);
+    mu_assert_string_eq("x", symbol_name(postfix_dec->data.unary_op.operand->data.var_ref.name));
 
     free_ast(ast);
 }
@@ -470,7 +471,7 @@ MU_TEST(test_binary_operations) {
     ASTNode *body = function->data.function_decl.body;
     ASTNode *var_decl = body->data.stmt_list.stmts[0];
     mu_assert_int_eq(NODE_VAR_DECL, var_decl->type);
-    mu_assert_string_eq("x", var_decl->data.var_decl.name);
+    mu_assert_string_eq("x", symbol_name(var_decl->data.var_decl.name));
 
     ASTNode *binary_op1 = var_decl->data.var_decl.init_value;
     mu_assert_int_eq(NODE_BINARY_OP, binary_op1->type);
@@ -568,9 +569,11 @@ MU_TEST(test_parser_array_type) {
     ASTNode *body = function->data.function_decl.body;
     ASTNode *var_decl = body->data.stmt_list.stmts[0];
     mu_assert_int_eq(NODE_VAR_DECL, var_decl->type);
-    mu_assert_string_eq("arr", var_decl->data.var_decl.name);
+    mu_assert_string_eq("arr", symbol_name(var_decl->data.var_decl.name));
     mu_assert_int_eq(TYPE_ARRAY, var_decl->data.var_decl.type->kind);
     mu_assert_int_eq(10, var_decl->data.var_decl.type->array_size);
+    mu_assert(var_decl->data.var_decl.type == type_array(type_get(TYPE_INT), 10), "int[10] should be the canonical array type");
+    mu_assert(function->data.function_decl.return_type == type_get(TYPE_INT), "Return type should share the canonical int");
 
     free_ast(ast);
 }
@@ -592,7 +595,7 @@ MU_TEST(test_parser_pointer_type) {
     ASTNode *body = function->data.function_decl.body;
     ASTNode *var_decl = body->data.stmt_list.stmts[0];
     mu_assert_int_eq(NODE_VAR_DECL, var_decl->type);
-    mu_assert_string_eq("ptr", var_decl->data.var_decl.name);
+    mu_assert_string_eq("ptr", symbol_name(var_decl->data.var_decl.name));
     mu_assert_int_eq(TYPE_POINTER, var_decl->data.var_decl.type->kind);
 
     free_ast(ast);
@@ -615,17 +618,17 @@ MU_TEST(test_parser_postfix_operations) {
     ASTNode *body = function->data.function_decl.body;
     ASTNode *var_decl = body->data.stmt_list.stmts[0];
     mu_assert_int_eq(NODE_VAR_DECL, var_decl->type);
-    mu_assert_string_eq("x", var_decl->data.var_decl.name);
+    mu_assert_string_eq("x", symbol_name(var_decl->data.var_decl.name));
 
     ASTNode *postfix_inc = body->data.stmt_list.stmts[1];
     mu_assert_int_eq(NODE_UNARY_OP, postfix_inc->type);
     mu_assert_int_eq(TOK_PLUS_PLUS, postfix_inc->data.unary_op.op);
-    mu_assert_string_eq("x", postfix_inc->data.unary_op.operand->data.var_ref.name);
+    mu_assert_string_eq("x", symbol_name(postfix_inc->data.unary_op.operand->data.var_ref.name));
 
     ASTNode *postfix_dec = body->data.stmt_list.stmts[2];
     mu_assert_int_eq(NODE_UNARY_OP, postfix_dec->type);
     mu_assert_int_eq(TOK_MINUS_MINUS, postfix_dec->data.unary_op.op);
-    mu_assert_string_eq("x", postfix_dec->data.unary_op.operand->data.var_ref.name);
+    mu_assert_string_eq("x", symbol_name(postfix_dec->data.unary_op.operand->data.var_ref.name));
 
     free_ast(ast);
 }
@@ -716,6 +719,112 @@ MU_TEST(test_parser_equality_operators) {
     free_ast(program);
 }
 
+// Parses "int main() { <statement> }" and returns the first statement of the body
+static ASTNode *parse_first_statement(const char *input, ASTNode **program) {
+    Lexer lexer;
+    lexer_init(&lexer, input);
+    *program = parse(&lexer);
+    if (!*program) return NULL;
+    ASTNode *body = (*program)->data.program.stmts[0]->data.function_decl.body;
+    return body->data.stmt_list.stmts[0];
+}
+
+MU_TEST(test_parser_bitwise_precedence) {
+    ASTNode *program;
+    // a | (b ^ (c & (d << 1)))
+    ASTNode *value = parse_first_statement("int main() { x = a | b ^ c & d << 1; }", &program)->data.assignment.value;
+    mu_assert_int_eq(TOK_PIPE, value->data.binary_op.op);
+    ASTNode *xor = value->data.binary_op.right;
+    mu_assert_int_eq(TOK_CARET, xor->data.binary_op.op);
+    ASTNode *and = xor->data.binary_op.right;
+    mu_assert_int_eq(TOK_AMP, and->data.binary_op.op);
+    mu_assert_int_eq(TOK_LSHIFT, and->data.binary_op.right->data.binary_op.op);
+    free_ast(program);
+
+    // Shifts bind tighter than comparisons and looser than addition: (a + 1) >> 2 < b
+    value = parse_first_statement("int main() { x = a + 1 >> 2 < b; }", &program)->data.assignment.value;
+    mu_assert_int_eq(TOK_LT, value->data.binary_op.op);
+    mu_assert_int_eq(TOK_RSHIFT, value->data.binary_op.left->data.binary_op.op);
+    mu_assert_int_eq(TOK_PLUS, value->data.binary_op.left->data.binary_op.left->data.binary_op.op);
+    free_ast(program);
+}
+
+MU_TEST(test_parser_ternary) {
+    ASTNode *program;
+    // a ? b : (c ? d : e)
+    ASTNode *value = parse_first_statement("int main() { x = a ? b : c ? d : e; }", &program)->data.assignment.value;
+    mu_assert_int_eq(NODE_TERNARY, value->type);
+    mu_assert_int_eq(NODE_VAR_REF, value->data.ternary.condition->type);
+    mu_assert_int_eq(NODE_VAR_REF, value->data.ternary.then_expr->type);
+    mu_assert_int_eq(NODE_TERNARY, value->data.ternary.else_expr->type);
+    free_ast(program);
+
+    // The condition takes the whole logical-or expression
+    value = parse_first_statement("int main() { x = a || b ? 1 : 2; }", &program)->data.assignment.value;
+    mu_assert_int_eq(NODE_TERNARY, value->type);
+    mu_assert_int_eq(TOK_PIPE_PIPE, value->data.ternary.condition->data.binary_op.op);
+    free_ast(program);
+
+    ASTNode *statement = parse_first_statement("int main() { x = a ? b; }", &program);
+    mu_assert(statement == NULL && program == NULL, "A conditional without ':' should fail");
+}
+
+MU_TEST(test_parser_comma_operator) {
+    ASTNode *program;
+    // (x = 1), (y = 2)
+    ASTNode *statement = parse_first_statement("int main() { x = 1, y = 2; }", &program);
+    mu_assert_int_eq(NODE_BINARY_OP, statement->type);
+    mu_assert_int_eq(TOK_COMMA, statement->data.binary_op.op);
+    mu_assert_int_eq(NODE_ASSIGNMENT, statement->data.binary_op.left->type);
+    mu_assert_int_eq(NODE_ASSIGNMENT, statement->data.binary_op.right->type);
+    free_ast(program);
+
+    // Call arguments stop at the comma
+    statement = parse_first_statement("int main() { f(a, (b, c)); }", &program);
+    mu_assert_int_eq(NODE_FUNCTION_CALL, statement->type);
+    mu_assert_int_eq(2, (int)statement->data.function_call.arg_count);
+    mu_assert_int_eq(TOK_COMMA, statement->data.function_call.args[1]->data.binary_op.op);
+    free_ast(program);
+}
+
+MU_TEST(test_parser_assignment_operators) {
+    const char *input = "int main() { x &= 1; x |= 2; x ^= 3; x <<= 4; x >>= 5; }";
+    const int ops[] = {TOK_AMP_EQ, TOK_PIPE_EQ, TOK_CARET_EQ, TOK_LSHIFT_EQ, TOK_RSHIFT_EQ};
+    Lexer lexer;
+    lexer_init(&lexer, input);
+    ASTNode *program = parse(&lexer);
+    mu_assert(program != NULL, "Compound assignments should parse");
+    ASTNode *body = program->data.program.stmts[0]->data.function_decl.body;
+    for (int i = 0; i < 5; i++) {
+        mu_assert_int_eq(NODE_BINARY_OP, body->data.stmt_list.stmts[i]->type);
+        mu_assert_int_eq(ops[i], body->data.stmt_list.stmts[i]->data.binary_op.op);
+    }
+    free_ast(program);
+
+    // Assignment groups to the right: a = (b = 1)
+    ASTNode *statement = parse_first_statement("int main() { a = b = 1; }", &program);
+    mu_assert_int_eq(NODE_ASSIGNMENT, statement->type);
+    mu_assert_string_eq("a", symbol_name(statement->data.assignment.name));
+    mu_assert_int_eq(NODE_ASSIGNMENT, statement->data.assignment.value->type);
+    free_ast(program);
+
+    statement = parse_first_statement("int main() { 1 = 2; }", &program);
+    mu_assert(statement == NULL && program == NULL, "Assigning to a literal should fail");
+}
+
+MU_TEST(test_parser_prefix_and_postfix_in_expressions) {
+    ASTNode *program;
+    // (x++) + (~y)
+    ASTNode *value = parse_first_statement("int main() { z = x++ + ~y; }", &program)->data.assignment.value;
+    mu_assert_int_eq(TOK_PLUS, value->data.binary_op.op);
+    ASTNode *postfix = value->data.binary_op.left;
+    mu_assert_int_eq(NODE_UNARY_OP, postfix->type);
+    mu_assert_int_eq(TOK_PLUS_PLUS, postfix->data.unary_op.op);
+    mu_assert(!postfix->data.unary_op.is_prefix, "x++ should be postfix");
+    mu_assert_int_eq(TOK_TILDE, value->data.binary_op.right->data.unary_op.op);
+    free_ast(program);
+}
+
 MU_TEST(test_parser_memory_allocation_failure) {
     LOG_TRACE("Running test_parser_memory_allocation_failure");
 
@@ -921,6 +1030,601 @@ MU_TEST(test_print_ast_simple) {
     free_ast(ast);
 }
 
+MU_TEST(test_token_buffer_drops_comments) {
+    const char *input = "int /* type */ x; // trailing\n";
+    Lexer lexer;
+    lexer_init(&lexer, input);
+    TokenBuffer tokens;
+    token_buffer_init(&tokens);
+    token_buffer_fill(&tokens, &lexer);
+
+    TokenType expected[] = { TOK_KW_INT, TOK_IDENTIFIER, TOK_SEMICOLON, TOK_EOF };
+    mu_assert_int_eq(4, (int)tokens.count);
+    for (size_t i = 0; i < tokens.count; i++) {
+        mu_assert_int_eq(expected[i], tokens.tokens[i].type);
+    }
+    mu_assert_int_eq(8, (int)sizeof(tokens.tokens[0]));
+    mu_assert(strncmp(token_buffer_text(&tokens, 1), "x;", 2) == 0, "Offsets should point into the source");
+    mu_assert_int_eq(1, (int)tokens.tokens[1].length);
+    mu_assert_string_eq("x", symbol_name(token_buffer_symbol(&tokens, 1)));
+    mu_assert(token_buffer_symbol(&tokens, 0) == SYMBOL_NONE, "Keywords have no symbol");
+
+    token_buffer_free(&tokens);
+    mu_assert(tokens.tokens == NULL && tokens.count == 0, "Freed buffer should be empty");
+}
+
+MU_TEST(test_token_buffer_literals) {
+    const char *input = "int main() { int x = 0x10; x = x + 1'000; return 2.5; }";
+    Lexer lexer;
+    lexer_init(&lexer, input);
+    TokenBuffer tokens;
+    token_buffer_init(&tokens);
+    token_buffer_fill(&tokens, &lexer);
+
+    mu_assert_int_eq(3, (int)tokens.literal_count);
+    for (size_t i = 0; i < tokens.literal_count; i++) {
+        const Literal *literal = &tokens.literals[i];
+        mu_assert(token_buffer_literal(&tokens, literal->token) == literal, "Lookup should find each literal");
+    }
+    mu_assert(token_buffer_literal(&tokens, 0) == NULL, "Keywords have no literal");
+    mu_assert(tokens.literals[0].value.integer == 16, "Hex value should be decoded");
+    mu_assert(tokens.literals[1].value.integer == 1000, "Separators should be skipped");
+    mu_assert(tokens.literals[2].value.floating == 2.5, "Float value should be decoded");
+
+    token_buffer_free(&tokens);
+    mu_assert(tokens.literals == NULL && tokens.literal_count == 0, "Freed buffer should have no literals");
+}
+
+MU_TEST(test_parse_wide_integer_literal) {
+    const char *input = "int main() { return 0x100000000; }";
+    Lexer lexer;
+    lexer_init(&lexer, input);
+    ASTNode *program = parse(&lexer);
+    mu_assert(program != NULL, "Program should parse");
+    ASTNode *body = program->data.program.stmts[0]->data.function_decl.body;
+    ASTNode *value = body->data.stmt_list.stmts[0]->data.return_stmt.value;
+    mu_assert(value->data.literal.value.int_value == 0x100000000ll, "Literal should keep all 64 bits");
+    free_ast(program);
+}
+
+// One token buffer can be parsed any number of times; the trees do not share state
+MU_TEST(test_parse_tokens_reuses_buffer) {
+    const char *input = "int main() { int x = 1; x = x + 2; return x; }";
+    Lexer lexer;
+    lexer_init(&lexer, input);
+    TokenBuffer tokens;
+    token_buffer_init(&tokens);
+    token_buffer_fill(&tokens, &lexer);
+
+    ASTNode *first = parse_tokens(&tokens);
+    ASTNode *second = parse_tokens(&tokens);
+    mu_assert(first != NULL && second != NULL, "Both parses should succeed");
+    mu_assert(first != second, "Each parse should build its own tree");
+
+    ASTNode *body = second->data.program.stmts[0]->data.function_decl.body;
+    mu_assert_int_eq(3, (int)body->data.stmt_list.count);
+    ASTNode *assignment = body->data.stmt_list.stmts[1];
+    mu_assert_int_eq(NODE_ASSIGNMENT, assignment->type);
+    mu_assert_string_eq("x", symbol_name(assignment->data.assignment.name));
+    mu_assert_int_eq(NODE_BINARY_OP, assignment->data.assignment.value->type);
+
+    free_ast(first);
+    free_ast(second);
+    token_buffer_free(&tokens);
+}
+
+// int main() { <open x n> middle <close x n> end }
+static char *nested_source(const char *open, const char *middle, const char *close, const char *end, int n) {
+    size_t length = strlen("int main() {  }") + strlen(middle) + strlen(end) + (strlen(open) + strlen(close)) * (size_t)n + 1;
+    char *source = malloc(length);
+    char *out = source + sprintf(source, "int main() { ");
+    for (int i = 0; i < n; i++) out += sprintf(out, "%s", open);
+    out += sprintf(out, "%s", middle);
+    for (int i = 0; i < n; i++) out += sprintf(out, "%s", close);
+    sprintf(out, "%s }", end);
+    return source;
+}
+
+typedef struct {
+    size_t nodes;
+    size_t max_depth;
+    int last_left; // Type of the last node left
+} WalkCount;
+
+static ASTWalkAction count_node(ASTNode *node, const ASTNode *parent, size_t slot, size_t depth, void *context) {
+    (void)node, (void)parent, (void)slot;
+    WalkCount *count = context;
+    count->nodes++;
+    if (depth > count->max_depth) count->max_depth = depth;
+    return AST_WALK_CONTINUE;
+}
+
+static void note_leave(ASTNode *node, size_t depth, void *context) {
+    (void)depth;
+    ((WalkCount *)context)->last_left = node->type;
+}
+
+typedef struct {
+    const char *source;
+    bool parsed;
+    WalkCount count;
+} DeepParse;
+
+static void *parse_and_walk(void *argument) {
+    DeepParse *deep = argument;
+    Lexer lexer;
+    lexer_init(&lexer, deep->source);
+    ASTNode *program = parse(&lexer);
+    deep->parsed = program != NULL;
+    ast_walk(program, &(ASTVisitor){ count_node, note_leave, &deep->count });
+    free_ast(program);
+    return NULL;
+}
+
+// Runs the parse and the walk on a 256 KB stack, which recursion 10000 levels deep would overflow
+static DeepParse parse_on_small_stack(char *source) {
+    DeepParse deep = { source, false, { 0, 0, -1 } };
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_setstacksize(&attributes, 256 * 1024);
+    pthread_t thread;
+    pthread_create(&thread, &attributes, parse_and_walk, &deep);
+    pthread_join(thread, NULL);
+    pthread_attr_destroy(&attributes);
+    free(source);
+    return deep;
+}
+
+MU_TEST(test_parser_deep_nesting) {
+    enum { DEPTH = 10000 };
+    // Program, function and body sit above each of these, and the function has an empty parameter list
+    DeepParse deep = parse_on_small_stack(nested_source("(", "x", ")", ";", DEPTH));
+    mu_assert(deep.parsed, "Nested parentheses should parse");
+    mu_assert_int_eq(5, (int)deep.count.nodes);
+    mu_assert_int_eq(3, (int)deep.count.max_depth);
+
+    deep = parse_on_small_stack(nested_source("~", "x", "", ";", DEPTH));
+    mu_assert(deep.parsed, "A chain of prefix operators should parse");
+    mu_assert_int_eq(DEPTH + 3, (int)deep.count.max_depth);
+
+    deep = parse_on_small_stack(nested_source("x = ", "1", "", ";", DEPTH));
+    mu_assert(deep.parsed, "A chain of assignments should parse");
+    mu_assert_int_eq(DEPTH + 3, (int)deep.count.max_depth);
+
+    deep = parse_on_small_stack(nested_source("x ? 1 : ", "2", "", ";", DEPTH));
+    mu_assert(deep.parsed, "A chain of conditionals should parse");
+    mu_assert_int_eq(DEPTH + 3, (int)deep.count.max_depth);
+
+    deep = parse_on_small_stack(nested_source("f(1, ", "2", ")", ";", DEPTH));
+    mu_assert(deep.parsed, "Nested calls should parse");
+    mu_assert_int_eq(DEPTH + 3, (int)deep.count.max_depth);
+
+    // Left-associative, so the tree is as deep as the chain is long
+    deep = parse_on_small_stack(nested_source("", "x = 1", " + 1", ";", DEPTH));
+    mu_assert(deep.parsed, "A long operator chain should parse");
+    mu_assert_int_eq(2 * DEPTH + 6, (int)deep.count.nodes);
+    mu_assert_int_eq(DEPTH + 4, (int)deep.count.max_depth);
+
+    deep = parse_on_small_stack(nested_source("{ ", "x = 1;", " }", "", DEPTH));
+    mu_assert(deep.parsed, "Nested blocks should parse");
+    mu_assert_int_eq(DEPTH + 4, (int)deep.count.max_depth);
+
+    deep = parse_on_small_stack(nested_source("if (x) while (x) ", "x = 1;", "", "", DEPTH));
+    mu_assert(deep.parsed, "Nested if and while statements should parse");
+    mu_assert_int_eq(2 * DEPTH + 4, (int)deep.count.max_depth);
+    mu_assert_int_eq(NODE_PROGRAM, deep.count.last_left);
+
+    deep = parse_on_small_stack(nested_source("(", "x", "", ";", DEPTH));
+    mu_assert(!deep.parsed, "Unclosed parentheses should fail");
+}
+
+typedef struct {
+    int entered[16];
+    size_t count;
+    int stop_at;
+} WalkTrace;
+
+static ASTWalkAction trace_node(ASTNode *node, const ASTNode *parent, size_t slot, size_t depth, void *context) {
+    (void)parent, (void)slot, (void)depth;
+    WalkTrace *trace = context;
+    if ((int)node->type == trace->stop_at) return AST_WALK_STOP;
+    if (trace->count < 16) trace->entered[trace->count++] = node->type;
+    return node->type == NODE_BINARY_OP ? AST_WALK_SKIP : AST_WALK_CONTINUE;
+}
+
+MU_TEST(test_ast_walk) {
+    Lexer lexer;
+    lexer_init(&lexer, "int main() { if (x) y = 1 + 2; else return f(3); }");
+    ASTNode *program = parse(&lexer);
+    mu_assert(program != NULL, "Program should parse");
+
+    ASTNode *statement = program->data.program.stmts[0]->data.function_decl.body->data.stmt_list.stmts[0];
+    mu_assert_int_eq(3, (int)ast_child_count(statement));
+    mu_assert_int_eq(NODE_VAR_REF, ast_child(statement, 0)->type);
+    mu_assert_int_eq(NODE_RETURN, ast_child(statement, 2)->type);
+
+    // Pre-order; the sum is skipped, and the empty parameter list has no slots
+    WalkTrace trace = { .stop_at = -1 };
+    mu_assert(ast_walk(program, &(ASTVisitor){ trace_node, NULL, &trace }), "A full walk should complete");
+    const int expected[] = { NODE_PROGRAM, NODE_FUNCTION_DECL, NODE_PARAM_LIST, NODE_STMT_LIST, NODE_IF_STMT, NODE_VAR_REF,
+                             NODE_ASSIGNMENT, NODE_BINARY_OP, NODE_RETURN, NODE_FUNCTION_CALL, NODE_LITERAL };
+    mu_assert_int_eq(11, (int)trace.count);
+    for (size_t i = 0; i < trace.count; i++) mu_assert_int_eq(expected[i], trace.entered[i]);
+
+    trace = (WalkTrace){ .stop_at = NODE_RETURN };
+    mu_assert(!ast_walk(program, &(ASTVisitor){ trace_node, NULL, &trace }), "A stopped walk should say so");
+    mu_assert_int_eq(8, (int)trace.count);
+
+    WalkCount count = { 0, 0, -1 };
+    ast_walk(statement, &(ASTVisitor){ NULL, note_leave, &count });
+    mu_assert_int_eq(NODE_IF_STMT, count.last_left);
+    free_ast(program);
+}
+
+MU_TEST(test_parse_tokens_lazy) {
+    const char *input = "int f(int a) { if (a) { return 1; } return 1 + ; } int main() { int x = 2; return x; }";
+    Lexer lexer;
+    lexer_init(&lexer, input);
+    TokenBuffer tokens;
+    token_buffer_init(&tokens);
+    token_buffer_fill(&tokens, &lexer);
+
+    ASTNode *program = parse_tokens_lazy(&tokens);
+    mu_assert(program != NULL, "Signatures should parse even though a body has an error");
+    mu_assert_int_eq(2, (int)program->data.program.count);
+    ASTNode *f = program->data.program.stmts[0];
+    ASTNode *main_function = program->data.program.stmts[1];
+    mu_assert_int_eq(1, (int)f->data.function_decl.params->data.param_list.count);
+    mu_assert(main_function->data.function_decl.body == NULL, "Bodies should wait for first use");
+    mu_assert(main_function->data.function_decl.deferred != NULL, "Bodies should be kept as token ranges");
+
+    ASTNode *body = function_body(main_function);
+    mu_assert(body != NULL, "The body should parse on first use");
+    mu_assert_int_eq(NODE_STMT_LIST, body->type);
+    mu_assert_int_eq(2, (int)body->data.stmt_list.count);
+    mu_assert(main_function->data.function_decl.deferred == NULL, "A parsed body is no longer deferred");
+    mu_assert(function_body(main_function) == body, "A body is parsed once");
+
+    mu_assert(function_body(f) == NULL, "The error surfaces when the body is parsed");
+    mu_assert(f->data.function_decl.deferred != NULL, "A body that does not parse stays deferred");
+    free_ast(program);
+
+    // Signatures still have to brace-match
+    lexer_init(&lexer, "int main() { { return 0; }");
+    token_buffer_free(&tokens);
+    token_buffer_init(&tokens);
+    token_buffer_fill(&tokens, &lexer);
+    mu_assert(parse_tokens_lazy(&tokens) == NULL, "An unclosed body should fail");
+    token_buffer_free(&tokens);
+}
+
+// Node types, depths and slots in walk order, plus function names: enough to tell two trees apart
+typedef struct {
+    size_t *entries;
+    size_t count;
+    size_t capacity;
+} TreeShape;
+
+static ASTWalkAction record_shape(ASTNode *node, const ASTNode *parent, size_t slot, size_t depth, void *context) {
+    (void)parent;
+    TreeShape *shape = context;
+    if (shape->count + 4 > shape->capacity) {
+        shape->capacity = shape->capacity ? shape->capacity * 2 : 256;
+        shape->entries = realloc(shape->entries, sizeof(size_t) * shape->capacity);
+    }
+    shape->entries[shape->count++] = node->type;
+    shape->entries[shape->count++] = depth;
+    shape->entries[shape->count++] = slot;
+    shape->entries[shape->count++] = node->type == NODE_FUNCTION_DECL ? (size_t)node->data.function_decl.name : 0;
+    return AST_WALK_CONTINUE;
+}
+
+static bool same_shape(ASTNode *a, ASTNode *b) {
+    TreeShape left = { 0 }, right = { 0 };
+    ast_walk(a, &(ASTVisitor){ record_shape, NULL, &left });
+    ast_walk(b, &(ASTVisitor){ record_shape, NULL, &right });
+    bool same = left.count == right.count && memcmp(left.entries, right.entries, sizeof(size_t) * left.count) == 0;
+    free(left.entries);
+    free(right.entries);
+    return same;
+}
+
+MU_TEST(test_parse_tokens_parallel) {
+    // Enough functions for several ranges per thread, with nested braces to match past
+    char source[8192];
+    size_t used = 0;
+    for (int i = 0; i < 40; i++) {
+        used += (size_t)snprintf(source + used, sizeof(source) - used,
+                                 "int f%d(int a) { if (a < %d) { while (a) { a = a - 1; } } else { return f%d(a - 1); } return a * %d; }\n",
+                                 i, i, i ? i - 1 : 0, i);
+    }
+    Lexer lexer;
+    lexer_init(&lexer, source);
+    TokenBuffer tokens;
+    token_buffer_init(&tokens);
+    token_buffer_fill(&tokens, &lexer);
+
+    ASTNode *serial = parse_tokens(&tokens);
+    mu_assert(serial != NULL, "The serial parse should succeed");
+    size_t threads[] = { 1, 2, 4, 64 };
+    for (size_t i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
+        ASTNode *parallel = parse_tokens_parallel(&tokens, threads[i]);
+        mu_assert(parallel != NULL, "The parallel parse should succeed");
+        mu_assert_int_eq(40, (int)parallel->data.program.count);
+        mu_assert(same_shape(serial, parallel), "Parallel and serial parses should build the same tree");
+        free_ast(parallel);
+    }
+    free_ast(serial);
+    token_buffer_free(&tokens);
+
+    // A syntax error anywhere falls back to the serial parse and its diagnostics
+    memcpy(strstr(source, "return f38") + 7, ")))", 3);
+    lexer_init(&lexer, source);
+    token_buffer_init(&tokens);
+    token_buffer_fill(&tokens, &lexer);
+    mu_assert(parse_tokens_parallel(&tokens, 4) == NULL, "A syntax error should fail the parallel parse");
+    token_buffer_free(&tokens);
+
+    lexer_init(&lexer, "");
+    token_buffer_init(&tokens);
+    token_buffer_fill(&tokens, &lexer);
+    mu_assert(parse_tokens_parallel(&tokens, 4) == NULL, "Empty input has no program");
+    token_buffer_free(&tokens);
+}
+
+// Parses "int main(int x) { return <expression>; }" and returns the returned value
+static ASTNode *parse_return_value(const char *expression, bool fold, ASTNode **program, size_t *folded) {
+    char input[256];
+    snprintf(input, sizeof(input), "int main(int x) { return %s; }", expression);
+    Lexer lexer;
+    lexer_init(&lexer, input);
+    TokenBuffer tokens;
+    token_buffer_init(&tokens);
+    token_buffer_fill(&tokens, &lexer);
+    ParseOptions options = { .fold = fold, .threads = 1 };
+    *program = parse_tokens_with(&tokens, &options);
+    token_buffer_free(&tokens);
+    if (folded) *folded = options.folded;
+    if (!*program) return NULL;
+    return (*program)->data.program.stmts[0]->data.function_decl.body->data.stmt_list.stmts[0]->data.return_stmt.value;
+}
+
+MU_TEST(test_parser_constant_folding) {
+    static const struct {
+        const char *expression;
+        long long value;
+    } folds[] = {
+        { "4 * 8", 32 },
+        { "-(1)", -1 },
+        { "1 + 2 * 3 - 4 / 2 % 3", 5 },
+        { "7 / -2", -3 }, // Division truncates toward zero
+        { "7 % -2", 1 },
+        { "-7 / 2", -3 },
+        { "1 << 30", 1 << 30 },
+        { "-2147483647 - 1", -2147483647LL - 1 },
+        { "!5 + ~0", -1 },
+        { "3 < 4 == 1", 1 },
+        { "0 && f()", 0 }, // The left operand decides; f is never called
+        { "2 || f()", 1 },
+        { "3 && 4", 1 },
+        { "(1, 2)", 2 },
+        { "(6 ^ 3) | (12 & 10)", 13 },
+    };
+    for (size_t i = 0; i < sizeof(folds) / sizeof(folds[0]); i++) {
+        ASTNode *program;
+        ASTNode *value = parse_return_value(folds[i].expression, true, &program, NULL);
+        mu_assert(value != NULL, folds[i].expression);
+        mu_assert(value->type == NODE_LITERAL, folds[i].expression);
+        mu_assert(value->data.literal.value.int_value == folds[i].value, folds[i].expression);
+        free_ast(program);
+    }
+
+    // Left for run time: C gives these no value, or one that depends on the implementation
+    static const struct {
+        const char *expression;
+        int op;
+    } kept[] = {
+        { "2147483647 + 1", TOK_PLUS },
+        { "-2147483647 - 2", TOK_MINUS },
+        { "65536 * 65536", TOK_STAR },
+        { "1 / 0", TOK_SLASH },
+        { "1 % 0", TOK_PERCENT },
+        { "(-2147483647 - 1) / -1", TOK_SLASH },
+        { "1 << 31", TOK_LSHIFT },
+        { "1 << 32", TOK_LSHIFT },
+        { "1 >> -1", TOK_RSHIFT },
+        { "-8 >> 1", TOK_RSHIFT },
+        { "-1 << 1", TOK_LSHIFT },
+        // Only int constants fold; these compare as unsigned in C, which gives 0
+        { "1u - 2 < 0", TOK_LT },
+        { "-1 < 0u", TOK_GT }, // The int constant still moves right: 0u > -1
+        { "2147483648 - 1", TOK_MINUS },
+    };
+    for (size_t i = 0; i < sizeof(kept) / sizeof(kept[0]); i++) {
+        ASTNode *program;
+        ASTNode *value = parse_return_value(kept[i].expression, true, &program, NULL);
+        mu_assert(value != NULL, kept[i].expression);
+        mu_assert(value->type == NODE_BINARY_OP, kept[i].expression);
+        mu_assert(value->data.binary_op.op == kept[i].op, kept[i].expression);
+        free_ast(program);
+    }
+
+    // Without the option every operator keeps its node
+    ASTNode *program;
+    size_t folded;
+    ASTNode *value = parse_return_value("4 * 8 + 0", false, &program, &folded);
+    mu_assert_int_eq(NODE_BINARY_OP, value->type);
+    mu_assert_int_eq(0, (int)folded);
+    free_ast(program);
+    value = parse_return_value("4 * 8 + 0", true, &program, &folded);
+    mu_assert_int_eq(NODE_LITERAL, value->type);
+    mu_assert_int_eq(2, (int)folded);
+    free_ast(program);
+}
+
+MU_TEST(test_parser_literal_types) {
+    static const struct {
+        const char *literal;
+        TypeKind kind;
+    } literals[] = {
+        { "2147483647", TYPE_INT },
+        { "2147483648", TYPE_LONG },
+        { "0x7fffffff", TYPE_INT },
+        { "0x80000000", TYPE_UNSIGNED },
+        { "0x100000000", TYPE_LONG },
+        { "0xFFFFFFFFFFFFFFFF", TYPE_UNSIGNED_LONG },
+        { "18446744073709551615", TYPE_UNSIGNED_LONG_LONG },
+        { "0u", TYPE_UNSIGNED },
+        { "4294967296u", TYPE_UNSIGNED_LONG },
+        { "1l", TYPE_LONG },
+        { "1ul", TYPE_UNSIGNED_LONG },
+        { "1ll", TYPE_LONG_LONG },
+        { "0xFFFFFFFFFFFFFFFFll", TYPE_UNSIGNED_LONG_LONG },
+        { "1ull", TYPE_UNSIGNED_LONG_LONG },
+        { "0", TYPE_INT },
+    };
+    for (size_t i = 0; i < sizeof(literals) / sizeof(literals[0]); i++) {
+        ASTNode *program;
+        ASTNode *value = parse_return_value(literals[i].literal, false, &program, NULL);
+        mu_assert(value != NULL && value->type == NODE_LITERAL, literals[i].literal);
+        mu_assert(value->data.literal.type->kind == literals[i].kind, literals[i].literal);
+        free_ast(program);
+    }
+
+    // All 64 bits are kept; the type says they are unsigned
+    ASTNode *program;
+    ASTNode *value = parse_return_value("0xFFFFFFFFFFFFFFFF", true, &program, NULL);
+    mu_assert((unsigned long long)value->data.literal.value.int_value == 0xFFFFFFFFFFFFFFFFull, "No bits should be lost");
+    free_ast(program);
+    // Folding an unsigned operand with an int one would need the usual arithmetic conversions
+    value = parse_return_value("-1 + 1u", true, &program, NULL);
+    mu_assert_int_eq(NODE_BINARY_OP, value->type);
+    free_ast(program);
+    mu_assert(parse_return_value("5wb", false, &program, NULL) == NULL, "There is no _BitInt to give 5wb");
+}
+
+MU_TEST(test_parser_canonicalization) {
+    ASTNode *program;
+    size_t folded;
+    // Constants move to the right, flipping comparisons
+    ASTNode *value = parse_return_value("1 + x", true, &program, &folded);
+    mu_assert_int_eq(TOK_PLUS, value->data.binary_op.op);
+    mu_assert_int_eq(NODE_VAR_REF, value->data.binary_op.left->type);
+    mu_assert_int_eq(NODE_LITERAL, value->data.binary_op.right->type);
+    mu_assert_int_eq(0, (int)folded);
+    free_ast(program);
+    value = parse_return_value("3 < x", true, &program, NULL);
+    mu_assert_int_eq(TOK_GT, value->data.binary_op.op);
+    mu_assert_int_eq(NODE_VAR_REF, value->data.binary_op.left->type);
+    free_ast(program);
+    value = parse_return_value("1 - x", true, &program, NULL);
+    mu_assert_int_eq(NODE_LITERAL, value->data.binary_op.left->type); // Not commutative
+    free_ast(program);
+
+    // Identities drop the operator, even when the constant is folded first
+    const char *identities[] = { "x + 0", "0 + x", "x * 1", "x - (2 - 2)", "x | 0", "x << 0", "+x", "(x * 1) / 1" };
+    for (size_t i = 0; i < sizeof(identities) / sizeof(identities[0]); i++) {
+        value = parse_return_value(identities[i], true, &program, NULL);
+        mu_assert(value != NULL && value->type == NODE_VAR_REF, identities[i]);
+        free_ast(program);
+    }
+    value = parse_return_value("x * 0", true, &program, NULL);
+    mu_assert_int_eq(NODE_BINARY_OP, value->type); // x is still evaluated
+    free_ast(program);
+
+    // Only when the operand already has the result's type: a char is promoted and an array decays
+    static const struct {
+        const char *source;
+        long long size;
+    } typed[] = {
+        { "int main() { char c; return sizeof(c + 0); }", 4 },
+        { "int main() { char c; return sizeof(+c); }", 4 },
+        { "int main() { char c; return sizeof(c * 1); }", 4 },
+        { "int main() { int arr[4]; return sizeof(arr + 0); }", 8 },
+        { "int main() { int arr[4]; return sizeof(arr - 0); }", 8 },
+        { "int main(int *p) { return sizeof(p + 0); }", 8 },
+        { "int main(int x) { for (char x = 0; x; x++) { return sizeof(x + 0); } return 0; }", 4 },
+    };
+    for (size_t i = 0; i < sizeof(typed) / sizeof(typed[0]); i++) {
+        for (int fold = 0; fold < 2; fold++) {
+            Lexer lexer;
+            lexer_init(&lexer, typed[i].source);
+            TokenBuffer tokens;
+            token_buffer_init(&tokens);
+            token_buffer_fill(&tokens, &lexer);
+            program = parse_tokens_with(&tokens, &(ParseOptions){ .fold = fold, .threads = 1 });
+            token_buffer_free(&tokens);
+            mu_assert(program != NULL, typed[i].source);
+            ASTNode *body = program->data.program.stmts[0]->data.function_decl.body;
+            ASTNode *last = body->data.stmt_list.stmts[body->data.stmt_list.count - 1];
+            if (last->type == NODE_RETURN && last->data.return_stmt.value->type == NODE_LITERAL &&
+                last->data.return_stmt.value->data.literal.value.int_value == 0) {
+                last = body->data.stmt_list.stmts[0]->data.for_stmt.body->data.stmt_list.stmts[0];
+            }
+            ASTNode *size = last->data.return_stmt.value;
+            mu_assert(size->type == NODE_LITERAL && size->data.literal.value.int_value == typed[i].size, typed[i].source);
+            free_ast(program);
+        }
+    }
+    value = parse_return_value("y + 0", true, &program, NULL);
+    mu_assert_int_eq(NODE_BINARY_OP, value->type); // Undeclared, so its type is unknown
+    free_ast(program);
+    value = parse_return_value("x - 0", true, &program, NULL);
+    mu_assert_int_eq(NODE_VAR_REF, value->type); // Parameters are typed too
+    mu_assert(value->data.var_ref.type == type_get(TYPE_INT), "References carry their declared type");
+    free_ast(program);
+
+    // A stripped operand is still not something to assign to
+    ASTNode *statement = parse_first_statement("int main() { (x) = 1; }", &program);
+    mu_assert_int_eq(NODE_ASSIGNMENT, statement->type);
+    free_ast(program);
+    const char *targets[] = { "int main(int x) { (x + 0) = 1; }", "int main(int x) { +x = 1; }",
+                              "int main(int x) { (x * 1) += 1; }" };
+    for (size_t i = 0; i < sizeof(targets) / sizeof(targets[0]); i++) {
+        Lexer lexer;
+        lexer_init(&lexer, targets[i]);
+        TokenBuffer tokens;
+        token_buffer_init(&tokens);
+        token_buffer_fill(&tokens, &lexer);
+        mu_assert(parse_tokens_with(&tokens, &(ParseOptions){ .fold = true, .threads = 1 }) == NULL, targets[i]);
+        token_buffer_free(&tokens);
+    }
+}
+
+MU_TEST(test_parser_folding_options) {
+    char source[4096];
+    size_t used = 0;
+    for (int i = 0; i < 40; i++) {
+        used += (size_t)snprintf(source + used, sizeof(source) - used, "int f%d() { return %d * 2 + 0; }\n", i, i);
+    }
+    Lexer lexer;
+    lexer_init(&lexer, source);
+    TokenBuffer tokens;
+    token_buffer_init(&tokens);
+    token_buffer_fill(&tokens, &lexer);
+
+    // Worker counts add up to the serial one
+    ParseOptions serial = { .fold = true, .threads = 1 };
+    ParseOptions parallel = { .fold = true, .threads = 4 };
+    ASTNode *serial_program = parse_tokens_with(&tokens, &serial);
+    ASTNode *parallel_program = parse_tokens_with(&tokens, &parallel);
+    mu_assert_int_eq(80, (int)serial.folded);
+    mu_assert_int_eq(80, (int)parallel.folded);
+    mu_assert(same_shape(serial_program, parallel_program), "Folding should not depend on threads");
+    free_ast(serial_program);
+    free_ast(parallel_program);
+
+    // Deferred bodies fold when they are parsed
+    ParseOptions lazy = { .lazy = true, .fold = true };
+    ASTNode *program = parse_tokens_with(&tokens, &lazy);
+    mu_assert_int_eq(0, (int)lazy.folded);
+    ASTNode *body = function_body(program->data.program.stmts[7]);
+    mu_assert_int_eq(NODE_LITERAL, body->data.stmt_list.stmts[0]->data.return_stmt.value->type);
+    mu_assert_int_eq(14, (int)body->data.stmt_list.stmts[0]->data.return_stmt.value->data.literal.value.int_value);
+    free_ast(program);
+    token_buffer_free(&tokens);
+}
+
 MU_TEST_SUITE(parser_suite) {
     MU_RUN_TEST(test_parser_simple_program);
     MU_RUN_TEST(test_parser_nested_program);
@@ -951,13 +1655,30 @@ MU_TEST_SUITE(parser_suite) {
     // MU_RUN_TEST(test_parser_array_declaration);
     MU_RUN_TEST(test_parser_logical_operators);
     MU_RUN_TEST(test_parser_equality_operators);
+    MU_RUN_TEST(test_parser_bitwise_precedence);
+    MU_RUN_TEST(test_parser_ternary);
+    MU_RUN_TEST(test_parser_comma_operator);
+    MU_RUN_TEST(test_parser_assignment_operators);
+    MU_RUN_TEST(test_parser_prefix_and_postfix_in_expressions);
+    MU_RUN_TEST(test_parser_deep_nesting);
+    MU_RUN_TEST(test_ast_walk);
+    MU_RUN_TEST(test_parse_tokens_lazy);
+    MU_RUN_TEST(test_parse_tokens_parallel);
+    MU_RUN_TEST(test_parser_constant_folding);
+    MU_RUN_TEST(test_parser_literal_types);
+    MU_RUN_TEST(test_parser_canonicalization);
+    MU_RUN_TEST(test_parser_folding_options);
     // MU_RUN_TEST(test_print_ast);
     // MU_RUN_TEST(test_parser_print_ast_comprehensive);
     MU_RUN_TEST(test_print_ast_simple);
+    MU_RUN_TEST(test_token_buffer_drops_comments);
+    MU_RUN_TEST(test_parse_tokens_reuses_buffer);
+    MU_RUN_TEST(test_token_buffer_literals);
+    MU_RUN_TEST(test_parse_wide_integer_literal);
 }
 
 int main() {
     MU_RUN_SUITE(parser_suite);
     MU_REPORT();
     return MU_EXIT_CODE;
-}
\ No newline at end of file
+}
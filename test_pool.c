@@ -0,0 +1,97 @@
+#include "pool.h"
+#include "intern.h"
+#include "minunit.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+static atomic_int counter;
+
+static void increment_task(void *arg) {
+    (void)arg;
+    atomic_fetch_add(&counter, 1);
+}
+
+static void record_task(void *arg) {
+    int *slot = arg;
+    *slot = 1;
+}
+
+MU_TEST(test_pool_runs_every_task) {
+    atomic_store(&counter, 0);
+    ThreadPool *pool = pool_create(4);
+    mu_assert_int_eq(4, (int)pool_thread_count(pool));
+    for (int i = 0; i < 1000; i++) {
+        pool_submit(pool, increment_task, NULL);
+    }
+    pool_wait(pool);
+    mu_assert_int_eq(1000, atomic_load(&counter));
+
+    // The pool stays usable after a wait
+    for (int i = 0; i < 10; i++) {
+        pool_submit(pool, increment_task, NULL);
+    }
+    pool_destroy(pool);
+    mu_assert_int_eq(1010, atomic_load(&counter));
+}
+
+MU_TEST(test_pool_task_arguments) {
+    int done[64] = {0};
+    ThreadPool *pool = pool_create(3);
+    for (int i = 0; i < 64; i++) {
+        pool_submit(pool, record_task, &done[i]);
+    }
+    pool_destroy(pool);
+    for (int i = 0; i < 64; i++) {
+        mu_assert_int_eq(1, done[i]);
+    }
+}
+
+MU_TEST(test_pool_default_thread_count) {
+    ThreadPool *pool = pool_create(0);
+    mu_assert(pool_thread_count(pool) >= 1, "Default pool should have at least one worker");
+    pool_destroy(pool);
+}
+
+// Every thread interns the same names; all of them must agree on the Symbols
+#define INTERN_THREAD_NAMES 2000
+static Symbol interned[8][INTERN_THREAD_NAMES];
+
+static void intern_task(void *arg) {
+    Symbol *out = arg;
+    char buffer[32];
+    for (int i = 0; i < INTERN_THREAD_NAMES; i++) {
+        int len = snprintf(buffer, sizeof(buffer), "name_%d", i);
+        out[i] = intern(buffer, (size_t)len);
+    }
+}
+
+MU_TEST(test_pool_concurrent_interning) {
+    ThreadPool *pool = pool_create(8);
+    for (int t = 0; t < 8; t++) {
+        pool_submit(pool, intern_task, interned[t]);
+    }
+    pool_destroy(pool);
+
+    char buffer[32];
+    for (int i = 0; i < INTERN_THREAD_NAMES; i++) {
+        snprintf(buffer, sizeof(buffer), "name_%d", i);
+        mu_assert_string_eq(buffer, symbol_name(interned[0][i]));
+        for (int t = 1; t < 8; t++) {
+            mu_assert(interned[t][i] == interned[0][i], "Threads should agree on interned symbols");
+        }
+    }
+}
+
+MU_TEST_SUITE(pool_suite) {
+    MU_RUN_TEST(test_pool_runs_every_task);
+    MU_RUN_TEST(test_pool_task_arguments);
+    MU_RUN_TEST(test_pool_default_thread_count);
+    MU_RUN_TEST(test_pool_concurrent_interning);
+}
+
+int main() {
+    MU_RUN_SUITE(pool_suite);
+    MU_REPORT();
+    return MU_EXIT_CODE;
+}
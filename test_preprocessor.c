@@ -0,0 +1,265 @@
+#include "preprocessor.h"
+#include "parser.h"
+#include "ast.h"
+#include "minunit.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static char flattened[4096];
+
+// Output text with every run of whitespace collapsed to one space, for comparisons
+static const char *flatten(const char *text) {
+    size_t length = 0;
+    bool space = false;
+    for (const char *p = text; *p && length + 2 < sizeof(flattened); p++) {
+        if (*p == ' ' || *p == '\n' || *p == '\t') {
+            space = length > 0;
+            continue;
+        }
+        if (space) flattened[length++] = ' ';
+        space = false;
+        flattened[length++] = *p;
+    }
+    flattened[length] = '\0';
+    return flattened;
+}
+
+static bool run_preprocessor(const char *source, const char **output) {
+    Preprocessor *pp = preprocessor_create();
+    TokenBuffer tokens;
+    token_buffer_init(&tokens);
+    bool ok = preprocess_source(pp, source, "test.c", &tokens);
+    *output = flatten(preprocessor_output(pp));
+    token_buffer_free(&tokens);
+    preprocessor_destroy(pp);
+    return ok;
+}
+
+static void write_file(const char *path, const char *text) {
+    FILE *file = fopen(path, "w");
+    fputs(text, file);
+    fclose(file);
+}
+
+MU_TEST(test_object_macros) {
+    const char *output;
+    mu_assert(run_preprocessor("#define N 10\n"
+                               "#define TWICE N + N\n"
+                               "int x = TWICE;\n"
+                               "#undef N\n"
+                               "int y = N;\n", &output), "Should preprocess");
+    mu_assert_string_eq("int x = 10 + 10 ; int y = N ;", output);
+
+    // A macro is not expanded again inside its own expansion
+    mu_assert(run_preprocessor("#define foo foo + 1\n"
+                               "#define a b\n"
+                               "#define b a\n"
+                               "foo a b\n", &output), "Should preprocess");
+    mu_assert_string_eq("foo + 1 a b", output);
+}
+
+MU_TEST(test_function_macros) {
+    const char *output;
+    mu_assert(run_preprocessor("#define MAX(a, b) ((a) > (b) ? (a) : (b))\n"
+                               "#define SQUARE(x) MAX(x, x) * x\n"
+                               "int m = MAX(1, f(2, 3));\n"
+                               "int s = SQUARE(y);\n"
+                               "int MAX = 1;\n", &output), "Should preprocess");
+    mu_assert_string_eq("int m = ( ( 1 ) > ( f ( 2 , 3 ) ) ? ( 1 ) : ( f ( 2 , 3 ) ) ) ; "
+                        "int s = ( ( y ) > ( y ) ? ( y ) : ( y ) ) * y ; "
+                        "int MAX = 1 ;", output);
+
+    // Arguments are expanded before substitution, but not for # and ##
+    mu_assert(run_preprocessor("#define STR(x) #x\n"
+                               "#define XSTR(x) STR(x)\n"
+                               "#define CAT(a, b) a ## b\n"
+                               "#define V 42\n"
+                               "STR(V) XSTR(V) CAT(x, 1) CAT(V, 0) CAT(, y) STR(\"q\" a  +  b)\n", &output), "Should preprocess");
+    mu_assert_string_eq("\"V\" \"42\" x1 V0 y \"\\\"q\\\" a + b\"", output);
+
+    // f(x) without parentheses is just the name
+    mu_assert(run_preprocessor("#define f(x) x\nint f;\n", &output), "Should preprocess");
+    mu_assert_string_eq("int f ;", output);
+}
+
+MU_TEST(test_variadic_macros) {
+    const char *output;
+    mu_assert(run_preprocessor("#define LOG(fmt, ...) printf(fmt, ##__VA_ARGS__)\n"
+                               "#define CALL(f, ...) f(__VA_ARGS__)\n"
+                               "#define OPT(a, ...) g(a __VA_OPT__(,) __VA_ARGS__)\n"
+                               "LOG(\"a\"); LOG(\"b\", 1, 2); CALL(h); CALL(h, 1, (2, 3)); OPT(1); OPT(1, 2);\n", &output),
+              "Should preprocess");
+    mu_assert_string_eq("printf ( \"a\" ) ; printf ( \"b\" , 1 , 2 ) ; h ( ) ; h ( 1 , ( 2 , 3 ) ) ; g ( 1 ) ; g ( 1 , 2 ) ;", output);
+}
+
+MU_TEST(test_conditionals) {
+    const char *output;
+    mu_assert(run_preprocessor("#define A 2\n"
+                               "#if A * 3 == 6 && defined(A) && !defined B\n"
+                               "yes1\n"
+                               "#else\n"
+                               "no1\n"
+                               "#endif\n"
+                               "#if 0\n"
+                               "#if 1\n"
+                               "nested\n"
+                               "#endif\n"
+                               "#elif A > 1\n"
+                               "yes2\n"
+                               "#elif 1\n"
+                               "no2\n"
+                               "#endif\n"
+                               "#ifdef B\n"
+                               "no3\n"
+                               "#elifndef B\n"
+                               "yes3\n"
+                               "#endif\n"
+                               "#if -1 > 0u && (0 || 1 / 1) && (1 ? 2 : 1 / 0) == 2 && 'a' == 97 && 0x10 == 16 && (1 << 4) == 16\n"
+                               "yes4\n"
+                               "#endif\n"
+                               "#if UNDEFINED_NAME || 0 && 1 / 0\n"
+                               "no4\n"
+                               "#endif\n", &output), "Should preprocess");
+    mu_assert_string_eq("yes1 yes2 yes3 yes4", output);
+}
+
+MU_TEST(test_directive_errors) {
+    const char *output;
+    mu_assert(!run_preprocessor("#error stop here\nint x;\n", &output), "#error should fail");
+    mu_assert(!run_preprocessor("#if 1\nint x;\n", &output), "Unterminated #if should fail");
+    mu_assert(!run_preprocessor("#endif\n", &output), "Stray #endif should fail");
+    mu_assert(!run_preprocessor("#define F(a) a\nF(1, 2)\n", &output), "Wrong argument count should fail");
+    mu_assert(!run_preprocessor("#include \"does_not_exist.h\"\n", &output), "Missing include should fail");
+    mu_assert(!run_preprocessor("#if 1 / 0\n#endif\n", &output), "Division by zero should fail");
+}
+
+MU_TEST(test_builtin_macros) {
+    const char *output;
+    mu_assert(run_preprocessor("int a = __LINE__;\n\nint b = __LINE__; char *f = __FILE__;\n"
+                               "#if __STDC_VERSION__ >= 201112L\nc11\n#endif\n", &output), "Should preprocess");
+    mu_assert_string_eq("int a = 1 ; int b = 3 ; char * f = \"test.c\" ; c11", output);
+}
+
+MU_TEST(test_line_continuation_and_comments) {
+    const char *output;
+    mu_assert(run_preprocessor("#define SUM(a, b) \\\n    ((a) + \\\n     (b))\n"
+                               "#define X 1 /* spans\n lines */ + 2\n"
+                               "int s = SUM(1, 2) + X;\n", &output), "Should preprocess");
+    mu_assert_string_eq("int s = ( ( 1 ) + ( 2 ) ) + 1 + 2 ;", output);
+}
+
+MU_TEST(test_include_guard_and_cache) {
+    mkdir("pp_test_dir", 0755);
+    mkdir("pp_test_dir/sub", 0755);
+    write_file("pp_test_dir/guarded.h", "#ifndef GUARDED_H\n#define GUARDED_H\nint guarded;\n#endif\n");
+    write_file("pp_test_dir/once.h", "#pragma once\nint once;\n");
+    write_file("pp_test_dir/plain.h", "int plain;\n");
+    write_file("pp_test_dir/sub/nested.h", "#include \"../plain.h\"\n");
+    write_file("pp_test_dir/main.c",
+               "#include \"guarded.h\"\n#include \"guarded.h\"\n"
+               "#include <once.h>\n#include \"once.h\"\n"
+               "#include \"plain.h\"\n#include \"sub/nested.h\"\n"
+               "#define HEADER \"guarded.h\"\n#include HEADER\n");
+    preprocessor_cache_reset();
+
+    Preprocessor *pp = preprocessor_create();
+    preprocessor_add_include_path(pp, "pp_test_dir");
+    TokenBuffer tokens;
+    token_buffer_init(&tokens);
+    mu_assert(preprocess_file(pp, "pp_test_dir/main.c", &tokens), "Should preprocess");
+    mu_assert_string_eq("int guarded ; int once ; int plain ; int plain ;", flatten(preprocessor_output(pp)));
+    PreprocessorStats stats = preprocessor_stats(pp);
+    mu_assert_int_eq(4, (int)stats.files_loaded);  // Each header is read once
+    mu_assert_int_eq(3, (int)stats.guard_skips);   // Two repeated guards, one repeated #pragma once
+    token_buffer_free(&tokens);
+    preprocessor_destroy(pp);
+
+    // A second translation unit reuses the tokenized headers without touching the disk
+    pp = preprocessor_create();
+    preprocessor_add_include_path(pp, "pp_test_dir");
+    token_buffer_init(&tokens);
+    mu_assert(preprocess_file(pp, "pp_test_dir/main.c", &tokens), "Should preprocess again");
+    mu_assert_string_eq("int guarded ; int once ; int plain ; int plain ;", flatten(preprocessor_output(pp)));
+    stats = preprocessor_stats(pp);
+    mu_assert_int_eq(0, (int)stats.files_loaded);
+    mu_assert(stats.cache_hits >= 4, "Headers should come from the cache");
+    token_buffer_free(&tokens);
+    preprocessor_destroy(pp);
+    preprocessor_cache_reset();
+
+    remove("pp_test_dir/sub/nested.h");
+    remove("pp_test_dir/main.c");
+    remove("pp_test_dir/plain.h");
+    remove("pp_test_dir/once.h");
+    remove("pp_test_dir/guarded.h");
+    rmdir("pp_test_dir/sub");
+    rmdir("pp_test_dir");
+}
+
+MU_TEST(test_command_line_defines) {
+    Preprocessor *pp = preprocessor_create();
+    preprocessor_define(pp, "SIZE", "4");
+    preprocessor_define(pp, "ENABLED", NULL);
+    preprocessor_define(pp, "ADD(a,b)", "a+b");
+    TokenBuffer tokens;
+    token_buffer_init(&tokens);
+    mu_assert(preprocess_source(pp, "#if ENABLED\nint x = ADD(SIZE, 1);\n#endif\n", "test.c", &tokens), "Should preprocess");
+    mu_assert_string_eq("int x = 4 + 1 ;", flatten(preprocessor_output(pp)));
+    token_buffer_free(&tokens);
+    preprocessor_destroy(pp);
+}
+
+// The parser reads the preprocessed buffer directly, literal values included
+MU_TEST(test_parse_preprocessed_tokens) {
+    const char *source = "#define LIMIT 0x10\n"
+                         "#define CLAMP(v) ((v) > LIMIT ? LIMIT : (v))\n"
+                         "int main() {\n"
+                         "    int x = LIMIT + 1;\n"
+                         "    return x;\n"
+                         "}\n";
+    Preprocessor *pp = preprocessor_create();
+    TokenBuffer tokens;
+    token_buffer_init(&tokens);
+    mu_assert(preprocess_source(pp, source, "test.c", &tokens), "Should preprocess");
+    mu_assert_int_eq(2, (int)tokens.literal_count);
+    mu_assert(tokens.literals[0].value.integer == 16, "Literal values should survive expansion");
+
+    // Main-file tokens keep their lines in the output
+    LineTable lines;
+    line_table_init(&lines, tokens.source);
+    SourceLocation location = line_table_locate(&lines, tokens.tokens[0].offset);
+    mu_assert_int_eq(3, (int)location.line);
+    line_table_free(&lines);
+
+    ASTNode *program = parse_tokens(&tokens);
+    mu_assert(program != NULL, "Preprocessed tokens should parse");
+    ASTNode *body = program->data.program.stmts[0]->data.function_decl.body;
+    ASTNode *init = body->data.stmt_list.stmts[0]->data.var_decl.init_value;
+    mu_assert_int_eq(NODE_BINARY_OP, init->type);
+    mu_assert_int_eq(16, (int)init->data.binary_op.left->data.literal.value.int_value);
+    free_ast(program);
+    token_buffer_free(&tokens);
+    preprocessor_destroy(pp);
+}
+
+MU_TEST_SUITE(preprocessor_suite) {
+    MU_RUN_TEST(test_object_macros);
+    MU_RUN_TEST(test_function_macros);
+    MU_RUN_TEST(test_variadic_macros);
+    MU_RUN_TEST(test_conditionals);
+    MU_RUN_TEST(test_directive_errors);
+    MU_RUN_TEST(test_builtin_macros);
+    MU_RUN_TEST(test_line_continuation_and_comments);
+    MU_RUN_TEST(test_include_guard_and_cache);
+    MU_RUN_TEST(test_command_line_defines);
+    MU_RUN_TEST(test_parse_preprocessed_tokens);
+}
+
+int main() {
+    MU_RUN_SUITE(preprocessor_suite);
+    MU_REPORT();
+    return MU_EXIT_CODE;
+}
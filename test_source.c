@@ -0,0 +1,110 @@
+#include "source.h"
+#include "lexer.h"
+#include "minunit.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static void write_file(const char *path, const char *data, size_t length) {
+    FILE *file = fopen(path, "wb");
+    fwrite(data, 1, length, file);
+    fclose(file);
+}
+
+MU_TEST(test_source_maps_regular_file) {
+    const char *path = "test_source_input.c";
+    const char *code = "int main() { return 42; }";
+    write_file(path, code, strlen(code));
+
+    SourceFile source;
+    mu_assert(source_open(&source, path), "Regular file should open");
+    mu_assert(source.mapping != NULL, "Regular file should be mapped, not copied");
+    mu_assert_int_eq((int)strlen(code), (int)source.length);
+    mu_assert(memcmp(source.text, code, source.length) == 0, "Mapped text should match the file");
+    mu_assert(source.text[source.length] == '\0', "Mapping should end in a NUL");
+
+    // Tokens reference the mapping directly
+    Lexer lexer;
+    lexer_init(&lexer, source.text);
+    Token token = next_token(&lexer);
+    mu_assert(token.text == source.text, "Token text should point into the mapping");
+
+    source_close(&source);
+    mu_assert(source.text == NULL, "Closing should clear the source");
+    remove(path);
+}
+
+MU_TEST(test_source_page_sized_file) {
+    // A file that fills its last page exactly has no zero tail of its own
+    const char *path = "test_source_page.c";
+    size_t length = (size_t)sysconf(_SC_PAGESIZE) * 2;
+    char *data = malloc(length);
+    memset(data, ' ', length);
+    memcpy(data + length - 2, "x;", 2);
+    write_file(path, data, length);
+
+    SourceFile source;
+    mu_assert(source_open(&source, path), "Page-sized file should open");
+    mu_assert(source.mapping != NULL, "Page-sized file should be mapped");
+    mu_assert_int_eq((int)length, (int)source.length);
+    mu_assert(source.text[length] == '\0', "NUL sentinel should follow a page-sized file");
+
+    // The lexer's block scanners read up to the sentinel without faulting
+    Lexer lexer;
+    lexer_init(&lexer, source.text);
+    mu_assert_int_eq(TOK_IDENTIFIER, next_token(&lexer).type);
+    mu_assert_int_eq(TOK_SEMICOLON, next_token(&lexer).type);
+    mu_assert_int_eq(TOK_EOF, next_token(&lexer).type);
+
+    source_close(&source);
+    free(data);
+    remove(path);
+}
+
+MU_TEST(test_source_empty_file) {
+    const char *path = "test_source_empty.c";
+    write_file(path, "", 0);
+
+    SourceFile source;
+    mu_assert(source_open(&source, path), "Empty file should open");
+    mu_assert_int_eq(0, (int)source.length);
+    mu_assert(source.text[0] == '\0', "Empty file should give an empty string");
+    source_close(&source);
+    remove(path);
+}
+
+MU_TEST(test_source_reads_pipe) {
+    int fds[2];
+    mu_assert(pipe(fds) == 0, "pipe() should succeed");
+    const char *code = "int x = 1;\n";
+    mu_assert(write(fds[1], code, strlen(code)) == (ssize_t)strlen(code), "Write to pipe should succeed");
+    close(fds[1]);
+
+    SourceFile source;
+    mu_assert(source_open_fd(&source, fds[0]), "Pipe should be read");
+    mu_assert(source.mapping == NULL, "Pipes cannot be mapped");
+    mu_assert_string_eq(code, source.text);
+    mu_assert_int_eq((int)strlen(code), (int)source.length);
+    source_close(&source);
+    close(fds[0]);
+}
+
+MU_TEST(test_source_missing_file) {
+    SourceFile source;
+    mu_assert(!source_open(&source, "test_source_does_not_exist.c"), "Missing file should fail to open");
+}
+
+MU_TEST_SUITE(source_suite) {
+    MU_RUN_TEST(test_source_maps_regular_file);
+    MU_RUN_TEST(test_source_page_sized_file);
+    MU_RUN_TEST(test_source_empty_file);
+    MU_RUN_TEST(test_source_reads_pipe);
+    MU_RUN_TEST(test_source_missing_file);
+}
+
+int main() {
+    MU_RUN_SUITE(source_suite);
+    MU_REPORT();
+    return MU_EXIT_CODE;
+}
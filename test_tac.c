@@ -32,6 +32,21 @@ MU_TEST(test_tac_with_phi_function_ssa) {
     create_tac(cfg);
     convert_to_ssa(cfg);
 
+    // Phi operands are stored per predecessor slot
+    BasicBlock *join = cfg->blocks[5];
+    mu_assert_int_eq(2, (int)join->pred_count);
+    bool found_phi = false;
+    TAC_FOREACH(join, t) {
+        if (t->opcode != TAC_PHI) continue;
+        found_phi = true;
+        Operand *args = tac_phi_args(join, t);
+        mu_assert_int_eq(OPERAND_VAR, args[0].kind);
+        mu_assert_int_eq(OPERAND_VAR, args[1].kind);
+        mu_assert_string_eq("x_1", symbol_name(args[0].var));
+        mu_assert_string_eq("x_2", symbol_name(args[1].var));
+    }
+    mu_assert(found_phi, "Join block should contain a phi");
+
     // Check TAC output against expected canonical SSA form
     const char *expected_output =
         "# BasicBlock 0 (Entry Block)\n"
@@ -95,7 +110,7 @@ MU_TEST(test_tac_with_phi_function_ssa) {
         }
         mu_assert(strcmp(expected_line, actual_line) == 0, "TAC output mismatch");
     }
-    for (size_t i = 0; i < cfg->block_count; ++i) free_tac(cfg->blocks[i]->tac_head);
+    for (size_t i = 0; i < cfg->block_count; ++i) free_tac(cfg->blocks[i]);
     free_cfg(cfg); free_ast(ast);
 }
 
@@ -152,7 +167,7 @@ MU_TEST(test_tac_arithmetic_precedence_ssa) {
         mu_assert(strcmp(expected_line, actual_line) == 0, "TAC output mismatch");
     }
 
-    for (size_t i = 0; i < cfg->block_count; ++i) free_tac(cfg->blocks[i]->tac_head);
+    for (size_t i = 0; i < cfg->block_count; ++i) free_tac(cfg->blocks[i]);
     free_cfg(cfg); free_ast(ast);
 }
 
@@ -223,7 +238,7 @@ MU_TEST(test_tac_while_loop_ssa) {
         }
         mu_assert(strcmp(expected_line, actual_line) == 0, "TAC output mismatch");
     }
-    for (size_t i = 0; i < cfg->block_count; ++i) free_tac(cfg->blocks[i]->tac_head);
+    for (size_t i = 0; i < cfg->block_count; ++i) free_tac(cfg->blocks[i]);
     free_cfg(cfg); free_ast(ast);
 }
 
@@ -298,7 +313,7 @@ MU_TEST(test_tac_for_loop_ssa) {
         }
         mu_assert(strcmp(expected_line, actual_line) == 0, "TAC output mismatch");
     }
-    for (size_t i = 0; i < cfg->block_count; ++i) free_tac(cfg->blocks[i]->tac_head);
+    for (size_t i = 0; i < cfg->block_count; ++i) free_tac(cfg->blocks[i]);
     free_cfg(cfg); free_ast(ast);
 }
 
@@ -342,7 +357,8 @@ MU_TEST(test_tac_dangling_else_ssa) {
         "\n"
         "# BasicBlock 5 (Normal Block)\n"
         "L60:\n"
-        "return x_0\n"
+        "x_4 = phi(x_3,x_0)\n"
+        "return x_4\n"
         "goto L56\n"
         "\n"
         "# BasicBlock 6 (If-Then Block)\n"
@@ -383,7 +399,7 @@ MU_TEST(test_tac_dangling_else_ssa) {
         }
         mu_assert(strcmp(expected_line, actual_line) == 0, "TAC output mismatch");
     }
-    for (size_t i = 0; i < cfg->block_count; ++i) free_tac(cfg->blocks[i]->tac_head);
+    for (size_t i = 0; i < cfg->block_count; ++i) free_tac(cfg->blocks[i]);
     free_cfg(cfg); free_ast(ast);
 }
 
@@ -549,7 +565,7 @@ MU_TEST(test_tac_with_phi_function) {
         mu_assert(strcmp(expected_line, actual_line) == 0, "TAC output mismatch");
     }
 
-    for (size_t i = 0; i < cfg->block_count; ++i) free_tac(cfg->blocks[i]->tac_head);
+    for (size_t i = 0; i < cfg->block_count; ++i) free_tac(cfg->blocks[i]);
     free_cfg(cfg);
     free_ast(ast);
 }
@@ -629,7 +645,7 @@ MU_TEST(test_tac_arithmetic_precedence) {
         mu_assert(strcmp(expected_line, actual_line) == 0, "TAC output mismatch");
     }
 
-    for (size_t i = 0; i < cfg->block_count; ++i) free_tac(cfg->blocks[i]->tac_head);
+    for (size_t i = 0; i < cfg->block_count; ++i) free_tac(cfg->blocks[i]);
     free_cfg(cfg);
     free_ast(ast);
 }
@@ -724,7 +740,7 @@ print_cfg(cfg, stdout);
         mu_assert(strcmp(expected_line, actual_line) == 0, "TAC output mismatch");
     }
 
-    for (size_t i = 0; i < cfg->block_count; ++i) free_tac(cfg->blocks[i]->tac_head);
+    for (size_t i = 0; i < cfg->block_count; ++i) free_tac(cfg->blocks[i]);
     free_cfg(cfg);
     free_ast(ast);
 }
@@ -818,7 +834,7 @@ MU_TEST(test_tac_for_loop) {
         mu_assert(strcmp(expected_line, actual_line) == 0, "TAC output mismatch");
     }
 
-    for (size_t i = 0; i < cfg->block_count; ++i) free_tac(cfg->blocks[i]->tac_head);
+    for (size_t i = 0; i < cfg->block_count; ++i) free_tac(cfg->blocks[i]);
     free_cfg(cfg);
     free_ast(ast);
 }
@@ -884,6 +900,7 @@ MU_TEST(test_tac_dangling_else) {
         "\n"
         "# BasicBlock 5 (Normal Block)\n"
         "L26:\n"
+        "x = phi(...)\n"
         "return x\n"
         "goto L22\n"
         "\n"
@@ -926,7 +943,7 @@ MU_TEST(test_tac_dangling_else) {
         mu_assert(strcmp(expected_line, actual_line) == 0, "TAC output mismatch");
     }
 
-    for (size_t i = 0; i < cfg->block_count; ++i) free_tac(cfg->blocks[i]->tac_head);
+    for (size_t i = 0; i < cfg->block_count; ++i) free_tac(cfg->blocks[i]);
     free_cfg(cfg);
     free_ast(ast);
 }
@@ -1007,11 +1024,123 @@ MU_TEST(test_tac_function_call) {
         mu_assert(strcmp(expected_line, actual_line) == 0, "TAC output mismatch");
     }
 
-    for (size_t i = 0; i < cfg->block_count; ++i) free_tac(cfg->blocks[i]->tac_head);
+    for (size_t i = 0; i < cfg->block_count; ++i) free_tac(cfg->blocks[i]);
     free_cfg(cfg);
     free_ast(ast);
 }
 
+MU_TEST(test_tac_array_editing) {
+    BasicBlock block = {0};
+    for (int i = 0; i < 40; i++) {
+        tac_append(&block, (TAC){ .opcode = TAC_ASSIGN, .dst = var_operand(intern_cstr("x")), .src1 = const_operand(i) });
+    }
+    mu_assert_int_eq(40, (int)block.tac_count);
+    mu_assert(block.tac_capacity >= 40, "TAC array should grow to fit every instruction");
+
+    TAC *label = tac_insert(&block, 0, (TAC){ .opcode = TAC_LABEL, .dst = label_operand(7) });
+    mu_assert(label == &block.tac[0], "Insert should return the slot it filled");
+    mu_assert_int_eq(TAC_LABEL, block.tac[0].opcode);
+    mu_assert_int_eq(0, block.tac[1].src1.constant);
+
+    tac_remove(&block, 1);
+    mu_assert_int_eq(40, (int)block.tac_count);
+    mu_assert_int_eq(1, block.tac[1].src1.constant);
+    mu_assert_int_eq(39, tac_last(&block)->src1.constant);
+
+    int visited = 0;
+    TAC_FOREACH(&block, t) visited++;
+    mu_assert_int_eq(40, visited);
+
+    char actual_output[64] = {0};
+    FILE *output_stream = fmemopen(actual_output, sizeof(actual_output), "w");
+    block.tac_count = 2;
+    print_tac_bb(&block, output_stream); fclose(output_stream);
+    mu_assert_string_eq("L7:\nx = 1\n", actual_output);
+
+    free_tac(&block);
+    mu_assert(block.tac == NULL && block.tac_count == 0, "free_tac should reset the block");
+}
+
+MU_TEST(test_tac_function_contexts) {
+    const char *input = "int f(int a) { int x = 0; x = a + 1; return x; }\n"
+                        "int g(int b) { int y = 0; y = b * 2; if (y > 3) { y = y - 1; } return y; }";
+    Lexer lexer;
+    lexer_init(&lexer, input);
+    ASTNode *ast = parse(&lexer);
+    mu_assert(ast != NULL, "AST should not be NULL");
+    Module *module = ast_to_module(ast);
+    mu_assert(module != NULL, "Module should not be NULL");
+    mu_assert_int_eq(2, (int)module->function_count);
+
+    // Convert g before f: with disjoint label bases the result does not depend on order
+    TACContext contexts[2];
+    int label_base = 100;
+    for (size_t i = 0; i < 2; i++) {
+        tac_context_init(&contexts[i], label_base);
+        label_base += (int)module->functions[i]->block_count;
+    }
+    for (size_t n = 2; n-- > 0;) {
+        CFG *cfg = module->functions[n];
+        compute_dominator_tree(cfg); compute_dominance_frontiers(cfg); insert_phi_functions(cfg);
+        create_tac_with(cfg, &contexts[n]);
+        convert_to_ssa(cfg);
+    }
+
+    CFG *f = module->functions[0];
+    CFG *g = module->functions[1];
+    mu_assert_int_eq(100 + (int)f->block_count, contexts[0].next_label);
+    mu_assert_int_eq(label_base, contexts[1].next_label);
+    mu_assert_int_eq(100, f->entry->tac[0].dst.label);
+    mu_assert_int_eq(100 + (int)f->block_count, g->entry->tac[0].dst.label);
+
+    // Temporaries restart in every function
+    mu_assert_int_eq(1, contexts[0].next_temp);
+    mu_assert_int_eq(3, contexts[1].next_temp);
+    TAC *first = NULL;
+    TAC_FOREACH(g->blocks[2], t) {
+        if (t->opcode == TAC_BINARY_OP) { first = t; break; }
+    }
+    mu_assert(first != NULL, "g should start with a binary operation");
+    mu_assert_string_eq("t0_0", symbol_name(first->dst.var));
+
+    // A per-function entry block jumps into its body rather than calling main
+    mu_assert_int_eq(TAC_GOTO, tac_last(f->entry)->opcode);
+
+    free_module(module);
+    free_ast(ast);
+}
+
+MU_TEST(test_tac_wide_constants) {
+    const char *input = "int main() { int x = 4294967297; return x; }";
+    Lexer lexer;
+    lexer_init(&lexer, input);
+    ASTNode *ast = parse(&lexer);
+    mu_assert(ast != NULL, "AST should not be NULL");
+    Module *module = ast_to_module(ast);
+    mu_assert(module != NULL, "Module should not be NULL");
+    CFG *cfg = module->functions[0];
+    TACContext context;
+    tac_context_init(&context, 0);
+    create_tac_with(cfg, &context);
+
+    // Constants above INT32_MAX keep their value rather than wrapping
+    TAC *assign = NULL;
+    TAC_FOREACH(cfg->blocks[2], t) {
+        if (t->opcode == TAC_ASSIGN && t->src1.kind == OPERAND_CONST) { assign = t; break; }
+    }
+    mu_assert(assign != NULL, "x should be assigned a constant");
+    mu_assert(assign->src1.constant == 4294967297LL, "The constant should not be truncated to 32 bits");
+
+    char output[256] = {0};
+    FILE *stream = fmemopen(output, sizeof(output), "w");
+    print_tac_bb(cfg->blocks[2], stream);
+    fclose(stream);
+    mu_assert(strstr(output, "x = 4294967297\n") != NULL, "The constant should print in full");
+
+    free_module(module);
+    free_ast(ast);
+}
+
 MU_TEST_SUITE(tac_suite) {
     MU_RUN_TEST(test_tac_with_phi_function);
     MU_RUN_TEST(test_tac_arithmetic_precedence);
@@ -1025,6 +1154,9 @@ MU_TEST_SUITE(tac_suite) {
     MU_RUN_TEST(test_tac_for_loop_ssa);
     MU_RUN_TEST(test_tac_dangling_else_ssa);
     MU_RUN_TEST(test_tac_function_call_ssa);
+    MU_RUN_TEST(test_tac_array_editing);
+    MU_RUN_TEST(test_tac_function_contexts);
+    MU_RUN_TEST(test_tac_wide_constants);
 }
 
 int main(int argc, char **argv) {
@@ -0,0 +1,59 @@
+#include "type.h"
+#include "minunit.h"
+
+MU_TEST(test_type_primitives_are_canonical) {
+    Type *a = type_get(TYPE_INT);
+    Type *b = type_get(TYPE_INT);
+    mu_assert(a == b, "int should be a single canonical type");
+    mu_assert(type_get(TYPE_CHAR) != a, "char and int should be distinct");
+    mu_assert_int_eq(TYPE_INT, a->kind);
+    mu_assert(a->base == NULL, "Primitive types have no base");
+}
+
+MU_TEST(test_type_derived_are_canonical) {
+    Type *int_ptr = type_pointer(type_get(TYPE_INT));
+    mu_assert(int_ptr == type_pointer(type_get(TYPE_INT)), "int* should be canonical");
+    mu_assert(type_pointer(int_ptr) == type_pointer(type_pointer(type_get(TYPE_INT))), "int** should be canonical");
+    mu_assert(int_ptr != type_pointer(type_get(TYPE_CHAR)), "int* and char* should differ");
+
+    Type *arr = type_array(type_get(TYPE_CHAR), 16);
+    mu_assert(type_equal(arr, type_array(type_get(TYPE_CHAR), 16)), "char[16] should be canonical");
+    mu_assert(arr != type_array(type_get(TYPE_CHAR), 8), "Array sizes should distinguish types");
+    mu_assert_int_eq(16, (int)arr->array_size);
+    mu_assert(arr->base == type_get(TYPE_CHAR), "Array base should be the canonical element type");
+}
+
+MU_TEST(test_type_size) {
+    Type *int_type = type_get(TYPE_INT);
+    mu_assert_int_eq(4, (int)type_size(int_type));
+    mu_assert_int_eq(1, (int)type_size(type_get(TYPE_CHAR)));
+    mu_assert_int_eq(8, (int)type_size(type_pointer(type_get(TYPE_CHAR))));
+    mu_assert_int_eq(40, (int)type_size(type_array(int_type, 10)));
+    mu_assert_int_eq(24, (int)type_size(type_array(type_array(type_get(TYPE_CHAR), 3), 8)));
+    mu_assert_int_eq(0, (int)type_size(type_get(TYPE_VOID)));
+    mu_assert_int_eq(0, (int)type_size(type_array(int_type, 0)));
+}
+
+MU_TEST(test_type_table_growth) {
+    type_reset();
+    Type *t = type_get(TYPE_INT);
+    for (size_t i = 0; i < 500; i++) {
+        mu_assert(type_array(t, i) == type_array(t, i), "Types should stay canonical as the table grows");
+    }
+    mu_assert_int_eq(501, (int)type_count());
+    type_reset();
+    mu_assert_int_eq(0, (int)type_count());
+}
+
+MU_TEST_SUITE(type_suite) {
+    MU_RUN_TEST(test_type_primitives_are_canonical);
+    MU_RUN_TEST(test_type_derived_are_canonical);
+    MU_RUN_TEST(test_type_size);
+    MU_RUN_TEST(test_type_table_growth);
+}
+
+int main() {
+    MU_RUN_SUITE(type_suite);
+    MU_REPORT();
+    return MU_EXIT_CODE;
+}
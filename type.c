@@ -0,0 +1,121 @@
+/*
+ * File: type.c
+ * Description: Implements the hash-consed type table declared in type.h.
+ * Purpose: Interns every Type by its structure so the frontend allocates each distinct type once.
+ */
+
+#include "type.h"
+#include "arena.h"
+#include "debug.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define TYPE_INITIAL_SLOTS 64
+
+// Types outlive any single program, so they get an arena of their own
+static Arena *type_arena = NULL;
+
+// Open-addressed table of canonical types, NULL marks an empty slot
+static Type **slots = NULL;
+static size_t slot_capacity = 0;
+static size_t count = 0;
+// Parser threads share the table
+static pthread_mutex_t type_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static size_t type_hash(TypeKind kind, const Type *base, size_t array_size) {
+    uint64_t h = (uint64_t)kind * 0x9E3779B97F4A7C15ull;
+    h ^= (uint64_t)(uintptr_t)base + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+    h ^= (uint64_t)array_size + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+    return (size_t)h;
+}
+
+static void type_grow_slots(void) {
+    size_t new_capacity = slot_capacity == 0 ? TYPE_INITIAL_SLOTS : slot_capacity * 2;
+    Type **new_slots = calloc(new_capacity, sizeof(Type *));
+    if (!new_slots) {
+        LOG_ERROR("Unable to allocate memory for type table");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < slot_capacity; i++) {
+        Type *t = slots[i];
+        if (!t) continue;
+        size_t j = type_hash(t->kind, t->base, t->array_size) & (new_capacity - 1);
+        while (new_slots[j]) j = (j + 1) & (new_capacity - 1);
+        new_slots[j] = t;
+    }
+    free(slots);
+    slots = new_slots;
+    slot_capacity = new_capacity;
+}
+
+static Type *type_intern(TypeKind kind, Type *base, size_t array_size) {
+    pthread_mutex_lock(&type_lock);
+    // Keep the load factor below one half
+    if ((count + 1) * 2 > slot_capacity) type_grow_slots();
+
+    size_t i = type_hash(kind, base, array_size) & (slot_capacity - 1);
+    while (slots[i]) {
+        Type *t = slots[i];
+        if (t->kind == kind && t->base == base && t->array_size == array_size) {
+            pthread_mutex_unlock(&type_lock);
+            return t;
+        }
+        i = (i + 1) & (slot_capacity - 1);
+    }
+
+    if (!type_arena) type_arena = arena_create();
+    Type *type = arena_alloc(type_arena, sizeof(Type));
+    type->kind = kind;
+    type->base = base;
+    type->array_size = array_size;
+    slots[i] = type;
+    count++;
+    pthread_mutex_unlock(&type_lock);
+    LOG_INFO("Created canonical type %d (base=%p, size=%zu)", kind, (void *)base, array_size);
+    return type;
+}
+
+Type *type_get(TypeKind kind) {
+    if (kind == TYPE_POINTER || kind == TYPE_ARRAY) {
+        LOG_ERROR("type_get called with derived kind %d, use type_pointer or type_array", kind);
+        return NULL;
+    }
+    return type_intern(kind, NULL, 0);
+}
+
+Type *type_pointer(Type *base) {
+    return type_intern(TYPE_POINTER, base, 0);
+}
+
+Type *type_array(Type *base, size_t size) {
+    return type_intern(TYPE_ARRAY, base, size);
+}
+
+size_t type_size(const Type *type) {
+    switch (type->kind) {
+        case TYPE_INT:
+        case TYPE_UNSIGNED: return 4;
+        case TYPE_CHAR: return 1;
+        case TYPE_LONG:
+        case TYPE_UNSIGNED_LONG:
+        case TYPE_LONG_LONG:
+        case TYPE_UNSIGNED_LONG_LONG:
+        case TYPE_POINTER: return 8;
+        case TYPE_ARRAY: return type->array_size * type_size(type->base);
+        default: return 0;
+    }
+}
+
+size_t type_count(void) {
+    return count;
+}
+
+void type_reset(void) {
+    arena_destroy(type_arena);
+    type_arena = NULL;
+    free(slots);
+    slots = NULL;
+    slot_capacity = 0;
+    count = 0;
+}
@@ -0,0 +1,56 @@
+/*
+ * File: type.h
+ * Description: Declares the C type representation and the canonical type table.
+ * Purpose: Hands out one shared Type object per distinct type, so types can be compared
+ *          and hashed by pointer.
+ */
+
+#ifndef TYPE_H
+#define TYPE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef enum {
+    TYPE_INT,
+    TYPE_CHAR,
+    TYPE_VOID,
+    TYPE_POINTER,
+    TYPE_ARRAY,
+    // Only integer constants have these, typed by their value and suffix as C23 does
+    TYPE_UNSIGNED,
+    TYPE_LONG,
+    TYPE_UNSIGNED_LONG,
+    TYPE_LONG_LONG,
+    TYPE_UNSIGNED_LONG_LONG
+} TypeKind;
+
+// Types are canonical and shared; never modify one after it has been handed out
+typedef struct Type {
+    TypeKind kind;
+    struct Type *base; // For pointer/array types
+    size_t array_size; // For array types
+} Type;
+
+/* Canonical constructors: structurally equal types return the same pointer */
+Type *type_get(TypeKind kind);               // Any kind but pointer and array
+Type *type_pointer(Type *base);
+Type *type_array(Type *base, size_t size);
+
+static inline bool type_equal(const Type *a, const Type *b) {
+    return a == b;
+}
+
+static inline bool type_is_unsigned(const Type *type) {
+    return type->kind == TYPE_UNSIGNED || type->kind == TYPE_UNSIGNED_LONG || type->kind == TYPE_UNSIGNED_LONG_LONG;
+}
+
+// Bytes an object of the type takes on the LP64 targets we generate for; 0 for void and unsized arrays
+size_t type_size(const Type *type);
+
+size_t type_count(void);  // Number of distinct types created so far
+
+/* Release every canonical type; all Type pointers handed out before become invalid */
+void type_reset(void);
+
+#endif // TYPE_H